@@ -0,0 +1,98 @@
+/**
+ * @file ActivitySummary.h
+ * @brief Per-interval activity summary of the IMU stream for B.R.A.V.O. collars
+ *
+ * Every IMU sample is folded into a running summary of the current report
+ * interval: a histogram of the activity level, the time spent resting,
+ * walking and running, the peak acceleration and the number of motion
+ * events and steps. The uplink carries the summary instead of a single
+ * instantaneous sample, then starts the next interval.
+ *
+ * Everything is updated incrementally in fixed memory; no samples are kept.
+ */
+
+#ifndef ACTIVITY_SUMMARY_H
+#define ACTIVITY_SUMMARY_H
+
+#include <Arduino.h>
+#include "IMU.h"
+
+// Activity level histogram: 0-9, 10-19, ... 90-100
+#define ACTIVITY_HISTOGRAM_BINS     10
+
+// Gait buckets on the smoothed dynamic acceleration (|a| - g, m/s²)
+#define ACTIVITY_REST_MAX           0.5f
+#define ACTIVITY_WALK_MAX           3.0f
+#define ACTIVITY_SMOOTH_ALPHA       0.3f
+
+// Gaps between samples longer than this are credited at most this long
+#define ACTIVITY_MAX_SAMPLE_GAP_MS  1000
+
+enum ActivityClass {
+    ACTIVITY_REST,
+    ACTIVITY_WALK,
+    ACTIVITY_RUN,
+    ACTIVITY_CLASS_COUNT
+};
+
+struct ActivitySummaryData {
+    uint32_t startMs;           // Start of the interval (millis())
+    uint32_t durationMs;
+    uint32_t samples;
+    uint32_t histogram[ACTIVITY_HISTOGRAM_BINS];  // Samples per activity-level bin
+    uint32_t classMs[ACTIVITY_CLASS_COUNT];       // Time in rest/walk/run
+    float peakAccel;            // Largest |a| (m/s²)
+    uint16_t motionEvents;      // Rest to walk/run transitions
+    uint16_t steps;
+    uint8_t meanActivity;       // Mean activity level (0-100)
+};
+
+class ActivitySummary {
+public:
+    /**
+     * @brief Constructor for ActivitySummary
+     */
+    ActivitySummary();
+
+    /**
+     * @brief Start a new interval
+     * @param nowMs Start time (millis())
+     */
+    void reset(uint32_t nowMs);
+
+    /**
+     * @brief Fold one IMU sample into the current interval
+     * @param sample IMU sample (m/s², millis() timestamp)
+     * @param activityLevel Activity level of the sample (0-100)
+     */
+    void addSample(const IMUData& sample, uint8_t activityLevel);
+
+    /**
+     * @brief Count a step detected in the current interval
+     */
+    void addStep();
+
+    /**
+     * @brief Get the summary of the current interval so far
+     * @param nowMs Current time (millis())
+     * @return ActivitySummaryData structure
+     */
+    ActivitySummaryData getSummary(uint32_t nowMs);
+
+    /**
+     * @brief Get the gait bucket of the latest sample
+     * @return ActivityClass of the smoothed acceleration
+     */
+    ActivityClass getCurrentClass();
+
+private:
+    ActivitySummaryData summary;
+    uint32_t activitySum;
+
+    float smoothedDynamic;
+    ActivityClass currentClass;
+    uint32_t lastSampleMs;
+    bool hasSample;
+};
+
+#endif // ACTIVITY_SUMMARY_H
@@ -11,21 +11,121 @@
 
 #include <Arduino.h>
 #include <NimBLEDevice.h>
+#include "Role.h"
+#if BRAVO_ROLE_COLLAR
+#include "DataLog.h"
+#include "IMUStream.h"
+#endif
 
 // BLE Service and Characteristic UUIDs
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CONFIG_UUID         "beb5483e-36e1-4688-b7f5-ea07361b26a8"
 #define STATUS_UUID         "1c95d5e3-d8f7-413a-bf3d-7a2e5d7be87e"
 #define COMMAND_UUID        "d8de624e-140f-4a22-8594-e2216b84a5f2"
+#define BULK_DATA_UUID      "6e1d7a40-3b1c-4f0e-9a55-2f4a8c1e7b01"
+#define BULK_CTRL_UUID      "6e1d7a40-3b1c-4f0e-9a55-2f4a8c1e7b02"
+#define IMU_STREAM_UUID     "6e1d7a40-3b1c-4f0e-9a55-2f4a8c1e7b03"
+
+// Bulk transfer settings
+#define BLE_PREFERRED_MTU       517   // Largest ATT MTU; phones negotiate down
+#define BLE_DATA_LEN_OCTETS     251   // LL data length extension payload
+#define BULK_DEFAULT_WINDOW     16    // Notifications in flight before an ACK
+#define BULK_MAX_WINDOW         64
+#define BULK_HEADER_SIZE        4     // uint32 offset prefix on every chunk
+
+// Live IMU stream notifications sent per update() call
+#define IMU_STREAM_SENDS_PER_UPDATE 2
+
+// Advertising and connection power policy
+#define BLE_FAST_ADV_WINDOW     30000   // ms of fast advertising after boot/wake
+#define BLE_FAST_ADV_INTERVAL   160     // 100 ms (0.625 ms units)
+#define BLE_SLOW_ADV_INTERVAL   2056    // 1285 ms
+#define BLE_IDLE_CONN_MIN       80      // 100 ms (1.25 ms units)
+#define BLE_IDLE_CONN_MAX       160     // 200 ms
+#define BLE_IDLE_CONN_LATENCY   4       // Events the collar may skip when idle
+#define BLE_FAST_CONN_MIN       6       // 7.5 ms
+#define BLE_FAST_CONN_MAX       12      // 15 ms
+#define BLE_CONN_TIMEOUT        600     // 6 s (10 ms units)
+
+// Radio cost model for power accounting
+#define BLE_ADV_EVENT_US        1500    // 3 channels TX + scan request window
+#define BLE_ADV_DELAY_US        5000    // Mean random advDelay added per event
+#define BLE_CONN_EVENT_US       400     // Empty connection event (RX + TX)
+#define BLE_BYTE_AIRTIME_US     8       // 1M PHY (conservative if 2M is used)
+#define BLE_RADIO_CURRENT_MA    100.0f  // ESP32 radio TX/RX current
+
+// Bulk control opcodes (client -> collar on BULK_CTRL_UUID)
+#define BULK_OP_START   0x01  // uint32 offset, uint8 window
+#define BULK_OP_ACK     0x02  // uint32 offset: all bytes below received
+#define BULK_OP_STOP    0x03
+
+// Bulk control responses (collar -> client, notified on BULK_CTRL_UUID)
+#define BULK_RSP_STARTED    0x81  // uint32 start, uint32 end, uint16 chunk size
+#define BULK_RSP_DONE       0x82  // uint32 bytes, uint32 elapsed ms, uint32 bytes/s
+
+// Operator-selected power modes
+enum PowerMode : uint8_t {
+    POWER_MODE_NORMAL = 0,
+    POWER_MODE_ECO = 1,         // GPS/telemetry intervals x3
+    POWER_MODE_SURVIVAL = 2     // Intervals x10, BLE advertising off
+};
 
 struct BLEConfigData {
-    uint16_t loraFrequency;
-    uint8_t loraPower;
-    uint16_t gpsInterval;
-    uint16_t telemetryInterval;
+    uint16_t loraFrequency;       // MHz
+    uint8_t loraPower;            // dBm
+    uint8_t loraSpreadingFactor;
+    uint16_t loraBandwidth;       // kHz (62 = 62.5 kHz)
+    uint32_t gpsInterval;         // ms
+    uint32_t telemetryInterval;   // ms
+    uint8_t powerMode;            // PowerMode
+    uint8_t trackTolerance;       // m a dropped fix may be off the track (0 = keep all)
+    uint8_t relayMode;            // 1 = forward other collars' uplinks (see Relay.h)
     char deviceName[32];
 };
 
+// Called from BLEConfig::update() after a valid config write
+typedef void (*ConfigChangedCallback)(const BLEConfigData& config);
+
+// Called from BLEConfig::update() with each write to COMMAND_UUID
+typedef void (*CommandCallback)(const uint8_t* data, size_t length);
+
+// Commands written to COMMAND_UUID (first byte)
+#define BLE_CMD_DOWNLINK    0x01  // u8 name length, name ("*" = herd), DL command
+#define BLE_CMD_STATUS      0x02  // Request a timing/energy status report
+#define BLE_CMD_TRACE       0x03  // Dump the trace ring as status notifications
+#define BLE_CMD_RECORD      0x04  // u8 mode: 0 stop, 1 record to flash, 2 to serial
+#define BLE_CMD_GEOFENCE    0x05  // GEOFENCE_OP_* command (see Geofence.h)
+#define BLE_CMD_HISTORY     0x06  // Dongle: u8 name length, name, u8 mode, args (TimeSeriesStore.h)
+#define BLE_CMD_PROXIMITY   0x07  // Dongle: u8 mode, i32 lat, i32 lon (1e-7), u16 m or k
+#define BLE_CMD_LATENCY     0x08  // Dongle: report latency percentiles per collar
+
+enum BLEPowerState {
+    BLE_STATE_ADV_FAST,     // Advertising quickly after boot or a wake event
+    BLE_STATE_ADV_SLOW,     // Advertising at the slow interval
+    BLE_STATE_CONN_IDLE,    // Connected, long interval with slave latency
+    BLE_STATE_CONN_BULK,    // Connected, short interval for a bulk transfer
+    BLE_STATE_COUNT
+};
+
+struct BLEStateStats {
+    uint32_t timeMs;        // Time spent in this state
+    float radioOnMs;        // Estimated radio-on time
+    float avgCurrentMa;     // Estimated average radio current in this state
+};
+
+#if BRAVO_ROLE_COLLAR
+struct BulkTransferStats {
+    bool active;
+    uint32_t startOffset;     // first offset of the current/last transfer
+    uint32_t endOffset;       // log end captured when the transfer started
+    uint32_t bytesSent;       // including retransmissions after a resume
+    uint32_t bytesAcked;
+    uint32_t elapsedMs;
+    float throughputKBps;     // acked bytes per second / 1000
+    uint16_t mtu;
+};
+#endif
+
 class BLEConfig {
 public:
     /**
@@ -51,6 +151,12 @@ public:
      */
     bool isConnected();
 
+    /**
+     * @brief Get largest notification payload for the current connection
+     * @return Bytes that fit in one notification (ATT MTU - 3)
+     */
+    size_t getMaxNotifySize();
+
     /**
      * @brief Get configuration data
      * @return BLEConfigData structure
@@ -63,33 +169,167 @@ public:
      */
     void setConfig(const BLEConfigData& config);
 
+    /**
+     * @brief Set callback invoked when a client writes a valid config
+     * @param callback Function to call from update() (nullptr to disable)
+     */
+    void setConfigCallback(ConfigChangedCallback callback);
+
+    /**
+     * @brief Set callback invoked for each command written by a client
+     * @param callback Function to call from update() (nullptr to disable)
+     */
+    void setCommandCallback(CommandCallback callback);
+
     /**
      * @brief Send status update to connected client
      * @param status Status string to send
      */
-    void sendStatus(const String& status);
+    void sendStatus(const char* status);
 
     /**
-     * @brief Start BLE advertising
+     * @brief Start BLE advertising (fast, then slow)
      */
     void startAdvertising();
 
     /**
-     * @brief Stop BLE advertising
+     * @brief Stop BLE advertising until startAdvertising() is called
      */
     void stopAdvertising();
 
+    /**
+     * @brief Re-open the fast advertising window (button or motion event)
+     */
+    void wake();
+
+    /**
+     * @brief Check if advertising is enabled (see stopAdvertising())
+     * @return true if enabled, false otherwise
+     */
+    bool isAdvertisingEnabled();
+
+    /**
+     * @brief Get current advertising/connection power state
+     * @return BLEPowerState
+     */
+    BLEPowerState getPowerState();
+
+    /**
+     * @brief Get radio-on time and current estimate for a power state
+     * @param state Power state to query
+     * @return BLEStateStats structure
+     */
+    BLEStateStats getPowerStats(BLEPowerState state);
+
+#if BRAVO_ROLE_COLLAR
+    /**
+     * @brief Set data log served by the bulk transfer characteristic
+     * @param log DataLog to stream (nullptr disables bulk transfer)
+     */
+    void setBulkSource(DataLog* log);
+
+    /**
+     * @brief Check if a bulk transfer is in progress
+     * @return true if transfer active, false otherwise
+     */
+    bool isBulkActive();
+
+    /**
+     * @brief Get statistics of the current or last bulk transfer
+     * @return BulkTransferStats structure
+     */
+    BulkTransferStats getBulkStats();
+
+    /**
+     * @brief Set IMU stream served while a client is subscribed
+     * @param stream IMUStream to drain (nullptr disables streaming)
+     */
+    void setStreamSource(IMUStream* stream);
+
+    /**
+     * @brief Check if a client is subscribed to the live IMU stream
+     * @return true if streaming, false otherwise
+     */
+    bool isStreaming();
+#endif
+
 private:
     BLEServer* pServer;
     BLEService* pService;
     BLECharacteristic* pConfigCharacteristic;
     BLECharacteristic* pStatusCharacteristic;
     BLECharacteristic* pCommandCharacteristic;
+#if BRAVO_ROLE_COLLAR
+    BLECharacteristic* pBulkDataCharacteristic;
+    BLECharacteristic* pBulkCtrlCharacteristic;
+    BLECharacteristic* pStreamCharacteristic;
+#endif
     BLEConfigData config;
+    ConfigChangedCallback configCallback;
+    CommandCallback commandCallback;
     bool initialized;
     bool clientConnected;
+    uint16_t connHandle;
+    uint16_t peerMTU;
+
+    // Power policy state
+    BLEPowerState powerState;
+    BLEStateStats powerStats[BLE_STATE_COUNT];
+    bool advertisingEnabled;
+    uint32_t fastAdvStart;
+    uint32_t powerLastUpdate;
+    uint32_t txBytes;             // Notification bytes since last accounting
+    uint16_t advInterval;         // 0.625 ms units
+    uint16_t connInterval;        // 1.25 ms units
+    uint16_t connLatency;
+
+#if BRAVO_ROLE_COLLAR
+    // Bulk transfer state (commands arrive on the BLE host task)
+    DataLog* bulkSource;
+    BulkTransferStats bulkStats;
+    uint32_t bulkNextOffset;
+    uint32_t bulkStartTime;
+    uint8_t bulkWindow;
+    volatile uint32_t bulkAckOffset;
+    volatile uint32_t bulkRequestOffset;
+    volatile uint8_t bulkRequestWindow;
+    volatile uint8_t bulkPendingOp;
+
+    // Live IMU stream state
+    IMUStream* streamSource;
+    volatile bool streamSubscribed;
+    volatile uint16_t streamRequestRate;
+    uint8_t notifyBuffer[BLE_PREFERRED_MTU];
+#endif
+
+    // Config writes are decoded in update(), off the BLE host task
+    uint8_t configWriteBuffer[BLE_PREFERRED_MTU];
+    volatile size_t configWriteLength;
+    volatile bool configWritePending;
+    uint8_t commandBuffer[BLE_PREFERRED_MTU];
+    volatile size_t commandLength;
+    volatile bool commandPending;
+
+#if BRAVO_ROLE_COLLAR
+    void processBulkCommand();
+    void pumpBulkTransfer();
+    void finishBulkTransfer();
+    size_t getBulkChunkSize();
+    void pumpStream();
+#endif
+    void processConfigWrite();
+    void refreshConfigValue();
+    void updatePowerState();
+    void applyPowerState(BLEPowerState state);
+    void accountPower();
 
     class ServerCallbacks;
+#if BRAVO_ROLE_COLLAR
+    class BulkCallbacks;
+    class StreamCallbacks;
+#endif
+    class ConfigCallbacks;
+    class CommandCallbacks;
 };
 
 #endif // BLE_CONFIG_H
@@ -0,0 +1,152 @@
+/**
+ * @file BatteryMonitor.h
+ * @brief Battery voltage, state of charge and power tiers for B.R.A.V.O. collars
+ *
+ * Each update averages an oversampled burst of calibrated ADC readings
+ * (trimming the extremes), smooths it with a first-order IIR filter, and maps
+ * the filtered voltage onto a LiPo discharge curve. As the charge falls the
+ * monitor steps down through power tiers, which the firmware applies on top
+ * of the configured power mode so the collar degrades gracefully instead of
+ * dying mid-deployment.
+ */
+
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <Arduino.h>
+#include "hal/HAL.h"
+
+// Battery sense for ESP32 (used to construct Esp32Battery): GPIO35 is ADC1
+// channel 7, behind a 2 x 100k divider on most boards
+#define BATTERY_ADC_CHANNEL     ADC1_CHANNEL_7
+#define BATTERY_DIVIDER_RATIO   2.0f
+
+// Samples per update; the highest and lowest are dropped
+#define BATTERY_OVERSAMPLE      16
+
+// IIR weight of each new update (lower = smoother, slower)
+#define BATTERY_FILTER_ALPHA    0.2f
+
+// Below this the sense input is floating (no battery or no divider fitted)
+#define BATTERY_PRESENT_MIN_MV  2500
+
+#ifndef BATTERY_CAPACITY_MAH
+#define BATTERY_CAPACITY_MAH    2000
+#endif
+
+// Board draw at idle, not covered by the profiler's current model
+#ifndef BATTERY_IDLE_MA
+#define BATTERY_IDLE_MA         30.0f
+#endif
+
+// Charge at which each tier starts; a tier is only left again once the
+// charge is BATTERY_TIER_HYSTERESIS above its threshold
+#define BATTERY_ECO_PERCENT         30
+#define BATTERY_SURVIVAL_PERCENT    10
+#define BATTERY_TIER_HYSTERESIS     5
+
+// Same order and meaning as PowerMode, so a tier can be used as a floor
+enum BatteryTier : uint8_t {
+    BATTERY_TIER_NORMAL = 0,
+    BATTERY_TIER_ECO = 1,
+    BATTERY_TIER_SURVIVAL = 2
+};
+
+struct BatteryStatus {
+    bool present;
+    uint16_t millivolts;        // Filtered
+    uint8_t percent;            // State of charge
+    BatteryTier tier;
+    float runtimeHours;         // Predicted remaining runtime (-1 if unknown)
+};
+
+class BatteryMonitor {
+public:
+    /**
+     * @brief Constructor for BatteryMonitor
+     * @param sensor Voltage sense input
+     */
+    BatteryMonitor(BatteryHAL& sensor);
+
+    /**
+     * @brief Initialize the input and take the first reading
+     * @return true if initialized, false otherwise
+     */
+    bool begin();
+
+    /**
+     * @brief Sample the battery and update charge and tier
+     * @return true if the tier changed, false otherwise
+     */
+    bool update();
+
+    /**
+     * @brief Check if a battery is sensed
+     * @return true if the voltage is plausible, false otherwise
+     */
+    bool isPresent();
+
+    /**
+     * @brief Get filtered battery voltage
+     * @return Voltage in millivolts
+     */
+    uint16_t getMillivolts();
+
+    /**
+     * @brief Get state of charge
+     * @return Charge percentage 0-100 (100 when no battery is sensed)
+     */
+    uint8_t getPercent();
+
+    /**
+     * @brief Get current power tier
+     * @return BatteryTier
+     */
+    BatteryTier getTier();
+
+    /**
+     * @brief Predict remaining runtime
+     * @param activeMa Average draw above idle (Profiler energy avgCurrentMa)
+     * @return Hours until empty, or -1 if no battery is sensed
+     */
+    float getRuntimeHours(float activeMa);
+
+    /**
+     * @brief Get a snapshot of the battery state
+     * @param activeMa Average draw above idle, for the runtime prediction
+     * @return BatteryStatus structure
+     */
+    BatteryStatus getStatus(float activeMa);
+
+    /**
+     * @brief Set the battery capacity
+     * @param capacityMAh Rated capacity in mAh
+     */
+    void setCapacity(uint16_t capacityMAh);
+
+    /**
+     * @brief Map a resting LiPo cell voltage to state of charge
+     * @param millivolts Cell voltage
+     * @return Charge percentage 0-100
+     */
+    static uint8_t percentFromMillivolts(uint16_t millivolts);
+
+    /**
+     * @brief Get the name of a tier
+     * @param tier Tier
+     * @return Tier name
+     */
+    static const char* tierName(BatteryTier tier);
+
+private:
+    BatteryHAL& sensor;
+    float filteredMv;
+    uint8_t percent;
+    BatteryTier tier;
+    uint16_t capacityMAh;
+
+    uint32_t sample();
+    BatteryTier tierFor(uint8_t percent);
+};
+
+#endif // BATTERY_MONITOR_H
@@ -0,0 +1,124 @@
+/**
+ * @file ConfigStore.h
+ * @brief Binary configuration format and NVS persistence for B.R.A.V.O. devices
+ *
+ * Configuration is exchanged and stored as a version byte followed by TLV
+ * (tag, length, value) entries. A write may carry any subset of tags, so
+ * small changes stay small over BLE and LoRa; unknown tags are skipped so
+ * older firmware accepts newer configs.
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "BLEConfig.h"
+
+// Format version (first byte of every encoded config)
+#define CONFIG_FORMAT_VERSION   1
+#define CONFIG_MAX_ENCODED_SIZE 96
+
+// NVS location
+#define CONFIG_NVS_NAMESPACE    "bravo"
+#define CONFIG_NVS_KEY          "config"
+
+// TLV tags (values are little-endian)
+enum ConfigTag : uint8_t {
+    CFG_TAG_LORA_FREQUENCY     = 0x01,  // u16 MHz
+    CFG_TAG_LORA_POWER         = 0x02,  // u8 dBm
+    CFG_TAG_LORA_SF            = 0x03,  // u8 spreading factor
+    CFG_TAG_LORA_BANDWIDTH     = 0x04,  // u16 kHz
+    CFG_TAG_GPS_INTERVAL       = 0x05,  // u32 ms
+    CFG_TAG_TELEMETRY_INTERVAL = 0x06,  // u32 ms
+    CFG_TAG_DEVICE_NAME        = 0x07,  // UTF-8, no terminator
+    CFG_TAG_POWER_MODE         = 0x08,  // u8 PowerMode
+    CFG_TAG_TRACK_TOLERANCE    = 0x09,  // u8 m
+    CFG_TAG_RELAY_MODE         = 0x0A   // u8 0/1
+};
+
+// Accepted ranges
+#define CFG_LORA_POWER_MIN      2
+#define CFG_LORA_POWER_MAX      20
+#define CFG_LORA_SF_MIN         6
+#define CFG_LORA_SF_MAX         12
+#define CFG_GPS_INTERVAL_MIN    1000
+#define CFG_GPS_INTERVAL_MAX    3600000
+#define CFG_TELEMETRY_MIN       2000
+#define CFG_TELEMETRY_MAX       3600000
+#define CFG_TRACK_TOLERANCE_MAX 100
+
+class ConfigStore {
+public:
+    /**
+     * @brief Constructor for ConfigStore
+     */
+    ConfigStore();
+
+    /**
+     * @brief Load persisted configuration from NVS
+     * @param config Configuration to update (left untouched on failure)
+     * @return true if a valid stored config was applied, false otherwise
+     */
+    bool load(BLEConfigData& config);
+
+    /**
+     * @brief Persist configuration to NVS (skipped if unchanged)
+     * @param config Configuration to store
+     * @return true if stored config matches, false otherwise
+     */
+    bool save(const BLEConfigData& config);
+
+    /**
+     * @brief Erase the persisted configuration
+     */
+    void reset();
+
+    /**
+     * @brief Load a module's persisted state from the config namespace
+     * @param key NVS key
+     * @param buffer Buffer to fill
+     * @param maxLength Buffer size
+     * @return Stored length, or 0 if there is none
+     */
+    size_t loadBlob(const char* key, uint8_t* buffer, size_t maxLength);
+
+    /**
+     * @brief Persist a module's state in the config namespace
+     * @param key NVS key
+     * @param data Bytes to store (length 0 removes the key)
+     * @param length Number of bytes
+     * @return true if stored, false otherwise
+     */
+    bool saveBlob(const char* key, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Encode a full configuration
+     * @param config Configuration to encode
+     * @param buffer Buffer to store encoded bytes
+     * @param maxLength Buffer size
+     * @return Encoded length, or 0 if the buffer is too small
+     */
+    static size_t encode(const BLEConfigData& config, uint8_t* buffer, size_t maxLength);
+
+    /**
+     * @brief Decode a (possibly partial) configuration on top of an existing one
+     * @param data Encoded bytes
+     * @param length Encoded length
+     * @param config Configuration to update; only changed if everything is valid
+     * @return true if decoded and valid, false otherwise
+     */
+    static bool decode(const uint8_t* data, size_t length, BLEConfigData& config);
+
+    /**
+     * @brief Check configuration values against accepted ranges
+     * @param config Configuration to check
+     * @return true if valid, false otherwise
+     */
+    static bool validate(const BLEConfigData& config);
+
+private:
+    Preferences prefs;
+};
+
+#endif // CONFIG_STORE_H
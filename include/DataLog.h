@@ -0,0 +1,134 @@
+/**
+ * @file DataLog.h
+ * @brief On-device data log for B.R.A.V.O. collar fixes and IMU samples
+ *
+ * This module stores GPS fixes and IMU samples as packed binary records in a
+ * fixed-size RAM ring so they can be pulled to the phone later (see the bulk
+ * transfer characteristic in BLEConfig). Records are addressed by a
+ * monotonically increasing byte offset, which lets a client resume a download
+ * from the last offset it received.
+ */
+
+#ifndef DATA_LOG_H
+#define DATA_LOG_H
+
+#include <Arduino.h>
+#include "GPS.h"
+#include "IMU.h"
+
+// Log capacity in bytes (override with -D DATALOG_CAPACITY=...)
+#ifndef DATALOG_CAPACITY
+#define DATALOG_CAPACITY    (32 * 1024)
+#endif
+
+// Record types
+enum DataLogRecordType : uint8_t {
+    LOG_RECORD_GPS = 1,  // DataLogGPSRecord
+    LOG_RECORD_IMU = 2,  // IMURawSample
+    LOG_RECORD_TIME = 3  // DataLogTimeRecord
+};
+
+// Every record starts with this header, followed by `length` payload bytes
+struct __attribute__((packed)) DataLogRecordHeader {
+    uint8_t type;
+    uint8_t length;
+    uint32_t timestamp;  // millis() when the sample was taken
+};
+
+struct __attribute__((packed)) DataLogGPSRecord {
+    int32_t latitude;    // 1e-7 degrees
+    int32_t longitude;   // 1e-7 degrees
+    int32_t altitude;    // centimetres
+    uint16_t speed;      // cm/s
+    uint16_t course;     // centidegrees
+    uint8_t satellites;
+    uint8_t hdop;        // tenths, saturated at 25.5
+};
+
+// Pins the millis() timestamps around it to UTC: logged when time is first
+// known, after a clock step and periodically (millis() restarts on reboot)
+struct __attribute__((packed)) DataLogTimeRecord {
+    uint64_t unixMs;     // UTC at the header's timestamp
+};
+
+class DataLog {
+public:
+    /**
+     * @brief Constructor for DataLog
+     */
+    DataLog();
+
+    /**
+     * @brief Append a GPS fix to the log
+     * @param data GPS data structure (invalid fixes are skipped)
+     * @return true if the record was stored, false otherwise
+     */
+    bool logGPS(const GPSData& data);
+
+    /**
+     * @brief Append an IMU sample to the log
+     * @param data IMU data structure
+     * @return true if the record was stored, false otherwise
+     */
+    bool logIMU(const IMUData& data);
+
+    /**
+     * @brief Append a time record tying millis() to UTC
+     * @param unixMs Milliseconds since 1970-01-01 UTC at the current millis()
+     * @return true if the record was stored, false otherwise
+     */
+    bool logTime(uint64_t unixMs);
+
+    /**
+     * @brief Append a raw record, evicting the oldest records if needed
+     * @param type Record type
+     * @param timestamp Sample timestamp
+     * @param payload Record payload
+     * @param length Payload length
+     * @return true if the record was stored, false otherwise
+     */
+    bool append(uint8_t type, uint32_t timestamp, const void* payload, uint8_t length);
+
+    /**
+     * @brief Read raw log bytes starting at an absolute offset
+     * @param offset Absolute byte offset (must be >= getStartOffset())
+     * @param buffer Buffer to store data
+     * @param maxLength Maximum number of bytes to read
+     * @return Number of bytes read (0 if offset is out of range)
+     */
+    size_t read(uint32_t offset, uint8_t* buffer, size_t maxLength);
+
+    /**
+     * @brief Get offset of the oldest record still held in the log
+     * @return Absolute byte offset
+     */
+    uint32_t getStartOffset();
+
+    /**
+     * @brief Get offset one past the newest record
+     * @return Absolute byte offset
+     */
+    uint32_t getEndOffset();
+
+    /**
+     * @brief Get number of records currently held
+     * @return Record count
+     */
+    uint32_t getRecordCount();
+
+    /**
+     * @brief Discard all records (offsets keep increasing)
+     */
+    void clear();
+
+private:
+    uint8_t buffer[DATALOG_CAPACITY];
+    uint32_t head;     // absolute offset of next write
+    uint32_t tail;     // absolute offset of oldest record
+    uint32_t records;
+
+    void copyIn(uint32_t offset, const void* src, size_t length);
+    void copyOut(uint32_t offset, void* dst, size_t length);
+};
+
+#endif // DATA_LOG_H
@@ -0,0 +1,157 @@
+/**
+ * @file DeadReckoning.h
+ * @brief GPS/IMU dead reckoning between sparse fixes for B.R.A.V.O. collars
+ *
+ * A Madgwick orientation filter runs on every IMU sample and gives the
+ * collar's yaw; steps are detected as peaks in the dynamic acceleration.
+ * Each step moves the position estimate one stride along the heading.
+ *
+ * GPS fixes correct the estimate (weighted by the fix and dead-reckoning
+ * uncertainties) and calibrate the model. The yaw-to-bearing offset and the
+ * stride length are learned from the displacement between fixes, so neither
+ * the collar's mounting nor the animal's gait needs to be known. Every
+ * estimate carries an uncertainty radius that grows with the distance
+ * walked since the last fix.
+ */
+
+#ifndef DEAD_RECKONING_H
+#define DEAD_RECKONING_H
+
+#include <Arduino.h>
+#include "GPS.h"
+#include "IMU.h"
+
+// Orientation filter gain (accelerometer correction of the gyro)
+#define DR_MADGWICK_BETA            0.1f
+
+// Step detection on |a| - its running mean (m/s²)
+#define DR_STEP_THRESHOLD           1.2f
+#define DR_STEP_MIN_INTERVAL_MS     250     // Fastest gait considered
+#define DR_ACCEL_MEAN_ALPHA         0.05f
+
+// Stride length (m), learned between fixes
+#define DR_DEFAULT_STRIDE_M         0.7f
+#define DR_STRIDE_MIN_M             0.2f
+#define DR_STRIDE_MAX_M             2.5f
+
+// Calibration needs this many steps and metres between two fixes
+#define DR_CALIBRATION_STEPS        8
+#define DR_CALIBRATION_MIN_M        10.0f
+#define DR_CALIBRATION_GAIN         0.3f    // Weight of each new estimate
+
+// Uncertainty model
+#define DR_FIX_SIGMA_PER_HDOP       2.5f    // m per unit of HDOP
+#define DR_STRIDE_SIGMA             0.15f   // Relative error of one stride
+#define DR_HEADING_SIGMA_RAD        0.2f    // Once calibrated (~11 degrees)
+#define DR_HEADING_DRIFT_RAD_S      0.002f  // Yaw drift of an uncorrected gyro
+#define DR_RESET_SIGMAS             3.0f    // A fix this far off replaces the estimate
+
+// Samples further apart restart the orientation filter's integration step
+#define DR_MAX_SAMPLE_GAP_MS        500
+
+struct DeadReckoningEstimate {
+    bool valid;                 // false until the first fix
+    double latitude;
+    double longitude;
+    float uncertaintyM;         // About one standard deviation, in metres
+    uint16_t steps;             // Steps since the last fix
+    uint32_t ageMs;             // Time since the last fix
+};
+
+struct DeadReckoningStats {
+    uint32_t samples;           // IMU samples filtered
+    uint32_t steps;
+    uint32_t fixes;             // Fixes used for correction
+    uint32_t calibrations;      // Fixes that updated stride and heading
+    float strideM;
+    float headingOffsetDeg;     // Bearing minus filter yaw
+    float lastCorrectionM;      // Distance the last fix moved the estimate
+};
+
+class DeadReckoning {
+public:
+    /**
+     * @brief Constructor for DeadReckoning
+     */
+    DeadReckoning();
+
+    /**
+     * @brief Forget position, orientation and calibration
+     */
+    void reset();
+
+    /**
+     * @brief Run the orientation filter and step detector on one sample
+     * @param sample IMU sample (m/s², rad/s, millis() timestamp)
+     * @return true if the sample completed a step, false otherwise
+     */
+    bool updateImu(const IMUData& sample);
+
+    /**
+     * @brief Correct the estimate with a GPS fix
+     * @param fix GPS fix (ignored unless valid and newer than the last one)
+     * @return true if the fix was used, false otherwise
+     */
+    bool updateFix(const GPSData& fix);
+
+    /**
+     * @brief Get the current position estimate
+     * @return DeadReckoningEstimate structure
+     */
+    DeadReckoningEstimate getEstimate();
+
+    /**
+     * @brief Get filter yaw (counter-clockwise, arbitrary zero)
+     * @return Yaw in radians
+     */
+    float getYaw();
+
+    /**
+     * @brief Get filter and calibration statistics
+     * @return DeadReckoningStats structure
+     */
+    DeadReckoningStats getStats();
+
+private:
+    // Orientation (sensor to earth quaternion)
+    float q0, q1, q2, q3;
+    uint32_t lastSampleMs;
+    bool hasSample;
+
+    // Step detection
+    float accelMean;
+    bool stepArmed;
+    uint32_t lastStepMs;
+
+    // Position: metres east/north of the origin (the last corrected fix)
+    bool hasOrigin;
+    double originLat;
+    double originLon;
+    float east;
+    float north;
+    float originSigmaM;
+    uint32_t originMs;
+
+    // Since the last fix
+    uint16_t steps;
+    float walkedM;
+    float yawSin;               // Sum of sin/cos of the yaw at each step
+    float yawCos;
+    double lastFixLat;          // Raw fix, for calibration
+    double lastFixLon;
+    uint32_t lastFixMs;
+
+    // Calibration
+    float strideM;
+    float headingOffset;        // Bearing = headingOffset - yaw
+    bool headingKnown;
+
+    DeadReckoningStats stats;
+
+    void madgwick(float gx, float gy, float gz, float ax, float ay, float az, float dt);
+    void advance(float yaw);
+    float uncertainty(uint32_t now);
+    float metresPerDegreeLon(double latitude);
+};
+
+#endif // DEAD_RECKONING_H
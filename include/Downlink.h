@@ -0,0 +1,197 @@
+/**
+ * @file Downlink.h
+ * @brief Remote configuration downlink from dongle to collars
+ *
+ * The dongle queues compact binary commands per collar. A collar only
+ * listens for a short window right after each of its own uplinks, so the
+ * dongle sends queued commands as soon as it hears that collar. Commands
+ * carry absolute values and a sequence number, making them idempotent: a
+ * collar re-acknowledges a repeated frame without applying it twice.
+ */
+
+#ifndef DOWNLINK_H
+#define DOWNLINK_H
+
+#include <Arduino.h>
+
+// Frame layout
+#define FRAME_MAGIC             0xB7
+#define FRAME_TYPE_DOWNLINK     0x01
+#define FRAME_TYPE_ACK          0x02
+#define DOWNLINK_MAX_PAYLOAD    96
+#define DOWNLINK_MAX_FRAME      (sizeof(DownlinkHeader) + DOWNLINK_MAX_PAYLOAD)
+
+// Collar RX window opened after each uplink
+#define DOWNLINK_RX_WINDOW_MS   500
+
+// Dongle queue size
+#define DOWNLINK_MAX_COLLARS    64
+
+// Commands (u8 opcode, u8 length, payload)
+#define DL_CMD_CONFIG           0x01  // ConfigStore TLV (intervals, PHY, power mode)
+#define DL_CMD_PHY_PROFILE      0x02  // u8 LoRaPhyProfile
+#define DL_CMD_POWER_MODE       0x03  // u8 PowerMode
+#define DL_CMD_GEOFENCE         0x04  // Geofence update (see README)
+
+// Per-command result codes carried in the ACK payload
+#define DL_STATUS_OK            0x00
+#define DL_STATUS_REJECTED      0x01
+#define DL_STATUS_UNSUPPORTED   0x02
+
+// Preset LoRa PHY settings
+enum LoRaPhyProfile : uint8_t {
+    PHY_PROFILE_FAST = 0,        // SF7 / 125 kHz
+    PHY_PROFILE_BALANCED = 1,    // SF9 / 125 kHz
+    PHY_PROFILE_LONG_RANGE = 2   // SF12 / 125 kHz
+};
+
+struct __attribute__((packed)) DownlinkHeader {
+    uint8_t magic;       // FRAME_MAGIC
+    uint8_t type;        // FRAME_TYPE_DOWNLINK or FRAME_TYPE_ACK
+    uint32_t deviceId;   // Target collar (downlink) or sender (ack)
+    uint16_t sequence;   // Command sequence, echoed in the ack
+};
+
+// Applies one command on the collar; returns a DL_STATUS_* code
+typedef uint8_t (*DownlinkCommandHandler)(uint8_t opcode, const uint8_t* payload, uint8_t length);
+
+struct DownlinkCampaignStats {
+    bool active;
+    uint32_t startTime;      // millis() when queued to the herd
+    uint16_t targets;        // Collars the change was queued for
+    uint16_t acked;          // Collars that acknowledged it
+    uint32_t lastAckTime;    // millis() of the most recent ack
+    uint32_t herdLatencyMs;  // Time until the last collar acked (once complete)
+};
+
+class Downlink {
+public:
+    /**
+     * @brief Hash a device ID string into the 32-bit ID used on air
+     * @param deviceId Device identifier string
+     * @return FNV-1a hash of the ID
+     */
+    static uint32_t hashDeviceId(const char* deviceId);
+
+    /**
+     * @brief Check whether a received packet is a binary downlink/ack frame
+     * @param data Packet bytes
+     * @param length Packet length
+     * @return true if the packet carries a frame header, false otherwise
+     */
+    static bool isFrame(const uint8_t* data, size_t length);
+};
+
+class DownlinkQueue {
+public:
+    /**
+     * @brief Constructor for DownlinkQueue
+     */
+    DownlinkQueue();
+
+    /**
+     * @brief Register a collar heard on the uplink
+     * @param deviceId Hashed collar ID
+     * @return true if the collar is (now) known, false if the table is full
+     */
+    bool addCollar(uint32_t deviceId);
+
+    /**
+     * @brief Queue a command for one collar
+     * @param deviceId Hashed collar ID
+     * @param opcode Command opcode (DL_CMD_*)
+     * @param payload Command payload
+     * @param length Payload length
+     * @return true if queued, false if the collar's frame is full
+     */
+    bool enqueue(uint32_t deviceId, uint8_t opcode, const uint8_t* payload, uint8_t length);
+
+    /**
+     * @brief Queue a command for every known collar and start timing it
+     * @param opcode Command opcode (DL_CMD_*)
+     * @param payload Command payload
+     * @param length Payload length
+     * @return Number of collars the command was queued for
+     */
+    uint16_t enqueueAll(uint8_t opcode, const uint8_t* payload, uint8_t length);
+
+    /**
+     * @brief Build the frame to send after hearing a collar's uplink
+     * @param deviceId Hashed collar ID
+     * @param frame Buffer of at least DOWNLINK_MAX_FRAME bytes
+     * @return Frame length, or 0 if nothing is pending for that collar
+     */
+    size_t onUplink(uint32_t deviceId, uint8_t* frame);
+
+    /**
+     * @brief Process an ack frame received from a collar
+     * @param frame Frame bytes
+     * @param length Frame length
+     * @return true if it acknowledged the pending frame, false otherwise
+     */
+    bool onAck(const uint8_t* frame, size_t length);
+
+    /**
+     * @brief Get number of collars with unacknowledged commands
+     * @return Pending collar count
+     */
+    uint16_t getPendingCount();
+
+    /**
+     * @brief Get progress of the last herd-wide change
+     * @return DownlinkCampaignStats structure
+     */
+    DownlinkCampaignStats getCampaignStats();
+
+private:
+    struct Entry {
+        uint32_t deviceId;
+        uint16_t sequence;
+        uint8_t length;           // Pending command bytes (0 = nothing pending)
+        uint8_t attempts;
+        bool inCampaign;
+        uint32_t queuedTime;
+        uint8_t payload[DOWNLINK_MAX_PAYLOAD];
+    };
+
+    Entry entries[DOWNLINK_MAX_COLLARS];
+    uint16_t collarCount;
+    DownlinkCampaignStats campaign;
+
+    Entry* find(uint32_t deviceId);
+    bool append(Entry& entry, uint8_t opcode, const uint8_t* payload, uint8_t length);
+};
+
+class DownlinkHandler {
+public:
+    /**
+     * @brief Constructor for DownlinkHandler
+     * @param deviceId This collar's device ID string
+     */
+    DownlinkHandler(const char* deviceId);
+
+    /**
+     * @brief Set function applying each received command
+     * @param handler Command handler
+     */
+    void setCommandHandler(DownlinkCommandHandler handler);
+
+    /**
+     * @brief Process a received frame and build the ack
+     * @param frame Frame bytes
+     * @param length Frame length
+     * @param ack Buffer of at least DOWNLINK_MAX_FRAME bytes for the ack
+     * @return Ack length, or 0 if the frame was not for this collar
+     */
+    size_t handleFrame(const uint8_t* frame, size_t length, uint8_t* ack);
+
+private:
+    uint32_t deviceId;
+    DownlinkCommandHandler commandHandler;
+    bool hasLastSequence;
+    uint16_t lastSequence;
+    uint8_t lastStatus[DOWNLINK_MAX_PAYLOAD / 2];
+    uint8_t lastStatusCount;
+};
+
+#endif // DOWNLINK_H
@@ -0,0 +1,276 @@
+/**
+ * @file FrameCrypto.h
+ * @brief Authenticated encryption of LoRa frames between collars and dongle
+ *
+ * A sealed frame wraps any collar uplink, ack or downlink:
+ *
+ *   [magic][u32 collar][u16 counter][ciphertext][u32 MIC]
+ *
+ * 11 bytes on top of the plaintext, no padding. The payload is encrypted with
+ * AES-128 in CTR mode and authenticated with AES-CMAC over the ciphertext,
+ * truncated to CRYPTO_MIC_SIZE bytes (encrypt-then-MAC). Both run on the
+ * ESP32 AES peripheral through mbedtls; native builds use a table-based
+ * software AES with the same results.
+ *
+ * Every device keeps a 32-bit transmit counter that never repeats for a key,
+ * and uses it as the nonce. Only its low 16 bits go on air: the receiver
+ * rebuilds the rest from the last counter it accepted from that peer, and
+ * rejects anything not newer (replay protection). The counter and direction
+ * enter the MIC, so a frame from one direction or epoch cannot be passed off
+ * as another.
+ *
+ * Keys: every collar has its own key, derived from the herd master key and
+ * the collar ID. The dongle keeps the master key and derives collar keys as
+ * it meets them, keeping one only after a frame under it authenticates; a
+ * collar keeps only its own key, so a lost collar does not give away the herd. Each key yields separate CTR and CMAC subkeys.
+ *
+ * Transmit counters are reserved in NVS CRYPTO_COUNTER_RESERVE at a time, so
+ * a reboot skips ahead rather than reusing a nonce. Collars also persist the
+ * last downlink counter they accepted. The dongle keeps its per-collar receive
+ * counters in RAM only: after a dongle reboot each collar's first frame is
+ * accepted from any later epoch, so one stale frame per collar can be
+ * replayed once in that window.
+ *
+ * Finding that epoch costs a CMAC per epoch tried, and every try is another
+ * chance for a forged MIC to match. A peer without a counter is searched
+ * CRYPTO_RESYNC_EPOCHS deep; the deep search for a collar further on runs
+ * at most once per CRYPTO_DEEP_RESYNC_MS, so frames under made-up IDs cannot
+ * keep the dongle busy or buy many guesses.
+ */
+
+#ifndef FRAME_CRYPTO_H
+#define FRAME_CRYPTO_H
+
+#include <Arduino.h>
+
+#ifndef BRAVO_NATIVE
+#include "mbedtls/aes.h"
+#endif
+
+// Frame layout
+#define CRYPTO_MAGIC                0xB9
+#define CRYPTO_KEY_SIZE             16
+#define CRYPTO_MIC_SIZE             4
+#define CRYPTO_MAX_FRAME            255     // LoRa payload limit
+
+// Collars remembered by the dongle (override with -D CRYPTO_MAX_PEERS=...)
+#ifndef CRYPTO_MAX_PEERS
+#define CRYPTO_MAX_PEERS            64
+#endif
+
+// Transmit counters reserved in NVS per write
+#define CRYPTO_COUNTER_RESERVE      256
+
+// Counter epochs (65536 frames each) searched past the last accepted
+// counter, and from zero for a peer we have no counter for yet
+#define CRYPTO_TRACK_EPOCHS         2
+#ifndef CRYPTO_RESYNC_EPOCHS
+#define CRYPTO_RESYNC_EPOCHS        4
+#endif
+
+// Deep search for a peer without a counter, rate-limited across all peers
+#ifndef CRYPTO_DEEP_RESYNC_EPOCHS
+#define CRYPTO_DEEP_RESYNC_EPOCHS   256
+#endif
+#ifndef CRYPTO_DEEP_RESYNC_MS
+#define CRYPTO_DEEP_RESYNC_MS       60000
+#endif
+
+// NVS keys (ConfigStore blobs)
+#define CRYPTO_NVS_KEY              "lora_key"
+#define CRYPTO_NVS_TX_COUNTER       "lora_tx_ctr"
+#define CRYPTO_NVS_RX_COUNTER       "lora_rx_ctr"
+
+// Directions, part of the nonce
+#define CRYPTO_DIR_UPLINK           0x00    // Collar to dongle
+#define CRYPTO_DIR_DOWNLINK         0x01    // Dongle to collar
+
+enum CryptoCounter {
+    CRYPTO_COUNTER_TX,          // Highest transmit counter reserved
+    CRYPTO_COUNTER_RX           // Collar: last downlink counter accepted
+};
+
+/**
+ * @brief Persists a counter (see FrameCrypto::setCounterStore)
+ * @param counter Which counter
+ * @param value Value to store
+ * @return true if stored, false otherwise
+ */
+typedef bool (*CryptoCounterStore)(CryptoCounter counter, uint32_t value);
+
+struct __attribute__((packed)) CryptoHeader {
+    uint8_t magic;       // CRYPTO_MAGIC
+    uint32_t collarId;   // Sending collar (uplink) or target collar (downlink)
+    uint16_t counter;    // Low bits of the sender's transmit counter
+};
+
+#define CRYPTO_OVERHEAD             (sizeof(CryptoHeader) + CRYPTO_MIC_SIZE)
+
+struct CryptoStats {
+    uint32_t sealed;
+    uint32_t opened;
+    uint32_t badMic;            // Forged, corrupted or sealed under another key
+    uint32_t replayed;          // Counter not newer than the last accepted
+    uint32_t notOurs;           // Collar: frame for another collar
+    uint32_t noPeer;            // Dongle: peer table full
+    uint32_t counterStalls;     // Not sealed: counter reservation not stored
+    uint32_t deepResyncs;       // Deep counter searches run
+    uint32_t lastSealUs;
+    uint32_t lastOpenUs;
+};
+
+class FrameCrypto {
+public:
+    /**
+     * @brief Constructor for FrameCrypto
+     * @param deviceId This device's ID (hashed as in Downlink::hashDeviceId)
+     * @param dongle true on the dongle (holds the master key)
+     */
+    FrameCrypto(const char* deviceId, bool dongle);
+
+    /**
+     * @brief Check whether a received packet is a sealed frame
+     * @param data Packet bytes
+     * @param length Packet length
+     * @return true if the packet carries a crypto header, false otherwise
+     */
+    static bool isFrame(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Get the key this device keeps for a herd master key
+     *
+     * The dongle keeps the master key itself, a collar the key derived from
+     * it for its own ID.
+     *
+     * @param masterKey Herd master key
+     * @param key Buffer for CRYPTO_KEY_SIZE bytes
+     */
+    void provisionKey(const uint8_t* masterKey, uint8_t* key);
+
+    /**
+     * @brief Set the callback persisting counters (call before begin)
+     * @param store Callback, or nullptr to keep counters in RAM only
+     */
+    void setCounterStore(CryptoCounterStore store);
+
+    /**
+     * @brief Start sealing and opening frames
+     * @param key Master key (dongle) or this collar's key
+     * @param txCounter Transmit counter reserved so far (0 if none)
+     * @param rxCounter Collar: last downlink counter accepted (0 if none)
+     * @return true if started, false if the counter reservation failed
+     */
+    bool begin(const uint8_t* key, uint32_t txCounter, uint32_t rxCounter);
+
+    /**
+     * @brief Check if a key is loaded
+     * @return true if frames are sealed and required, false otherwise
+     */
+    bool isActive();
+
+    /**
+     * @brief Encrypt and authenticate a payload
+     * @param payload Plaintext bytes
+     * @param length Plaintext length
+     * @param frame Buffer for the frame (may not overlap the payload)
+     * @param maxLength Buffer size
+     * @param collarId Dongle: target collar; collars always seal under their own ID
+     * @return Frame length, or 0 if it does not fit or cannot be sealed
+     */
+    size_t seal(const uint8_t* payload, size_t length, uint8_t* frame, size_t maxLength,
+                uint32_t collarId = 0);
+
+    /**
+     * @brief Authenticate and decrypt a received frame in place
+     * @param frame Frame bytes; holds the plaintext on success
+     * @param length Frame length; set to the plaintext length on success
+     * @param collarId Reference to store the collar the frame is from or for
+     * @return true if authentic and new, false otherwise
+     */
+    bool open(uint8_t* frame, size_t& length, uint32_t& collarId);
+
+    /**
+     * @brief Get counters and timings
+     * @return CryptoStats structure
+     */
+    CryptoStats getStats();
+
+    /**
+     * @brief Compute a full AES-CMAC (RFC 4493) through the MIC code path
+     *
+     * For known-answer tests; frames use seal() and open().
+     *
+     * @param key CRYPTO_KEY_SIZE-byte key
+     * @param data Message
+     * @param length Message length (up to CRYPTO_MAX_FRAME)
+     * @param tag Buffer for the 16-byte tag
+     * @return true if computed, false if the message is too long
+     */
+    bool cmac(const uint8_t* key, const uint8_t* data, size_t length, uint8_t* tag);
+
+    /**
+     * @brief Encrypt or decrypt in AES-128-CTR mode through the frame code path
+     *
+     * For known-answer tests; frames use seal() and open().
+     *
+     * @param key CRYPTO_KEY_SIZE-byte key
+     * @param counterBlock Initial 16-byte counter block, advanced past the data
+     * @param data Data, transformed in place
+     * @param length Data length
+     */
+    void ctr(const uint8_t* key, uint8_t* counterBlock, uint8_t* data, size_t length);
+
+private:
+    struct Peer {
+        uint32_t collarId;
+        uint32_t lastRx;            // Last counter accepted (0 = none)
+        uint8_t ctrKey[CRYPTO_KEY_SIZE];
+        uint8_t macKey[CRYPTO_KEY_SIZE];
+        uint8_t macK1[CRYPTO_KEY_SIZE];   // CMAC subkey for a complete last block
+    };
+
+    uint32_t ownId;
+    bool dongle;
+    bool active;
+    uint8_t masterKey[CRYPTO_KEY_SIZE];
+    uint32_t txCounter;         // Last counter used
+    uint32_t txReserved;        // Highest counter stored
+    CryptoCounterStore counterStore;
+    uint32_t deepResyncMs;      // Last deep counter search
+
+    Peer peers[CRYPTO_MAX_PEERS];
+    uint8_t peerCount;
+    uint8_t scratch[CRYPTO_MAX_FRAME + 16];
+    CryptoStats stats;
+
+#ifdef BRAVO_NATIVE
+    uint8_t roundKeys[176];
+#else
+    mbedtls_aes_context aes;
+#endif
+
+    Peer* findPeer(uint32_t collarId);
+    void derivePeer(uint32_t collarId, Peer& peer);
+    Peer* addPeer(const Peer& peer);
+    void deriveCollarKey(const uint8_t* masterKey, uint32_t collarId, uint8_t* key);
+    void setupPeer(Peer& peer, const uint8_t* key);
+    void cmacSubkey(const uint8_t* macKey, uint8_t* k1);
+    bool reserveCounters();
+    void crypt(const Peer& peer, uint8_t direction, uint32_t counter, uint8_t* data,
+               size_t length);
+    void mic(const Peer& peer, uint8_t direction, uint32_t counter, const uint8_t* data,
+             size_t length, uint8_t* out);
+    void cmacScratch(const uint8_t* macKey, const uint8_t* k1, size_t length, uint8_t* tag);
+    bool findCounter(const Peer& peer, uint8_t direction, const uint8_t* body,
+                     size_t bodyLength, const uint8_t* received, uint32_t& counter,
+                     uint16_t epochs);
+    bool deepResyncAllowed();
+
+    // AES-128 block primitives (hardware on the ESP32)
+    void setKey(const uint8_t* key);
+    void encryptBlock(const uint8_t* in, uint8_t* out);
+    void encryptCtr(uint8_t* counterBlock, uint8_t* data, size_t length);
+    void cbcMac(uint8_t* state, const uint8_t* data, size_t blocks);
+};
+
+#endif // FRAME_CRYPTO_H
@@ -11,12 +11,16 @@
 
 #include <Arduino.h>
 #include <TinyGPSPlus.h>
+#include "hal/HAL.h"
 
-// GPS pin definitions for ESP32
+// GPS pin definitions for ESP32 (used to construct Esp32Uart)
 #define GPS_RX_PIN  16
 #define GPS_TX_PIN  17
 #define GPS_BAUD    9600
 
+// Receiver PPS output, if wired (TIME_PPS_PIN_NONE = -1 if not)
+#define GPS_PPS_PIN -1
+
 struct GPSData {
     double latitude;
     double longitude;
@@ -29,12 +33,19 @@ struct GPSData {
     uint32_t timestamp;
 };
 
+struct GPSTime {
+    uint32_t unixSeconds;       // Seconds since 1970-01-01 UTC
+    uint16_t millisecond;
+    uint32_t receivedUs;        // micros() when the sentence was parsed
+};
+
 class GPS {
 public:
     /**
      * @brief Constructor for GPS
+     * @param uart Serial port the receiver is connected to
      */
-    GPS();
+    GPS(UartHAL& uart);
 
     /**
      * @brief Initialize GPS module
@@ -91,10 +102,32 @@ public:
      */
     GPSData getData();
 
+    /**
+     * @brief Get the UTC time of the latest GPS epoch
+     * @param time Reference to store the time
+     * @return true if a new, valid time was parsed since the last call, false otherwise
+     */
+    bool getTime(GPSTime& time);
+
+    /**
+     * @brief Set receiver navigation rate (u-blox UBX-CFG-RATE)
+     * @param periodMs Measurement period in milliseconds (>= 200)
+     * @return true if command sent, false otherwise
+     */
+    bool setUpdateRate(uint16_t periodMs);
+
+    /**
+     * @brief Get time the receiver has been powered
+     * @return On-time in milliseconds
+     */
+    uint32_t getOnTimeMs();
+
 private:
     TinyGPSPlus gps;
-    HardwareSerial* gpsSerial;
+    UartHAL& uart;
     bool initialized;
+    uint32_t powerOnTime;
+    uint32_t sentenceUs;        // micros() when the last sentence completed
 };
 
 #endif // GPS_H
@@ -0,0 +1,225 @@
+/**
+ * @file Geofence.h
+ * @brief On-collar geofence polygons with a uniform grid index
+ *
+ * Fences are polygons in fixed point (1e-5 degree units, about 1.1 m). On
+ * commit the fence area is covered by a GEOFENCE_GRID_DIM x GEOFENCE_GRID_DIM
+ * grid; each cell lists the edges within the hysteresis margin of it and
+ * stores which fences contain a reference point near its centre. A fix is
+ * then classified by counting the crossings between it and its cell's
+ * reference point, so only the edges of one cell are tested, however many
+ * vertices the fences have.
+ *
+ * Fences arrive as GEOFENCE_OP_* commands (Downlink DL_CMD_GEOFENCE or
+ * BLE_CMD_GEOFENCE) and persist in the same compact format.
+ */
+
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <Arduino.h>
+#include "GPS.h"
+
+// Capacity (RAM use is about 11 KB at these sizes)
+#define GEOFENCE_MAX_FENCES         16
+#define GEOFENCE_MAX_VERTICES       512
+#define GEOFENCE_GRID_DIM           16
+#define GEOFENCE_MAX_CELL_EDGES     2048
+
+// Fixed-point coordinates
+#define GEOFENCE_UNITS_PER_DEGREE   100000
+#define GEOFENCE_METRES_PER_UNIT    1.1132f     // Along a meridian
+
+// A crossing is only confirmed this far from the boundary, for this many
+// consecutive fixes
+#define GEOFENCE_HYSTERESIS_M       10.0f
+#define GEOFENCE_CONFIRM_FIXES      2
+
+// Commands (u8 op, then arguments; little-endian)
+#define GEOFENCE_OP_CLEAR           0x00  // Remove all fences
+#define GEOFENCE_OP_BEGIN           0x01  // u8 id, i32 lat, i32 lon origin, vertices...
+#define GEOFENCE_OP_APPEND          0x02  // u8 id, vertices... (fence being defined)
+#define GEOFENCE_OP_COMMIT          0x03  // Index the fences and start evaluating
+
+// Persisted encoding (ConfigStore blob)
+#define GEOFENCE_FORMAT_VERSION     1
+#define GEOFENCE_NVS_KEY            "fences"
+#define GEOFENCE_MAX_ENCODED_SIZE   (2 + GEOFENCE_MAX_FENCES * 11 + GEOFENCE_MAX_VERTICES * 4)
+
+// Vertices on the wire are offsets from the fence origin
+struct __attribute__((packed)) GeofenceWireVertex {
+    int16_t lat;
+    int16_t lon;
+};
+
+struct GeofencePoint {
+    int32_t lat;
+    int32_t lon;
+};
+
+struct GeofenceInfo {
+    uint8_t id;
+    GeofencePoint origin;
+    uint16_t firstVertex;
+    uint16_t vertexCount;
+};
+
+// Confirmed boundary crossing
+struct GeofenceEvent {
+    uint8_t fenceId;
+    bool entered;       // true on entry, false on exit
+};
+
+struct GeofenceStats {
+    uint32_t evaluations;
+    uint32_t edgesTested;
+    uint16_t cellEdges;         // Edge entries in the grid
+    uint16_t maxCellEdges;      // Longest cell list
+};
+
+class Geofence {
+public:
+    /**
+     * @brief Constructor for Geofence
+     */
+    Geofence();
+
+    /**
+     * @brief Remove all fences
+     */
+    void clear();
+
+    /**
+     * @brief Start (or replace) a fence; evaluation pauses until commit()
+     * @param id Fence identifier
+     * @param origin Origin the vertex offsets are relative to
+     * @return true if there is room, false otherwise
+     */
+    bool beginFence(uint8_t id, const GeofencePoint& origin);
+
+    /**
+     * @brief Add a vertex to the fence being defined
+     * @param offset Offset from the fence origin
+     * @return true if added, false if full or no fence is being defined
+     */
+    bool addVertex(const GeofenceWireVertex& offset);
+
+    /**
+     * @brief Index the fences and start evaluating them
+     * @return true if every fence is a polygon and the index fits, false otherwise
+     */
+    bool commit();
+
+    /**
+     * @brief Apply one GEOFENCE_OP_* command
+     * @param payload Command bytes
+     * @param length Command length
+     * @return true if applied, false if malformed or rejected
+     */
+    bool applyCommand(const uint8_t* payload, size_t length);
+
+    /**
+     * @brief Encode all fences for storage
+     * @param buffer Buffer to store encoded bytes
+     * @param maxLength Buffer size
+     * @return Encoded length, or 0 if the buffer is too small
+     */
+    size_t encode(uint8_t* buffer, size_t maxLength);
+
+    /**
+     * @brief Replace all fences with encoded ones and commit them
+     * @param data Encoded bytes
+     * @param length Encoded length
+     * @return true if decoded and committed, false otherwise (fences cleared)
+     */
+    bool decode(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Get the fences containing a point, using the grid index
+     * @param point Position in fixed point
+     * @return Bit mask of fence slots (bit i = getFence(i))
+     */
+    uint16_t contains(const GeofencePoint& point);
+
+    /**
+     * @brief Get the fences containing a point by testing every edge
+     * @param point Position in fixed point
+     * @return Bit mask of fence slots
+     */
+    uint16_t containsLinear(const GeofencePoint& point);
+
+    /**
+     * @brief Evaluate a fix and report confirmed entries and exits
+     * @param fix GPS fix (ignored unless valid)
+     * @param events Events to fill
+     * @param maxEvents Capacity of events
+     * @return Number of events
+     */
+    uint8_t update(const GPSData& fix, GeofenceEvent* events, uint8_t maxEvents);
+
+    /**
+     * @brief Check if committed fences are being evaluated
+     * @return true if active, false otherwise
+     */
+    bool isActive();
+
+    uint8_t getFenceCount();
+    uint16_t getVertexCount();
+
+    /**
+     * @brief Get a fence by slot
+     * @param slot Slot index (0..getFenceCount()-1)
+     * @return GeofenceInfo structure
+     */
+    GeofenceInfo getFence(uint8_t slot);
+
+    /**
+     * @brief Get evaluation statistics
+     * @return GeofenceStats structure
+     */
+    GeofenceStats getStats();
+
+    /**
+     * @brief Convert degrees to fixed point
+     * @param degrees Latitude or longitude
+     * @return Value in 1e-5 degree units
+     */
+    static int32_t toUnits(double degrees);
+
+private:
+    GeofenceInfo fences[GEOFENCE_MAX_FENCES];
+    uint8_t fenceCount;
+    bool defining;
+    bool active;
+
+    GeofencePoint vertices[GEOFENCE_MAX_VERTICES];
+    uint8_t vertexFence[GEOFENCE_MAX_VERTICES];
+    uint16_t vertexCount;
+
+    // Grid index (CSR: cell i owns cellEdges[cellStart[i]..cellStart[i+1]))
+    GeofencePoint gridOrigin;
+    int32_t cellHeight;
+    int32_t cellWidth;
+    int32_t marginLat;
+    int32_t marginLon;
+    float lonScale;             // Metres per unit of longitude / of latitude
+    uint16_t cellStart[GEOFENCE_GRID_DIM * GEOFENCE_GRID_DIM + 1];
+    uint16_t cellEdges[GEOFENCE_MAX_CELL_EDGES];
+    GeofencePoint cellReference[GEOFENCE_GRID_DIM * GEOFENCE_GRID_DIM];
+    uint16_t cellMask[GEOFENCE_GRID_DIM * GEOFENCE_GRID_DIM];
+
+    // Hysteresis state per fence slot
+    uint16_t confirmedInside;
+    uint16_t confirmedKnown;
+    uint8_t pendingFixes[GEOFENCE_MAX_FENCES];
+
+    GeofenceStats stats;
+
+    uint16_t edgeEnd(uint16_t edge);
+    int cellOf(const GeofencePoint& point);
+    uint16_t assignEdges(bool fill, uint16_t* cursor);
+    uint16_t evaluate(const GeofencePoint& point, float* distanceM);
+    float distanceToEdge(const GeofencePoint& point, uint16_t edge);
+};
+
+#endif // GEOFENCE_H
@@ -10,13 +10,16 @@
 #define IMU_H
 
 #include <Arduino.h>
-#include <Adafruit_MPU6050.h>
-#include <Adafruit_Sensor.h>
+#include "hal/HAL.h"
 
-// IMU I2C pins for ESP32
+// IMU I2C pins for ESP32 (used to construct Esp32Imu)
 #define IMU_SDA_PIN 21
 #define IMU_SCL_PIN 22
 
+// Fixed-point scales for packed samples (LSB per unit)
+#define IMU_RAW_ACCEL_SCALE 100.0f   // 0.01 m/s² per LSB (±327 m/s²)
+#define IMU_RAW_GYRO_SCALE  1000.0f  // 0.001 rad/s per LSB (±32 rad/s)
+
 struct IMUData {
     float accelX;
     float accelY;
@@ -28,12 +31,23 @@ struct IMUData {
     uint32_t timestamp;
 };
 
+// Compact int16 sample used for logging and streaming
+struct __attribute__((packed)) IMURawSample {
+    int16_t accelX;
+    int16_t accelY;
+    int16_t accelZ;
+    int16_t gyroX;
+    int16_t gyroY;
+    int16_t gyroZ;
+};
+
 class IMU {
 public:
     /**
      * @brief Constructor for IMU
+     * @param sensor Motion sensor hardware
      */
-    IMU();
+    IMU(ImuHAL& sensor);
 
     /**
      * @brief Initialize IMU module
@@ -88,8 +102,15 @@ public:
      */
     bool isInMotion(float threshold = 0.5);
 
+    /**
+     * @brief Convert an IMU sample to its packed int16 form
+     * @param data IMU data structure
+     * @return IMURawSample scaled by IMU_RAW_ACCEL_SCALE/IMU_RAW_GYRO_SCALE
+     */
+    static IMURawSample toRaw(const IMUData& data);
+
 private:
-    Adafruit_MPU6050 mpu;
+    ImuHAL& sensor;
     IMUData currentData;
     bool initialized;
 };
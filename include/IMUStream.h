@@ -0,0 +1,115 @@
+/**
+ * @file IMUStream.h
+ * @brief Live IMU sample streaming for B.R.A.V.O. field diagnostics
+ *
+ * This module packs raw IMU samples into fixed-size batches for live
+ * streaming over BLE. The sensor side only ever appends to a bounded batch
+ * queue; if the consumer falls behind, whole batches are dropped and counted
+ * instead of blocking sampling.
+ */
+
+#ifndef IMU_STREAM_H
+#define IMU_STREAM_H
+
+#include <Arduino.h>
+#include "IMU.h"
+
+// Streaming configuration
+#define IMU_STREAM_MIN_RATE         50    // Hz
+#define IMU_STREAM_MAX_RATE         200   // Hz
+#define IMU_STREAM_DEFAULT_RATE     100   // Hz
+#define IMU_STREAM_MAX_BATCH        32    // Samples per notification
+#define IMU_STREAM_QUEUE_BATCHES    8     // Batches buffered for sending
+#define IMU_STREAM_MAX_LATENCY      100   // ms before a partial batch is sent
+
+// Notification header, followed by `count` IMURawSample entries
+struct __attribute__((packed)) IMUStreamHeader {
+    uint16_t sequence;       // Batch sequence number (wraps)
+    uint32_t baseTimestamp;  // millis() of the first sample
+    uint8_t count;           // Samples in this batch
+    uint8_t periodMs;        // Nominal sample spacing
+};
+
+struct IMUStreamStats {
+    uint32_t samples;          // Samples accepted
+    uint32_t sentBatches;
+    uint32_t droppedBatches;   // Batches discarded because the queue was full
+    uint16_t rateHz;
+    bool active;
+};
+
+class IMUStream {
+public:
+    /**
+     * @brief Constructor for IMUStream
+     */
+    IMUStream();
+
+    /**
+     * @brief Start streaming with an empty queue
+     * @param maxPacketSize Largest notification payload the link accepts
+     */
+    void start(size_t maxPacketSize);
+
+    /**
+     * @brief Stop streaming and discard queued batches
+     */
+    void stop();
+
+    /**
+     * @brief Check if streaming is active
+     * @return true if active, false otherwise
+     */
+    bool isActive();
+
+    /**
+     * @brief Set stream sample rate
+     * @param hz Sample rate, clamped to IMU_STREAM_MIN_RATE..IMU_STREAM_MAX_RATE
+     */
+    void setRate(uint16_t hz);
+
+    /**
+     * @brief Get sample period for the current rate
+     * @return Sample period in milliseconds
+     */
+    uint8_t getPeriodMs();
+
+    /**
+     * @brief Add a sample to the current batch (never blocks)
+     * @param data IMU data structure
+     */
+    void push(const IMUData& data);
+
+    /**
+     * @brief Take the next ready batch as a notification payload
+     * @param buffer Buffer to store the packet
+     * @param maxLength Buffer size
+     * @return Packet length, or 0 if no batch is ready
+     */
+    size_t nextPacket(uint8_t* buffer, size_t maxLength);
+
+    /**
+     * @brief Get streaming statistics
+     * @return IMUStreamStats structure
+     */
+    IMUStreamStats getStats();
+
+private:
+    struct Batch {
+        IMUStreamHeader header;
+        IMURawSample samples[IMU_STREAM_MAX_BATCH];
+    };
+
+    Batch queue[IMU_STREAM_QUEUE_BATCHES];
+    uint8_t writeIndex;    // Batch being filled
+    uint8_t readIndex;     // Next batch to send
+    uint8_t readyCount;    // Completed batches waiting to be sent
+    uint8_t batchSize;
+    uint16_t sequence;
+    bool active;
+    IMUStreamStats stats;
+
+    void commitBatch();
+};
+
+#endif // IMU_STREAM_H
@@ -0,0 +1,164 @@
+/**
+ * @file LatencyTracker.h
+ * @brief Sample-to-dongle latency accounting per collar
+ *
+ * The way from a collar's sample to the operator is split into stages:
+ *
+ *   sample   sample taken -> uplink built (enqueued for TX)     collar
+ *   queue    uplink built -> radio TX start                     collar
+ *   air      radio TX start -> TX end                           collar
+ *   network  TX end -> dongle RX (relay hops, RX polling)       dongle, from "ts"
+ *   decode   dongle RX -> telemetry parsed                      dongle
+ *   total    sample taken -> telemetry parsed                   dongle, from "ts"
+ *
+ * The collar's stages travel in the uplink (LatencyReport). An uplink is
+ * sealed before it goes on air, so it cannot carry its own TX times: each one
+ * carries the queue and air times measured for the collar's previous uplink.
+ * Both describe the same collar and radio settings, so the histograms come
+ * out the same without matching frames up by sequence.
+ *
+ * The network and total stages compare the uplink's "ts" stamp with the
+ * dongle's clock, so they are only measured when both ends have absolute
+ * time (see TimeService). Their error is the two clocks' uncertainty added
+ * together: tens of milliseconds with NMEA time, microseconds with PPS.
+ *
+ * Every stage has a log-linear histogram per collar, four buckets per
+ * doubling from 1 ms to LATENCY_MAX_MS, so percentiles come out within 12%.
+ * When a bucket fills up, all of a histogram's counts are halved, which keeps
+ * the histograms weighted towards recent traffic.
+ */
+
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <Arduino.h>
+
+// Collars tracked (override with -D LATENCY_MAX_COLLARS=...)
+#ifndef LATENCY_MAX_COLLARS
+#define LATENCY_MAX_COLLARS     32
+#endif
+
+// Buckets 0-3 hold 0-3 ms exactly, then four per doubling; the last bucket
+// is open-ended
+#define LATENCY_BUCKETS         64
+#define LATENCY_MAX_MS          131071
+
+enum LatencyStage : uint8_t {
+    LATENCY_SAMPLE = 0,
+    LATENCY_QUEUE,
+    LATENCY_AIR,
+    LATENCY_NETWORK,
+    LATENCY_DECODE,
+    LATENCY_TOTAL,
+    LATENCY_STAGE_COUNT
+};
+
+// Collar stages carried in an uplink ("lat" in telemetry)
+struct LatencyReport {
+    uint32_t sampleMs;          // Age of the sample when the uplink was built
+    uint32_t queueMs;           // Previous uplink: built -> TX start
+    uint32_t airMs;             // Previous uplink: TX start -> TX end
+};
+
+struct LatencyPercentiles {
+    uint32_t count;             // Uplinks recorded (before any halving)
+    uint32_t p50Ms;
+    uint32_t p95Ms;
+    uint32_t p99Ms;
+};
+
+class LatencyTracker {
+public:
+    /**
+     * @brief Constructor for LatencyTracker
+     */
+    LatencyTracker();
+
+    /**
+     * @brief Allocate the histograms
+     * @param maxCollars Collars to track
+     * @return true if allocated, false otherwise
+     */
+    bool begin(uint8_t maxCollars = LATENCY_MAX_COLLARS);
+
+    /**
+     * @brief Record one stage of an uplink
+     * @param collarId Collar (Downlink::hashDeviceId)
+     * @param deviceId Collar name, kept for reports
+     * @param stage Stage measured
+     * @param ms Stage duration in milliseconds
+     * @return true if recorded, false if the collar table is full
+     */
+    bool record(uint32_t collarId, const char* deviceId, LatencyStage stage, uint32_t ms);
+
+    /**
+     * @brief Get number of collars tracked
+     * @return Collar count
+     */
+    uint8_t getCollarCount();
+
+    /**
+     * @brief Get a tracked collar
+     * @param index Collar index (0..getCollarCount()-1)
+     * @param collarId Reference to store the collar ID
+     * @return Collar name, or nullptr if index is out of range
+     */
+    const char* getCollar(uint8_t index, uint32_t& collarId);
+
+    /**
+     * @brief Get percentiles of one stage for one collar
+     * @param index Collar index
+     * @param stage Stage
+     * @return LatencyPercentiles structure (zero if none recorded)
+     */
+    LatencyPercentiles getPercentiles(uint8_t index, LatencyStage stage);
+
+    /**
+     * @brief Get percentiles of one stage over all collars
+     * @param stage Stage
+     * @return LatencyPercentiles structure (zero if none recorded)
+     */
+    LatencyPercentiles getHerdPercentiles(LatencyStage stage);
+
+    /**
+     * @brief Get number of stages not recorded because the table was full
+     * @return Stage records dropped
+     */
+    uint32_t getUntracked();
+
+    /**
+     * @brief Forget all collars and counts
+     */
+    void reset();
+
+    /**
+     * @brief Get short name of a stage
+     * @param stage Stage
+     * @return Name string
+     */
+    static const char* stageName(LatencyStage stage);
+
+private:
+    struct Histogram {
+        uint32_t count;
+        uint16_t buckets[LATENCY_BUCKETS];
+    };
+
+    struct Collar {
+        uint32_t collarId;
+        char deviceId[32];
+        Histogram stages[LATENCY_STAGE_COUNT];
+    };
+
+    Collar* collars;
+    uint8_t capacity;
+    uint8_t count;
+    uint32_t untracked;
+
+    Collar* find(uint32_t collarId, const char* deviceId);
+    static uint8_t bucketFor(uint32_t ms);
+    static uint32_t bucketMidMs(uint8_t bucket);
+    static LatencyPercentiles percentiles(const uint32_t* buckets, uint32_t count);
+};
+
+#endif // LATENCY_TRACKER_H
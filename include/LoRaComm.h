@@ -10,9 +10,9 @@
 #define LORA_COMM_H
 
 #include <Arduino.h>
-#include <LoRa.h>
+#include "hal/HAL.h"
 
-// LoRa pin definitions for ESP32
+// LoRa pin definitions for ESP32 (used to construct Esp32Radio)
 #define LORA_SCK    5
 #define LORA_MISO   19
 #define LORA_MOSI   27
@@ -25,12 +25,20 @@
 #define LORA_SPREAD 7
 #define LORA_BANDWIDTH 125E3
 
+struct LoRaRadioStats {
+    uint32_t txTimeMs;      // Time spent transmitting
+    uint32_t rxTimeMs;      // Time spent listening
+    uint32_t txPackets;
+    uint32_t rxPackets;
+};
+
 class LoRaComm {
 public:
     /**
      * @brief Constructor for LoRaComm
+     * @param radio Radio hardware to drive
      */
-    LoRaComm();
+    LoRaComm(RadioHAL& radio);
 
     /**
      * @brief Initialize LoRa module
@@ -85,8 +93,93 @@ public:
      */
     float getSNR();
 
+    /**
+     * @brief Listen for a limited time, then put the radio to sleep
+     * @param durationMs Window length in milliseconds
+     */
+    void openReceiveWindow(uint32_t durationMs);
+
+    /**
+     * @brief Check if a receive window is open (closes it once expired)
+     * @return true if the window is still open, false otherwise
+     */
+    bool isReceiveWindowOpen();
+
+    /**
+     * @brief Apply radio PHY settings (takes effect from the next packet)
+     * @param frequency Carrier frequency in Hz
+     * @param spreadingFactor Spreading factor (6-12)
+     * @param bandwidth Signal bandwidth in Hz
+     * @param txPower TX power in dBm (2-20)
+     * @return true if applied, false if not initialized
+     */
+    bool setPHY(long frequency, uint8_t spreadingFactor, long bandwidth, int txPower);
+
+    /**
+     * @brief Get current spreading factor
+     * @return Spreading factor
+     */
+    uint8_t getSpreadingFactor();
+
+    /**
+     * @brief Get current signal bandwidth
+     * @return Bandwidth in Hz
+     */
+    long getBandwidth();
+
+    /**
+     * @brief Get cumulative radio on-time and packet counts
+     * @return LoRaRadioStats structure
+     */
+    LoRaRadioStats getRadioStats();
+
+    /**
+     * @brief Get when the last packet went on air
+     * @return micros() at TX start
+     */
+    uint32_t getLastTxStartUs();
+
+    /**
+     * @brief Get how long the last packet took to send
+     * @return TX start to TX done in microseconds
+     */
+    uint32_t getLastTxDurationUs();
+
+    /**
+     * @brief Get when the last received packet was picked up
+     *
+     * The radio is polled, so this is the available() call that found the
+     * packet, up to one loop pass after it finished arriving.
+     *
+     * @return micros() when the packet was found
+     */
+    uint32_t getLastRxUs();
+
 private:
+    RadioHAL& radio;
     bool initialized;
+    int pendingPacketSize;    // Packet parsed by available() but not yet read
+    bool windowOpen;
+    uint32_t windowStart;
+    uint32_t windowLength;
+    long frequency;
+    uint8_t spreadingFactor;
+    long bandwidth;
+    int txPower;
+
+    // Radio on-time accounting (microseconds)
+    bool listening;
+    uint32_t listenStartUs;
+    uint64_t txTimeUs;
+    uint64_t rxTimeUs;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t lastTxStartUs;
+    uint32_t lastTxDurationUs;
+    uint32_t lastRxUs;
+
+    void setListening(bool on);
+    bool finishPacket();
 };
 
 #endif // LORA_COMM_H
@@ -0,0 +1,250 @@
+/**
+ * @file Log.h
+ * @brief Deferred-format logging for B.R.A.V.O. firmware
+ *
+ * A log call stores a format ID, a timestamp and its arguments in binary
+ * into a fixed RAM ring and returns; no text is formatted and nothing waits
+ * on the UART. A low-priority task drains the ring, formats the records and
+ * writes them to Serial while the loop sleeps. When the ring is full, new
+ * records are dropped and counted.
+ *
+ * Writers claim slots with a compare-and-swap and publish them with a
+ * per-slot sequence number, so the loop, the BLE host task and ISRs can log
+ * without locks.
+ *
+ * Levels below BRAVO_LOG_LEVEL compile to nothing, arguments included.
+ * Formats live in LogFormats.h. In binary mode records are written as
+ * "LOG <hex>" lines that tools/logdecode.py turns back into text.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "LogFormats.h"
+
+// Levels
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+#ifndef BRAVO_LOG_LEVEL
+#define BRAVO_LOG_LEVEL     LOG_LEVEL_INFO
+#endif
+
+// Ring size in records (power of two, 40 bytes each)
+#ifndef LOG_CAPACITY
+#define LOG_CAPACITY        64
+#endif
+
+// Argument bytes per record: a tag byte plus 4 bytes per number, or a tag,
+// a length and the characters of a string
+#define LOG_ARGS_MAX        28
+
+// Longest formatted line
+#define LOG_LINE_MAX        160
+
+// Drain task: runs below the loop, which sleeps every pass
+#define LOG_TASK_STACK      3072
+#define LOG_TASK_PRIORITY   0
+#define LOG_TASK_CORE       1       // Arduino loop core
+#define LOG_DRAIN_INTERVAL_MS 20
+
+// Argument tags
+#define LOG_ARG_INT         'i'
+#define LOG_ARG_UINT        'u'
+#define LOG_ARG_FLOAT       'f'
+#define LOG_ARG_STRING      's'
+
+#define LOG_FORMAT_ENUM(id, text) id,
+
+enum LogFormat : uint16_t {
+    LOG_FORMATS(LOG_FORMAT_ENUM)
+    LOG_FORMAT_COUNT
+};
+
+struct LogRecord {
+    std::atomic<uint32_t> sequence;     // Slot index + 1 once written
+    uint32_t timestampMs;
+    uint16_t format;
+    uint8_t level;
+    uint8_t length;                     // Argument bytes used
+    uint8_t args[LOG_ARGS_MAX];
+};
+
+struct LogStats {
+    uint32_t written;                   // Records stored
+    uint32_t dropped;                   // Records lost to a full ring
+    uint32_t drained;                   // Records output
+};
+
+class Logger {
+public:
+    /**
+     * @brief Constructor for Logger
+     */
+    Logger();
+
+    /**
+     * @brief Start the drain task (firmware builds only)
+     * @return true if the task started, false otherwise
+     */
+    bool begin();
+
+    /**
+     * @brief Store a record; arguments are copied in binary
+     * @param level LOG_LEVEL_*
+     * @param format Format ID
+     * @param args Integers, floats or strings matching the format
+     */
+    template <typename... Args>
+    void write(uint8_t level, LogFormat format, const Args&... args) {
+        uint32_t slot;
+        if (!claim(slot)) {
+            return;
+        }
+
+        LogRecord& record = records[slot % LOG_CAPACITY];
+        record.timestampMs = millis();
+        record.format = format;
+        record.level = level;
+        record.length = 0;
+        pack(record, args...);
+        record.sequence.store(slot + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Format and output every stored record
+     * @param output Destination (Serial in the firmware)
+     * @return Records output
+     */
+    size_t drain(Print& output);
+
+    /**
+     * @brief Drop every stored record without formatting it
+     * @return Records dropped
+     */
+    size_t discard();
+
+    /**
+     * @brief Format one record as a text line
+     * @param record Record to format
+     * @param buffer Output buffer
+     * @param maxLength Buffer size
+     * @return Bytes written, excluding the terminator
+     */
+    static size_t formatRecord(const LogRecord& record, char* buffer, size_t maxLength);
+
+    /**
+     * @brief Output records as hex for tools/logdecode.py instead of text
+     * @param binary true for "LOG <hex>" lines, false for text
+     */
+    void setBinary(bool binary);
+
+    /**
+     * @brief Check the output mode
+     * @return true if records are output as hex, false if as text
+     */
+    bool isBinary();
+
+    /**
+     * @brief Get record counts
+     * @return LogStats structure
+     */
+    LogStats getStats();
+
+    /**
+     * @brief Get the format string for an ID
+     * @param format Format ID
+     * @return Format string ("?" if unknown)
+     */
+    static const char* formatString(uint16_t format);
+
+private:
+    LogRecord records[LOG_CAPACITY];
+    std::atomic<uint32_t> writeIndex;
+    uint32_t readIndex;
+    std::atomic<uint32_t> written;
+    std::atomic<uint32_t> dropped;
+    uint32_t reportedDropped;
+    uint32_t drained;
+    bool binary;
+
+    bool claim(uint32_t& slot);
+    bool next(LogRecord*& record);
+    void release();
+    void emit(Print& output, const LogRecord& record);
+
+    static void pack(LogRecord& record) {}
+
+    template <typename T, typename... Rest>
+    static void pack(LogRecord& record, const T& first, const Rest&... rest) {
+        put(record, first);
+        pack(record, rest...);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+    put(LogRecord& record, T value) {
+        putWord(record, LOG_ARG_INT, (uint32_t)(int32_t)value);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type
+    put(LogRecord& record, T value) {
+        putWord(record, LOG_ARG_UINT, (uint32_t)value);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_enum<T>::value>::type
+    put(LogRecord& record, T value) {
+        putWord(record, LOG_ARG_INT, (uint32_t)(int32_t)value);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type
+    put(LogRecord& record, T value) {
+        float narrowed = value;
+        uint32_t word;
+        memcpy(&word, &narrowed, sizeof(word));
+        putWord(record, LOG_ARG_FLOAT, word);
+    }
+
+    static void put(LogRecord& record, const char* text);
+    static void put(LogRecord& record, const String& text);
+    static void putWord(LogRecord& record, uint8_t tag, uint32_t word);
+};
+
+extern Logger logger;
+
+#define LOG_WRITE(level, format, ...)   logger.write(level, format, ##__VA_ARGS__)
+
+#if BRAVO_LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(format, ...)  LOG_WRITE(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(format, ...)  ((void)0)
+#endif
+
+#if BRAVO_LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(format, ...)   LOG_WRITE(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...)   ((void)0)
+#endif
+
+#if BRAVO_LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(format, ...)   LOG_WRITE(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...)   ((void)0)
+#endif
+
+#if BRAVO_LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(format, ...)  LOG_WRITE(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...)  ((void)0)
+#endif
+
+#endif // LOG_H
@@ -0,0 +1,78 @@
+/**
+ * @file LogFormats.h
+ * @brief Log message formats for B.R.A.V.O. deferred logging
+ *
+ * Each entry's position in the list is its format ID, which is all a log
+ * record stores of the text. tools/logdecode.py reads this file to rebuild
+ * the messages, so keep one entry per line, append new entries at the end
+ * and never reorder or remove one that has shipped.
+ *
+ * Conversions are printf-style without length modifiers: %d, %u, %x, %X
+ * and %c take integers, %f, %e and %g floats, and %s a string (copied
+ * into the record and truncated to fit).
+ */
+
+#ifndef LOG_FORMATS_H
+#define LOG_FORMATS_H
+
+#define LOG_FORMATS(X) \
+    X(LOG_DROPPED,              "%u log records dropped") \
+    X(LOG_CONFIG_APPLIED,       "Config applied: GPS %u ms, telemetry %u ms, power mode %u, track tolerance %u m") \
+    X(LOG_CONFIG_PHY,           "LoRa %u MHz SF%u BW%u %u dBm") \
+    X(LOG_CONFIG_SAVE_FAILED,   "Failed to persist config") \
+    X(LOG_GEOFENCE_REJECTED,    "Geofence command rejected") \
+    X(LOG_GEOFENCE_SAVE_FAILED, "Failed to persist geofences") \
+    X(LOG_GEOFENCE_EVENT,       "Geofence %u %s") \
+    X(LOG_DOWNLINK_STATUS,      "Downlink command 0x%02X: status %u") \
+    X(LOG_DOWNLINK_QUEUED_ALL,  "Downlink 0x%02X queued for %u collars") \
+    X(LOG_DOWNLINK_QUEUED,      "Downlink 0x%02X queued for %s") \
+    X(LOG_HERD_UPDATE,          "Herd update reached %u/%u collars in %u ms") \
+    X(LOG_TELEMETRY_SENT,       "Telemetry sent via LoRa") \
+    X(LOG_LORA_RX,              "LoRa message received: %u bytes, RSSI %d dBm, SNR %.1f dB") \
+    X(LOG_LORA_RX_TEXT,         "Message: %s") \
+    X(LOG_LORA_RX_TELEMETRY,    "Valid telemetry packet received from %s") \
+    X(LOG_STATUS_HEADER,        "=== Status Update ===") \
+    X(LOG_STATUS_UPTIME,        "Uptime: %u seconds") \
+    X(LOG_STATUS_BATTERY,       "Battery: %u%% (%u mV, %s tier)") \
+    X(LOG_STATUS_NO_BATTERY,    "Battery: not sensed") \
+    X(LOG_STATUS_GPS,           "GPS Fix: %s, satellites: %u") \
+    X(LOG_STATUS_TRACK,         "Track: %u of %u fixes kept, max error %.1f m") \
+    X(LOG_STATUS_DR,            "Dead reckoning: %u steps since fix, +/-%.1f m, stride %.2f m, %u calibrations") \
+    X(LOG_STATUS_BLE,           "BLE connected: %s, state %s (radio-on %.1f ms, avg %.3f mA)") \
+    X(LOG_STATUS_ACTIVITY,      "Activity: level %u, %s, %u motion events and %u steps in %u s") \
+    X(LOG_STATUS_GEOFENCE,      "Geofences: %u (%u vertices), %.1f edges tested per fix") \
+    X(LOG_STATUS_DOWNLINK,      "Downlinks pending: %u, herd update %u/%u acked") \
+    X(LOG_STATUS_OVERRUN,       "Budget overruns: %u (last: %s took %u us at %u ms)") \
+    X(LOG_STATUS_RECORDING,     "Recording: %u records, %u bytes, %u dropped") \
+    X(LOG_STATUS_STREAM,        "IMU Stream: %u Hz, %u sent, %u dropped batches") \
+    X(LOG_STATUS_LOG,           "Log: %u records, %u dropped") \
+    X(LOG_STATUS_FOOTER,        "====================") \
+    X(LOG_STATUS_MEMORY,        "Heap: %u free, %u largest block, %u min free, %u allocations, %u failed") \
+    X(LOG_STATUS_HISTORY,       "History: %u collars, %u points in %u blocks, %.1fx compressed, query %u us") \
+    X(LOG_PROXIMITY_ISOLATED,   "%s left the herd: nearest collar %u m away") \
+    X(LOG_PROXIMITY_REJOINED,   "%s rejoined the herd") \
+    X(LOG_STATUS_PROXIMITY,     "Proximity: %u collars, %u pairs within %u m, %u isolated, sweep %u us") \
+    X(LOG_STATUS_RELAY,         "Relay: level %u, %u direct, %u relayed, %u duplicates, %u forwarded") \
+    X(LOG_CRYPTO_NO_KEY,        "No LoRa key provisioned: frames are sent and accepted in plaintext") \
+    X(LOG_CRYPTO_KEY_SET,       "LoRa key provisioned") \
+    X(LOG_CRYPTO_KEY_INVALID,   "LoRa key must be 32 hex digits") \
+    X(LOG_CRYPTO_KEY_SAVE_FAILED, "Failed to persist LoRa key") \
+    X(LOG_CRYPTO_COUNTER_FAILED, "Failed to reserve LoRa frame counters: sealing stalled") \
+    X(LOG_CRYPTO_IDENTITY,      "Dropped frame sealed for %08X naming another collar") \
+    X(LOG_STATUS_CRYPTO,        "Crypto: %u sealed (%u us), %u opened (%u us), %u rejected") \
+    X(LOG_TIME_SYNCED,          "Time synced from %s, +/-%u us") \
+    X(LOG_TIME_RESTORED,        "Time restored from RTC memory, +/-%u us") \
+    X(LOG_TIME_STEPPED,         "Clock stepped by %d us") \
+    X(LOG_LORA_RX_AGE,          "Telemetry from %s: sample taken %u ms ago") \
+    X(LOG_STATUS_TIME,          "Time: %s, drift %.2f ppm, +/-%u us, %u samples, %u steps") \
+    X(LOG_STATUS_NO_TIME,       "Time: not synced") \
+    X(LOG_STATUS_LATENCY,       "Latency: %u collars, sample to dongle p50 %u / p95 %u / p99 %u ms") \
+    X(LOG_BOOT_DONE,            "Boot: %s firmware, %u bytes flash, %u bytes heap free, ready after %u ms") \
+    X(LOG_LORA_UPLINK_OVERSIZE, "Dropped %u-byte uplink: over the %u-byte budget") \
+    X(LOG_STATUS_UPLINK,        "Uplinks: %u dropped as oversize") \
+    X(LOG_STATUS_TRACK_LOST,    "Track: %u kept fixes lost before uplink, track exceeds tolerance") \
+    X(LOG_PROFILE_TIMING,       "Timing %s: avg %u / p95 %u / max %u us") \
+    X(LOG_PROFILE_ENERGY,       "Energy %s: %u ms on, %.3f mAh") \
+    X(LOG_PROFILE_TOTAL,        "Energy: %.3f mAh total, avg %.1f mA")
+
+#endif // LOG_FORMATS_H
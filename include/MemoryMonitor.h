@@ -0,0 +1,148 @@
+/**
+ * @file MemoryMonitor.h
+ * @brief Heap health and per-subsystem allocation accounting for B.R.A.V.O.
+ *
+ * malloc, calloc, realloc and free are wrapped at link time
+ * (-Wl,--wrap=...; see platformio.ini), so every heap allocation, including
+ * those made by String, ArduinoJson and operator new, is counted. Each one is
+ * charged to the subsystem whose MemoryScope is open on the loop task;
+ * allocations made by other tasks (the BLE host, WiFi) are charged to
+ * "tasks". Net bytes (allocated minus freed) per subsystem show what a
+ * subsystem keeps on the heap between calls.
+ *
+ * With BRAVO_MEMORY_STRICT=1, any allocation on the loop task after
+ * lockHeap() (the end of setup()) fails an assert, whose backtrace points at
+ * the caller.
+ */
+
+#ifndef MEMORY_MONITOR_H
+#define MEMORY_MONITOR_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef BRAVO_MEMORY_STRICT
+#define BRAVO_MEMORY_STRICT 0
+#endif
+
+// Subsystems allocations are charged to
+enum MemorySubsystem : uint8_t {
+    MEM_SETUP = 0,      // Before and during setup()
+    MEM_GPS,
+    MEM_IMU,
+    MEM_FUSION,
+    MEM_TELEMETRY,
+    MEM_LORA_RX,
+    MEM_BLE,
+    MEM_STATUS,         // Status prints, reports and serial commands
+    MEM_LOOP,           // Loop code outside any scope
+    MEM_TASKS,          // Other FreeRTOS tasks
+    MEM_SUBSYSTEM_COUNT
+};
+
+struct MemorySubsystemStats {
+    uint32_t allocations;
+    uint32_t bytes;             // Allocated, including allocator rounding
+    int32_t netBytes;           // Allocated minus freed
+};
+
+struct MemoryStats {
+    uint32_t freeHeap;
+    uint32_t largestFreeBlock;
+    uint32_t minFreeHeap;       // Lowest free heap since boot
+    uint8_t fragmentation;      // 100 - largest block as % of free heap
+    uint32_t allocations;       // All subsystems
+    uint32_t bytes;
+    uint32_t failures;          // Allocations that returned NULL
+    MemorySubsystemStats subsystems[MEM_SUBSYSTEM_COUNT];
+};
+
+class MemoryMonitor {
+public:
+    /**
+     * @brief Constructor for MemoryMonitor
+     */
+    MemoryMonitor();
+
+    /**
+     * @brief Start attributing allocations; call first thing in setup()
+     */
+    void begin();
+
+    /**
+     * @brief Mark the end of setup(); in strict mode later loop allocations assert
+     */
+    void lockHeap();
+
+    /**
+     * @brief Check whether setup() has completed
+     * @return true once lockHeap() was called, false otherwise
+     */
+    bool isHeapLocked();
+
+    /**
+     * @brief Charge loop-task allocations to a subsystem
+     * @param subsystem Subsystem
+     * @return Previous subsystem
+     */
+    MemorySubsystem enter(MemorySubsystem subsystem);
+
+    /**
+     * @brief Get heap state and allocation counts
+     * @return MemoryStats structure
+     */
+    MemoryStats getStats();
+
+    /**
+     * @brief Get name of a subsystem
+     * @param subsystem Subsystem
+     * @return Name string
+     */
+    static const char* subsystemName(uint8_t subsystem);
+
+    /**
+     * @brief Count an allocation (called by the malloc wrappers)
+     * @param size Block size
+     */
+    void onAllocate(size_t size);
+
+    /**
+     * @brief Count a free (called by the malloc wrappers)
+     * @param size Block size
+     */
+    void onFree(size_t size);
+
+    /**
+     * @brief Count a failed allocation (called by the malloc wrappers)
+     */
+    void onFailure();
+
+private:
+    std::atomic<uint32_t> allocations[MEM_SUBSYSTEM_COUNT];
+    std::atomic<uint32_t> bytes[MEM_SUBSYSTEM_COUNT];
+    std::atomic<uint32_t> freedBytes[MEM_SUBSYSTEM_COUNT];
+    std::atomic<uint32_t> failures;
+    volatile uint8_t current;
+    void* loopTask;             // Arduino loop task handle
+    volatile bool locked;
+
+    uint8_t charged();
+};
+
+/**
+ * @brief Charges loop-task allocations in the enclosing scope to a subsystem
+ */
+class MemoryScope {
+public:
+    MemoryScope(MemoryMonitor& monitor, MemorySubsystem subsystem)
+        : monitor(monitor), previous(monitor.enter(subsystem)) {}
+    ~MemoryScope() { monitor.enter(previous); }
+
+private:
+    MemoryMonitor& monitor;
+    MemorySubsystem previous;
+};
+
+extern MemoryMonitor memoryMonitor;
+
+#endif // MEMORY_MONITOR_H
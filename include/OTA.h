@@ -17,6 +17,14 @@
 #define OTA_PORT        3232
 #define OTA_PASSWORD    "bravo123"  // Change in production!
 
+// Network joined when built with BRAVO_OTA=1 (override with -D OTA_WIFI_SSID=...)
+#ifndef OTA_WIFI_SSID
+#define OTA_WIFI_SSID       "YourSSID"
+#endif
+#ifndef OTA_WIFI_PASSWORD
+#define OTA_WIFI_PASSWORD   "YourPassword"
+#endif
+
 class OTA {
 public:
     /**
@@ -0,0 +1,186 @@
+/**
+ * @file Profiler.h
+ * @brief Per-subsystem timing and energy accounting for B.R.A.V.O. devices
+ *
+ * Handler durations are measured with esp_timer and folded into fixed-size
+ * log2 histograms, so the profiler can stay enabled in the field. Radio,
+ * GPS and BLE on-times are combined with a current model to estimate where
+ * the battery goes.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Histogram bucket i counts durations in [2^i, 2^(i+1)) microseconds;
+// the last bucket is open-ended (>= 32 ms)
+#define PROFILER_BUCKETS        16
+
+// Default current model in mA (override with build flags or setCurrentModel)
+#ifndef PROFILER_CPU_ACTIVE_MA
+#define PROFILER_CPU_ACTIVE_MA  40.0f   // ESP32 at 240 MHz above idle
+#endif
+#ifndef PROFILER_LORA_TX_MA
+#define PROFILER_LORA_TX_MA     120.0f  // SX127x at +20 dBm
+#endif
+#ifndef PROFILER_LORA_RX_MA
+#define PROFILER_LORA_RX_MA     11.5f   // SX127x continuous RX
+#endif
+#ifndef PROFILER_GPS_MA
+#define PROFILER_GPS_MA         45.0f   // u-blox NEO-6M tracking
+#endif
+#ifndef PROFILER_BLE_MA
+#define PROFILER_BLE_MA         100.0f  // Radio-on current during BLE events
+#endif
+
+// Timed code sections
+enum ProfileSection : uint8_t {
+    PROF_GPS = 0,
+    PROF_IMU,
+    PROF_TELEMETRY,
+    PROF_LORA_RX,
+    PROF_FUSION,
+    PROF_SECTION_COUNT
+};
+
+// Energy consumers
+enum EnergyConsumer : uint8_t {
+    ENERGY_CPU = 0,
+    ENERGY_LORA_TX,
+    ENERGY_LORA_RX,
+    ENERGY_GPS,
+    ENERGY_BLE,
+    ENERGY_CONSUMER_COUNT
+};
+
+struct ProfileHistogram {
+    uint32_t count;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t buckets[PROFILER_BUCKETS];
+};
+
+struct CurrentModel {
+    float currentMa[ENERGY_CONSUMER_COUNT];
+};
+
+struct EnergySummary {
+    uint32_t elapsedMs;                         // Time since profiling began
+    uint32_t onTimeMs[ENERGY_CONSUMER_COUNT];   // Active time per consumer
+    float mAh[ENERGY_CONSUMER_COUNT];           // Estimated charge per consumer
+    float totalMAh;
+    float avgCurrentMa;                         // totalMAh spread over elapsedMs
+};
+
+class Profiler {
+public:
+    /**
+     * @brief Constructor for Profiler
+     */
+    Profiler();
+
+    /**
+     * @brief Start (or restart) profiling from zero
+     */
+    void begin();
+
+    /**
+     * @brief Get timestamp to pass to record()
+     * @return Microseconds from esp_timer
+     */
+    static uint32_t now();
+
+    /**
+     * @brief Record one section invocation
+     * @param section Section that ran
+     * @param startUs Timestamp from now() taken when the section began
+     */
+    void record(ProfileSection section, uint32_t startUs);
+
+    /**
+     * @brief Report cumulative on-time for a peripheral
+     * @param consumer Consumer (ENERGY_CPU is derived from section times)
+     * @param onTimeMs Total on-time since boot in milliseconds
+     */
+    void setOnTime(EnergyConsumer consumer, uint32_t onTimeMs);
+
+    /**
+     * @brief Replace the current model
+     * @param model Current per consumer in mA
+     */
+    void setCurrentModel(const CurrentModel& model);
+
+    /**
+     * @brief Get the current model
+     * @return CurrentModel structure
+     */
+    CurrentModel getCurrentModel();
+
+    /**
+     * @brief Get histogram for a section
+     * @param section Section to query
+     * @return ProfileHistogram structure
+     */
+    const ProfileHistogram& getHistogram(ProfileSection section);
+
+    /**
+     * @brief Estimate a percentile from a histogram
+     * @param section Section to query
+     * @param percent Percentile (0-100)
+     * @return Upper bound of the bucket holding the percentile, in microseconds
+     */
+    uint32_t getPercentileUs(ProfileSection section, uint8_t percent);
+
+    /**
+     * @brief Compute energy estimate from current on-times
+     * @return EnergySummary structure
+     */
+    EnergySummary getEnergy();
+
+    /**
+     * @brief Get short name of a section
+     * @param section Section
+     * @return Name string
+     */
+    static const char* sectionName(ProfileSection section);
+
+    /**
+     * @brief Get short name of a consumer
+     * @param consumer Consumer
+     * @return Name string
+     */
+    static const char* consumerName(EnergyConsumer consumer);
+
+    /**
+     * @brief Log the timing and energy summary
+     *
+     * One deferred log record per section and consumer (see Log.h), so the
+     * caller never waits on the UART.
+     */
+    void logSummary();
+
+private:
+    ProfileHistogram histograms[PROF_SECTION_COUNT];
+    uint32_t onTimeMs[ENERGY_CONSUMER_COUNT];
+    CurrentModel model;
+    uint32_t startTime;
+};
+
+/**
+ * @brief Times the enclosing scope into a Profiler section
+ */
+class ProfileScope {
+public:
+    ProfileScope(Profiler& profiler, ProfileSection section)
+        : profiler(profiler), section(section), startUs(Profiler::now()) {}
+    ~ProfileScope() { profiler.record(section, startUs); }
+
+private:
+    Profiler& profiler;
+    ProfileSection section;
+    uint32_t startUs;
+};
+
+#endif // PROFILER_H
@@ -0,0 +1,192 @@
+/**
+ * @file ProximityIndex.h
+ * @brief Spatial index over the latest position of every collar (dongle)
+ *
+ * Positions are projected to metres around the first one received and
+ * bucketed into a uniform grid of PROXIMITY_CELL_M cells, hashed into a
+ * fixed bucket table. A received packet moves its collar between buckets
+ * in O(1). Radius queries visit only the cells the circle touches, k-nearest
+ * searches rings of cells outwards until no closer collar can remain, and
+ * the pair sweep compares each collar with its own and neighbouring cells
+ * only, so its cost grows with local density rather than herd size squared.
+ */
+
+#ifndef PROXIMITY_INDEX_H
+#define PROXIMITY_INDEX_H
+
+#include <Arduino.h>
+
+// Collars indexed (override with -D PROXIMITY_MAX_COLLARS=...)
+#ifndef PROXIMITY_MAX_COLLARS
+#define PROXIMITY_MAX_COLLARS   64
+#endif
+
+#define PROXIMITY_CELL_M        50.0f       // Grid cell size
+#define PROXIMITY_MAX_AGE_MS    1800000     // Positions older than this expire
+#define PROXIMITY_NONE          0xFFFF
+
+// BLE_CMD_PROXIMITY modes and reply size
+#define PROXIMITY_QUERY_RADIUS  0       // u16 radius in metres
+#define PROXIMITY_QUERY_NEAREST 1       // u16 k
+#define PROXIMITY_MAX_RESULTS   16      // Collars per reply
+
+struct ProximityEntry {
+    uint32_t collarId;
+    char deviceId[16];
+    double latitude;
+    double longitude;
+    uint64_t timeMs;            // When the position was taken
+    uint16_t neighbours;        // Within the distance of the last pair sweep
+    uint16_t previousNeighbours;  // From the sweep before that
+};
+
+struct ProximityResult {
+    uint16_t index;             // Entry index (see getEntry)
+    float distanceM;
+};
+
+struct ProximityPair {
+    uint16_t a;
+    uint16_t b;
+    float distanceM;
+};
+
+class ProximityIndex {
+public:
+    /**
+     * @brief Constructor for ProximityIndex
+     */
+    ProximityIndex();
+
+    /**
+     * @brief Allocate the index
+     * @param maxCollars Number of collars to hold
+     * @param cellSizeM Grid cell size in metres
+     * @return true if successful, false otherwise
+     */
+    bool begin(uint16_t maxCollars = PROXIMITY_MAX_COLLARS, float cellSizeM = PROXIMITY_CELL_M);
+
+    /**
+     * @brief Set or move a collar's position
+     * @param collarId Collar ID (Downlink::hashDeviceId)
+     * @param deviceId Device ID string
+     * @param timeMs Receive time, Unix ms once time is known
+     * @param latitude Latitude in degrees
+     * @param longitude Longitude in degrees
+     * @return true if indexed, false if the index is full
+     */
+    bool update(uint32_t collarId, const char* deviceId, uint64_t timeMs,
+                double latitude, double longitude);
+
+    /**
+     * @brief Drop collars not heard from within PROXIMITY_MAX_AGE_MS
+     * @param nowMs Current time, on the same clock as the updates
+     * @return Number of collars removed
+     */
+    uint16_t expire(uint64_t nowMs);
+
+    /**
+     * @brief Find collars within a radius of a point, nearest first
+     * @param latitude Latitude in degrees
+     * @param longitude Longitude in degrees
+     * @param radiusM Radius in metres
+     * @param results Buffer for the results
+     * @param maxResults Buffer size
+     * @return Number of results written
+     */
+    size_t findWithin(double latitude, double longitude, float radiusM,
+                      ProximityResult* results, size_t maxResults);
+
+    /**
+     * @brief Find the k collars nearest to a point, nearest first
+     * @param latitude Latitude in degrees
+     * @param longitude Longitude in degrees
+     * @param k Number of collars wanted
+     * @param results Buffer for at least k results
+     * @return Number of results written
+     */
+    size_t findNearest(double latitude, double longitude, size_t k, ProximityResult* results);
+
+    /**
+     * @brief Find all pairs of collars within a distance, and count neighbours
+     * @param distanceM Pair distance in metres
+     * @param pairs Buffer for the pairs (may be nullptr to only count)
+     * @param maxPairs Buffer size
+     * @return Number of pairs found (more than written if the buffer is full)
+     */
+    size_t findPairs(float distanceM, ProximityPair* pairs, size_t maxPairs);
+
+    /**
+     * @brief Find pairs by comparing every collar with every other one
+     * @param distanceM Pair distance in metres
+     * @return Number of pairs found (reference for findPairs)
+     */
+    size_t findPairsBruteForce(float distanceM);
+
+    /**
+     * @brief Get an entry by index
+     * @param index Entry index (0 to getCapacity() - 1)
+     * @return Entry, or nullptr if the slot is empty
+     */
+    const ProximityEntry* getEntry(uint16_t index);
+
+    /**
+     * @brief Look up a collar's entry index
+     * @param collarId Collar ID
+     * @return Entry index, or PROXIMITY_NONE
+     */
+    uint16_t find(uint32_t collarId);
+
+    /**
+     * @brief Get number of collars indexed
+     * @return Collar count
+     */
+    uint16_t getCount();
+
+    /**
+     * @brief Get number of entry slots
+     * @return Capacity
+     */
+    uint16_t getCapacity();
+
+private:
+    struct Node {
+        float x;                // Metres east of the origin
+        float y;                // Metres north of the origin
+        int16_t cellX;
+        int16_t cellY;
+        uint16_t cellNext;      // Next entry in the same cell bucket
+        uint16_t cellPrev;
+        uint16_t idNext;        // Next entry in the same ID bucket, or next free
+        bool used;
+    };
+
+    ProximityEntry* entries;
+    Node* nodes;
+    uint16_t* cellBuckets;
+    uint16_t* idBuckets;
+    uint16_t capacity;
+    uint16_t bucketMask;
+    uint16_t count;
+    uint16_t freeList;
+    float cellSize;
+
+    bool hasOrigin;
+    double originLat;
+    double originLon;
+    float metresPerDegreeLon;
+
+    void project(double latitude, double longitude, float& x, float& y);
+    int16_t toCell(float metres);
+    uint16_t cellBucket(int16_t cellX, int16_t cellY);
+    uint16_t idBucket(uint32_t collarId);
+    void link(uint16_t index);
+    void unlink(uint16_t index);
+    void remove(uint16_t index);
+    size_t visitCell(int16_t cellX, int16_t cellY, float x, float y, float radiusM,
+                     ProximityResult* results, size_t found, size_t maxResults);
+    size_t scanAll(float x, float y, float radiusM, ProximityResult* results,
+                   size_t maxResults);
+};
+
+#endif // PROXIMITY_INDEX_H
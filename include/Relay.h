@@ -0,0 +1,233 @@
+/**
+ * @file Relay.h
+ * @brief Multi-hop forwarding of collar uplinks beyond the dongle's range
+ *
+ * In relay mode a collar wraps its uplinks in a relay header naming the
+ * originating collar and a per-collar sequence number, and keeps its receiver
+ * on so it can forward the uplinks of collars that cannot reach the dongle.
+ *
+ * The dongle sends a short beacon every RELAY_BEACON_INTERVAL_MS, which
+ * collars forward like uplinks. The hops a beacon took tell a collar its
+ * level, its distance in hops from the dongle. Only beacon copies received
+ * RELAY_LINK_MARGIN_DB above the sensitivity floor count, so only collars
+ * with a solid link towards the dongle take a level and forward; the others
+ * stay unknown and are forwarded for. Every frame carries the level of the
+ * collar that sent it, and only collars closer to the dongle forward it, so
+ * traffic flows towards the dongle instead of flooding the herd. Further
+ * flooding is kept in check by:
+ *
+ *   - a hop limit carried in the header (RELAY_MAX_HOPS),
+ *   - a bounded cache of (origin, sequence) pairs already seen, so every
+ *     collar forwards a frame at most once and the dongle delivers it once,
+ *   - a randomized rebroadcast delay that is shorter the weaker the frame was
+ *     received, so the collar furthest from the sender (the one adding the
+ *     most coverage) usually goes first, and everyone else cancels their
+ *     pending copy on hearing it,
+ *   - no forwarding at all of frames received above RELAY_RSSI_SUPPRESS_DBM:
+ *     the sender is close by, so a rebroadcast would reach nobody new.
+ *
+ * The dongle runs the same class to build beacons, unwrap uplinks and drop
+ * the copies that arrive over several paths; it never forwards.
+ */
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <Arduino.h>
+
+// Frame layout
+#define RELAY_MAGIC                 0xB8
+#define RELAY_TYPE_UPLINK           0x01    // Collar uplink as payload
+#define RELAY_TYPE_BEACON           0x02    // From the dongle, no payload
+#define RELAY_MAX_FRAME             255     // LoRa payload limit
+
+// Dongle beacons; a collar forgets its level after missing a few
+#define RELAY_BEACON_INTERVAL_MS    60000
+#define RELAY_LEVEL_TIMEOUT_MS      (5 * RELAY_BEACON_INTERVAL_MS)
+#define RELAY_LEVEL_UNKNOWN         0xFF
+
+// Flood control
+#define RELAY_MAX_HOPS              3       // Forwards a frame may take
+#define RELAY_CACHE_SIZE            64      // (origin, sequence) pairs remembered
+#define RELAY_QUEUE_SIZE            4       // Frames waiting for their rebroadcast
+#define RELAY_RSSI_SUPPRESS_DBM     -90     // Heard this strongly: don't forward
+#define RELAY_RSSI_FLOOR_DBM        -124    // Sensitivity at SF7 / 125 kHz
+#define RELAY_LINK_MARGIN_DB        5       // Above the floor for a usable link
+
+// Rebroadcast delay in slots of roughly one uplink's time on air: at least
+// RELAY_DELAY_MIN_SLOTS, up to RELAY_DELAY_SPREAD_SLOTS more for strong
+// frames, plus up to one slot of jitter
+#define RELAY_SLOT_MS               400     // At SF7 / 125 kHz
+#define RELAY_DELAY_MIN_SLOTS       1
+#define RELAY_DELAY_SPREAD_SLOTS    12
+
+struct __attribute__((packed)) RelayHeader {
+    uint8_t magic;       // RELAY_MAGIC
+    uint8_t type;        // RELAY_TYPE_*
+    uint8_t ttl;         // Forwards left
+    uint8_t hops;        // Forwards taken so far
+    uint8_t level;       // Level of the device that sent it (0 = dongle)
+    uint32_t origin;     // Originating device (Downlink::hashDeviceId)
+    uint16_t sequence;   // Per-origin frame sequence
+};
+
+struct RelayStats {
+    uint32_t received;          // Relay frames heard
+    uint32_t duplicates;        // Already seen (not delivered or forwarded again)
+    uint32_t beacons;           // New dongle beacons
+    uint32_t weakBeacons;       // Beacon copies below the link margin (ignored)
+    uint32_t firstDirect;       // New uplinks straight from their origin
+    uint32_t firstRelayed;      // New uplinks that took at least one hop
+    uint32_t forwarded;         // Frames rebroadcast
+    uint32_t forwardedBytes;
+    uint32_t notCloser;         // Not forwarded: sender as close to the dongle as us
+    uint32_t suppressedRssi;    // Not forwarded: sender too close
+    uint32_t suppressedHeard;   // Cancelled: another collar forwarded it first
+    uint32_t hopLimit;          // Not forwarded: no hops left
+    uint32_t queueFull;         // Not forwarded: no room to hold it
+};
+
+class Relay {
+public:
+    /**
+     * @brief Constructor for Relay
+     * @param deviceId This device's ID (hashed as the origin of its frames)
+     * @param dongle true on the dongle (level 0, never forwards)
+     */
+    Relay(const char* deviceId, bool dongle);
+
+    /**
+     * @brief Check whether a received packet is a relay frame
+     * @param data Packet bytes
+     * @param length Packet length
+     * @return true if the packet carries a relay header, false otherwise
+     */
+    static bool isFrame(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Turn relay mode on or off
+     *
+     * On a collar this wraps its uplinks and forwards others'; on the dongle
+     * it only gates beacons. Relay frames are unwrapped either way.
+     *
+     * @param enabled true to relay
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Check if relay mode is on
+     * @return true if enabled, false otherwise
+     */
+    bool isEnabled();
+
+    /**
+     * @brief Scale the rebroadcast delay to the LoRa PHY in use
+     * @param spreadingFactor Spreading factor
+     * @param bandwidth Bandwidth in Hz
+     */
+    void setPHY(uint8_t spreadingFactor, long bandwidth);
+
+    /**
+     * @brief Get this device's distance in hops from the dongle
+     * @return Level, or RELAY_LEVEL_UNKNOWN if no recent beacon was heard
+     */
+    uint8_t getLevel();
+
+    /**
+     * @brief Build a beacon (dongle)
+     * @param frame Buffer for at least sizeof(RelayHeader) bytes
+     * @return Frame length
+     */
+    size_t beacon(uint8_t* frame);
+
+    /**
+     * @brief Wrap one of our own uplinks in a relay header
+     * @param payload Uplink bytes
+     * @param length Uplink length
+     * @param frame Buffer for the frame
+     * @param maxLength Buffer size
+     * @return Frame length, or 0 if it does not fit (send the uplink unwrapped)
+     */
+    size_t wrap(const uint8_t* payload, size_t length, uint8_t* frame, size_t maxLength);
+
+    /**
+     * @brief Handle a received relay frame
+     *
+     * New frames are queued for rebroadcast when relaying is enabled and the
+     * flood rules allow it; beacons also update our level. A duplicate
+     * cancels a pending rebroadcast of the same frame.
+     *
+     * @param frame Frame bytes (payload follows the header)
+     * @param length Frame length
+     * @param rssi Received power in dBm
+     * @param nowMs Current time
+     * @param header Reference to store the frame header
+     * On the dongle a new uplink is only checked against the cache of frames
+     * seen; it is recorded by accept() once its payload authenticates.
+     *
+     * @return true if the frame is a new uplink, false otherwise
+     */
+    bool receive(const uint8_t* frame, size_t length, int rssi, uint32_t nowMs,
+                 RelayHeader& header);
+
+    /**
+     * @brief Record an uplink the dongle delivered (dongle)
+     *
+     * Later copies of it are then dropped as duplicates.
+     *
+     * @param header Header from receive()
+     */
+    void accept(const RelayHeader& header);
+
+    /**
+     * @brief Take the next frame whose rebroadcast is due
+     * @param nowMs Current time
+     * @param frame Buffer for the frame
+     * @param maxLength Buffer size
+     * @return Frame length, or 0 if nothing is due
+     */
+    size_t poll(uint32_t nowMs, uint8_t* frame, size_t maxLength);
+
+    /**
+     * @brief Get forwarding and duplicate statistics
+     * @return RelayStats structure
+     */
+    RelayStats getStats();
+
+private:
+    struct SeenFrame {
+        uint32_t origin;
+        uint16_t sequence;
+    };
+
+    struct PendingFrame {
+        uint32_t dueMs;
+        uint8_t length;         // 0 = slot free
+        uint8_t data[RELAY_MAX_FRAME];
+    };
+
+    uint32_t ownId;
+    uint16_t sequence;
+    bool dongle;
+    bool enabled;
+    uint32_t slotMs;
+    int floorDbm;               // Sensitivity for the PHY in use
+    uint8_t level;
+    uint32_t levelMs;           // When the level was last confirmed by a beacon
+
+    SeenFrame seen[RELAY_CACHE_SIZE];
+    uint8_t seenCount;
+    uint8_t seenNext;           // Oldest entry, overwritten next
+
+    PendingFrame pending[RELAY_QUEUE_SIZE];
+    RelayStats stats;
+
+    bool wasSeen(uint32_t origin, uint16_t sequence);
+    void remember(uint32_t origin, uint16_t sequence);
+    void countFirst(const RelayHeader& header);
+    void queue(const RelayHeader& header, const uint8_t* frame, size_t length, int rssi,
+               uint32_t nowMs);
+    uint32_t rebroadcastDelay(int rssi);
+};
+
+#endif // RELAY_H
@@ -0,0 +1,36 @@
+/**
+ * @file Role.h
+ * @brief Compile-time device role and optional features for B.R.A.V.O. firmware
+ *
+ * Collars and the dongle build from the same tree as separate PlatformIO
+ * environments (collar, dongle), which set BRAVO_ROLE_COLLAR. Each role
+ * leaves out what only the other one uses:
+ *
+ *   collar  IMU (MPU6050), activity summary, dead reckoning, track filter,
+ *           geofences, data log, IMU stream, sensor recording, downlink handler
+ *   dongle  downlink queue, position history, proximity index, latency tracker
+ *   both    LoRa, GPS and time, BLE, telemetry, relay, frame crypto, battery
+ *
+ * Sources of the other role's modules are filtered out of the build, their
+ * instances and handlers in main.cpp are under #if BRAVO_ROLE_COLLAR, and
+ * their libraries are not linked. Code both roles run picks its branch with
+ * if constexpr on DEVICE_TYPE_COLLAR, so the other branch is not compiled in.
+ */
+
+#ifndef ROLE_H
+#define ROLE_H
+
+// 1 = collar, 0 = dongle
+#ifndef BRAVO_ROLE_COLLAR
+#define BRAVO_ROLE_COLLAR   1
+#endif
+
+// WiFi OTA updates (see OTA.h); off unless asked for, as the WiFi stack
+// is the largest thing either role would link
+#ifndef BRAVO_OTA
+#define BRAVO_OTA           0
+#endif
+
+constexpr bool DEVICE_TYPE_COLLAR = BRAVO_ROLE_COLLAR != 0;
+
+#endif // ROLE_H
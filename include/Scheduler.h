@@ -0,0 +1,70 @@
+/**
+ * @file Scheduler.h
+ * @brief Periodic task scheduler for the B.R.A.V.O. main loop
+ *
+ * This module keeps the interval and last-run time of each periodic task so
+ * intervals can be changed at runtime (e.g. from a config update) instead of
+ * being fixed at compile time.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+class Scheduler {
+public:
+    /**
+     * @brief Constructor for Scheduler
+     */
+    Scheduler();
+
+    /**
+     * @brief Set the interval of a task
+     * @param task Task index (0..SCHEDULER_MAX_TASKS-1)
+     * @param intervalMs Interval in milliseconds
+     */
+    void setInterval(uint8_t task, uint32_t intervalMs);
+
+    /**
+     * @brief Get the interval of a task
+     * @param task Task index
+     * @return Interval in milliseconds
+     */
+    uint32_t getInterval(uint8_t task);
+
+    /**
+     * @brief Check if a task is due, and re-arm it if so
+     * @param task Task index
+     * @return true if the interval has elapsed, false otherwise
+     */
+    bool isDue(uint8_t task);
+
+    /**
+     * @brief Make a task due on its next check
+     * @param task Task index
+     */
+    void trigger(uint8_t task);
+
+    /**
+     * @brief Make a task due after a delay, then every interval from there
+     * @param task Task index
+     * @param delayMs Milliseconds until due
+     */
+    void setNextDue(uint8_t task, uint32_t delayMs);
+
+    /**
+     * @brief Get the time left until a task is due
+     * @param task Task index
+     * @return Milliseconds until due (0 if already due)
+     */
+    uint32_t getTimeUntilDue(uint8_t task);
+
+private:
+    uint32_t intervals[SCHEDULER_MAX_TASKS];
+    uint32_t lastRun[SCHEDULER_MAX_TASKS];
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,249 @@
+/**
+ * @file SensorRecorder.h
+ * @brief Raw GPS/IMU stream recording for B.R.A.V.O. field debugging
+ *
+ * Records exactly what the modules were fed: the raw NMEA bytes read from
+ * the GPS UART and every IMU reading (or failed read), each with a micros()
+ * timestamp, plus the activity decisions the firmware took from them. A
+ * recording replays deterministically through SensorReplay, on the host or
+ * on a bench unit.
+ *
+ * Recordings are a RecordingHeader followed by records, each a RecordHeader
+ * and `length` payload bytes (all little-endian). They go to a file (flash
+ * on the ESP32) or to serial as "REC <hex>" lines, which
+ * tools/rec_extract.py turns back into a file.
+ */
+
+#ifndef SENSOR_RECORDER_H
+#define SENSOR_RECORDER_H
+
+#include <Arduino.h>
+#include "hal/HAL.h"
+
+#ifdef BRAVO_NATIVE
+#include <stdio.h>
+#else
+#include <FS.h>
+#endif
+
+#define RECORDING_MAGIC     0x56525242  // "BRRV"
+#define RECORDING_VERSION   1
+
+// Longest run of UART bytes stored in one record
+#define RECORDER_CHUNK_MAX  64
+
+// Records are batched in RAM before reaching the sink
+#ifndef RECORDER_BUFFER_SIZE
+#define RECORDER_BUFFER_SIZE 512
+#endif
+
+// Serial sink line prefix
+#define RECORDER_SERIAL_PREFIX "REC "
+
+enum RecordType : uint8_t {
+    RECORD_NMEA = 1,        // Raw GPS UART bytes
+    RECORD_IMU = 2,         // IMUReading
+    RECORD_IMU_FAIL = 3,    // Sensor read failed (no payload)
+    RECORD_ACTIVITY = 4     // ActivityRecord
+};
+
+struct __attribute__((packed)) RecordingHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t imuReadingSize;     // sizeof(IMUReading) on the recorder
+    uint16_t reserved;
+};
+
+struct __attribute__((packed)) RecordHeader {
+    uint32_t timestampUs;       // micros() when recorded (wraps every ~71 min)
+    uint8_t type;
+    uint8_t length;
+};
+
+// Activity decision taken from the IMU reading just before it
+struct __attribute__((packed)) ActivityRecord {
+    uint8_t activity;           // IMU::getActivityLevel()
+    uint8_t inMotion;           // IMU::isInMotion(motionThreshold)
+    float motionThreshold;
+};
+
+struct RecorderStats {
+    bool active;
+    uint32_t records;
+    uint32_t bytes;             // Bytes handed to the sink
+    uint32_t dropped;           // Bytes the sink refused
+};
+
+/**
+ * @brief Destination for recording bytes
+ */
+class RecordSink {
+public:
+    virtual ~RecordSink() {}
+
+    /**
+     * @brief Write bytes
+     * @param data Bytes to write
+     * @param length Number of bytes
+     * @return Number of bytes written
+     */
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+
+    /**
+     * @brief Push buffered bytes out
+     */
+    virtual void flush() {}
+};
+
+/**
+ * @brief Source of recording bytes
+ */
+class RecordSource {
+public:
+    virtual ~RecordSource() {}
+
+    /**
+     * @brief Read bytes
+     * @param data Buffer to fill
+     * @param length Bytes wanted
+     * @return Number of bytes read (less at end of recording)
+     */
+    virtual size_t read(uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * @brief Sink writing "REC <hex>" lines to a serial port
+ */
+class SerialRecordSink : public RecordSink {
+public:
+    /**
+     * @brief Constructor for SerialRecordSink
+     * @param out Port to write to
+     */
+    SerialRecordSink(Print& out);
+
+    size_t write(const uint8_t* data, size_t length) override;
+
+private:
+    Print& out;
+};
+
+/**
+ * @brief Recording file (LittleFS on the ESP32, host file system natively)
+ */
+class RecordFile : public RecordSink, public RecordSource {
+public:
+    RecordFile();
+    ~RecordFile();
+
+    /**
+     * @brief Open a recording
+     * @param path File path
+     * @param writing true to create/truncate, false to read
+     * @return true if opened, false otherwise
+     */
+    bool open(const char* path, bool writing);
+
+    /**
+     * @brief Close the file
+     */
+    void close();
+
+    /**
+     * @brief Get file size
+     * @return Size in bytes (0 if not open)
+     */
+    size_t size();
+
+    size_t write(const uint8_t* data, size_t length) override;
+    void flush() override;
+    size_t read(uint8_t* data, size_t length) override;
+
+private:
+#ifdef BRAVO_NATIVE
+    FILE* file;
+#else
+    fs::File file;
+#endif
+};
+
+class SensorRecorder {
+public:
+    /**
+     * @brief Constructor for SensorRecorder
+     */
+    SensorRecorder();
+
+    /**
+     * @brief Start recording
+     * @param sink Destination (must outlive the recording)
+     * @return true if the header was written, false otherwise
+     */
+    bool begin(RecordSink& sink);
+
+    /**
+     * @brief Flush everything and stop recording
+     */
+    void end();
+
+    /**
+     * @brief Check if a recording is in progress
+     * @return true if recording, false otherwise
+     */
+    bool isRecording();
+
+    /**
+     * @brief Record one byte read from the GPS UART
+     * @param value Byte value
+     */
+    void recordUartByte(uint8_t value);
+
+    /**
+     * @brief Mark the end of a burst of UART bytes (closes the chunk)
+     */
+    void endUartBurst();
+
+    /**
+     * @brief Record an IMU reading
+     * @param reading Reading returned by the sensor
+     */
+    void recordImu(const IMUReading& reading);
+
+    /**
+     * @brief Record a failed IMU read
+     */
+    void recordImuFailure();
+
+    /**
+     * @brief Record an activity decision
+     * @param activity Activity level (0-100)
+     * @param inMotion Motion detector result
+     * @param motionThreshold Threshold passed to the motion detector
+     */
+    void recordActivity(uint8_t activity, bool inMotion, float motionThreshold);
+
+    /**
+     * @brief Hand buffered records to the sink
+     */
+    void flush();
+
+    /**
+     * @brief Get recording statistics
+     * @return RecorderStats structure
+     */
+    RecorderStats getStats();
+
+private:
+    RecordSink* sink;
+    uint8_t chunk[RECORDER_CHUNK_MAX];
+    uint8_t chunkLength;
+    uint32_t chunkStartUs;
+    uint8_t buffer[RECORDER_BUFFER_SIZE];
+    size_t bufferLength;
+    RecorderStats stats;
+
+    void append(uint8_t type, uint32_t timestampUs, const void* payload, uint8_t length);
+    void writeToSink(const uint8_t* data, size_t length);
+};
+
+#endif // SENSOR_RECORDER_H
@@ -0,0 +1,111 @@
+/**
+ * @file SensorReplay.h
+ * @brief Deterministic replay of recorded GPS/IMU streams
+ *
+ * Feeds a SensorRecorder recording back through the real GPS and IMU
+ * modules, either paced by the recorded timestamps or as fast as possible,
+ * and checks every recorded activity decision against the one the modules
+ * make from the replayed data.
+ */
+
+#ifndef SENSOR_REPLAY_H
+#define SENSOR_REPLAY_H
+
+#include <Arduino.h>
+#include "SensorRecorder.h"
+#include "GPS.h"
+#include "IMU.h"
+#include "hal/RecordHAL.h"
+
+enum ReplaySpeed : uint8_t {
+    REPLAY_REALTIME = 0,    // Wait for each record's recorded time
+    REPLAY_FAST = 1         // No waiting
+};
+
+// Recorded activity decision and the one reproduced from the replay
+struct ReplayDecision {
+    uint64_t timestampUs;       // Since the first record
+    uint8_t recordedActivity;
+    uint8_t replayedActivity;
+    bool recordedInMotion;
+    bool replayedInMotion;
+};
+
+struct ReplayStats {
+    uint32_t records;
+    uint32_t nmeaBytes;
+    uint32_t imuSamples;
+    uint32_t imuFailures;
+    uint32_t decisions;
+    uint32_t mismatches;
+    uint32_t skipped;           // Unknown or malformed records
+    uint64_t firstMismatchUs;   // Since the first record (0 if none)
+    uint64_t durationUs;        // Recorded time covered so far
+};
+
+class SensorReplay {
+public:
+    /**
+     * @brief Constructor for SensorReplay
+     * @param source Recording to read
+     * @param uart Port the GPS module was constructed on
+     * @param sensor Sensor the IMU module was constructed on
+     * @param gps GPS module to feed (begin() already called)
+     * @param imu IMU module to feed (begin() already called)
+     * @param clock Clock used for realtime pacing
+     */
+    SensorReplay(RecordSource& source, ReplayUart& uart, ReplayImu& sensor,
+                 GPS& gps, IMU& imu, ClockHAL& clock);
+
+    /**
+     * @brief Read and check the recording header
+     * @param speed Pacing mode
+     * @return true if the recording can be replayed, false otherwise
+     */
+    bool begin(ReplaySpeed speed);
+
+    /**
+     * @brief Replay the next record
+     * @return RecordType replayed, or 0 at the end of the recording
+     */
+    uint8_t step();
+
+    /**
+     * @brief Replay the rest of the recording
+     * @return true if every activity decision matched, false otherwise
+     */
+    bool run();
+
+    /**
+     * @brief Get the decision checked by the last RECORD_ACTIVITY step
+     * @return ReplayDecision structure
+     */
+    ReplayDecision getLastDecision();
+
+    /**
+     * @brief Get replay statistics
+     * @return ReplayStats structure
+     */
+    ReplayStats getStats();
+
+private:
+    RecordSource& source;
+    ReplayUart& uart;
+    ReplayImu& sensor;
+    GPS& gps;
+    IMU& imu;
+    ClockHAL& clock;
+    ReplaySpeed speed;
+    bool started;
+    uint32_t lastTimestampUs;
+    uint64_t recordUs;
+    uint32_t lastClockUs;
+    uint64_t clockElapsedUs;
+    uint8_t payload[255];
+    ReplayDecision lastDecision;
+    ReplayStats stats;
+
+    void waitUntil(uint64_t elapsedUs);
+};
+
+#endif // SENSOR_REPLAY_H
@@ -13,6 +13,60 @@
 #include <ArduinoJson.h>
 #include "GPS.h"
 #include "IMU.h"
+#include "Profiler.h"
+#include "BatteryMonitor.h"
+#include "TrackFilter.h"
+#include "DeadReckoning.h"
+#include "ActivitySummary.h"
+#include "MemoryMonitor.h"
+#include "TimeService.h"
+#include "LatencyTracker.h"
+#include "FrameCrypto.h"
+#include "Relay.h"
+
+// Largest uplink that still fits one LoRa frame once sealed and relay-wrapped
+#define TELEMETRY_MAX_UPLINK    (CRYPTO_MAX_FRAME - CRYPTO_OVERHEAD - sizeof(RelayHeader))
+
+// Buffer for the longest JSON packet, a full status report with every
+// memory subsystem, including the terminator
+#define TELEMETRY_JSON_MAX      1536
+
+// Binary activity record, the LoRa form of createActivityTelemetry()
+#define ACTIVITY_UPLINK_MAGIC   0xB6
+#define ACTIVITY_UPLINK_FIX       0x01    // Position present
+#define ACTIVITY_UPLINK_DR        0x02    // Dead-reckoned position present
+#define ACTIVITY_UPLINK_ABS_TIME  0x04    // time is ms into the UTC hour, else millis()
+#define ACTIVITY_UPLINK_LATENCY   0x08    // Latency stages present
+
+// Fixed part of an activity record; the device ID follows, nameLength bytes.
+// Fields without their flag set are zero.
+struct __attribute__((packed)) ActivityUplink {
+    uint8_t magic;                  // ACTIVITY_UPLINK_MAGIC
+    uint8_t flags;                  // ACTIVITY_UPLINK_*
+    uint32_t time;                  // "ts" or "timestamp"
+    uint8_t battery;
+    uint32_t sampleMs;              // Latency stages, clamped to LATENCY_MAX_MS
+    uint16_t queueMs;
+    uint16_t airMs;
+    int32_t latitude;               // 1e-7 degrees
+    int32_t longitude;
+    int16_t altitudeM;
+    uint16_t speed;                 // 0.1 km/h
+    uint16_t course;                // 0.01 degrees
+    uint8_t satellites;
+    int32_t drLatitude;             // 1e-7 degrees
+    int32_t drLongitude;
+    uint16_t drErrorDm;             // Uncertainty, 0.1 m
+    uint16_t drSteps;
+    uint32_t periodDs;              // Summary interval, 0.1 s
+    uint32_t classDs[ACTIVITY_CLASS_COUNT];  // Rest/walk/run, 0.1 s
+    uint8_t mean;
+    uint8_t histogram[ACTIVITY_HISTOGRAM_BINS];  // Percent of samples per bin
+    uint16_t peak;                  // 0.1 m/s^2
+    uint16_t motionEvents;
+    uint16_t steps;
+    uint8_t nameLength;
+};
 
 // Telemetry packet types
 enum TelemetryType {
@@ -20,7 +74,8 @@ enum TelemetryType {
     TELEMETRY_GPS,       // GPS data only
     TELEMETRY_IMU,       // IMU data only
     TELEMETRY_STATUS,    // Status/health data
-    TELEMETRY_ALERT      // Alert/event data
+    TELEMETRY_ALERT,     // Alert/event data
+    TELEMETRY_ACTIVITY   // Position with a summary of activity since the last report
 };
 
 class Telemetry {
@@ -30,16 +85,87 @@ public:
      */
     Telemetry();
 
+    /**
+     * @brief Stamp packets with absolute time once it is known
+     * @param timeService Time service, or nullptr for millis() stamps only
+     */
+    void setTimeService(TimeService* timeService);
+
     /**
      * @brief Create full telemetry JSON packet
      * @param gpsData GPS data structure
      * @param imuData IMU data structure
      * @param deviceId Device identifier
      * @param battery Battery level (0-100)
+     * @param estimate Optional dead-reckoned position, included once it has moved on from the fix
      * @return JSON string with telemetry data
      */
     String createFullTelemetry(const GPSData& gpsData, const IMUData& imuData, 
-                               const char* deviceId, uint8_t battery);
+                               const char* deviceId, uint8_t battery,
+                               const DeadReckoningEstimate* estimate = nullptr);
+
+    /**
+     * @brief Create activity telemetry packet
+     *
+     * For BLE and serial; over LoRa use encodeActivityUplink().
+     *
+     * @param gpsData GPS data, or nullptr for a heartbeat without position
+     * @param summary Activity summary of the report interval
+     * @param deviceId Device identifier
+     * @param battery Battery level (0-100)
+     * @param estimate Optional dead-reckoned position, included once it has moved on from the fix
+     * @param latency Optional collar latency stages
+     * @param output Buffer for the JSON
+     * @param maxLength Size of the buffer
+     * @return JSON length, or 0 if it does not fit
+     */
+    size_t createActivityTelemetry(const GPSData* gpsData, const ActivitySummaryData& summary,
+                                   const char* deviceId, uint8_t battery,
+                                   const DeadReckoningEstimate* estimate,
+                                   const LatencyReport* latency,
+                                   char* output, size_t maxLength);
+
+    /**
+     * @brief Encode the activity packet as a binary record for LoRa
+     *
+     * Carries what createActivityTelemetry() does in under half of
+     * TELEMETRY_MAX_UPLINK, where the JSON form would not fit.
+     *
+     * @param gpsData GPS data, or nullptr for a heartbeat without position
+     * @param summary Activity summary of the report interval
+     * @param deviceId Device identifier (truncated to 31 characters)
+     * @param battery Battery level (0-100)
+     * @param estimate Optional dead-reckoned position
+     * @param latency Optional collar latency stages
+     * @param record Buffer for the record
+     * @param maxLength Size of the buffer
+     * @return Record length, or 0 if it does not fit
+     */
+    size_t encodeActivityUplink(const GPSData* gpsData, const ActivitySummaryData& summary,
+                                const char* deviceId, uint8_t battery,
+                                const DeadReckoningEstimate* estimate,
+                                const LatencyReport* latency,
+                                uint8_t* record, size_t maxLength);
+
+    /**
+     * @brief Check whether a received packet is a binary activity record
+     * @param data Packet bytes
+     * @param length Packet length
+     * @return true if it is, false otherwise (JSON telemetry)
+     */
+    static bool isActivityUplink(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Parse a binary activity record
+     *
+     * The record is decoded into the same fields as the JSON packet, so the
+     * getters below work on either.
+     *
+     * @param data Record bytes
+     * @param length Record length
+     * @return true if parsing successful, false otherwise
+     */
+    bool parseActivityUplink(const uint8_t* data, size_t length);
 
     /**
      * @brief Create GPS-only telemetry packet
@@ -63,27 +189,41 @@ public:
      * @param battery Battery level (0-100)
      * @param uptime Uptime in seconds
      * @param rssi Signal strength
-     * @return JSON string with status data
+     * @param profiler Optional profiler whose timing/energy summary is included
+     * @param batteryStatus Optional voltage, power tier and predicted runtime
+     * @param trackStats Optional track simplification counts and error
+     * @param memoryStats Optional heap state and per-subsystem allocations
+     * @param output Buffer for the JSON
+     * @param maxLength Size of the buffer
+     * @return JSON length, or 0 if it does not fit
      */
-    String createStatusTelemetry(const char* deviceId, uint8_t battery, 
-                                 uint32_t uptime, int rssi);
+    size_t createStatusTelemetry(const char* deviceId, uint8_t battery, 
+                                 uint32_t uptime, int rssi,
+                                 Profiler* profiler,
+                                 const BatteryStatus* batteryStatus,
+                                 const TrackStats* trackStats,
+                                 const MemoryStats* memoryStats,
+                                 char* output, size_t maxLength);
 
     /**
      * @brief Create alert telemetry packet
      * @param deviceId Device identifier
      * @param alertType Type of alert
      * @param message Alert message
-     * @return JSON string with alert data
+     * @param output Buffer for the JSON
+     * @param maxLength Size of the buffer
+     * @return JSON length, or 0 if it does not fit
      */
-    String createAlertTelemetry(const char* deviceId, const char* alertType, 
-                                const char* message);
+    size_t createAlertTelemetry(const char* deviceId, const char* alertType, 
+                                const char* message, char* output, size_t maxLength);
 
     /**
      * @brief Parse incoming JSON telemetry
-     * @param json JSON string to parse
+     * @param json JSON text, not necessarily terminated
+     * @param length Length of the text
      * @return true if parsing successful, false otherwise
      */
-    bool parseTelemetry(const String& json);
+    bool parseTelemetry(const char* json, size_t length);
 
     /**
      * @brief Get last parsed telemetry type
@@ -91,12 +231,45 @@ public:
      */
     TelemetryType getLastType();
 
+    /**
+     * @brief Get device ID of last parsed packet
+     * @return Device identifier (empty if none)
+     */
+    const char* getLastDeviceId();
+
+    /**
+     * @brief Get GPS position of last parsed packet
+     * @param latitude Reference to store latitude
+     * @param longitude Reference to store longitude
+     * @return true if the packet carried a valid fix, false otherwise
+     */
+    bool getLastPosition(double& latitude, double& longitude);
+
+    /**
+     * @brief Get the absolute time stamp of last parsed packet
+     * @param hourMs Reference to store milliseconds into the UTC hour
+     * @return true if the sender had absolute time, false otherwise
+     */
+    bool getLastTime(uint32_t& hourMs);
+
+    /**
+     * @brief Get the collar latency stages of last parsed packet
+     * @param report Reference to store the stages
+     * @return true if the packet carried them, false otherwise
+     */
+    bool getLastLatency(LatencyReport& report);
+
 private:
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<2048> doc;       // Status with timing, energy and memory
     TelemetryType lastType;
+    char lastDeviceId[32];
+    TimeService* timeService;
 
     /**
      * @brief Add timestamp to JSON document
+     *
+     * "ts" is milliseconds into the UTC hour when time is known (the receiver
+     * resolves the hour), else "timestamp" is the sender's millis().
      */
     void addTimestamp();
 
@@ -105,6 +278,33 @@ private:
      * @param deviceId Device identifier
      */
     void addDeviceInfo(const char* deviceId);
+
+    /**
+     * @brief Add the GPS block and, if it has moved on, the dead-reckoned position
+     * @param gpsData GPS data structure
+     * @param estimate Optional dead-reckoned position
+     */
+    void addPosition(const GPSData& gpsData, const DeadReckoningEstimate* estimate);
+
+    /**
+     * @brief Serialize the JSON document into a buffer
+     *
+     * The packets the loop builds go into fixed buffers rather than a
+     * String, so building them never touches the heap.
+     *
+     * @param output Buffer for the JSON
+     * @param maxLength Size of the buffer
+     * @return JSON length, or 0 (and an empty string) if it does not fit
+     */
+    size_t serialize(char* output, size_t maxLength);
+
+    /**
+     * @brief Share of the summary's samples in one histogram bin
+     * @param summary Activity summary
+     * @param bin Histogram bin
+     * @return Percent of samples, rounded
+     */
+    static uint8_t histogramPercent(const ActivitySummaryData& summary, uint8_t bin);
 };
 
 #endif // TELEMETRY_H
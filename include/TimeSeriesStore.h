@@ -0,0 +1,191 @@
+/**
+ * @file TimeSeriesStore.h
+ * @brief Compressed per-collar position history on the B.R.A.V.O. dongle
+ *
+ * The dongle keeps the positions it receives from every collar so a phone
+ * can ask for "the last N positions" or "positions between t1 and t2" over
+ * BLE (BLE_CMD_HISTORY) or serial. Each collar's series keeps its newest
+ * points raw in a small head; when the head fills, as many points as fit
+ * are compressed into a fixed-size block:
+ *
+ *   [header: count, first time/lat/lon, column offsets]
+ *   [time column][latitude column][longitude column]
+ *
+ * Times (receive time in TSDB_TIME_UNIT_MS units: Unix time once the dongle
+ * has absolute time, its millis() before) are stored as delta-of-delta, so a collar reporting at a steady interval costs one bit
+ * per point; coordinates (1e-7 degrees, lossless) as deltas. Both use the
+ * same prefix-coded variable-width integers. The time span of every block is
+ * kept in RAM, so a range query skips blocks outside it without decoding.
+ *
+ * Blocks come from one pool, in PSRAM when the board has it. When the pool
+ * is exhausted, the oldest block of the collar holding the most blocks is
+ * evicted, so every collar keeps some history.
+ */
+
+#ifndef TIME_SERIES_STORE_H
+#define TIME_SERIES_STORE_H
+
+#include <Arduino.h>
+
+// Collars tracked (override with -D TSDB_MAX_SERIES=...)
+#ifndef TSDB_MAX_SERIES
+#define TSDB_MAX_SERIES         32
+#endif
+
+// Block pool size in internal RAM and in PSRAM
+#ifndef TSDB_BLOCK_COUNT
+#define TSDB_BLOCK_COUNT        128
+#endif
+#ifndef TSDB_PSRAM_BLOCK_COUNT
+#define TSDB_PSRAM_BLOCK_COUNT  4096
+#endif
+
+#define TSDB_BLOCK_SIZE         128     // Bytes per compressed block
+#define TSDB_HEAD_POINTS        32      // Raw points per series before compressing
+#define TSDB_TIME_UNIT_MS       100     // Stored time resolution
+#define TSDB_NO_BLOCK           0xFFFF
+
+// BLE_CMD_HISTORY modes and reply size
+#define HISTORY_QUERY_LAST      0       // u32 count
+#define HISTORY_QUERY_RANGE     1       // u64 start ms, u64 end ms
+#define HISTORY_MAX_POINTS      64      // Positions per reply
+
+struct TimeSeriesPoint {
+    uint64_t timeMs;        // Unix ms of the fix, or dongle millis() before time sync
+    int32_t latitude;       // 1e-7 degrees
+    int32_t longitude;      // 1e-7 degrees
+};
+
+struct TimeSeriesStats {
+    uint8_t series;
+    uint32_t points;            // Points held (blocks and heads)
+    uint32_t evictedPoints;
+    uint16_t blocksUsed;
+    uint16_t blockCount;
+    float compressionRatio;     // Raw point bytes / encoded bytes, sealed blocks
+    float storageRatio;         // Raw point bytes / block bytes, sealed blocks
+    uint32_t queries;
+    uint32_t lastQueryUs;
+    uint32_t maxQueryUs;
+};
+
+class TimeSeriesStore {
+public:
+    /**
+     * @brief Constructor for TimeSeriesStore
+     */
+    TimeSeriesStore();
+
+    /**
+     * @brief Allocate the block pool (PSRAM when present)
+     * @return true if successful, false otherwise
+     */
+    bool begin();
+
+    /**
+     * @brief Append a received position to a collar's series
+     * @param collarId Collar ID (Downlink::hashDeviceId)
+     * @param deviceId Device ID string, kept for listings
+     * @param timeMs Receive time, Unix ms once time is known
+     * @param latitude Latitude in degrees
+     * @param longitude Longitude in degrees
+     * @return true if stored, false if no series or pool is available
+     */
+    bool append(uint32_t collarId, const char* deviceId, uint64_t timeMs,
+                double latitude, double longitude);
+
+    /**
+     * @brief Get a collar's newest positions, oldest first
+     * @param collarId Collar ID
+     * @param count Number of positions wanted
+     * @param points Buffer for at least count points
+     * @return Number of positions written
+     */
+    size_t queryLast(uint32_t collarId, size_t count, TimeSeriesPoint* points);
+
+    /**
+     * @brief Get a collar's positions received between two times, oldest first
+     * @param collarId Collar ID
+     * @param startMs First time included
+     * @param endMs Last time included
+     * @param points Buffer for the results
+     * @param maxPoints Buffer size; query again from the last time + 1 for more
+     * @return Number of positions written
+     */
+    size_t queryRange(uint32_t collarId, uint64_t startMs, uint64_t endMs,
+                      TimeSeriesPoint* points, size_t maxPoints);
+
+    /**
+     * @brief Get number of collars with a series
+     * @return Series count
+     */
+    uint8_t getSeriesCount();
+
+    /**
+     * @brief Get a series' device ID and point count
+     * @param index Series index (0 to getSeriesCount() - 1)
+     * @param collarId Reference to store the collar ID
+     * @param points Reference to store the number of points held
+     * @return Device ID string
+     */
+    const char* getSeries(uint8_t index, uint32_t& collarId, uint32_t& points);
+
+    /**
+     * @brief Get storage and query statistics
+     * @return TimeSeriesStats structure
+     */
+    TimeSeriesStats getStats();
+
+    /**
+     * @brief Drop all history (the pool stays allocated)
+     */
+    void clear();
+
+private:
+    struct BlockInfo {
+        uint64_t firstTime;     // ms
+        uint64_t lastTime;
+        uint16_t prev;          // Older block of the same series
+        uint16_t next;          // Newer block, or next free block
+        uint8_t series;
+        uint8_t count;
+        uint8_t encodedBytes;
+    };
+
+    struct Series {
+        uint32_t collarId;
+        char deviceId[16];
+        uint16_t oldest;
+        uint16_t newest;
+        uint16_t blocks;
+        uint32_t blockPoints;
+        uint8_t headCount;
+        TimeSeriesPoint* head;  // TSDB_HEAD_POINTS raw points
+    };
+
+    uint8_t* pool;
+    BlockInfo* blockInfo;
+    TimeSeriesPoint* heads;
+    uint16_t blockCount;
+    uint16_t freeList;
+    uint16_t blocksUsed;
+
+    Series series[TSDB_MAX_SERIES];
+    uint8_t seriesCount;
+
+    uint32_t evictedPoints;
+    uint32_t sealedPoints;
+    uint32_t sealedBytes;
+    uint32_t queries;
+    uint32_t lastQueryUs;
+    uint32_t maxQueryUs;
+
+    int findSeries(uint32_t collarId);
+    uint16_t allocateBlock();
+    void evictOldest(uint8_t index);
+    void seal(uint8_t index);
+    uint8_t decodeBlock(uint16_t block, TimeSeriesPoint* points);
+    void finishQuery(uint32_t startUs);
+};
+
+#endif // TIME_SERIES_STORE_H
@@ -0,0 +1,212 @@
+/**
+ * @file TimeService.h
+ * @brief GPS-disciplined absolute time for B.R.A.V.O. collars and dongle
+ *
+ * A 64-bit local microsecond clock (micros() extended past its 71-minute
+ * wrap) is mapped to UTC by a base point and a drift rate:
+ *
+ *   utc = baseUtc + (local - baseLocal) * (1 + drift)
+ *
+ * Every GPS time is a sample of that mapping. With the receiver's PPS output
+ * wired, the sample is the PPS edge captured in an interrupt, labelled with
+ * the second of the NMEA sentence that follows it, good to a few
+ * microseconds. Without PPS it is the time the sentence finished arriving,
+ * less TIME_NMEA_LAG_US, good to tens of milliseconds. Each sample corrects
+ * the phase (fully for PPS, partly for NMEA, whose jitter would otherwise
+ * show up in every stamp), and samples TIME_DRIFT_INTERVAL_* apart measure
+ * the crystal's drift, so the clock holds time between fixes and while GPS
+ * is off.
+ *
+ * The mapping is kept in RTC memory against the system clock, which the
+ * ESP32 keeps counting on the RTC timer through deep sleep, so a collar
+ * waking up has absolute time before its first fix, with an uncertainty
+ * that grows with the sleep by TIME_SLEEP_DRIFT_PPM.
+ *
+ * Samples keep their millis() stamps, which the filters rely on; they are
+ * converted to absolute time (toUnixMs) where they leave the device. Frames
+ * carry the compact form: milliseconds into the current UTC hour, resolved
+ * by the receiver against its own clock (resolveHourMs).
+ */
+
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+
+// Sample quality
+#define TIME_NMEA_LAG_US            100000  // Sentence end after the epoch it labels (9600 baud)
+#define TIME_NMEA_ERROR_US          50000   // Residual NMEA timing error
+#define TIME_PPS_ERROR_US           10      // Interrupt latency
+#define TIME_PPS_MAX_AGE_US         1000000 // A sentence labels a PPS edge this recent
+
+// Discipline loop
+#define TIME_STEP_THRESHOLD_US      500000  // Errors above this step the clock
+#define TIME_NMEA_PHASE_GAIN        0.1f    // Share of an NMEA error corrected at once
+#define TIME_DRIFT_INTERVAL_PPS_US  64000000ULL
+#define TIME_DRIFT_INTERVAL_NMEA_US 600000000ULL
+#define TIME_DRIFT_GAIN             0.25f   // Share of a new drift measurement taken
+#define TIME_MAX_DRIFT_PPM          500.0f  // Beyond any crystal: a bad measurement
+
+// Uncertainty growth without GPS
+#define TIME_HOLDOVER_PPM           2       // Crystal wander once drift is known
+#define TIME_SLEEP_DRIFT_PPM        200     // RTC slow clock through deep sleep
+
+#define TIME_PPS_PIN_NONE           -1
+#define TIME_HOUR_MS                3600000UL
+
+struct TimeStats {
+    bool synced;
+    bool pps;                   // Last sample came from a PPS edge
+    bool restored;              // Time carried over from before a sleep or reset
+    float driftPpm;             // Local clock rate error, positive = slow
+    uint32_t uncertaintyUs;     // Current error bound
+    int32_t lastErrorUs;        // Prediction error of the last sample
+    uint32_t samples;
+    uint32_t steps;             // Times the clock was stepped
+    uint32_t ppsEdges;
+};
+
+class TimeService {
+public:
+    /**
+     * @brief Constructor for TimeService
+     */
+    TimeService();
+
+    /**
+     * @brief Restore time kept through deep sleep and start PPS capture
+     * @param ppsPin GPIO the receiver's PPS output is wired to, or TIME_PPS_PIN_NONE
+     */
+    void begin(int ppsPin = TIME_PPS_PIN_NONE);
+
+    /**
+     * @brief Record a PPS edge (called from the PPS interrupt)
+     * @param edgeUs micros() at the edge
+     */
+    void onPPS(uint32_t edgeUs);
+
+    /**
+     * @brief Feed the UTC time of a GPS epoch
+     * @param unixSeconds Seconds since 1970-01-01 UTC
+     * @param millisecond Milliseconds into that second
+     * @param receivedUs micros() when the sentence was parsed
+     */
+    void onGpsTime(uint32_t unixSeconds, uint16_t millisecond, uint32_t receivedUs);
+
+    /**
+     * @brief Keep the local clock counting (call at least every hour)
+     */
+    void update();
+
+    /**
+     * @brief Check if absolute time is known
+     * @return true if synced or restored, false otherwise
+     */
+    bool isSynced();
+
+    /**
+     * @brief Get the local microsecond clock
+     * @return Microseconds since boot, without wrap
+     */
+    uint64_t localUs();
+
+    /**
+     * @brief Get the current absolute time
+     * @return Microseconds since 1970-01-01 UTC (0 if not synced)
+     */
+    uint64_t nowUnixUs();
+
+    /**
+     * @brief Get the current absolute time
+     * @return Milliseconds since 1970-01-01 UTC (0 if not synced)
+     */
+    uint64_t nowUnixMs();
+
+    /**
+     * @brief Convert a millis() stamp to absolute time
+     * @param localMs millis() when a sample was taken (in the last 49 days)
+     * @return Milliseconds since 1970-01-01 UTC (0 if not synced)
+     */
+    uint64_t toUnixMs(uint32_t localMs);
+
+    /**
+     * @brief Get the compact frame stamp for now
+     * @return Milliseconds into the current UTC hour
+     */
+    uint32_t getHourMs();
+
+    /**
+     * @brief Expand a compact frame stamp to absolute time
+     * @param hourMs Milliseconds into a UTC hour, within half an hour of now
+     * @return Milliseconds since 1970-01-01 UTC (0 if not synced)
+     */
+    uint64_t resolveHourMs(uint32_t hourMs);
+
+    /**
+     * @brief Find this device's next transmit slot
+     *
+     * Time is cut into UTC-aligned periods of periodMs, and periods into
+     * slots of slotMs. Each period the device takes a slot picked from its
+     * seed and the period number, so collars land in different slots (slotted
+     * rather than pure ALOHA) and a colliding pair does not collide again.
+     *
+     * @param periodMs Transmit period
+     * @param slotMs Slot length (one frame's time on air plus the clock error)
+     * @param seed Device seed (e.g. its hashed ID)
+     * @param minDelayMs Do not pick a slot sooner than this
+     * @return Milliseconds until the slot starts, or -1 if not synced
+     */
+    int32_t msUntilSlot(uint32_t periodMs, uint32_t slotMs, uint32_t seed, uint32_t minDelayMs);
+
+    /**
+     * @brief Get the current error bound
+     * @return Microseconds (UINT32_MAX if not synced)
+     */
+    uint32_t getUncertaintyUs();
+
+    /**
+     * @brief Get discipline statistics
+     * @return TimeStats structure
+     */
+    TimeStats getStats();
+
+private:
+    // Local clock extension
+    uint32_t lastMicros;
+    uint32_t microsHigh;
+
+    // PPS edge from the interrupt, picked up by update()
+    volatile uint32_t ppsEdgeUs;
+    volatile bool ppsPending;
+    uint64_t ppsLocalUs;
+    bool ppsSeen;
+
+    // Mapping to UTC
+    bool synced;
+    bool restored;
+    bool lastPps;
+    uint64_t baseLocalUs;
+    int64_t baseUnixUs;
+    float driftPpm;
+    bool driftKnown;
+    uint32_t syncErrorUs;       // Error at the last sample
+    uint64_t lastSampleUnixUs;
+
+    // Drift measurement
+    uint64_t anchorLocalUs;
+    int64_t anchorUnixUs;
+    bool anchorPps;
+
+    int32_t lastErrorUs;
+    uint32_t samples;
+    uint32_t steps;
+    uint32_t ppsEdges;
+
+    uint64_t extend(uint32_t us);
+    int64_t toUnixUs(uint64_t local);
+    void discipline(uint64_t local, int64_t utc, bool pps);
+    void step(uint64_t local, int64_t utc, bool pps);
+    void save();
+};
+
+#endif // TIME_SERVICE_H
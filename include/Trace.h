@@ -0,0 +1,195 @@
+/**
+ * @file Trace.h
+ * @brief Hot-path trace ring buffer and loop-overrun monitor for B.R.A.V.O.
+ *
+ * Trace points record timestamped begin/end events into a fixed RAM ring.
+ * Writers claim slots with a single atomic increment, so the loop, the BLE
+ * host task and ISRs can all trace without locks. Each traced section can
+ * have a time budget; exceeding it is counted and marked in the trace.
+ *
+ * All TRACE_* macros compile to nothing unless BRAVO_TRACE is set to 1.
+ * Dumps are text lines ("T <us> <core> <B|E|I> <name> <arg>") that
+ * tools/trace2chrome.py converts to Chrome trace JSON.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef BRAVO_TRACE
+#define BRAVO_TRACE 0
+#endif
+
+// Ring size in events (power of two, 8 bytes each)
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY  512
+#endif
+
+// Longest formatted dump line
+#define TRACE_LINE_MAX  48
+
+// Trace points
+enum TracePoint : uint8_t {
+    TRACE_LOOP = 0,
+    TRACE_GPS,
+    TRACE_IMU,
+    TRACE_TELEMETRY,
+    TRACE_LORA_RX,
+    TRACE_LORA_TX,
+    TRACE_BLE_UPDATE,
+    TRACE_STATUS,
+    TRACE_FUSION,
+    TRACE_OVERRUN,      // Instant; arg = point that exceeded its budget
+    TRACE_POINT_COUNT
+};
+
+enum TracePhase : uint8_t {
+    TRACE_PHASE_BEGIN = 0,
+    TRACE_PHASE_END,
+    TRACE_PHASE_INSTANT
+};
+
+struct TraceEvent {
+    uint32_t timestampUs;
+    uint8_t point;
+    uint8_t flags;      // Bits 0-1: TracePhase, bit 7: core
+    uint16_t arg;
+};
+
+struct TracePointStats {
+    uint32_t count;     // Completed begin/end pairs
+    uint32_t maxUs;
+    uint32_t budgetUs;  // 0 = unmonitored
+    uint32_t overruns;
+};
+
+struct TraceOverrun {
+    uint8_t point;
+    uint32_t durationUs;
+    uint32_t timestampMs;
+};
+
+class Trace {
+public:
+    /**
+     * @brief Constructor for Trace
+     */
+    Trace();
+
+    /**
+     * @brief Record the start of a section
+     * @param point Trace point
+     */
+    void begin(TracePoint point);
+
+    /**
+     * @brief Record the end of a section and check its budget
+     * @param point Trace point
+     */
+    void end(TracePoint point);
+
+    /**
+     * @brief Record an instant event
+     * @param point Trace point
+     * @param arg Event argument
+     */
+    void instant(TracePoint point, uint16_t arg);
+
+    /**
+     * @brief Set the time budget for a section
+     * @param point Trace point
+     * @param budgetUs Budget in microseconds (0 disables the check)
+     */
+    void setBudget(TracePoint point, uint32_t budgetUs);
+
+    /**
+     * @brief Get statistics for a trace point
+     * @param point Trace point
+     * @return TracePointStats structure
+     */
+    TracePointStats getStats(TracePoint point);
+
+    /**
+     * @brief Get total budget overruns across all points
+     * @return Overrun count
+     */
+    uint32_t getOverrunCount();
+
+    /**
+     * @brief Get the most recent budget overrun
+     * @return TraceOverrun structure (timestampMs is 0 if none yet)
+     */
+    TraceOverrun getLastOverrun();
+
+    /**
+     * @brief Stop recording and return the dump start position
+     * @return Cursor for formatDump()
+     */
+    uint32_t startDump();
+
+    /**
+     * @brief Format held events as text lines
+     * @param cursor Position from startDump(), advanced past formatted events
+     * @param buffer Output buffer
+     * @param maxLength Buffer size (at least TRACE_LINE_MAX)
+     * @return Bytes written, or 0 once all events are formatted (recording resumes)
+     */
+    size_t formatDump(uint32_t& cursor, char* buffer, size_t maxLength);
+
+    /**
+     * @brief Dump all held events to Serial
+     */
+    void dumpToSerial();
+
+    /**
+     * @brief Get name of a trace point
+     * @param point Trace point
+     * @return Name string
+     */
+    static const char* pointName(uint8_t point);
+
+private:
+    TraceEvent events[TRACE_CAPACITY];
+    std::atomic<uint32_t> writeIndex;
+    std::atomic<bool> recording;
+    uint32_t beginUs[TRACE_POINT_COUNT];
+    TracePointStats stats[TRACE_POINT_COUNT];
+    TraceOverrun lastOverrun;
+
+    void record(TracePoint point, TracePhase phase, uint16_t arg, uint32_t timestampUs);
+};
+
+/**
+ * @brief Traces the enclosing scope as a begin/end pair
+ */
+class TraceScope {
+public:
+    TraceScope(Trace& trace, TracePoint point);
+    ~TraceScope();
+
+private:
+    Trace& trace;
+    TracePoint point;
+};
+
+extern Trace trace;
+
+#if BRAVO_TRACE
+#define TRACE_BEGIN(point)          trace.begin(point)
+#define TRACE_END(point)            trace.end(point)
+#define TRACE_INSTANT(point, arg)   trace.instant(point, arg)
+#define TRACE_BUDGET(point, us)     trace.setBudget(point, us)
+#define TRACE_SCOPE_CONCAT(a, b)    a##b
+#define TRACE_SCOPE_NAME(line)      TRACE_SCOPE_CONCAT(traceScope, line)
+#define TRACE_SCOPE(point)          TraceScope TRACE_SCOPE_NAME(__LINE__)(trace, point)
+#else
+#define TRACE_BEGIN(point)          ((void)0)
+#define TRACE_END(point)            ((void)0)
+#define TRACE_INSTANT(point, arg)   ((void)0)
+#define TRACE_BUDGET(point, us)     ((void)0)
+#define TRACE_SCOPE(point)          ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,114 @@
+/**
+ * @file TrackFilter.h
+ * @brief Streaming track simplification for B.R.A.V.O. GPS fixes
+ *
+ * Sits between GPS acquisition and telemetry/storage and keeps only the
+ * fixes needed to redraw the track within a tolerance. Each kept fix starts
+ * a segment; later fixes extend it while the straight line from the kept
+ * fix to the newest one passes within the tolerance of every fix in
+ * between. When it no longer does, the fix before the newest is kept and
+ * starts the next segment, so a straight walk or a resting animal costs one
+ * point instead of one per fix.
+ *
+ * Memory is bounded: only fixes farther than the tolerance from the segment
+ * start are held (those nearer can never leave the corridor), at most
+ * TRACK_WINDOW_MAX of them.
+ */
+
+#ifndef TRACK_FILTER_H
+#define TRACK_FILTER_H
+
+#include <Arduino.h>
+#include "GPS.h"
+
+// Fixes held per segment; a longer straight run is split
+#define TRACK_WINDOW_MAX            32
+
+// Defaults: tolerance in metres (0 keeps every fix) and the longest time
+// between kept fixes, so a resting animal still reports now and then
+#define TRACK_DEFAULT_TOLERANCE_M   5
+#define TRACK_MAX_GAP_MS            300000
+
+// Metres per degree of latitude
+#define TRACK_METRES_PER_DEGREE     111320.0
+
+struct TrackStats {
+    uint32_t received;          // Valid fixes pushed
+    uint32_t kept;              // Fixes passed on
+    float maxErrorM;            // Largest distance of a dropped fix from the kept track
+    uint32_t unsent;            // Kept fixes the sender lost before uplink (set by the sender)
+};
+
+// Position in metres east/north of the segment start
+struct TrackOffset {
+    float x;
+    float y;
+};
+
+class TrackFilter {
+public:
+    /**
+     * @brief Constructor for TrackFilter
+     */
+    TrackFilter();
+
+    /**
+     * @brief Set the error tolerance
+     * @param metres Largest allowed distance of a dropped fix from the track (0 keeps every fix)
+     */
+    void setTolerance(float metres);
+
+    /**
+     * @brief Get the error tolerance
+     * @return Tolerance in metres
+     */
+    float getTolerance();
+
+    /**
+     * @brief Set the longest time between kept fixes
+     * @param ms Gap in milliseconds (0 = no limit)
+     */
+    void setMaxGap(uint32_t ms);
+
+    /**
+     * @brief Feed a fix
+     * @param fix GPS fix (ignored unless valid)
+     * @param kept Filled with the fix that became a track point, if any
+     * @return true if a fix was kept, false otherwise
+     */
+    bool push(const GPSData& fix, GPSData& kept);
+
+    /**
+     * @brief Forget the track; the next fix is kept
+     */
+    void reset();
+
+    /**
+     * @brief Get simplification statistics
+     * @return TrackStats structure
+     */
+    TrackStats getStats();
+
+private:
+    float tolerance;
+    uint32_t maxGapMs;
+
+    GPSData anchor;             // Last kept fix (segment start)
+    GPSData previous;           // Newest fix (segment end candidate)
+    bool hasAnchor;
+    bool hasPrevious;
+    double lonScale;            // Metres per degree of longitude at the anchor
+
+    TrackOffset interior[TRACK_WINDOW_MAX];
+    uint8_t interiorCount;
+    float nearMaxM;             // Farthest unheld fix from the anchor
+    float segmentErrorM;        // Error if the segment ended at previous
+
+    TrackStats stats;
+
+    void startSegment(const GPSData& fix);
+    TrackOffset offsetOf(const GPSData& fix);
+    static float distanceToSegment(const TrackOffset& point, const TrackOffset& end);
+};
+
+#endif // TRACK_FILTER_H
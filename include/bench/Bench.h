@@ -0,0 +1,77 @@
+/**
+ * @file Bench.h
+ * @brief Microbenchmark harness for B.R.A.V.O. hot paths
+ *
+ * Each benchmark is a function performing one operation. The harness picks
+ * an iteration count that runs for at least BENCH_MIN_TIME_US, then reports
+ * time, CPU cycles and heap allocations per operation as one JSON object per
+ * line, prefixed with "BENCH " so results can be pulled out of a serial log
+ * and compared with tools/bench_compare.py.
+ *
+ * Allocations are counted by replacing operator new and wrapping malloc,
+ * calloc and realloc at link time (-Wl,--wrap=...; see platformio.ini).
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifdef BRAVO_BENCH
+
+#include <Arduino.h>
+
+// Minimum measured time per benchmark
+#ifndef BENCH_MIN_TIME_US
+#define BENCH_MIN_TIME_US   200000
+#endif
+
+// Iterations used to warm caches before calibrating
+#define BENCH_WARMUP_ITERATIONS 16
+
+typedef void (*BenchFunction)();
+
+struct BenchResult {
+    const char* name;
+    uint32_t iterations;
+    double nsPerOp;
+    double cyclesPerOp;        // 0 where no cycle counter is available
+    double allocsPerOp;
+    double allocBytesPerOp;
+};
+
+class Bench {
+public:
+    /**
+     * @brief Print the suite header line (target, CPU, code size)
+     */
+    static void printHeader();
+
+    /**
+     * @brief Calibrate, run and report one benchmark
+     * @param name Benchmark name (stable across builds)
+     * @param op Operation to measure
+     * @return BenchResult structure
+     */
+    static BenchResult run(const char* name, BenchFunction op);
+
+    /**
+     * @brief Print the suite footer line
+     * @param count Number of benchmarks run
+     */
+    static void printFooter(uint16_t count);
+
+    /**
+     * @brief Get bytes requested from the heap so far
+     * @return Cumulative allocated bytes
+     */
+    static uint64_t getAllocatedBytes();
+
+    /**
+     * @brief Get number of heap allocations so far
+     * @return Cumulative allocation count
+     */
+    static uint64_t getAllocationCount();
+};
+
+#endif // BRAVO_BENCH
+
+#endif // BENCH_H
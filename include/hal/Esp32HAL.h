@@ -0,0 +1,140 @@
+/**
+ * @file Esp32HAL.h
+ * @brief ESP32 implementations of the hardware abstraction interfaces
+ */
+
+#ifndef ESP32_HAL_H
+#define ESP32_HAL_H
+
+#ifndef BRAVO_NATIVE
+
+#include <Arduino.h>
+#include <driver/adc.h>
+#include <esp_adc_cal.h>
+#include "hal/HAL.h"
+#include "Role.h"
+
+#if BRAVO_ROLE_COLLAR
+#include <Adafruit_MPU6050.h>
+#endif
+
+/**
+ * @brief Arduino core millis()/micros()/delay()
+ */
+class Esp32Clock : public ClockHAL {
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+};
+
+/**
+ * @brief Hardware UART on configurable pins
+ */
+class Esp32Uart : public UartHAL {
+public:
+    /**
+     * @brief Constructor for Esp32Uart
+     * @param serial Hardware serial port (e.g. Serial2)
+     * @param rxPin RX pin
+     * @param txPin TX pin
+     */
+    Esp32Uart(HardwareSerial& serial, int8_t rxPin, int8_t txPin);
+
+    bool begin(uint32_t baud) override;
+    int available() override;
+    int read() override;
+    size_t write(const uint8_t* data, size_t length) override;
+
+private:
+    HardwareSerial& serial;
+    int8_t rxPin;
+    int8_t txPin;
+};
+
+/**
+ * @brief SX127x radio through the LoRa library
+ */
+class Esp32Radio : public RadioHAL {
+public:
+    /**
+     * @brief Constructor for Esp32Radio
+     * @param sck SPI clock pin
+     * @param miso SPI MISO pin
+     * @param mosi SPI MOSI pin
+     * @param cs Chip select pin
+     * @param reset Reset pin
+     * @param dio0 DIO0 interrupt pin
+     */
+    Esp32Radio(int8_t sck, int8_t miso, int8_t mosi, int8_t cs, int8_t reset, int8_t dio0);
+
+    bool begin(long frequency) override;
+    void setFrequency(long frequency) override;
+    void setSpreadingFactor(int spreadingFactor) override;
+    void setSignalBandwidth(long bandwidth) override;
+    void setTxPower(int txPower) override;
+    void enableCrc() override;
+    bool beginPacket() override;
+    size_t write(const uint8_t* data, size_t length) override;
+    bool endPacket() override;
+    int parsePacket() override;
+    int available() override;
+    int read() override;
+    int packetRssi() override;
+    float packetSnr() override;
+    void sleep() override;
+
+private:
+    int8_t sck, miso, mosi, cs, reset, dio0;
+};
+
+#if BRAVO_ROLE_COLLAR
+/**
+ * @brief MPU6050 on I2C (collar only)
+ */
+class Esp32Imu : public ImuHAL {
+public:
+    /**
+     * @brief Constructor for Esp32Imu
+     * @param sda I2C data pin
+     * @param scl I2C clock pin
+     */
+    Esp32Imu(int8_t sda, int8_t scl);
+
+    bool begin() override;
+    bool read(IMUReading& reading) override;
+
+private:
+    Adafruit_MPU6050 mpu;
+    int8_t sda;
+    int8_t scl;
+};
+#endif // BRAVO_ROLE_COLLAR
+
+/**
+ * @brief Battery voltage on an ADC1 channel behind a resistor divider
+ *
+ * Raw readings are corrected with the calibration burned into eFuse
+ * (two-point or Vref, whichever the chip has).
+ */
+class Esp32Battery : public BatteryHAL {
+public:
+    /**
+     * @brief Constructor for Esp32Battery
+     * @param channel ADC1 channel of the sense pin
+     * @param dividerRatio Battery voltage / pin voltage
+     */
+    Esp32Battery(adc1_channel_t channel, float dividerRatio);
+
+    bool begin() override;
+    uint32_t readMillivolts() override;
+
+private:
+    adc1_channel_t channel;
+    float dividerRatio;
+    esp_adc_cal_characteristics_t calibration;
+};
+
+#endif // BRAVO_NATIVE
+
+#endif // ESP32_HAL_H
@@ -0,0 +1,191 @@
+/**
+ * @file HAL.h
+ * @brief Hardware abstraction interfaces for B.R.A.V.O. peripherals
+ *
+ * Modules talk to hardware only through these interfaces, so the same
+ * parsing, telemetry and scheduling code runs on the ESP32 (Esp32HAL.h)
+ * and on a Linux host (LinuxHAL.h).
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Monotonic time source
+ */
+class ClockHAL {
+public:
+    virtual ~ClockHAL() {}
+
+    /**
+     * @brief Get milliseconds since start
+     * @return Time in milliseconds
+     */
+    virtual uint32_t millis() = 0;
+
+    /**
+     * @brief Get microseconds since start
+     * @return Time in microseconds
+     */
+    virtual uint32_t micros() = 0;
+
+    /**
+     * @brief Wait for a number of milliseconds
+     * @param ms Delay in milliseconds
+     */
+    virtual void delay(uint32_t ms) = 0;
+};
+
+/**
+ * @brief Byte-oriented serial port
+ */
+class UartHAL {
+public:
+    virtual ~UartHAL() {}
+
+    /**
+     * @brief Open the port
+     * @param baud Baud rate
+     * @return true if opened, false otherwise
+     */
+    virtual bool begin(uint32_t baud) = 0;
+
+    /**
+     * @brief Get number of bytes ready to read
+     * @return Byte count
+     */
+    virtual int available() = 0;
+
+    /**
+     * @brief Read one byte
+     * @return Byte value, or -1 if none available
+     */
+    virtual int read() = 0;
+
+    /**
+     * @brief Write bytes
+     * @param data Data to write
+     * @param length Number of bytes
+     * @return Bytes written
+     */
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+};
+
+/**
+ * @brief Packet radio with the LoRa library's call pattern
+ */
+class RadioHAL {
+public:
+    virtual ~RadioHAL() {}
+
+    /**
+     * @brief Initialize the radio
+     * @param frequency Carrier frequency in Hz
+     * @return true if the radio responded, false otherwise
+     */
+    virtual bool begin(long frequency) = 0;
+
+    virtual void setFrequency(long frequency) = 0;
+    virtual void setSpreadingFactor(int spreadingFactor) = 0;
+    virtual void setSignalBandwidth(long bandwidth) = 0;
+    virtual void setTxPower(int txPower) = 0;
+    virtual void enableCrc() = 0;
+
+    /**
+     * @brief Start building a packet (leaves receive mode)
+     * @return true if ready, false otherwise
+     */
+    virtual bool beginPacket() = 0;
+
+    /**
+     * @brief Append bytes to the packet being built
+     * @param data Data to append
+     * @param length Number of bytes
+     * @return Bytes appended
+     */
+    virtual size_t write(const uint8_t* data, size_t length) = 0;
+
+    /**
+     * @brief Transmit the packet (blocks until done)
+     * @return true if sent, false otherwise
+     */
+    virtual bool endPacket() = 0;
+
+    /**
+     * @brief Enter receive mode and check for a packet
+     * @return Size of the received packet, or 0 if none
+     */
+    virtual int parsePacket() = 0;
+
+    /**
+     * @brief Get unread bytes of the received packet
+     * @return Byte count
+     */
+    virtual int available() = 0;
+
+    /**
+     * @brief Read one byte of the received packet
+     * @return Byte value, or -1 if none left
+     */
+    virtual int read() = 0;
+
+    virtual int packetRssi() = 0;
+    virtual float packetSnr() = 0;
+
+    /**
+     * @brief Put the radio to sleep (stops receiving)
+     */
+    virtual void sleep() = 0;
+};
+
+// One IMU reading in SI units
+struct IMUReading {
+    float accel[3];     // m/s²
+    float gyro[3];      // rad/s
+    float temperature;  // °C
+};
+
+/**
+ * @brief 6-axis motion sensor
+ */
+class ImuHAL {
+public:
+    virtual ~ImuHAL() {}
+
+    /**
+     * @brief Initialize and configure the sensor
+     * @return true if the sensor responded, false otherwise
+     */
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Read one sample
+     * @param reading Reading to fill
+     * @return true if read, false otherwise
+     */
+    virtual bool read(IMUReading& reading) = 0;
+};
+
+/**
+ * @brief Battery voltage sense input
+ */
+class BatteryHAL {
+public:
+    virtual ~BatteryHAL() {}
+
+    /**
+     * @brief Configure the input
+     * @return true if ready, false otherwise
+     */
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Read one calibrated sample
+     * @return Battery voltage in millivolts (after the divider is undone)
+     */
+    virtual uint32_t readMillivolts() = 0;
+};
+
+#endif // HAL_H
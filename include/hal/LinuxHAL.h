@@ -0,0 +1,221 @@
+/**
+ * @file LinuxHAL.h
+ * @brief Linux host implementations of the hardware abstraction interfaces
+ *
+ * Used by the native build: a simulated clock that only moves when told to,
+ * a UART that replays a file at the configured baud rate, an in-memory radio
+ * channel shared by any number of simulated nodes, and a scripted IMU and
+ * battery.
+ */
+
+#ifndef LINUX_HAL_H
+#define LINUX_HAL_H
+
+#ifdef BRAVO_NATIVE
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <deque>
+#include <vector>
+#include "hal/HAL.h"
+
+// Largest packet the simulated radio accepts (SX127x FIFO size)
+#define SIM_RADIO_MAX_PACKET    255
+
+// Packets held per receiver before the oldest is lost
+#define SIM_RADIO_RX_QUEUE      16
+
+/**
+ * @brief Simulated clock; time advances only via advance() or delay()
+ */
+class SimClock : public ClockHAL {
+public:
+    SimClock();
+
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+
+    /**
+     * @brief Move time forward
+     * @param us Microseconds to advance
+     */
+    void advance(uint64_t us);
+
+    /**
+     * @brief Get the full-width time (micros() wraps after ~71 minutes)
+     * @return Microseconds since the clock started
+     */
+    uint64_t getTimeUs();
+
+private:
+    uint64_t nowUs;
+};
+
+/**
+ * @brief UART that reads from a file and writes to another
+ *
+ * Input bytes become available at the rate a real port would deliver them
+ * (10 bits per byte at the begin() baud rate) on the active clock.
+ */
+class FileUart : public UartHAL {
+public:
+    /**
+     * @brief Constructor for FileUart
+     * @param rxPath File replayed as received bytes (nullptr for none)
+     * @param txPath File receiving written bytes (nullptr to discard)
+     */
+    FileUart(const char* rxPath, const char* txPath = nullptr);
+    ~FileUart();
+
+    bool begin(uint32_t baud) override;
+    int available() override;
+    int read() override;
+    size_t write(const uint8_t* data, size_t length) override;
+
+private:
+    const char* rxPath;
+    const char* txPath;
+    FILE* rxFile;
+    FILE* txFile;
+    uint32_t baud;
+    uint32_t startUs;
+    uint64_t bytesRead;
+    int peeked;
+};
+
+class MemoryRadio;
+
+/**
+ * @brief Shared medium connecting MemoryRadio instances
+ */
+class RadioChannel {
+public:
+    /**
+     * @brief Deliver a packet to every other receiving radio on the same PHY
+     * @param sender Transmitting radio
+     * @param packet Packet bytes
+     */
+    void transmit(MemoryRadio* sender, const std::vector<uint8_t>& packet);
+
+    void attach(MemoryRadio* radio);
+    void detach(MemoryRadio* radio);
+
+private:
+    std::vector<MemoryRadio*> radios;
+};
+
+/**
+ * @brief Radio that exchanges packets through a RadioChannel in memory
+ *
+ * Like the SX127x, it only hears packets while in receive mode: after
+ * parsePacket() and until the next beginPacket() or sleep().
+ */
+class MemoryRadio : public RadioHAL {
+public:
+    /**
+     * @brief Constructor for MemoryRadio
+     * @param channel Channel to join
+     */
+    MemoryRadio(RadioChannel& channel);
+    ~MemoryRadio();
+
+    bool begin(long frequency) override;
+    void setFrequency(long frequency) override;
+    void setSpreadingFactor(int spreadingFactor) override;
+    void setSignalBandwidth(long bandwidth) override;
+    void setTxPower(int txPower) override;
+    void enableCrc() override;
+    bool beginPacket() override;
+    size_t write(const uint8_t* data, size_t length) override;
+    bool endPacket() override;
+    int parsePacket() override;
+    int available() override;
+    int read() override;
+    int packetRssi() override;
+    float packetSnr() override;
+    void sleep() override;
+
+    /**
+     * @brief Set link quality reported for received packets
+     * @param rssi RSSI in dBm
+     * @param snr SNR in dB
+     */
+    void setLinkQuality(int rssi, float snr);
+
+    /**
+     * @brief Check whether this radio would hear a transmission
+     * @param sender Transmitting radio
+     * @return true if receiving on the sender's PHY, false otherwise
+     */
+    bool canHear(const MemoryRadio& sender);
+
+    /**
+     * @brief Queue a packet as received
+     * @param packet Packet bytes
+     */
+    void deliver(const std::vector<uint8_t>& packet);
+
+private:
+    RadioChannel& channel;
+    long frequency;
+    int spreadingFactor;
+    long bandwidth;
+    bool receiving;
+    std::vector<uint8_t> txPacket;
+    std::deque<std::vector<uint8_t> > rxQueue;
+    std::vector<uint8_t> rxPacket;
+    size_t rxPosition;
+    int rssi;
+    float snr;
+};
+
+/**
+ * @brief IMU returning a scripted reading
+ */
+class SimImu : public ImuHAL {
+public:
+    SimImu();
+
+    bool begin() override;
+    bool read(IMUReading& reading) override;
+
+    /**
+     * @brief Set the reading returned from now on
+     * @param reading Sensor values
+     */
+    void setReading(const IMUReading& reading);
+
+private:
+    IMUReading current;
+};
+
+/**
+ * @brief Battery returning a scripted voltage
+ */
+class SimBattery : public BatteryHAL {
+public:
+    SimBattery();
+
+    bool begin() override;
+    uint32_t readMillivolts() override;
+
+    /**
+     * @brief Set the voltage returned from now on
+     * @param millivolts Battery voltage
+     */
+    void setMillivolts(uint32_t millivolts);
+
+private:
+    uint32_t millivolts;
+};
+
+/**
+ * @brief Route millis()/micros()/delay() to a clock
+ * @param clock Clock to use
+ */
+void setNativeClock(ClockHAL& clock);
+
+#endif // BRAVO_NATIVE
+
+#endif // LINUX_HAL_H
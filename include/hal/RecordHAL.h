@@ -0,0 +1,107 @@
+/**
+ * @file RecordHAL.h
+ * @brief Recording taps and replay sources for the sensor interfaces
+ *
+ * The taps wrap a real UART/IMU and copy everything the modules read into a
+ * SensorRecorder. The replay classes are fed by SensorReplay and hand the
+ * recorded bytes and readings back to GPS and IMU. All of them work on both
+ * the ESP32 and the native build.
+ */
+
+#ifndef RECORD_HAL_H
+#define RECORD_HAL_H
+
+#include <Arduino.h>
+#include "hal/HAL.h"
+#include "SensorRecorder.h"
+
+/**
+ * @brief UART passing reads through and recording them
+ */
+class RecordingUart : public UartHAL {
+public:
+    /**
+     * @brief Constructor for RecordingUart
+     * @param inner Port being read
+     * @param recorder Recorder receiving the bytes
+     */
+    RecordingUart(UartHAL& inner, SensorRecorder& recorder);
+
+    bool begin(uint32_t baud) override;
+    int available() override;
+    int read() override;
+    size_t write(const uint8_t* data, size_t length) override;
+
+private:
+    UartHAL& inner;
+    SensorRecorder& recorder;
+};
+
+/**
+ * @brief IMU passing reads through and recording them
+ */
+class RecordingImu : public ImuHAL {
+public:
+    /**
+     * @brief Constructor for RecordingImu
+     * @param inner Sensor being read
+     * @param recorder Recorder receiving the readings
+     */
+    RecordingImu(ImuHAL& inner, SensorRecorder& recorder);
+
+    bool begin() override;
+    bool read(IMUReading& reading) override;
+
+private:
+    ImuHAL& inner;
+    SensorRecorder& recorder;
+};
+
+/**
+ * @brief UART returning recorded bytes
+ */
+class ReplayUart : public UartHAL {
+public:
+    ReplayUart();
+
+    bool begin(uint32_t baud) override;
+    int available() override;
+    int read() override;
+    size_t write(const uint8_t* data, size_t length) override;
+
+    /**
+     * @brief Make bytes available to read (replaces any unread ones)
+     * @param data Bytes (must stay valid until read)
+     * @param length Number of bytes
+     */
+    void feed(const uint8_t* data, size_t length);
+
+private:
+    const uint8_t* data;
+    size_t length;
+    size_t position;
+};
+
+/**
+ * @brief IMU returning the recorded reading
+ */
+class ReplayImu : public ImuHAL {
+public:
+    ReplayImu();
+
+    bool begin() override;
+    bool read(IMUReading& reading) override;
+
+    /**
+     * @brief Set the result of the next read
+     * @param reading Recorded reading
+     * @param ok false to replay a failed read
+     */
+    void setReading(const IMUReading& reading, bool ok);
+
+private:
+    IMUReading current;
+    bool ok;
+};
+
+#endif // RECORD_HAL_H
@@ -0,0 +1,283 @@
+/**
+ * @file LoRaChannel.h
+ * @brief Shared LoRa channel model for the network simulator
+ *
+ * Unlike MemoryRadio, packets here take real time on air (from the SX127x
+ * datasheet formula), are attenuated with distance, and interfere: two
+ * overlapping packets on the same frequency, SF and bandwidth destroy each
+ * other unless one is at least the capture threshold stronger, in which case
+ * the stronger one still decodes. Different spreading factors are treated as
+ * orthogonal.
+ *
+ * Reception is decided when a packet ends on air, by resolve(), which the
+ * simulator calls before running any node at a later time.
+ */
+
+#ifndef LORA_CHANNEL_H
+#define LORA_CHANNEL_H
+
+#ifdef BRAVO_NATIVE
+
+#include <Arduino.h>
+#include <random>
+#include <vector>
+#include "hal/HAL.h"
+#include "hal/LinuxHAL.h"
+
+// PHY settings of every simulated radio (explicit header, CRC on, CR 4/5)
+#define NETSIM_PREAMBLE_SYMBOLS     8
+#define NETSIM_CODING_RATE          1
+
+// Channel model defaults
+#define NETSIM_CAPTURE_DB           6.0f    // Margin for the stronger packet to survive
+#define NETSIM_NOISE_FIGURE_DB      6.0f    // SX127x receiver noise figure
+#define NETSIM_PATH_LOSS_1M_DB      31.7f   // Free-space loss at 1 m, 915 MHz
+#define NETSIM_PATH_LOSS_EXPONENT   2.7f    // Open pasture with some vegetation
+#define NETSIM_SHADOWING_DB         4.0f    // Per-packet fading, standard deviation
+
+// Longest possible packet (SF12, 125 kHz, 255 bytes), used to expire history
+#define NETSIM_MAX_AIRTIME_US       10000000ULL
+
+struct ChannelModel {
+    float captureDb;
+    float noiseFigureDb;
+    float pathLoss1mDb;
+    float pathLossExponent;
+    float shadowingDb;
+};
+
+// Fate of packets at one receiver
+struct ChannelRadioStats {
+    uint32_t delivered;     // Decoded and handed to the radio
+    uint32_t captured;      // Delivered despite overlapping packets
+    uint32_t collided;      // Lost to an overlapping packet
+    uint32_t weak;          // Below the demodulator floor for its SF
+    uint32_t missed;        // Receiver not in RX for the whole packet
+    uint32_t overwritten;   // Replaced in the FIFO before being read
+};
+
+class ChannelRadio;
+
+/**
+ * @brief Shared medium with time on air, path loss and collisions
+ */
+class LoRaChannel {
+public:
+    /**
+     * @brief Constructor for LoRaChannel
+     * @param seed Seed for the fading random generator
+     */
+    LoRaChannel(uint32_t seed = 1);
+
+    /**
+     * @brief Default channel model
+     * @return ChannelModel built from the NETSIM_* defaults
+     */
+    static ChannelModel defaultModel();
+
+    /**
+     * @brief Replace the channel model
+     * @param model New model
+     */
+    void setModel(const ChannelModel& model);
+
+    /**
+     * @brief Time a packet occupies the channel
+     * @param spreadingFactor Spreading factor (6-12)
+     * @param bandwidth Bandwidth in Hz
+     * @param length Payload length in bytes
+     * @return Time on air in microseconds
+     */
+    static uint32_t timeOnAirUs(uint8_t spreadingFactor, long bandwidth, size_t length);
+
+    /**
+     * @brief Lowest SNR the demodulator decodes at a spreading factor
+     * @param spreadingFactor Spreading factor (6-12)
+     * @return SNR floor in dB
+     */
+    static float demodFloorDb(uint8_t spreadingFactor);
+
+    /**
+     * @brief Thermal noise at the receiver
+     * @param bandwidth Bandwidth in Hz
+     * @return Noise floor in dBm
+     */
+    float noiseFloorDbm(long bandwidth);
+
+    /**
+     * @brief Mean received power between two points
+     * @param txPower Transmit power in dBm
+     * @param distanceM Distance in meters
+     * @return Received power in dBm, before fading
+     */
+    float meanRssi(int txPower, float distanceM);
+
+    /**
+     * @brief Put a packet on air
+     * @param sender Transmitting radio
+     * @param data Packet bytes
+     * @return Time on air in microseconds
+     */
+    uint32_t transmit(ChannelRadio* sender, const std::vector<uint8_t>& data);
+
+    /**
+     * @brief Decide the fate of every packet that ended by a given time
+     * @param nowUs Simulation time in microseconds
+     */
+    void resolve(uint64_t nowUs);
+
+    /**
+     * @brief Get total time packets spent on air
+     * @return Sum of time on air in microseconds
+     */
+    uint64_t getAirtimeUs();
+
+    void attach(ChannelRadio* radio);
+    void detach(ChannelRadio* radio);
+
+private:
+    struct Packet {
+        ChannelRadio* sender;
+        uint64_t startUs;
+        uint64_t endUs;
+        long frequency;
+        uint8_t spreadingFactor;
+        long bandwidth;
+        int txPower;
+        float fadingDb;
+        bool resolved;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<ChannelRadio*> radios;
+    std::vector<Packet> packets;    // On air, or recent enough to interfere
+    ChannelModel model;
+    std::mt19937 random;
+    std::normal_distribution<float> fading;
+    uint64_t airtimeUs;
+
+    float rssiAt(const Packet& packet, const ChannelRadio& receiver);
+    void resolveAt(const Packet& packet, ChannelRadio& receiver);
+};
+
+/**
+ * @brief Radio on a LoRaChannel, driven by one node's clock
+ *
+ * endPacket() blocks for the time on air like the LoRa library does, by
+ * advancing the node's clock. Like the SX127x it holds one received packet:
+ * a new one overwrites a packet that has not been read yet.
+ */
+class ChannelRadio : public RadioHAL {
+public:
+    /**
+     * @brief Constructor for ChannelRadio
+     * @param channel Channel to join
+     * @param clock Clock of the node owning the radio
+     */
+    ChannelRadio(LoRaChannel& channel, SimClock& clock);
+    ~ChannelRadio();
+
+    bool begin(long frequency) override;
+    void setFrequency(long frequency) override;
+    void setSpreadingFactor(int spreadingFactor) override;
+    void setSignalBandwidth(long bandwidth) override;
+    void setTxPower(int txPower) override;
+    void enableCrc() override;
+    bool beginPacket() override;
+    size_t write(const uint8_t* data, size_t length) override;
+    bool endPacket() override;
+    int parsePacket() override;
+    int available() override;
+    int read() override;
+    int packetRssi() override;
+    float packetSnr() override;
+    void sleep() override;
+
+    /**
+     * @brief Place the radio
+     * @param x East offset in meters
+     * @param y North offset in meters
+     */
+    void setPosition(float x, float y);
+
+    /**
+     * @brief Distance to another radio
+     * @param other Other radio
+     * @return Distance in meters
+     */
+    float distanceTo(const ChannelRadio& other) const;
+
+    /**
+     * @brief Check whether the radio is tuned to a PHY
+     * @param frequency Carrier frequency in Hz
+     * @param spreadingFactor Spreading factor
+     * @param bandwidth Bandwidth in Hz
+     * @return true if frequency, SF and bandwidth match, false otherwise
+     */
+    bool tunedTo(long frequency, uint8_t spreadingFactor, long bandwidth) const;
+
+    /**
+     * @brief Check whether the receiver was in RX for a whole interval
+     * @param startUs Interval start
+     * @param endUs Interval end
+     * @return true if listening throughout, false otherwise
+     */
+    bool listenedThrough(uint64_t startUs, uint64_t endUs) const;
+
+    /**
+     * @brief Hand over a decoded packet
+     * @param data Packet bytes
+     * @param rssi Received power in dBm
+     * @param snr Signal-to-noise ratio in dB
+     */
+    void deliver(const std::vector<uint8_t>& data, float rssi, float snr);
+
+    /**
+     * @brief Get reception statistics for this receiver
+     * @return Mutable ChannelRadioStats structure
+     */
+    ChannelRadioStats& getStats();
+
+    /**
+     * @brief Get the owning node's time
+     * @return Microseconds since the simulation started
+     */
+    uint64_t getTimeUs();
+
+    long getFrequency() const { return frequency; }
+    uint8_t getSpreadingFactor() const { return spreadingFactor; }
+    long getBandwidth() const { return bandwidth; }
+    int getTxPower() const { return txPower; }
+
+private:
+    LoRaChannel& channel;
+    SimClock& clock;
+    long frequency;
+    uint8_t spreadingFactor;
+    long bandwidth;
+    int txPower;
+    float x;
+    float y;
+
+    // Current (or last) RX period
+    bool receiving;
+    uint64_t rxStartUs;
+    uint64_t rxStopUs;
+
+    std::vector<uint8_t> txPacket;
+    std::vector<uint8_t> fifo;
+    bool fifoFull;
+    std::vector<uint8_t> rxPacket;
+    size_t rxPosition;
+    float fifoRssi;
+    float fifoSnr;
+    float rssi;
+    float snr;
+    ChannelRadioStats stats;
+
+    void stopReceiving();
+};
+
+#endif // BRAVO_NATIVE
+
+#endif // LORA_CHANNEL_H
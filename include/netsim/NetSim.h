@@ -0,0 +1,307 @@
+/**
+ * @file NetSim.h
+ * @brief Discrete-event network simulator for collar/dongle scaling studies
+ *
+ * Simulates one dongle and any number of collars sharing a LoRaChannel.
+ * Each node is the real firmware code (LoRaComm, GPS, Telemetry, Scheduler,
+ * Downlink, Profiler) on its own simulated clock; the simulator always runs
+ * the node with the earliest pending wake-up, so hours of herd traffic take
+ * seconds on a host.
+ *
+ * Collars follow the firmware's collar loop: parse GPS, send the activity
+ * uplink when the telemetry task is due, then poll a downlink receive window.
+ * All frames are sealed with a simulation herd key as on a provisioned herd,
+ * so the dongle decodes at most CRYPTO_MAX_PEERS collars. While
+ * idle they sleep until the next fix or telemetry instead of spinning every
+ * loop period; the IMU is sampled once at boot since it does not affect the
+ * radio. The dongle polls its receiver every loop period, like loop() does.
+ *
+ * In relay mode collars wrap their uplinks in relay frames and, like the
+ * firmware, keep their receiver on to forward other collars' frames; they
+ * then poll every loop period too. The dongle sends the relay beacons.
+ */
+
+#ifndef NETSIM_H
+#define NETSIM_H
+
+#ifdef BRAVO_NATIVE
+
+#include <Arduino.h>
+#include <random>
+#include <vector>
+#include "netsim/LoRaChannel.h"
+#include "LoRaComm.h"
+#include "GPS.h"
+#include "IMU.h"
+#include "Telemetry.h"
+#include "Scheduler.h"
+#include "Downlink.h"
+#include "Profiler.h"
+#include "Relay.h"
+#include "FrameCrypto.h"
+#include "ActivitySummary.h"
+
+// Firmware loop period (delay(10) at the end of loop())
+#define NETSIM_LOOP_US          10000
+
+// Receiver fix rate and simulated herd location
+#define NETSIM_GPS_PERIOD_US    1000000
+#define NETSIM_BASE_LATITUDE    48.1173
+#define NETSIM_BASE_LONGITUDE   11.5167
+#define NETSIM_METERS_PER_DEG   111320.0
+
+// Collar device IDs are NETSIM_ID_PREFIX followed by the collar index
+#define NETSIM_ID_PREFIX        "SIM_"
+
+struct NetSimConfig {
+    uint16_t collars;
+    uint8_t spreadingFactor;
+    long bandwidth;             // Hz
+    int txPower;                // dBm
+    uint32_t telemetryIntervalMs;
+    uint32_t durationS;
+    float radiusM;              // Collars are spread uniformly over this disc
+    uint32_t downlinkAtS;       // Queue a herd-wide downlink at this time (0 = none)
+    uint32_t seed;
+    bool relay;                 // Collars run relay mode
+    ChannelModel channel;
+};
+
+struct CollarResult {
+    float distanceM;            // From the dongle
+    uint32_t sent;
+    uint32_t delivered;
+    uint32_t txTimeMs;
+    uint32_t rxTimeMs;
+    uint32_t forwarded;         // Other collars' frames rebroadcast
+    float radioMAhPerDay;       // LoRa TX + RX
+    float totalMAhPerDay;       // Including GPS and CPU (Profiler model)
+};
+
+struct NetSimResult {
+    uint32_t offered;           // Telemetry packets sent by collars
+    uint32_t delivered;         // Telemetry packets parsed by the dongle
+    uint32_t deliveredRelayed;  // Of those, first heard over at least one hop
+    float deliveryRatio;
+    ChannelRadioStats dongleRadio;
+    float channelLoad;          // Time on air / simulated time
+    uint32_t forwarded;         // Relay rebroadcasts by all collars
+    uint32_t duplicates;        // Relay copies dropped by the dongle
+    float relayAirtimeShare;    // Rebroadcast time on air / all time on air
+    float goodputBps;           // Delivered telemetry bits per second
+    float latencyP50Ms;         // Send start to parsed at the dongle
+    float latencyP95Ms;
+    float latencyP99Ms;
+    float latencyMaxMs;
+    float radioMAhPerDayAvg;
+    float radioMAhPerDayMax;
+    float totalMAhPerDayAvg;
+    DownlinkCampaignStats herd; // Herd-wide downlink, if one was queued
+    std::vector<CollarResult> collars;
+};
+
+/**
+ * @brief GPS UART producing a GGA + RMC fix for a fixed position each second
+ */
+class NmeaUart : public UartHAL {
+public:
+    /**
+     * @brief Constructor for NmeaUart
+     * @param clock Clock of the owning node
+     */
+    NmeaUart(SimClock& clock);
+
+    bool begin(uint32_t baud) override;
+    int available() override;
+    int read() override;
+    size_t write(const uint8_t* data, size_t length) override;
+
+    /**
+     * @brief Set the reported position
+     * @param latitude Latitude in degrees
+     * @param longitude Longitude in degrees
+     */
+    void setPosition(double latitude, double longitude);
+
+private:
+    SimClock& clock;
+    double latitude;
+    double longitude;
+    uint64_t lastSecond;
+    char buffer[192];
+    size_t length;
+    size_t position;
+
+    void appendSentence(const char* body);
+};
+
+/**
+ * @brief Simulated collar running the firmware's collar path
+ */
+class SimCollar {
+public:
+    /**
+     * @brief Constructor for SimCollar
+     * @param channel Channel to join
+     * @param index Collar number (used for the device ID)
+     * @param config Simulation parameters
+     */
+    SimCollar(LoRaChannel& channel, uint16_t index, const NetSimConfig& config);
+
+    /**
+     * @brief Place the collar relative to the dongle
+     * @param x East offset in meters
+     * @param y North offset in meters
+     */
+    void setPosition(float x, float y);
+
+    /**
+     * @brief Run one loop pass (booting on the first call)
+     * @return Simulation time of the next wake-up in microseconds
+     */
+    uint64_t step();
+
+    /**
+     * @brief Summarize radio use and energy up to now
+     * @return CollarResult (delivered is filled in by the simulator)
+     */
+    CollarResult getResult();
+
+    SimClock& getClock() { return clock; }
+    ChannelRadio& getRadio() { return radio; }
+
+    /**
+     * @brief Get when the last telemetry send started
+     * @return Simulation time in microseconds
+     */
+    uint64_t getLastSendUs() { return lastSendUs; }
+
+    /**
+     * @brief Get time on air spent forwarding other collars' frames
+     * @return Microseconds
+     */
+    uint64_t getRelayAirtimeUs() { return relayAirtimeUs; }
+
+private:
+    char deviceId[16];          // Before downlinkHandler and relay, which hash it
+    SimClock clock;
+    ChannelRadio radio;
+    NmeaUart gpsUart;
+    SimImu imuSensor;
+    LoRaComm lora;
+    GPS gps;
+    IMU imu;
+    Telemetry telemetry;
+    Scheduler scheduler;
+    DownlinkHandler downlinkHandler;
+    Relay relay;
+    FrameCrypto crypto;
+    ActivitySummary activitySummary;
+    Profiler profiler;
+    const NetSimConfig& config;
+    bool booted;
+    uint64_t lastSendUs;
+    uint32_t sent;
+    uint64_t relayAirtimeUs;
+
+    void boot();
+    bool sendUplink(const uint8_t* payload, size_t length);
+};
+
+/**
+ * @brief Simulated dongle running the firmware's receive path
+ */
+class SimDongle {
+public:
+    /**
+     * @brief Constructor for SimDongle
+     * @param channel Channel to join
+     * @param config Simulation parameters
+     */
+    SimDongle(LoRaChannel& channel, const NetSimConfig& config);
+
+    /**
+     * @brief Initialize the radio
+     * @return true if successful, false otherwise
+     */
+    bool begin();
+
+    /**
+     * @brief Run one loop pass
+     * @return Simulation time of the next wake-up in microseconds
+     */
+    uint64_t step();
+
+    /**
+     * @brief Get the collar whose telemetry the last step parsed
+     * @param relayed Reference to store whether it arrived over a relay
+     * @return Collar index, or -1 if none
+     */
+    int takeDelivered(bool& relayed);
+
+    /**
+     * @brief Queue a command for every collar heard so far
+     * @param opcode Command opcode (DL_CMD_*)
+     * @param payload Command payload
+     * @param length Payload length
+     * @return Number of collars it was queued for
+     */
+    uint16_t queueHerdCommand(uint8_t opcode, const uint8_t* payload, uint8_t length);
+
+    /**
+     * @brief Get telemetry bytes parsed so far
+     * @return Payload bytes
+     */
+    uint64_t getDeliveredBytes();
+
+    DownlinkCampaignStats getCampaignStats();
+    RelayStats getRelayStats() { return relay.getStats(); }
+
+    SimClock& getClock() { return clock; }
+    ChannelRadio& getRadio() { return radio; }
+
+private:
+    SimClock clock;
+    ChannelRadio radio;
+    LoRaComm lora;
+    Telemetry telemetry;
+    DownlinkQueue downlinkQueue;
+    Relay relay;
+    FrameCrypto crypto;
+    const NetSimConfig& config;
+    int delivered;
+    bool deliveredRelayed;
+    uint64_t deliveredBytes;
+    uint64_t nextBeaconUs;
+};
+
+/**
+ * @brief Event loop tying the dongle and collars to one channel
+ */
+class NetSim {
+public:
+    /**
+     * @brief Constructor for NetSim
+     * @param config Simulation parameters
+     */
+    NetSim(const NetSimConfig& config);
+
+    /**
+     * @brief Default parameters (100 collars, SF7, 125 kHz, 30 s, 1 hour)
+     * @return NetSimConfig structure
+     */
+    static NetSimConfig defaultConfig();
+
+    /**
+     * @brief Run the simulation to completion
+     * @return NetSimResult structure
+     */
+    NetSimResult run();
+
+private:
+    NetSimConfig config;
+};
+
+#endif // BRAVO_NATIVE
+
+#endif // NETSIM_H
@@ -0,0 +1,118 @@
+/**
+ * @file Arduino.cpp
+ * @brief Minimal Arduino core shim implementation
+ */
+
+#include "Arduino.h"
+#include <stdarg.h>
+
+NativeSerial Serial;
+
+// ---------------------------------------------------------------------------
+// Random numbers
+// ---------------------------------------------------------------------------
+
+long random(long howBig) {
+    return howBig > 0 ? ::random() % howBig : 0;
+}
+
+long random(long howSmall, long howBig) {
+    return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+void randomSeed(unsigned long seed) {
+    srandom(seed);
+}
+
+// ---------------------------------------------------------------------------
+// String
+// ---------------------------------------------------------------------------
+
+String::String(double number, unsigned int decimalPlaces) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, number);
+    value = buffer;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t pos = value.find(c, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const char* str, unsigned int from) const {
+    size_t pos = value.find(str, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        std::swap(from, to);
+    }
+    if (from >= value.size()) {
+        return String();
+    }
+    return String(value.substr(from, to - from));
+}
+
+void String::trim() {
+    size_t start = value.find_first_not_of(" \t\r\n");
+    size_t end = value.find_last_not_of(" \t\r\n");
+    value = start == std::string::npos ? "" : value.substr(start, end - start + 1);
+}
+
+StringSumHelper operator+(const String& lhs, const String& rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const String& lhs, const char* rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const char* lhs, const String& rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Print / Serial
+// ---------------------------------------------------------------------------
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    while (size--) {
+        written += write(*buffer++);
+    }
+    return written;
+}
+
+size_t Print::printf(const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length < 0) {
+        return 0;
+    }
+    return write((const uint8_t*)buffer, min((size_t)length, sizeof(buffer) - 1));
+}
+
+size_t NativeSerial::write(uint8_t c) {
+    if (!output) {
+        return 1;
+    }
+    return fputc(c, output) == EOF ? 0 : 1;
+}
+
+size_t NativeSerial::write(const uint8_t* buffer, size_t size) {
+    if (!output) {
+        return size;
+    }
+    return fwrite(buffer, 1, size, output);
+}
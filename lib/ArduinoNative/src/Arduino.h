@@ -0,0 +1,171 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core shim for the native (Linux) build
+ *
+ * Provides the subset of the Arduino/ESP32 core the portable modules use:
+ * String, Serial, math helpers and random(). millis()/micros()/delay() are
+ * implemented by the Linux HAL on top of its simulated clock.
+ */
+
+#ifndef ARDUINO_NATIVE_H
+#define ARDUINO_NATIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using std::min;
+using std::max;
+using std::abs;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PI          3.1415926535897932384626433832795
+#define HALF_PI     1.5707963267948966192313216916398
+#define TWO_PI      6.283185307179586476925286766559
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+
+// ESP32 core attributes with no meaning on the host
+#define IRAM_ATTR
+inline int xPortGetCoreID() { return 0; }
+
+// Time (implemented by the Linux HAL); 32-bit like the ESP32 core, so
+// wraparound behaves the same as on the device
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// Random numbers
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief Arduino-compatible string backed by std::string
+ */
+class String {
+public:
+    String() {}
+    String(const char* cstr) : value(cstr ? cstr : "") {}
+    String(const std::string& str) : value(str) {}
+    explicit String(char c) : value(1, c) {}
+    explicit String(int number) : value(std::to_string(number)) {}
+    explicit String(unsigned int number) : value(std::to_string(number)) {}
+    explicit String(long number) : value(std::to_string(number)) {}
+    explicit String(unsigned long number) : value(std::to_string(number)) {}
+    explicit String(double number, unsigned int decimalPlaces = 2);
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool isEmpty() const { return value.empty(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+
+    bool concat(const String& str) { value += str.value; return true; }
+    bool concat(const char* cstr) { if (cstr) value += cstr; return true; }
+    bool concat(const char* cstr, unsigned int length) { value.append(cstr, length); return true; }
+    bool concat(char c) { value += c; return true; }
+
+    String& operator+=(const String& rhs) { concat(rhs); return *this; }
+    String& operator+=(const char* rhs) { concat(rhs); return *this; }
+    String& operator+=(char rhs) { concat(rhs); return *this; }
+
+    bool operator==(const String& rhs) const { return value == rhs.value; }
+    bool operator==(const char* rhs) const { return value == (rhs ? rhs : ""); }
+    bool operator!=(const String& rhs) const { return value != rhs.value; }
+    bool operator!=(const char* rhs) const { return !(*this == rhs); }
+    bool equals(const String& rhs) const { return value == rhs.value; }
+
+    char charAt(unsigned int index) const { return index < value.size() ? value[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const char* str, unsigned int from = 0) const;
+    bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+    String substring(unsigned int from) const { return substring(from, value.size()); }
+    String substring(unsigned int from, unsigned int to) const;
+    void trim();
+    long toInt() const { return atol(value.c_str()); }
+    float toFloat() const { return atof(value.c_str()); }
+
+private:
+    std::string value;
+};
+
+// Result type of String concatenation (ArduinoJson checks for it)
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& str) : String(str) {}
+};
+
+StringSumHelper operator+(const String& lhs, const String& rhs);
+StringSumHelper operator+(const String& lhs, const char* rhs);
+StringSumHelper operator+(const char* lhs, const String& rhs);
+
+/**
+ * @brief Text and byte output, as Arduino's Print class
+ */
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+
+    size_t print(const char* str) { return write(str); }
+    size_t print(const String& str) { return write(str.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int number) { return print(String(number)); }
+    size_t print(unsigned int number) { return print(String(number)); }
+    size_t print(long number) { return print(String(number)); }
+    size_t print(unsigned long number) { return print(String(number)); }
+    size_t print(double number, int digits = 2) { return print(String(number, digits)); }
+
+    size_t println() { return write("\n"); }
+    template<typename T> size_t println(const T& value) { return print(value) + println(); }
+    size_t println(double number, int digits) { return print(number, digits) + println(); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+/**
+ * @brief Console serial port writing to stdout
+ */
+class NativeSerial : public Print {
+public:
+    NativeSerial() : output(stdout) {}
+
+    void begin(unsigned long baud) {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() { if (output) fflush(output); }
+
+    /**
+     * @brief Redirect output (nullptr discards it)
+     * @param stream Destination stream
+     */
+    void setOutput(FILE* stream) { output = stream; }
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+private:
+    FILE* output;
+};
+
+extern NativeSerial Serial;
+
+#endif // ARDUINO_NATIVE_H
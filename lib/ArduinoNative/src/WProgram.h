@@ -0,0 +1,11 @@
+/**
+ * @file WProgram.h
+ * @brief Pre-1.0 Arduino header name, included by libraries when ARDUINO is unset
+ */
+
+#ifndef WPROGRAM_NATIVE_H
+#define WPROGRAM_NATIVE_H
+
+#include "Arduino.h"
+
+#endif // WPROGRAM_NATIVE_H
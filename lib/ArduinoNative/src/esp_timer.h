@@ -0,0 +1,15 @@
+/**
+ * @file esp_timer.h
+ * @brief ESP-IDF high-resolution timer on the native clock
+ */
+
+#ifndef ESP_TIMER_NATIVE_H
+#define ESP_TIMER_NATIVE_H
+
+#include "Arduino.h"
+
+inline int64_t esp_timer_get_time() {
+    return micros();
+}
+
+#endif // ESP_TIMER_NATIVE_H
@@ -0,0 +1,70 @@
+/**
+ * @file ActivitySummary.cpp
+ * @brief Per-interval activity summary implementation
+ */
+
+#include "ActivitySummary.h"
+
+// Same gravity the IMU's activity level is measured against
+#define ACTIVITY_GRAVITY    9.8f
+
+ActivitySummary::ActivitySummary() : smoothedDynamic(0), currentClass(ACTIVITY_REST),
+                                     lastSampleMs(0), hasSample(false) {
+    reset(0);
+}
+
+void ActivitySummary::reset(uint32_t nowMs) {
+    memset(&summary, 0, sizeof(summary));
+    summary.startMs = nowMs;
+    activitySum = 0;
+}
+
+void ActivitySummary::addSample(const IMUData& sample, uint8_t activityLevel) {
+    // The time since the previous sample is spent in that sample's bucket
+    if (hasSample) {
+        uint32_t elapsedMs = sample.timestamp - lastSampleMs;
+        summary.classMs[currentClass] += min(elapsedMs, (uint32_t)ACTIVITY_MAX_SAMPLE_GAP_MS);
+    }
+    lastSampleMs = sample.timestamp;
+    hasSample = true;
+
+    summary.samples++;
+    activitySum += activityLevel;
+    uint8_t bin = min(activityLevel / (100 / ACTIVITY_HISTOGRAM_BINS), ACTIVITY_HISTOGRAM_BINS - 1);
+    summary.histogram[bin]++;
+
+    float magnitude = sqrtf(sample.accelX * sample.accelX + sample.accelY * sample.accelY +
+                            sample.accelZ * sample.accelZ);
+    summary.peakAccel = max(summary.peakAccel, magnitude);
+
+    // Classify on the smoothed dynamic acceleration so a single jolt is not
+    // a run and a stride's quiet phase is not a rest
+    smoothedDynamic += ACTIVITY_SMOOTH_ALPHA * (fabsf(magnitude - ACTIVITY_GRAVITY) - smoothedDynamic);
+    ActivityClass next = ACTIVITY_RUN;
+    if (smoothedDynamic < ACTIVITY_REST_MAX) {
+        next = ACTIVITY_REST;
+    } else if (smoothedDynamic < ACTIVITY_WALK_MAX) {
+        next = ACTIVITY_WALK;
+    }
+    if (currentClass == ACTIVITY_REST && next != ACTIVITY_REST && summary.motionEvents < UINT16_MAX) {
+        summary.motionEvents++;
+    }
+    currentClass = next;
+}
+
+void ActivitySummary::addStep() {
+    if (summary.steps < UINT16_MAX) {
+        summary.steps++;
+    }
+}
+
+ActivitySummaryData ActivitySummary::getSummary(uint32_t nowMs) {
+    ActivitySummaryData result = summary;
+    result.durationMs = nowMs - summary.startMs;
+    result.meanActivity = summary.samples ? activitySum / summary.samples : 0;
+    return result;
+}
+
+ActivityClass ActivitySummary::getCurrentClass() {
+    return currentClass;
+}
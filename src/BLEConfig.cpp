@@ -4,6 +4,24 @@
  */
 
 #include "BLEConfig.h"
+#include "ConfigStore.h"
+
+#define BLE_DEFAULT_MTU 23
+
+// Bulk transfer offsets (collar only: the dongle has no data log)
+#if BRAVO_ROLE_COLLAR
+static void putLE32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static uint32_t getLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+#endif
 
 // Server callbacks class implementation
 class BLEConfig::ServerCallbacks : public NimBLEServerCallbacks {
@@ -13,16 +31,145 @@ private:
 public:
     ServerCallbacks(BLEConfig* p) : parent(p) {}
 
-    void onConnect(NimBLEServer* pServer) {
+    void onConnect(NimBLEServer* pServer, ble_gap_conn_desc* desc) {
         Serial.println("BLE client connected");
         parent->clientConnected = true;
+        parent->connHandle = desc->conn_handle;
+
+        // Ask for the largest link-layer packets and the 2M PHY; phones
+        // that don't support them keep the defaults
+        pServer->setDataLen(desc->conn_handle, BLE_DATA_LEN_OCTETS);
+        ble_gap_set_prefered_le_phy(desc->conn_handle,
+                                    BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK,
+                                    BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK,
+                                    0);
     }
 
     void onDisconnect(NimBLEServer* pServer) {
         Serial.println("BLE client disconnected");
         parent->clientConnected = false;
-        // Restart advertising
-        pServer->startAdvertising();
+        parent->connHandle = BLE_HS_CONN_HANDLE_NONE;
+        parent->peerMTU = BLE_DEFAULT_MTU;
+#if BRAVO_ROLE_COLLAR
+        // Pause any bulk transfer; the client resumes from its last offset
+        parent->bulkPendingOp = BULK_OP_STOP;
+        parent->streamSubscribed = false;
+#endif
+        // The owner is probably still nearby: advertise fast again. The
+        // power policy in update() restarts advertising.
+        parent->fastAdvStart = millis();
+    }
+
+    void onMTUChange(uint16_t MTU, ble_gap_conn_desc* desc) {
+        Serial.printf("BLE MTU negotiated: %u\n", MTU);
+        parent->peerMTU = MTU;
+    }
+};
+
+#if BRAVO_ROLE_COLLAR
+// Bulk control characteristic callbacks
+class BLEConfig::BulkCallbacks : public NimBLECharacteristicCallbacks {
+private:
+    BLEConfig* parent;
+
+public:
+    BulkCallbacks(BLEConfig* p) : parent(p) {}
+
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        NimBLEAttValue value = pCharacteristic->getValue();
+        const uint8_t* data = value.data();
+        size_t length = value.length();
+
+        if (length < 1) {
+            return;
+        }
+
+        switch (data[0]) {
+            case BULK_OP_START:
+                if (length >= 5) {
+                    parent->bulkRequestOffset = getLE32(&data[1]);
+                    parent->bulkRequestWindow = length >= 6 ? data[5] : BULK_DEFAULT_WINDOW;
+                    parent->bulkPendingOp = BULK_OP_START;
+                }
+                break;
+            case BULK_OP_ACK:
+                if (length >= 5) {
+                    uint32_t offset = getLE32(&data[1]);
+                    if (offset > parent->bulkAckOffset) {
+                        parent->bulkAckOffset = offset;
+                    }
+                }
+                break;
+            case BULK_OP_STOP:
+                parent->bulkPendingOp = BULK_OP_STOP;
+                break;
+        }
+    }
+};
+
+// Live IMU stream characteristic callbacks
+class BLEConfig::StreamCallbacks : public NimBLECharacteristicCallbacks {
+private:
+    BLEConfig* parent;
+
+public:
+    StreamCallbacks(BLEConfig* p) : parent(p) {}
+
+    void onSubscribe(NimBLECharacteristic* pCharacteristic,
+                     ble_gap_conn_desc* desc, uint16_t subValue) {
+        // Bit 0: notifications enabled
+        parent->streamSubscribed = (subValue & 0x0001) != 0;
+    }
+
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        // Optional uint16 sample rate in Hz
+        NimBLEAttValue value = pCharacteristic->getValue();
+        if (value.length() >= 2) {
+            parent->streamRequestRate = value.data()[0] | (value.data()[1] << 8);
+        }
+    }
+};
+#endif
+
+// Config characteristic callbacks
+class BLEConfig::ConfigCallbacks : public NimBLECharacteristicCallbacks {
+private:
+    BLEConfig* parent;
+
+public:
+    ConfigCallbacks(BLEConfig* p) : parent(p) {}
+
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        if (parent->configWritePending) {
+            return;  // Previous write not applied yet
+        }
+
+        NimBLEAttValue value = pCharacteristic->getValue();
+        size_t length = min(value.length(), sizeof(parent->configWriteBuffer));
+        memcpy(parent->configWriteBuffer, value.data(), length);
+        parent->configWriteLength = length;
+        parent->configWritePending = true;
+    }
+};
+
+// Command characteristic callbacks
+class BLEConfig::CommandCallbacks : public NimBLECharacteristicCallbacks {
+private:
+    BLEConfig* parent;
+
+public:
+    CommandCallbacks(BLEConfig* p) : parent(p) {}
+
+    void onWrite(NimBLECharacteristic* pCharacteristic) {
+        if (parent->commandPending) {
+            return;  // Previous command not handled yet
+        }
+
+        NimBLEAttValue value = pCharacteristic->getValue();
+        size_t length = min(value.length(), sizeof(parent->commandBuffer));
+        memcpy(parent->commandBuffer, value.data(), length);
+        parent->commandLength = length;
+        parent->commandPending = true;
     }
 };
 
@@ -30,22 +177,59 @@ BLEConfig::BLEConfig() : pServer(nullptr), pService(nullptr),
                          pConfigCharacteristic(nullptr), 
                          pStatusCharacteristic(nullptr),
                          pCommandCharacteristic(nullptr),
-                         initialized(false), clientConnected(false) {
+#if BRAVO_ROLE_COLLAR
+                         pBulkDataCharacteristic(nullptr),
+                         pBulkCtrlCharacteristic(nullptr),
+                         pStreamCharacteristic(nullptr),
+#endif
+                         configCallback(nullptr), commandCallback(nullptr),
+                         initialized(false), clientConnected(false),
+                         connHandle(BLE_HS_CONN_HANDLE_NONE),
+                         peerMTU(BLE_DEFAULT_MTU),
+                         powerState(BLE_STATE_ADV_FAST),
+                         advertisingEnabled(true), fastAdvStart(0),
+                         powerLastUpdate(0), txBytes(0),
+                         advInterval(BLE_FAST_ADV_INTERVAL),
+                         connInterval(BLE_IDLE_CONN_MAX),
+                         connLatency(BLE_IDLE_CONN_LATENCY),
+#if BRAVO_ROLE_COLLAR
+                         bulkSource(nullptr), bulkNextOffset(0),
+                         bulkStartTime(0), bulkWindow(BULK_DEFAULT_WINDOW),
+                         bulkAckOffset(0), bulkRequestOffset(0),
+                         bulkRequestWindow(BULK_DEFAULT_WINDOW), bulkPendingOp(0),
+                         streamSource(nullptr), streamSubscribed(false),
+                         streamRequestRate(0),
+#endif
+                         configWriteLength(0),
+                         configWritePending(false), commandLength(0),
+                         commandPending(false) {
+#if BRAVO_ROLE_COLLAR
+    memset(&bulkStats, 0, sizeof(bulkStats));
+#endif
+    memset(powerStats, 0, sizeof(powerStats));
     // Initialize default config
     config.loraFrequency = 915;
     config.loraPower = 20;
-    config.gpsInterval = 5000;
+    config.loraSpreadingFactor = 7;
+    config.loraBandwidth = 125;
+    config.gpsInterval = 1000;
     config.telemetryInterval = 10000;
+    config.powerMode = POWER_MODE_NORMAL;
+    config.trackTolerance = 5;
+    config.relayMode = 0;
     strcpy(config.deviceName, "BRAVO_COLLAR");
 }
 
 bool BLEConfig::begin(const char* deviceName) {
     // Initialize BLE
     NimBLEDevice::init(deviceName);
+    NimBLEDevice::setMTU(BLE_PREFERRED_MTU);
 
     // Create BLE Server
     pServer = NimBLEDevice::createServer();
     pServer->setCallbacks(new ServerCallbacks(this));
+    // Advertising restarts are driven by the power policy in update()
+    pServer->advertiseOnDisconnect(false);
 
     // Create BLE Service
     pService = pServer->createService(SERVICE_UUID);
@@ -55,6 +239,8 @@ bool BLEConfig::begin(const char* deviceName) {
         CONFIG_UUID,
         NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE
     );
+    pConfigCharacteristic->setCallbacks(new ConfigCallbacks(this));
+    refreshConfigValue();
 
     pStatusCharacteristic = pService->createCharacteristic(
         STATUS_UUID,
@@ -65,6 +251,26 @@ bool BLEConfig::begin(const char* deviceName) {
         COMMAND_UUID,
         NIMBLE_PROPERTY::WRITE
     );
+    pCommandCharacteristic->setCallbacks(new CommandCallbacks(this));
+
+#if BRAVO_ROLE_COLLAR
+    pBulkDataCharacteristic = pService->createCharacteristic(
+        BULK_DATA_UUID,
+        NIMBLE_PROPERTY::NOTIFY
+    );
+
+    pBulkCtrlCharacteristic = pService->createCharacteristic(
+        BULK_CTRL_UUID,
+        NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR | NIMBLE_PROPERTY::NOTIFY
+    );
+    pBulkCtrlCharacteristic->setCallbacks(new BulkCallbacks(this));
+
+    pStreamCharacteristic = pService->createCharacteristic(
+        IMU_STREAM_UUID,
+        NIMBLE_PROPERTY::NOTIFY | NIMBLE_PROPERTY::WRITE
+    );
+    pStreamCharacteristic->setCallbacks(new StreamCallbacks(this));
+#endif
 
     // Start service
     pService->start();
@@ -73,49 +279,388 @@ bool BLEConfig::begin(const char* deviceName) {
     NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
     pAdvertising->addServiceUUID(SERVICE_UUID);
     pAdvertising->setScanResponse(true);
-    pAdvertising->start();
 
     initialized = true;
+    fastAdvStart = powerLastUpdate = millis();
+    applyPowerState(BLE_STATE_ADV_FAST);
+
     Serial.println("BLE initialized successfully");
     return true;
 }
 
 void BLEConfig::update() {
-    // BLE stack handles updates automatically
-    // This function is for future extensions
+    if (!initialized) {
+        return;
+    }
+
+    if (configWritePending) {
+        processConfigWrite();
+    }
+
+    if (commandPending) {
+        if (commandCallback) {
+            commandCallback(commandBuffer, commandLength);
+        }
+        commandPending = false;
+    }
+
+#if BRAVO_ROLE_COLLAR
+    if (bulkPendingOp) {
+        processBulkCommand();
+    }
+
+    if (bulkStats.active) {
+        pumpBulkTransfer();
+    }
+
+    if (streamSource) {
+        pumpStream();
+    }
+#endif
+
+    updatePowerState();
 }
 
 bool BLEConfig::isConnected() {
     return clientConnected;
 }
 
+size_t BLEConfig::getMaxNotifySize() {
+    return peerMTU - 3;
+}
+
 BLEConfigData BLEConfig::getConfig() {
     return config;
 }
 
 void BLEConfig::setConfig(const BLEConfigData& newConfig) {
     config = newConfig;
+    refreshConfigValue();
 }
 
-void BLEConfig::sendStatus(const String& status) {
+void BLEConfig::setConfigCallback(ConfigChangedCallback callback) {
+    configCallback = callback;
+}
+
+void BLEConfig::setCommandCallback(CommandCallback callback) {
+    commandCallback = callback;
+}
+
+void BLEConfig::refreshConfigValue() {
+    if (!pConfigCharacteristic) {
+        return;
+    }
+
+    uint8_t encoded[CONFIG_MAX_ENCODED_SIZE];
+    size_t length = ConfigStore::encode(config, encoded, sizeof(encoded));
+    pConfigCharacteristic->setValue(encoded, length);
+}
+
+void BLEConfig::processConfigWrite() {
+    BLEConfigData updated = config;
+    bool valid = ConfigStore::decode(configWriteBuffer, configWriteLength, updated);
+    configWritePending = false;
+
+    if (valid) {
+        config = updated;
+        Serial.println("BLE config updated");
+        if (configCallback) {
+            configCallback(config);
+        }
+    } else {
+        Serial.println("BLE config write rejected");
+    }
+
+    // Reads always return the config actually in effect
+    refreshConfigValue();
+    sendStatus(valid ? "{\"type\":\"config\",\"result\":\"ok\"}" :
+                       "{\"type\":\"config\",\"result\":\"rejected\"}");
+}
+
+void BLEConfig::sendStatus(const char* status) {
     if (!initialized || !pStatusCharacteristic) {
         return;
     }
 
-    pStatusCharacteristic->setValue(status.c_str());
+    size_t length = strlen(status);
+    pStatusCharacteristic->setValue((const uint8_t*)status, length);
     if (clientConnected) {
         pStatusCharacteristic->notify();
+        txBytes += length;
     }
 }
 
 void BLEConfig::startAdvertising() {
-    if (initialized) {
-        NimBLEDevice::getAdvertising()->start();
-    }
+    advertisingEnabled = true;
+    wake();
 }
 
 void BLEConfig::stopAdvertising() {
+    advertisingEnabled = false;
     if (initialized) {
         NimBLEDevice::getAdvertising()->stop();
     }
 }
+
+void BLEConfig::wake() {
+    fastAdvStart = millis();
+}
+
+bool BLEConfig::isAdvertisingEnabled() {
+    return advertisingEnabled;
+}
+
+BLEPowerState BLEConfig::getPowerState() {
+    return powerState;
+}
+
+BLEStateStats BLEConfig::getPowerStats(BLEPowerState state) {
+    return powerStats[state];
+}
+
+void BLEConfig::updatePowerState() {
+    accountPower();
+
+    BLEPowerState next;
+    if (clientConnected) {
+#if BRAVO_ROLE_COLLAR
+        next = bulkStats.active ? BLE_STATE_CONN_BULK : BLE_STATE_CONN_IDLE;
+#else
+        next = BLE_STATE_CONN_IDLE;
+#endif
+    } else if (millis() - fastAdvStart < BLE_FAST_ADV_WINDOW) {
+        next = BLE_STATE_ADV_FAST;
+    } else {
+        next = BLE_STATE_ADV_SLOW;
+    }
+
+    // Advertising state also needs re-applying if it was stopped or
+    // re-enabled while the state itself did not change
+    bool advertising = NimBLEDevice::getAdvertising()->isAdvertising();
+    bool advMismatch = !clientConnected && advertising != advertisingEnabled;
+
+    if (next != powerState || advMismatch) {
+        applyPowerState(next);
+    }
+}
+
+void BLEConfig::applyPowerState(BLEPowerState state) {
+    NimBLEAdvertising* pAdvertising = NimBLEDevice::getAdvertising();
+    powerState = state;
+
+    switch (state) {
+        case BLE_STATE_ADV_FAST:
+        case BLE_STATE_ADV_SLOW:
+            advInterval = state == BLE_STATE_ADV_FAST ?
+                          BLE_FAST_ADV_INTERVAL : BLE_SLOW_ADV_INTERVAL;
+            pAdvertising->stop();
+            pAdvertising->setMinInterval(advInterval);
+            pAdvertising->setMaxInterval(advInterval);
+            if (advertisingEnabled) {
+                pAdvertising->start();
+            }
+            break;
+
+        case BLE_STATE_CONN_IDLE:
+            connInterval = BLE_IDLE_CONN_MAX;
+            connLatency = BLE_IDLE_CONN_LATENCY;
+            pServer->updateConnParams(connHandle, BLE_IDLE_CONN_MIN, BLE_IDLE_CONN_MAX,
+                                      BLE_IDLE_CONN_LATENCY, BLE_CONN_TIMEOUT);
+            break;
+
+        case BLE_STATE_CONN_BULK:
+            connInterval = BLE_FAST_CONN_MAX;
+            connLatency = 0;
+            pServer->updateConnParams(connHandle, BLE_FAST_CONN_MIN, BLE_FAST_CONN_MAX,
+                                      0, BLE_CONN_TIMEOUT);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void BLEConfig::accountPower() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - powerLastUpdate;
+    if (elapsed == 0) {
+        return;
+    }
+    powerLastUpdate = now;
+
+    BLEStateStats& stats = powerStats[powerState];
+    float radioUs = 0;
+
+    if (powerState == BLE_STATE_ADV_FAST || powerState == BLE_STATE_ADV_SLOW) {
+        if (advertisingEnabled) {
+            float eventUs = advInterval * 625.0f + BLE_ADV_DELAY_US;
+            radioUs = elapsed * 1000.0f / eventUs * BLE_ADV_EVENT_US;
+        }
+    } else {
+        // Idle links only wake every (1 + latency) intervals; data forces
+        // the collar to attend every event, which the byte term covers
+        float eventUs = connInterval * 1250.0f * (1 + connLatency);
+        radioUs = elapsed * 1000.0f / eventUs * BLE_CONN_EVENT_US;
+        radioUs += (float)txBytes * BLE_BYTE_AIRTIME_US;
+    }
+    txBytes = 0;
+
+    stats.timeMs += elapsed;
+    stats.radioOnMs += radioUs / 1000.0f;
+    stats.avgCurrentMa = stats.radioOnMs / stats.timeMs * BLE_RADIO_CURRENT_MA;
+}
+
+#if BRAVO_ROLE_COLLAR
+void BLEConfig::setBulkSource(DataLog* log) {
+    bulkSource = log;
+}
+
+bool BLEConfig::isBulkActive() {
+    return bulkStats.active;
+}
+
+BulkTransferStats BLEConfig::getBulkStats() {
+    return bulkStats;
+}
+
+size_t BLEConfig::getBulkChunkSize() {
+    // ATT notification header is 3 bytes, plus our offset prefix
+    return peerMTU - 3 - BULK_HEADER_SIZE;
+}
+
+void BLEConfig::processBulkCommand() {
+    uint8_t op = bulkPendingOp;
+    bulkPendingOp = 0;
+
+    if (op == BULK_OP_STOP) {
+        bulkStats.active = false;
+        return;
+    }
+
+    if (op != BULK_OP_START || !bulkSource || !clientConnected) {
+        return;
+    }
+
+    // Resume from the requested offset, clamped to what is still held
+    uint32_t offset = bulkRequestOffset;
+    offset = max(offset, bulkSource->getStartOffset());
+    offset = min(offset, bulkSource->getEndOffset());
+
+    bulkWindow = constrain(bulkRequestWindow, 1, BULK_MAX_WINDOW);
+    bulkNextOffset = offset;
+    bulkAckOffset = offset;
+
+    // A resume during a transfer keeps the original start time and end
+    if (!bulkStats.active) {
+        bulkStats.startOffset = offset;
+        bulkStats.endOffset = bulkSource->getEndOffset();
+        bulkStats.bytesSent = 0;
+        bulkStats.bytesAcked = 0;
+        bulkStats.throughputKBps = 0;
+        bulkStartTime = millis();
+        bulkStats.active = true;
+    }
+    bulkStats.mtu = peerMTU;
+
+    uint8_t response[11];
+    response[0] = BULK_RSP_STARTED;
+    putLE32(&response[1], offset);
+    putLE32(&response[5], bulkStats.endOffset);
+    response[9] = getBulkChunkSize() & 0xFF;
+    response[10] = (getBulkChunkSize() >> 8) & 0xFF;
+    pBulkCtrlCharacteristic->notify(response, sizeof(response));
+
+    Serial.printf("BLE bulk transfer: %u..%u, window %u, MTU %u\n",
+                  offset, bulkStats.endOffset, bulkWindow, peerMTU);
+}
+
+void BLEConfig::pumpBulkTransfer() {
+    if (!clientConnected || !bulkSource) {
+        bulkStats.active = false;
+        return;
+    }
+
+    uint32_t acked = bulkAckOffset;
+    bulkStats.bytesAcked = acked - bulkStats.startOffset;
+
+    if (acked >= bulkStats.endOffset) {
+        finishBulkTransfer();
+        return;
+    }
+
+    // Records evicted while paused cannot be resent; skip ahead
+    if (bulkNextOffset < bulkSource->getStartOffset()) {
+        bulkNextOffset = bulkSource->getStartOffset();
+    }
+
+    size_t chunkSize = getBulkChunkSize();
+    uint32_t windowBytes = (uint32_t)bulkWindow * chunkSize;
+
+    while (bulkNextOffset < bulkStats.endOffset &&
+           bulkNextOffset - acked < windowBytes) {
+        size_t length = min(chunkSize, (size_t)(bulkStats.endOffset - bulkNextOffset));
+        length = bulkSource->read(bulkNextOffset, &notifyBuffer[BULK_HEADER_SIZE], length);
+        if (length == 0) {
+            break;
+        }
+
+        putLE32(notifyBuffer, bulkNextOffset);
+        pBulkDataCharacteristic->notify(notifyBuffer, BULK_HEADER_SIZE + length);
+        txBytes += BULK_HEADER_SIZE + length;
+
+        bulkNextOffset += length;
+        bulkStats.bytesSent += length;
+    }
+}
+
+void BLEConfig::finishBulkTransfer() {
+    bulkStats.active = false;
+    bulkStats.bytesAcked = bulkStats.endOffset - bulkStats.startOffset;
+    bulkStats.elapsedMs = max(millis() - bulkStartTime, 1UL);
+    bulkStats.throughputKBps = (float)bulkStats.bytesAcked / bulkStats.elapsedMs;
+
+    uint8_t response[13];
+    response[0] = BULK_RSP_DONE;
+    putLE32(&response[1], bulkStats.bytesAcked);
+    putLE32(&response[5], bulkStats.elapsedMs);
+    putLE32(&response[9], (uint32_t)(bulkStats.throughputKBps * 1000.0f));
+    pBulkCtrlCharacteristic->notify(response, sizeof(response));
+
+    Serial.printf("BLE bulk transfer complete: %u bytes in %u ms (%.1f KB/s)\n",
+                  bulkStats.bytesAcked, bulkStats.elapsedMs, bulkStats.throughputKBps);
+}
+
+void BLEConfig::setStreamSource(IMUStream* stream) {
+    streamSource = stream;
+}
+
+bool BLEConfig::isStreaming() {
+    return streamSource && streamSource->isActive();
+}
+
+void BLEConfig::pumpStream() {
+    if (streamRequestRate) {
+        streamSource->setRate(streamRequestRate);
+        streamRequestRate = 0;
+    }
+
+    // Follow the client's subscription; stop() drops anything queued
+    bool wanted = streamSubscribed && clientConnected;
+    if (wanted != streamSource->isActive()) {
+        if (wanted) {
+            streamSource->start(peerMTU - 3);
+        } else {
+            streamSource->stop();
+        }
+    }
+
+    for (uint8_t i = 0; i < IMU_STREAM_SENDS_PER_UPDATE; i++) {
+        size_t length = streamSource->nextPacket(notifyBuffer, peerMTU - 3);
+        if (length == 0) {
+            break;
+        }
+        pStreamCharacteristic->notify(notifyBuffer, length);
+        txBytes += length;
+    }
+}
+#endif
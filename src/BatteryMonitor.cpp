@@ -0,0 +1,165 @@
+/**
+ * @file BatteryMonitor.cpp
+ * @brief Battery monitor implementation
+ */
+
+#include "BatteryMonitor.h"
+
+// Resting single-cell LiPo discharge curve at room temperature
+struct CurvePoint {
+    uint16_t millivolts;
+    uint8_t percent;
+};
+
+static const CurvePoint LIPO_CURVE[] = {
+    { 4200, 100 }, { 4150, 95 }, { 4110, 90 }, { 4080, 85 }, { 4020, 80 },
+    { 3980, 75 }, { 3950, 70 }, { 3910, 65 }, { 3870, 60 }, { 3850, 55 },
+    { 3840, 50 }, { 3820, 45 }, { 3800, 40 }, { 3790, 35 }, { 3770, 30 },
+    { 3750, 25 }, { 3730, 20 }, { 3710, 15 }, { 3690, 10 }, { 3610, 5 },
+    { 3270, 0 }
+};
+
+#define LIPO_CURVE_POINTS (sizeof(LIPO_CURVE) / sizeof(LIPO_CURVE[0]))
+
+BatteryMonitor::BatteryMonitor(BatteryHAL& sensor)
+    : sensor(sensor), filteredMv(0), percent(100), tier(BATTERY_TIER_NORMAL),
+      capacityMAh(BATTERY_CAPACITY_MAH) {
+}
+
+bool BatteryMonitor::begin() {
+    if (!sensor.begin()) {
+        Serial.println("Battery monitor initialization failed");
+        return false;
+    }
+
+    // Seed the filter so the first readings are not dragged up from zero
+    filteredMv = sample();
+    percent = isPresent() ? percentFromMillivolts(filteredMv) : 100;
+    tier = tierFor(percent);
+
+    if (isPresent()) {
+        Serial.printf("Battery: %u mV, %u%%, tier %s\n", getMillivolts(), percent,
+                      tierName(tier));
+    } else {
+        Serial.println("Battery: not sensed, assuming external power");
+    }
+    return true;
+}
+
+uint32_t BatteryMonitor::sample() {
+    // Trimmed mean: the extremes catch most ADC spikes
+    uint32_t sum = 0;
+    uint32_t lowest = UINT32_MAX;
+    uint32_t highest = 0;
+    for (uint8_t i = 0; i < BATTERY_OVERSAMPLE; i++) {
+        uint32_t value = sensor.readMillivolts();
+        sum += value;
+        lowest = min(lowest, value);
+        highest = max(highest, value);
+    }
+
+    return (sum - lowest - highest) / (BATTERY_OVERSAMPLE - 2);
+}
+
+BatteryTier BatteryMonitor::tierFor(uint8_t charge) {
+    if (!isPresent()) {
+        return BATTERY_TIER_NORMAL;
+    }
+
+    // Step down as soon as a threshold is crossed; step back up only with
+    // margin, so a voltage recovering after a TX burst does not flap
+    BatteryTier next = tier;
+    if (charge < BATTERY_SURVIVAL_PERCENT) {
+        next = BATTERY_TIER_SURVIVAL;
+    } else if (charge < BATTERY_ECO_PERCENT) {
+        next = tier == BATTERY_TIER_SURVIVAL ? BATTERY_TIER_SURVIVAL : BATTERY_TIER_ECO;
+    }
+
+    if (next == BATTERY_TIER_SURVIVAL &&
+        charge >= BATTERY_SURVIVAL_PERCENT + BATTERY_TIER_HYSTERESIS) {
+        next = BATTERY_TIER_ECO;
+    }
+    if (next == BATTERY_TIER_ECO &&
+        charge >= BATTERY_ECO_PERCENT + BATTERY_TIER_HYSTERESIS) {
+        next = BATTERY_TIER_NORMAL;
+    }
+
+    return next;
+}
+
+bool BatteryMonitor::update() {
+    filteredMv += BATTERY_FILTER_ALPHA * ((float)sample() - filteredMv);
+    percent = isPresent() ? percentFromMillivolts(filteredMv) : 100;
+
+    BatteryTier next = tierFor(percent);
+    if (next == tier) {
+        return false;
+    }
+
+    Serial.printf("Battery %u mV (%u%%): tier %s -> %s\n", getMillivolts(), percent,
+                  tierName(tier), tierName(next));
+    tier = next;
+    return true;
+}
+
+bool BatteryMonitor::isPresent() {
+    return filteredMv >= BATTERY_PRESENT_MIN_MV;
+}
+
+uint16_t BatteryMonitor::getMillivolts() {
+    return (uint16_t)(filteredMv + 0.5f);
+}
+
+uint8_t BatteryMonitor::getPercent() {
+    return percent;
+}
+
+BatteryTier BatteryMonitor::getTier() {
+    return tier;
+}
+
+float BatteryMonitor::getRuntimeHours(float activeMa) {
+    if (!isPresent()) {
+        return -1;
+    }
+
+    float remainingMAh = capacityMAh * percent / 100.0f;
+    return remainingMAh / (activeMa + BATTERY_IDLE_MA);
+}
+
+BatteryStatus BatteryMonitor::getStatus(float activeMa) {
+    BatteryStatus status;
+    status.present = isPresent();
+    status.millivolts = getMillivolts();
+    status.percent = percent;
+    status.tier = tier;
+    status.runtimeHours = getRuntimeHours(activeMa);
+    return status;
+}
+
+void BatteryMonitor::setCapacity(uint16_t mAh) {
+    capacityMAh = mAh;
+}
+
+uint8_t BatteryMonitor::percentFromMillivolts(uint16_t millivolts) {
+    if (millivolts >= LIPO_CURVE[0].millivolts) {
+        return 100;
+    }
+
+    // Linear between the points of the curve
+    for (size_t i = 1; i < LIPO_CURVE_POINTS; i++) {
+        const CurvePoint& upper = LIPO_CURVE[i - 1];
+        const CurvePoint& lower = LIPO_CURVE[i];
+        if (millivolts >= lower.millivolts) {
+            return lower.percent + (uint32_t)(millivolts - lower.millivolts) *
+                   (upper.percent - lower.percent) / (upper.millivolts - lower.millivolts);
+        }
+    }
+
+    return 0;
+}
+
+const char* BatteryMonitor::tierName(BatteryTier tier) {
+    static const char* names[] = { "normal", "eco", "survival" };
+    return tier <= BATTERY_TIER_SURVIVAL ? names[tier] : "unknown";
+}
@@ -0,0 +1,240 @@
+/**
+ * @file ConfigStore.cpp
+ * @brief Binary configuration format and NVS persistence implementation
+ */
+
+#include "ConfigStore.h"
+
+static bool isValidFrequency(uint16_t mhz) {
+    // SX1276/77/78 synthesizer ranges
+    return (mhz >= 410 && mhz <= 525) || (mhz >= 862 && mhz <= 1020);
+}
+
+static bool isValidBandwidth(uint16_t khz) {
+    return khz == 62 || khz == 125 || khz == 250 || khz == 500;
+}
+
+static uint8_t* putTag(uint8_t* p, uint8_t tag, uint8_t length) {
+    p[0] = tag;
+    p[1] = length;
+    return p + 2;
+}
+
+static uint8_t* putU16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+    return p + 4;
+}
+
+static uint32_t getLE(const uint8_t* p, uint8_t length) {
+    uint32_t v = 0;
+    for (int i = length - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+ConfigStore::ConfigStore() {
+}
+
+bool ConfigStore::validate(const BLEConfigData& config) {
+    return isValidFrequency(config.loraFrequency) &&
+           config.loraPower >= CFG_LORA_POWER_MIN &&
+           config.loraPower <= CFG_LORA_POWER_MAX &&
+           config.loraSpreadingFactor >= CFG_LORA_SF_MIN &&
+           config.loraSpreadingFactor <= CFG_LORA_SF_MAX &&
+           isValidBandwidth(config.loraBandwidth) &&
+           config.gpsInterval >= CFG_GPS_INTERVAL_MIN &&
+           config.gpsInterval <= CFG_GPS_INTERVAL_MAX &&
+           config.telemetryInterval >= CFG_TELEMETRY_MIN &&
+           config.telemetryInterval <= CFG_TELEMETRY_MAX &&
+           config.powerMode <= POWER_MODE_SURVIVAL &&
+           config.trackTolerance <= CFG_TRACK_TOLERANCE_MAX &&
+           config.relayMode <= 1 &&
+           config.deviceName[0] != '\0';
+}
+
+size_t ConfigStore::encode(const BLEConfigData& config, uint8_t* buffer, size_t maxLength) {
+    size_t nameLength = strnlen(config.deviceName, sizeof(config.deviceName) - 1);
+    size_t length = 1 + (2 + 2) + (2 + 1) + (2 + 1) + (2 + 2) +
+                    (2 + 4) + (2 + 4) + (2 + 1) + (2 + 1) + (2 + 1) + (2 + nameLength);
+    if (length > maxLength) {
+        return 0;
+    }
+
+    uint8_t* p = buffer;
+    *p++ = CONFIG_FORMAT_VERSION;
+
+    p = putU16(putTag(p, CFG_TAG_LORA_FREQUENCY, 2), config.loraFrequency);
+    p = putTag(p, CFG_TAG_LORA_POWER, 1);
+    *p++ = config.loraPower;
+    p = putTag(p, CFG_TAG_LORA_SF, 1);
+    *p++ = config.loraSpreadingFactor;
+    p = putU16(putTag(p, CFG_TAG_LORA_BANDWIDTH, 2), config.loraBandwidth);
+    p = putU32(putTag(p, CFG_TAG_GPS_INTERVAL, 4), config.gpsInterval);
+    p = putU32(putTag(p, CFG_TAG_TELEMETRY_INTERVAL, 4), config.telemetryInterval);
+    p = putTag(p, CFG_TAG_POWER_MODE, 1);
+    *p++ = config.powerMode;
+    p = putTag(p, CFG_TAG_TRACK_TOLERANCE, 1);
+    *p++ = config.trackTolerance;
+    p = putTag(p, CFG_TAG_RELAY_MODE, 1);
+    *p++ = config.relayMode;
+    p = putTag(p, CFG_TAG_DEVICE_NAME, nameLength);
+    memcpy(p, config.deviceName, nameLength);
+
+    return length;
+}
+
+bool ConfigStore::decode(const uint8_t* data, size_t length, BLEConfigData& config) {
+    if (length < 1 || data[0] != CONFIG_FORMAT_VERSION) {
+        return false;
+    }
+
+    // Work on a copy so a bad entry leaves the live config untouched
+    BLEConfigData updated = config;
+    size_t pos = 1;
+
+    while (pos < length) {
+        if (pos + 2 > length) {
+            return false;
+        }
+
+        uint8_t tag = data[pos];
+        uint8_t size = data[pos + 1];
+        const uint8_t* value = &data[pos + 2];
+        pos += 2 + size;
+
+        if (pos > length) {
+            return false;
+        }
+
+        switch (tag) {
+            case CFG_TAG_LORA_FREQUENCY:
+                if (size != 2) return false;
+                updated.loraFrequency = getLE(value, 2);
+                break;
+            case CFG_TAG_LORA_POWER:
+                if (size != 1) return false;
+                updated.loraPower = value[0];
+                break;
+            case CFG_TAG_LORA_SF:
+                if (size != 1) return false;
+                updated.loraSpreadingFactor = value[0];
+                break;
+            case CFG_TAG_LORA_BANDWIDTH:
+                if (size != 2) return false;
+                updated.loraBandwidth = getLE(value, 2);
+                break;
+            case CFG_TAG_GPS_INTERVAL:
+                if (size != 4) return false;
+                updated.gpsInterval = getLE(value, 4);
+                break;
+            case CFG_TAG_TELEMETRY_INTERVAL:
+                if (size != 4) return false;
+                updated.telemetryInterval = getLE(value, 4);
+                break;
+            case CFG_TAG_POWER_MODE:
+                if (size != 1) return false;
+                updated.powerMode = value[0];
+                break;
+            case CFG_TAG_TRACK_TOLERANCE:
+                if (size != 1) return false;
+                updated.trackTolerance = value[0];
+                break;
+            case CFG_TAG_RELAY_MODE:
+                if (size != 1) return false;
+                updated.relayMode = value[0];
+                break;
+            case CFG_TAG_DEVICE_NAME:
+                if (size == 0 || size >= sizeof(updated.deviceName)) return false;
+                memcpy(updated.deviceName, value, size);
+                updated.deviceName[size] = '\0';
+                break;
+            default:
+                // Unknown tag from newer firmware; skip it
+                break;
+        }
+    }
+
+    if (!validate(updated)) {
+        return false;
+    }
+
+    config = updated;
+    return true;
+}
+
+bool ConfigStore::load(BLEConfigData& config) {
+    uint8_t buffer[CONFIG_MAX_ENCODED_SIZE];
+
+    // One blob read keeps startup fast
+    prefs.begin(CONFIG_NVS_NAMESPACE, true);
+    size_t length = prefs.getBytes(CONFIG_NVS_KEY, buffer, sizeof(buffer));
+    prefs.end();
+
+    if (length == 0) {
+        return false;
+    }
+
+    return decode(buffer, length, config);
+}
+
+bool ConfigStore::save(const BLEConfigData& config) {
+    uint8_t encoded[CONFIG_MAX_ENCODED_SIZE];
+    uint8_t stored[CONFIG_MAX_ENCODED_SIZE];
+
+    size_t length = encode(config, encoded, sizeof(encoded));
+    if (length == 0 || !validate(config)) {
+        return false;
+    }
+
+    prefs.begin(CONFIG_NVS_NAMESPACE, false);
+
+    // Avoid flash wear when nothing changed
+    size_t storedLength = prefs.getBytes(CONFIG_NVS_KEY, stored, sizeof(stored));
+    bool ok = storedLength == length && memcmp(stored, encoded, length) == 0;
+    if (!ok) {
+        ok = prefs.putBytes(CONFIG_NVS_KEY, encoded, length) == length;
+    }
+
+    prefs.end();
+    return ok;
+}
+
+void ConfigStore::reset() {
+    prefs.begin(CONFIG_NVS_NAMESPACE, false);
+    prefs.remove(CONFIG_NVS_KEY);
+    prefs.end();
+}
+
+size_t ConfigStore::loadBlob(const char* key, uint8_t* buffer, size_t maxLength) {
+    prefs.begin(CONFIG_NVS_NAMESPACE, true);
+    size_t length = prefs.getBytesLength(key);
+    if (length > maxLength) {
+        length = 0;
+    } else if (length > 0) {
+        length = prefs.getBytes(key, buffer, length);
+    }
+    prefs.end();
+    return length;
+}
+
+bool ConfigStore::saveBlob(const char* key, const uint8_t* data, size_t length) {
+    prefs.begin(CONFIG_NVS_NAMESPACE, false);
+    bool ok;
+    if (length == 0) {
+        prefs.remove(key);
+        ok = true;
+    } else {
+        ok = prefs.putBytes(key, data, length) == length;
+    }
+    prefs.end();
+    return ok;
+}
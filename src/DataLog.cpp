@@ -0,0 +1,110 @@
+/**
+ * @file DataLog.cpp
+ * @brief On-device data log implementation
+ */
+
+#include "DataLog.h"
+
+DataLog::DataLog() : head(0), tail(0), records(0) {
+}
+
+void DataLog::copyIn(uint32_t offset, const void* src, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)src;
+    size_t pos = offset % DATALOG_CAPACITY;
+    size_t first = min(length, (size_t)(DATALOG_CAPACITY - pos));
+
+    memcpy(&buffer[pos], bytes, first);
+    memcpy(&buffer[0], bytes + first, length - first);
+}
+
+void DataLog::copyOut(uint32_t offset, void* dst, size_t length) {
+    uint8_t* bytes = (uint8_t*)dst;
+    size_t pos = offset % DATALOG_CAPACITY;
+    size_t first = min(length, (size_t)(DATALOG_CAPACITY - pos));
+
+    memcpy(bytes, &buffer[pos], first);
+    memcpy(bytes + first, &buffer[0], length - first);
+}
+
+bool DataLog::append(uint8_t type, uint32_t timestamp, const void* payload, uint8_t length) {
+    size_t recordSize = sizeof(DataLogRecordHeader) + length;
+    if (recordSize > DATALOG_CAPACITY) {
+        return false;
+    }
+
+    // Evict whole records from the tail until the new one fits
+    while (head - tail + recordSize > DATALOG_CAPACITY) {
+        DataLogRecordHeader oldest;
+        copyOut(tail, &oldest, sizeof(oldest));
+        tail += sizeof(DataLogRecordHeader) + oldest.length;
+        records--;
+    }
+
+    DataLogRecordHeader header;
+    header.type = type;
+    header.length = length;
+    header.timestamp = timestamp;
+
+    copyIn(head, &header, sizeof(header));
+    copyIn(head + sizeof(header), payload, length);
+    head += recordSize;
+    records++;
+
+    return true;
+}
+
+bool DataLog::logGPS(const GPSData& data) {
+    if (!data.valid) {
+        return false;
+    }
+
+    DataLogGPSRecord record;
+    record.latitude = (int32_t)lround(data.latitude * 1e7);
+    record.longitude = (int32_t)lround(data.longitude * 1e7);
+    record.altitude = (int32_t)lround(data.altitude * 100.0);
+    record.speed = (uint16_t)min(data.speed / 3.6f * 100.0f, 65535.0f);
+    record.course = (uint16_t)(data.course * 100.0f);
+    record.satellites = data.satellites;
+    // TinyGPS++ reports HDOP in hundredths
+    record.hdop = (uint8_t)min(data.hdop / 10, (uint32_t)255);
+
+    return append(LOG_RECORD_GPS, data.timestamp, &record, sizeof(record));
+}
+
+bool DataLog::logIMU(const IMUData& data) {
+    IMURawSample sample = IMU::toRaw(data);
+    return append(LOG_RECORD_IMU, data.timestamp, &sample, sizeof(sample));
+}
+
+bool DataLog::logTime(uint64_t unixMs) {
+    DataLogTimeRecord record;
+    record.unixMs = unixMs;
+    return append(LOG_RECORD_TIME, millis(), &record, sizeof(record));
+}
+
+size_t DataLog::read(uint32_t offset, uint8_t* out, size_t maxLength) {
+    if (offset < tail || offset >= head) {
+        return 0;
+    }
+
+    size_t length = min(maxLength, (size_t)(head - offset));
+    copyOut(offset, out, length);
+    return length;
+}
+
+uint32_t DataLog::getStartOffset() {
+    return tail;
+}
+
+uint32_t DataLog::getEndOffset() {
+    return head;
+}
+
+uint32_t DataLog::getRecordCount() {
+    return records;
+}
+
+void DataLog::clear() {
+    tail = head;
+    records = 0;
+}
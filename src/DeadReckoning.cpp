@@ -0,0 +1,263 @@
+/**
+ * @file DeadReckoning.cpp
+ * @brief GPS/IMU dead reckoning implementation
+ */
+
+#include "DeadReckoning.h"
+
+#define DR_GRAVITY              9.80665f
+#define DR_METRES_PER_DEGREE    111320.0
+
+/**
+ * @brief Wrap an angle to [-pi, pi)
+ */
+static float wrapAngle(float angle) {
+    while (angle >= PI) {
+        angle -= 2 * PI;
+    }
+    while (angle < -PI) {
+        angle += 2 * PI;
+    }
+    return angle;
+}
+
+DeadReckoning::DeadReckoning() {
+    reset();
+}
+
+void DeadReckoning::reset() {
+    q0 = 1;
+    q1 = q2 = q3 = 0;
+    hasSample = false;
+    lastSampleMs = 0;
+
+    accelMean = DR_GRAVITY;
+    stepArmed = true;
+    lastStepMs = 0;
+
+    hasOrigin = false;
+    east = north = 0;
+    steps = 0;
+    walkedM = 0;
+    yawSin = yawCos = 0;
+
+    strideM = DR_DEFAULT_STRIDE_M;
+    headingOffset = 0;
+    headingKnown = false;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.strideM = strideM;
+}
+
+void DeadReckoning::madgwick(float gx, float gy, float gz, float ax, float ay, float az,
+                             float dt) {
+    // Rate of change of the quaternion from the gyro
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    // Gradient descent step towards the gravity direction
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+    if (norm > 0) {
+        ax /= norm;
+        ay /= norm;
+        az /= norm;
+
+        float _2q0 = 2 * q0, _2q1 = 2 * q1, _2q2 = 2 * q2, _2q3 = 2 * q3;
+        float _4q0 = 4 * q0, _4q1 = 4 * q1, _4q2 = 4 * q2;
+        float _8q1 = 8 * q1, _8q2 = 8 * q2;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        float s1 = _4q1 * q3q3 - _2q3 * ax + 4 * q0q0 * q1 - _2q0 * ay - _4q1 +
+                   _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        float s2 = 4 * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 +
+                   _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        float s3 = 4 * q1q1 * q3 - _2q1 * ax + 4 * q2q2 * q3 - _2q2 * ay;
+
+        norm = sqrtf(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+        if (norm > 0) {
+            qDot0 -= DR_MADGWICK_BETA * s0 / norm;
+            qDot1 -= DR_MADGWICK_BETA * s1 / norm;
+            qDot2 -= DR_MADGWICK_BETA * s2 / norm;
+            qDot3 -= DR_MADGWICK_BETA * s3 / norm;
+        }
+    }
+
+    q0 += qDot0 * dt;
+    q1 += qDot1 * dt;
+    q2 += qDot2 * dt;
+    q3 += qDot3 * dt;
+
+    norm = sqrtf(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q0 /= norm;
+    q1 /= norm;
+    q2 /= norm;
+    q3 /= norm;
+}
+
+float DeadReckoning::getYaw() {
+    return atan2f(2 * (q0 * q3 + q1 * q2), 1 - 2 * (q2 * q2 + q3 * q3));
+}
+
+float DeadReckoning::metresPerDegreeLon(double latitude) {
+    return DR_METRES_PER_DEGREE * cos(latitude * DEG_TO_RAD);
+}
+
+void DeadReckoning::advance(float yaw) {
+    steps++;
+    walkedM += strideM;
+    yawSin += sinf(yaw);
+    yawCos += cosf(yaw);
+    stats.steps++;
+
+    // Without a heading the step still widens the uncertainty
+    if (headingKnown) {
+        float bearing = headingOffset - yaw;
+        east += strideM * sinf(bearing);
+        north += strideM * cosf(bearing);
+    }
+}
+
+bool DeadReckoning::updateImu(const IMUData& sample) {
+    stats.samples++;
+
+    uint32_t elapsedMs = sample.timestamp - lastSampleMs;
+    bool continuous = hasSample && elapsedMs > 0 && elapsedMs <= DR_MAX_SAMPLE_GAP_MS;
+    lastSampleMs = sample.timestamp;
+    hasSample = true;
+    if (continuous) {
+        madgwick(sample.gyroX, sample.gyroY, sample.gyroZ,
+                 sample.accelX, sample.accelY, sample.accelZ, elapsedMs / 1000.0f);
+    }
+
+    // A step is a rise of |a| above its running mean, re-armed when it
+    // falls back below
+    float magnitude = sqrtf(sample.accelX * sample.accelX + sample.accelY * sample.accelY +
+                            sample.accelZ * sample.accelZ);
+    float dynamic = magnitude - accelMean;
+    accelMean += DR_ACCEL_MEAN_ALPHA * (magnitude - accelMean);
+
+    if (dynamic < 0) {
+        stepArmed = true;
+        return false;
+    }
+    if (!stepArmed || dynamic < DR_STEP_THRESHOLD ||
+        sample.timestamp - lastStepMs < DR_STEP_MIN_INTERVAL_MS) {
+        return false;
+    }
+
+    stepArmed = false;
+    lastStepMs = sample.timestamp;
+    advance(getYaw());
+    return true;
+}
+
+float DeadReckoning::uncertainty(uint32_t now) {
+    // Stride errors add up like a random walk; a heading error moves the
+    // whole walk sideways and grows as the gyro drifts
+    float strideSigma = DR_STRIDE_SIGMA * strideM * sqrtf((float)steps);
+    float alongTrack = sqrtf(originSigmaM * originSigmaM + strideSigma * strideSigma);
+    if (!headingKnown) {
+        return alongTrack + walkedM;
+    }
+
+    float headingSigma = DR_HEADING_SIGMA_RAD + DR_HEADING_DRIFT_RAD_S * (now - originMs) / 1000.0f;
+    return alongTrack + walkedM * min(headingSigma, 1.0f);
+}
+
+bool DeadReckoning::updateFix(const GPSData& fix) {
+    if (!fix.valid || (hasOrigin && fix.timestamp == lastFixMs)) {
+        return false;
+    }
+    stats.fixes++;
+
+    // hdop is in hundredths
+    float fixSigma = max(fix.hdop / 100.0f, 1.0f) * DR_FIX_SIGMA_PER_HDOP;
+
+    if (!hasOrigin) {
+        hasOrigin = true;
+        originLat = fix.latitude;
+        originLon = fix.longitude;
+        originSigmaM = fixSigma;
+    } else {
+        // Learn stride and heading from what the fixes say was walked
+        float lonScale = metresPerDegreeLon(lastFixLat);
+        float fixEast = (fix.longitude - lastFixLon) * lonScale;
+        float fixNorth = (fix.latitude - lastFixLat) * DR_METRES_PER_DEGREE;
+        float fixDistance = sqrtf(fixEast * fixEast + fixNorth * fixNorth);
+        if (steps >= DR_CALIBRATION_STEPS && fixDistance >= DR_CALIBRATION_MIN_M) {
+            float stride = constrain(fixDistance / steps, DR_STRIDE_MIN_M, DR_STRIDE_MAX_M);
+            strideM += DR_CALIBRATION_GAIN * (stride - strideM);
+
+            float offset = atan2f(fixEast, fixNorth) + atan2f(yawSin, yawCos);
+            if (headingKnown) {
+                headingOffset = wrapAngle(headingOffset +
+                                          DR_CALIBRATION_GAIN * wrapAngle(offset - headingOffset));
+            } else {
+                headingOffset = wrapAngle(offset);
+                headingKnown = true;
+            }
+            stats.calibrations++;
+        }
+
+        // Blend the dead-reckoned and fixed positions by their variances
+        lonScale = metresPerDegreeLon(originLat);
+        float offsetEast = (fix.longitude - originLon) * lonScale;
+        float offsetNorth = (fix.latitude - originLat) * DR_METRES_PER_DEGREE;
+        float drSigma = uncertainty(fix.timestamp);
+        float gain = drSigma * drSigma / (drSigma * drSigma + fixSigma * fixSigma);
+        float innovation = sqrtf((offsetEast - east) * (offsetEast - east) +
+                                 (offsetNorth - north) * (offsetNorth - north));
+        if (innovation > DR_RESET_SIGMAS * sqrtf(drSigma * drSigma + fixSigma * fixSigma)) {
+            // Moved without stepping (or a bad model): trust the fix
+            gain = 1;
+        }
+        float correctedEast = east + gain * (offsetEast - east);
+        float correctedNorth = north + gain * (offsetNorth - north);
+
+        stats.lastCorrectionM = innovation;
+        originLat += correctedNorth / DR_METRES_PER_DEGREE;
+        originLon += correctedEast / lonScale;
+        originSigmaM = sqrtf(gain) * fixSigma;
+    }
+
+    east = north = 0;
+    originMs = fix.timestamp;
+    steps = 0;
+    walkedM = 0;
+    yawSin = yawCos = 0;
+    lastFixLat = fix.latitude;
+    lastFixLon = fix.longitude;
+    lastFixMs = fix.timestamp;
+
+    stats.strideM = strideM;
+    stats.headingOffsetDeg = headingOffset * RAD_TO_DEG;
+    return true;
+}
+
+DeadReckoningEstimate DeadReckoning::getEstimate() {
+    DeadReckoningEstimate estimate;
+    estimate.valid = hasOrigin;
+    if (!hasOrigin) {
+        estimate.latitude = 0;
+        estimate.longitude = 0;
+        estimate.uncertaintyM = 0;
+        estimate.steps = 0;
+        estimate.ageMs = 0;
+        return estimate;
+    }
+
+    uint32_t now = millis();
+    estimate.latitude = originLat + north / DR_METRES_PER_DEGREE;
+    estimate.longitude = originLon + east / metresPerDegreeLon(originLat);
+    estimate.uncertaintyM = uncertainty(now);
+    estimate.steps = steps;
+    estimate.ageMs = now - originMs;
+    return estimate;
+}
+
+DeadReckoningStats DeadReckoning::getStats() {
+    return stats;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file Downlink.cpp
+ * @brief Remote configuration downlink implementation
+ */
+
+#include "Downlink.h"
+
+uint32_t Downlink::hashDeviceId(const char* deviceId) {
+    uint32_t hash = 2166136261UL;
+    while (*deviceId) {
+        hash ^= (uint8_t)*deviceId++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+bool Downlink::isFrame(const uint8_t* data, size_t length) {
+    return length >= sizeof(DownlinkHeader) && data[0] == FRAME_MAGIC;
+}
+
+// ---------------------------------------------------------------------------
+// Dongle side
+// ---------------------------------------------------------------------------
+
+DownlinkQueue::DownlinkQueue() : collarCount(0) {
+    memset(entries, 0, sizeof(entries));
+    memset(&campaign, 0, sizeof(campaign));
+}
+
+DownlinkQueue::Entry* DownlinkQueue::find(uint32_t deviceId) {
+    for (uint16_t i = 0; i < collarCount; i++) {
+        if (entries[i].deviceId == deviceId) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+bool DownlinkQueue::addCollar(uint32_t deviceId) {
+    if (find(deviceId)) {
+        return true;
+    }
+
+    if (collarCount >= DOWNLINK_MAX_COLLARS) {
+        return false;
+    }
+
+    Entry& entry = entries[collarCount++];
+    memset(&entry, 0, sizeof(entry));
+    entry.deviceId = deviceId;
+    // Random start so a dongle reboot never reuses a sequence the collar
+    // would treat as a duplicate
+    entry.sequence = random(0x10000);
+    return true;
+}
+
+bool DownlinkQueue::append(Entry& entry, uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    if (entry.length + 2 + length > DOWNLINK_MAX_PAYLOAD) {
+        return false;
+    }
+
+    if (entry.length == 0) {
+        entry.queuedTime = millis();
+        entry.attempts = 0;
+    }
+
+    entry.payload[entry.length++] = opcode;
+    entry.payload[entry.length++] = length;
+    memcpy(&entry.payload[entry.length], payload, length);
+    entry.length += length;
+
+    // New content means a new frame; an ack for the old one no longer counts
+    entry.sequence++;
+    return true;
+}
+
+bool DownlinkQueue::enqueue(uint32_t deviceId, uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    if (!addCollar(deviceId)) {
+        return false;
+    }
+
+    return append(*find(deviceId), opcode, payload, length);
+}
+
+uint16_t DownlinkQueue::enqueueAll(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    campaign.active = true;
+    campaign.startTime = millis();
+    campaign.targets = 0;
+    campaign.acked = 0;
+    campaign.lastAckTime = 0;
+    campaign.herdLatencyMs = 0;
+
+    for (uint16_t i = 0; i < collarCount; i++) {
+        if (append(entries[i], opcode, payload, length)) {
+            entries[i].inCampaign = true;
+            campaign.targets++;
+        }
+    }
+
+    if (campaign.targets == 0) {
+        campaign.active = false;
+    }
+
+    return campaign.targets;
+}
+
+size_t DownlinkQueue::onUplink(uint32_t deviceId, uint8_t* frame) {
+    addCollar(deviceId);
+
+    Entry* entry = find(deviceId);
+    if (!entry || entry->length == 0) {
+        return 0;
+    }
+
+    DownlinkHeader header;
+    header.magic = FRAME_MAGIC;
+    header.type = FRAME_TYPE_DOWNLINK;
+    header.deviceId = deviceId;
+    header.sequence = entry->sequence;
+
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), entry->payload, entry->length);
+    entry->attempts++;
+
+    return sizeof(header) + entry->length;
+}
+
+bool DownlinkQueue::onAck(const uint8_t* frame, size_t length) {
+    if (!Downlink::isFrame(frame, length)) {
+        return false;
+    }
+
+    DownlinkHeader header;
+    memcpy(&header, frame, sizeof(header));
+    if (header.type != FRAME_TYPE_ACK) {
+        return false;
+    }
+
+    Entry* entry = find(header.deviceId);
+    if (!entry || entry->length == 0 || header.sequence != entry->sequence) {
+        return false;  // Stale or duplicate ack
+    }
+
+    Serial.printf("Downlink %04X acked by %08X after %u attempt(s), %u ms\n",
+                  header.sequence, header.deviceId, entry->attempts,
+                  millis() - entry->queuedTime);
+
+    entry->length = 0;
+
+    if (entry->inCampaign) {
+        entry->inCampaign = false;
+        campaign.acked++;
+        campaign.lastAckTime = millis();
+        if (campaign.active && campaign.acked >= campaign.targets) {
+            campaign.active = false;
+            campaign.herdLatencyMs = campaign.lastAckTime - campaign.startTime;
+        }
+    }
+
+    return true;
+}
+
+uint16_t DownlinkQueue::getPendingCount() {
+    uint16_t pending = 0;
+    for (uint16_t i = 0; i < collarCount; i++) {
+        if (entries[i].length > 0) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+DownlinkCampaignStats DownlinkQueue::getCampaignStats() {
+    return campaign;
+}
+
+// ---------------------------------------------------------------------------
+// Collar side
+// ---------------------------------------------------------------------------
+
+DownlinkHandler::DownlinkHandler(const char* id) : deviceId(Downlink::hashDeviceId(id)),
+                                                   commandHandler(nullptr),
+                                                   hasLastSequence(false),
+                                                   lastSequence(0),
+                                                   lastStatusCount(0) {
+}
+
+void DownlinkHandler::setCommandHandler(DownlinkCommandHandler handler) {
+    commandHandler = handler;
+}
+
+size_t DownlinkHandler::handleFrame(const uint8_t* frame, size_t length, uint8_t* ack) {
+    if (!Downlink::isFrame(frame, length)) {
+        return 0;
+    }
+
+    DownlinkHeader header;
+    memcpy(&header, frame, sizeof(header));
+    if (header.type != FRAME_TYPE_DOWNLINK || header.deviceId != deviceId) {
+        return 0;
+    }
+
+    // A repeat means our ack was lost: acknowledge again, don't re-apply
+    bool duplicate = hasLastSequence && header.sequence == lastSequence;
+
+    if (!duplicate) {
+        lastStatusCount = 0;
+        size_t pos = sizeof(header);
+
+        while (pos + 2 <= length && lastStatusCount < sizeof(lastStatus)) {
+            uint8_t opcode = frame[pos];
+            uint8_t size = frame[pos + 1];
+            if (pos + 2 + size > length) {
+                break;
+            }
+
+            uint8_t status = DL_STATUS_UNSUPPORTED;
+            if (commandHandler) {
+                status = commandHandler(opcode, &frame[pos + 2], size);
+            }
+            lastStatus[lastStatusCount++] = status;
+            pos += 2 + size;
+        }
+
+        lastSequence = header.sequence;
+        hasLastSequence = true;
+    }
+
+    header.type = FRAME_TYPE_ACK;
+    memcpy(ack, &header, sizeof(header));
+    memcpy(ack + sizeof(header), lastStatus, lastStatusCount);
+
+    return sizeof(header) + lastStatusCount;
+}
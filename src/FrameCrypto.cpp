@@ -0,0 +1,515 @@
+/**
+ * @file FrameCrypto.cpp
+ * @brief Authenticated LoRa frame encryption implementation
+ */
+
+#include "FrameCrypto.h"
+#include "Downlink.h"
+
+#define AES_BLOCK   16
+
+// Constants for the keys derived from a collar key
+#define KEY_LABEL_CTR       0x01
+#define KEY_LABEL_MAC       0x02
+#define KEY_LABEL_COLLAR    0x03
+
+#ifdef BRAVO_NATIVE
+static const uint8_t SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+static inline uint8_t xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+}
+#endif
+
+/**
+ * @brief Multiply by x in GF(2^128), as for the CMAC subkeys
+ */
+static void doubleBlock(const uint8_t* in, uint8_t* out) {
+    uint8_t carry = in[0] & 0x80;
+    for (int i = 0; i < AES_BLOCK - 1; i++) {
+        out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+    }
+    out[AES_BLOCK - 1] = (uint8_t)(in[AES_BLOCK - 1] << 1);
+    if (carry) {
+        out[AES_BLOCK - 1] ^= 0x87;
+    }
+}
+
+/**
+ * @brief Fill the block shared by the CTR nonce and the MIC prefix
+ */
+static void nonceBlock(uint8_t direction, uint32_t collarId, uint32_t counter, uint8_t* block) {
+    memset(block, 0, AES_BLOCK);
+    block[0] = direction;
+    memcpy(block + 1, &collarId, sizeof(collarId));
+    memcpy(block + 5, &counter, sizeof(counter));
+}
+
+FrameCrypto::FrameCrypto(const char* deviceId, bool dongle)
+    : ownId(Downlink::hashDeviceId(deviceId)), dongle(dongle), active(false),
+      txCounter(0), txReserved(0), counterStore(nullptr), deepResyncMs(0), peerCount(0) {
+    memset(masterKey, 0, sizeof(masterKey));
+    memset(&stats, 0, sizeof(stats));
+#ifndef BRAVO_NATIVE
+    mbedtls_aes_init(&aes);
+#endif
+}
+
+bool FrameCrypto::isFrame(const uint8_t* data, size_t length) {
+    return length >= CRYPTO_OVERHEAD && data[0] == CRYPTO_MAGIC;
+}
+
+void FrameCrypto::provisionKey(const uint8_t* herdKey, uint8_t* key) {
+    if (dongle) {
+        memcpy(key, herdKey, CRYPTO_KEY_SIZE);
+    } else {
+        deriveCollarKey(herdKey, ownId, key);
+    }
+}
+
+void FrameCrypto::setCounterStore(CryptoCounterStore store) {
+    counterStore = store;
+}
+
+bool FrameCrypto::begin(const uint8_t* key, uint32_t tx, uint32_t rx) {
+    memset(peers, 0, sizeof(peers));
+    peerCount = 0;
+    if (dongle) {
+        memcpy(masterKey, key, CRYPTO_KEY_SIZE);
+    } else {
+        peers[0].collarId = ownId;
+        peers[0].lastRx = rx;
+        setupPeer(peers[0], key);
+        peerCount = 1;
+    }
+
+    // Counters up to the stored reservation may have been used before the
+    // reboot: carry on above it
+    txCounter = tx;
+    txReserved = tx;
+    deepResyncMs = millis() - CRYPTO_DEEP_RESYNC_MS;
+    active = true;
+    return reserveCounters();
+}
+
+bool FrameCrypto::isActive() {
+    return active;
+}
+
+size_t FrameCrypto::seal(const uint8_t* payload, size_t length, uint8_t* frame, size_t maxLength,
+                         uint32_t collarId) {
+    size_t frameLength = length + CRYPTO_OVERHEAD;
+    if (!active || frameLength > maxLength || frameLength > CRYPTO_MAX_FRAME) {
+        return 0;
+    }
+
+    uint32_t startUs = micros();
+    Peer* peer = findPeer(dongle ? collarId : ownId);
+    if (peer == nullptr && dongle) {
+        // First frame for this collar: derive its keys once
+        Peer added;
+        derivePeer(collarId, added);
+        peer = addPeer(added);
+    }
+    if (peer == nullptr) {
+        return 0;
+    }
+    if (txCounter >= txReserved && !reserveCounters()) {
+        stats.counterStalls++;
+        return 0;
+    }
+    uint32_t counter = ++txCounter;
+    uint8_t direction = dongle ? CRYPTO_DIR_DOWNLINK : CRYPTO_DIR_UPLINK;
+
+    CryptoHeader header;
+    header.magic = CRYPTO_MAGIC;
+    header.collarId = peer->collarId;
+    header.counter = (uint16_t)counter;
+    memcpy(frame, &header, sizeof(header));
+
+    uint8_t* body = frame + sizeof(header);
+    memcpy(body, payload, length);
+    crypt(*peer, direction, counter, body, length);
+    mic(*peer, direction, counter, body, length, body + length);
+
+    stats.sealed++;
+    stats.lastSealUs = micros() - startUs;
+    return frameLength;
+}
+
+bool FrameCrypto::open(uint8_t* frame, size_t& length, uint32_t& collarId) {
+    if (!active || !isFrame(frame, length) || length > CRYPTO_MAX_FRAME) {
+        return false;
+    }
+
+    uint32_t startUs = micros();
+    CryptoHeader header;
+    memcpy(&header, frame, sizeof(header));
+    collarId = header.collarId;
+
+    // Collars hear the downlinks of their neighbours, and in relay mode
+    // their uplinks too
+    if (!dongle && header.collarId != ownId) {
+        stats.notOurs++;
+        return false;
+    }
+    // An unknown collar's keys go into a scratch entry that takes a slot
+    // only once the MIC checks out, so forged IDs cannot fill the table
+    Peer candidate;
+    Peer* peer = findPeer(header.collarId);
+    if (peer == nullptr) {
+        if (!dongle) {
+            return false;
+        }
+        derivePeer(header.collarId, candidate);
+        peer = &candidate;
+    }
+
+    uint8_t direction = dongle ? CRYPTO_DIR_UPLINK : CRYPTO_DIR_DOWNLINK;
+    uint8_t* body = frame + sizeof(header);
+    size_t bodyLength = length - CRYPTO_OVERHEAD;
+    const uint8_t* received = body + bodyLength;
+
+    // The first counter above the last accepted one with these low bits,
+    // then the same low bits in later epochs
+    uint32_t counter = (peer->lastRx & 0xFFFF0000UL) | header.counter;
+    if (counter <= peer->lastRx) {
+        counter += 0x10000UL;
+    }
+    uint16_t epochs = peer->lastRx == 0 ? CRYPTO_RESYNC_EPOCHS : CRYPTO_TRACK_EPOCHS;
+    bool authentic = findCounter(*peer, direction, body, bodyLength, received, counter, epochs);
+    if (!authentic && peer->lastRx == 0 && CRYPTO_DEEP_RESYNC_EPOCHS > epochs &&
+        deepResyncAllowed()) {
+        // A collar that has sent more frames than the first epochs hold, or
+        // a forgery: carry on from where the search stopped
+        authentic = findCounter(*peer, direction, body, bodyLength, received, counter,
+                                CRYPTO_DEEP_RESYNC_EPOCHS - epochs);
+    }
+
+    if (!authentic) {
+        // Tell a replay from a forgery: the same low bits at or below the
+        // last accepted counter
+        uint32_t old = (peer->lastRx & 0xFFFF0000UL) | header.counter;
+        if (old > peer->lastRx) {
+            old -= 0x10000UL;
+        }
+        bool replay = false;
+        if (old <= peer->lastRx) {
+            uint8_t expected[CRYPTO_MIC_SIZE];
+            mic(*peer, direction, old, body, bodyLength, expected);
+            replay = memcmp(expected, received, CRYPTO_MIC_SIZE) == 0;
+        }
+        if (replay) {
+            stats.replayed++;
+        } else {
+            stats.badMic++;
+        }
+        return false;
+    }
+
+    if (peer == &candidate) {
+        peer = addPeer(candidate);
+        if (peer == nullptr) {
+            return false;
+        }
+    }
+
+    crypt(*peer, direction, counter, body, bodyLength);
+    memmove(frame, body, bodyLength);
+    length = bodyLength;
+
+    peer->lastRx = counter;
+    if (!dongle && counterStore != nullptr) {
+        counterStore(CRYPTO_COUNTER_RX, counter);
+    }
+
+    stats.opened++;
+    stats.lastOpenUs = micros() - startUs;
+    return true;
+}
+
+CryptoStats FrameCrypto::getStats() {
+    return stats;
+}
+
+bool FrameCrypto::cmac(const uint8_t* key, const uint8_t* data, size_t length, uint8_t* tag) {
+    if (length > CRYPTO_MAX_FRAME) {
+        return false;
+    }
+    uint8_t k1[AES_BLOCK];
+    cmacSubkey(key, k1);
+    memcpy(scratch, data, length);
+    cmacScratch(key, k1, length, tag);
+    return true;
+}
+
+void FrameCrypto::ctr(const uint8_t* key, uint8_t* counterBlock, uint8_t* data, size_t length) {
+    setKey(key);
+    encryptCtr(counterBlock, data, length);
+}
+
+FrameCrypto::Peer* FrameCrypto::findPeer(uint32_t collarId) {
+    for (uint8_t i = 0; i < peerCount; i++) {
+        if (peers[i].collarId == collarId) {
+            return &peers[i];
+        }
+    }
+    return nullptr;
+}
+
+void FrameCrypto::derivePeer(uint32_t collarId, Peer& peer) {
+    uint8_t collarKey[CRYPTO_KEY_SIZE];
+    deriveCollarKey(masterKey, collarId, collarKey);
+    peer.collarId = collarId;
+    peer.lastRx = 0;
+    setupPeer(peer, collarKey);
+}
+
+FrameCrypto::Peer* FrameCrypto::addPeer(const Peer& peer) {
+    if (peerCount >= CRYPTO_MAX_PEERS) {
+        stats.noPeer++;
+        return nullptr;
+    }
+    peers[peerCount] = peer;
+    return &peers[peerCount++];
+}
+
+void FrameCrypto::deriveCollarKey(const uint8_t* herdKey, uint32_t collarId, uint8_t* key) {
+    uint8_t block[AES_BLOCK];
+    memset(block, 0, sizeof(block));
+    block[0] = KEY_LABEL_COLLAR;
+    memcpy(block + 1, &collarId, sizeof(collarId));
+    setKey(herdKey);
+    encryptBlock(block, key);
+}
+
+void FrameCrypto::setupPeer(Peer& peer, const uint8_t* key) {
+    uint8_t block[AES_BLOCK];
+    memset(block, 0, sizeof(block));
+
+    setKey(key);
+    block[0] = KEY_LABEL_CTR;
+    encryptBlock(block, peer.ctrKey);
+    block[0] = KEY_LABEL_MAC;
+    encryptBlock(block, peer.macKey);
+    cmacSubkey(peer.macKey, peer.macK1);
+}
+
+void FrameCrypto::cmacSubkey(const uint8_t* macKey, uint8_t* k1) {
+    // K1 = 2 * E(0); K2 = 2 * K1 is cheap enough to redo
+    uint8_t block[AES_BLOCK];
+    memset(block, 0, sizeof(block));
+    setKey(macKey);
+    encryptBlock(block, block);
+    doubleBlock(block, k1);
+}
+
+bool FrameCrypto::reserveCounters() {
+    uint32_t reserved = txCounter + CRYPTO_COUNTER_RESERVE;
+    if (counterStore != nullptr && !counterStore(CRYPTO_COUNTER_TX, reserved)) {
+        return false;
+    }
+    txReserved = reserved;
+    return true;
+}
+
+void FrameCrypto::crypt(const Peer& peer, uint8_t direction, uint32_t counter, uint8_t* data,
+                        size_t length) {
+    uint8_t counterBlock[AES_BLOCK];
+    nonceBlock(direction, peer.collarId, counter, counterBlock);
+    setKey(peer.ctrKey);
+    encryptCtr(counterBlock, data, length);
+}
+
+void FrameCrypto::mic(const Peer& peer, uint8_t direction, uint32_t counter,
+                      const uint8_t* data, size_t length, uint8_t* out) {
+    // CMAC over nonce block || ciphertext
+    uint8_t tag[AES_BLOCK];
+    nonceBlock(direction, peer.collarId, counter, scratch);
+    memcpy(scratch + AES_BLOCK, data, length);
+    cmacScratch(peer.macKey, peer.macK1, AES_BLOCK + length, tag);
+    memcpy(out, tag, CRYPTO_MIC_SIZE);
+}
+
+void FrameCrypto::cmacScratch(const uint8_t* macKey, const uint8_t* k1, size_t length,
+                              uint8_t* tag) {
+    // An empty message is one incomplete block
+    size_t blocks = length == 0 ? 1 : (length + AES_BLOCK - 1) / AES_BLOCK;
+    size_t lastLength = length - (blocks - 1) * AES_BLOCK;
+
+    uint8_t last[AES_BLOCK];
+    memset(last, 0, sizeof(last));
+    memcpy(last, scratch + (blocks - 1) * AES_BLOCK, lastLength);
+    if (lastLength == AES_BLOCK) {
+        for (int i = 0; i < AES_BLOCK; i++) {
+            last[i] ^= k1[i];
+        }
+    } else {
+        uint8_t k2[AES_BLOCK];
+        doubleBlock(k1, k2);
+        last[lastLength] = 0x80;
+        for (int i = 0; i < AES_BLOCK; i++) {
+            last[i] ^= k2[i];
+        }
+    }
+
+    uint8_t state[AES_BLOCK];
+    memset(state, 0, sizeof(state));
+    setKey(macKey);
+    cbcMac(state, scratch, blocks - 1);
+    for (int i = 0; i < AES_BLOCK; i++) {
+        state[i] ^= last[i];
+    }
+    encryptBlock(state, tag);
+}
+
+bool FrameCrypto::findCounter(const Peer& peer, uint8_t direction, const uint8_t* body,
+                              size_t bodyLength, const uint8_t* received, uint32_t& counter,
+                              uint16_t epochs) {
+    uint8_t expected[CRYPTO_MIC_SIZE];
+    for (uint16_t i = 0; i < epochs && counter > peer.lastRx; i++, counter += 0x10000UL) {
+        mic(peer, direction, counter, body, bodyLength, expected);
+        if (memcmp(expected, received, CRYPTO_MIC_SIZE) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FrameCrypto::deepResyncAllowed() {
+    uint32_t now = millis();
+    if (now - deepResyncMs < CRYPTO_DEEP_RESYNC_MS) {
+        return false;
+    }
+    deepResyncMs = now;
+    stats.deepResyncs++;
+    return true;
+}
+
+#ifdef BRAVO_NATIVE
+
+void FrameCrypto::setKey(const uint8_t* key) {
+    memcpy(roundKeys, key, AES_BLOCK);
+    uint8_t rcon = 0x01;
+    for (int i = AES_BLOCK; i < (int)sizeof(roundKeys); i += 4) {
+        uint8_t t[4] = {roundKeys[i - 4], roundKeys[i - 3], roundKeys[i - 2], roundKeys[i - 1]};
+        if (i % AES_BLOCK == 0) {
+            uint8_t first = t[0];
+            t[0] = SBOX[t[1]] ^ rcon;
+            t[1] = SBOX[t[2]];
+            t[2] = SBOX[t[3]];
+            t[3] = SBOX[first];
+            rcon = xtime(rcon);
+        }
+        for (int j = 0; j < 4; j++) {
+            roundKeys[i + j] = roundKeys[i - AES_BLOCK + j] ^ t[j];
+        }
+    }
+}
+
+void FrameCrypto::encryptBlock(const uint8_t* in, uint8_t* out) {
+    uint8_t s[AES_BLOCK];
+    for (int i = 0; i < AES_BLOCK; i++) {
+        s[i] = in[i] ^ roundKeys[i];
+    }
+
+    for (int round = 1; round <= 10; round++) {
+        // SubBytes and ShiftRows (column-major state)
+        uint8_t t[AES_BLOCK];
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                t[c * 4 + r] = SBOX[s[((c + r) & 3) * 4 + r]];
+            }
+        }
+
+        if (round < 10) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* a = &t[c * 4];
+                uint8_t all = a[0] ^ a[1] ^ a[2] ^ a[3];
+                uint8_t a0 = a[0];
+                a[0] ^= all ^ xtime(a[0] ^ a[1]);
+                a[1] ^= all ^ xtime(a[1] ^ a[2]);
+                a[2] ^= all ^ xtime(a[2] ^ a[3]);
+                a[3] ^= all ^ xtime(a[3] ^ a0);
+            }
+        }
+
+        const uint8_t* key = &roundKeys[round * AES_BLOCK];
+        for (int i = 0; i < AES_BLOCK; i++) {
+            s[i] = t[i] ^ key[i];
+        }
+    }
+
+    memcpy(out, s, AES_BLOCK);
+}
+
+void FrameCrypto::encryptCtr(uint8_t* counterBlock, uint8_t* data, size_t length) {
+    uint8_t stream[AES_BLOCK];
+    for (size_t offset = 0; offset < length; offset += AES_BLOCK) {
+        encryptBlock(counterBlock, stream);
+        size_t count = min(length - offset, (size_t)AES_BLOCK);
+        for (size_t i = 0; i < count; i++) {
+            data[offset + i] ^= stream[i];
+        }
+        for (int i = AES_BLOCK - 1; i >= 0 && ++counterBlock[i] == 0; i--) {
+        }
+    }
+}
+
+void FrameCrypto::cbcMac(uint8_t* state, const uint8_t* data, size_t blocks) {
+    for (size_t b = 0; b < blocks; b++) {
+        for (int i = 0; i < AES_BLOCK; i++) {
+            state[i] ^= data[b * AES_BLOCK + i];
+        }
+        encryptBlock(state, state);
+    }
+}
+
+#else
+
+// mbedtls hands these to the AES peripheral (CONFIG_MBEDTLS_HARDWARE_AES,
+// on by default); whole-buffer calls take the peripheral once per frame
+// rather than once per block
+
+void FrameCrypto::setKey(const uint8_t* key) {
+    mbedtls_aes_setkey_enc(&aes, key, CRYPTO_KEY_SIZE * 8);
+}
+
+void FrameCrypto::encryptBlock(const uint8_t* in, uint8_t* out) {
+    mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, in, out);
+}
+
+void FrameCrypto::encryptCtr(uint8_t* counterBlock, uint8_t* data, size_t length) {
+    size_t offset = 0;
+    uint8_t stream[AES_BLOCK];
+    mbedtls_aes_crypt_ctr(&aes, length, &offset, counterBlock, stream, data, data);
+}
+
+void FrameCrypto::cbcMac(uint8_t* state, const uint8_t* data, size_t blocks) {
+    if (blocks == 0) {
+        return;
+    }
+    // CBC encryption leaves the last ciphertext block in the IV; the
+    // ciphertext itself goes to the scratch buffer the data came from
+    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, blocks * AES_BLOCK, state, data,
+                          scratch);
+}
+
+#endif
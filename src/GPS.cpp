@@ -5,27 +5,32 @@
 
 #include "GPS.h"
 
-GPS::GPS() : gpsSerial(nullptr), initialized(false) {
+GPS::GPS(UartHAL& uart) : uart(uart), initialized(false), powerOnTime(0), sentenceUs(0) {
 }
 
 bool GPS::begin() {
-    // Initialize hardware serial for GPS
-    gpsSerial = &Serial2;
-    gpsSerial->begin(GPS_BAUD, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+    // Initialize serial port for GPS
+    if (!uart.begin(GPS_BAUD)) {
+        Serial.println("GPS serial init failed!");
+        return false;
+    }
 
     initialized = true;
+    powerOnTime = millis();
     Serial.println("GPS initialized successfully");
     return true;
 }
 
 void GPS::update() {
-    if (!initialized || !gpsSerial) {
+    if (!initialized) {
         return;
     }
 
     // Feed GPS parser with available data
-    while (gpsSerial->available() > 0) {
-        gps.encode(gpsSerial->read());
+    while (uart.available() > 0) {
+        if (gps.encode(uart.read())) {
+            sentenceUs = micros();
+        }
     }
 }
 
@@ -102,3 +107,65 @@ GPSData GPS::getData() {
 
     return data;
 }
+
+bool GPS::getTime(GPSTime& time) {
+    if (!initialized || !gps.time.isUpdated() || !gps.time.isValid() || !gps.date.isValid()) {
+        return false;
+    }
+
+    // Receivers report 2000 or 2080 before they have the almanac
+    uint16_t year = gps.date.year();
+    uint8_t month = gps.date.month();
+    uint8_t day = gps.date.day();
+    if (year < 2020 || year > 2079 || month < 1 || month > 12 || day < 1 || day > 31) {
+        gps.time.value();  // Clears the update
+        return false;
+    }
+
+    // Days from civil date (Howard Hinnant), March-based year
+    int32_t y = (int32_t)year - (month <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + (int32_t)doe - 719468;
+
+    time.unixSeconds = (uint32_t)days * 86400UL + gps.time.hour() * 3600UL +
+                       gps.time.minute() * 60UL + gps.time.second();
+    time.millisecond = gps.time.centisecond() * 10;
+    time.receivedUs = sentenceUs;
+    return true;
+}
+
+bool GPS::setUpdateRate(uint16_t periodMs) {
+    if (!initialized) {
+        return false;
+    }
+
+    periodMs = max(periodMs, (uint16_t)200);
+
+    // UBX-CFG-RATE: measRate, navRate = 1, timeRef = GPS
+    uint8_t packet[14] = {
+        0xB5, 0x62, 0x06, 0x08, 0x06, 0x00,
+        (uint8_t)(periodMs & 0xFF), (uint8_t)(periodMs >> 8),
+        0x01, 0x00, 0x01, 0x00,
+        0x00, 0x00
+    };
+
+    // Fletcher checksum over class, id, length and payload
+    uint8_t ckA = 0, ckB = 0;
+    for (int i = 2; i < 12; i++) {
+        ckA += packet[i];
+        ckB += ckA;
+    }
+    packet[12] = ckA;
+    packet[13] = ckB;
+
+    uart.write(packet, sizeof(packet));
+    return true;
+}
+
+uint32_t GPS::getOnTimeMs() {
+    // The receiver is powered continuously once started
+    return initialized ? millis() - powerOnTime : 0;
+}
@@ -0,0 +1,561 @@
+/**
+ * @file Geofence.cpp
+ * @brief Geofence engine implementation
+ */
+
+#include "Geofence.h"
+
+#define GEOFENCE_CELLS      (GEOFENCE_GRID_DIM * GEOFENCE_GRID_DIM)
+
+// Distance reported for fences with no edge near the point
+#define GEOFENCE_FAR_M      1e9f
+
+// Times a cell's reference point is moved off a fence edge
+#define GEOFENCE_NUDGE_TRIES 8
+
+/**
+ * @brief Twice the signed area of triangle (a, b, c)
+ * @return > 0 if c is left of a->b, < 0 if right, 0 if collinear
+ */
+static int64_t orient(const GeofencePoint& a, const GeofencePoint& b, const GeofencePoint& c) {
+    return (int64_t)(b.lon - a.lon) * (c.lat - a.lat) -
+           (int64_t)(b.lat - a.lat) * (c.lon - a.lon);
+}
+
+static void putI32(uint8_t* p, int32_t value) {
+    memcpy(p, &value, sizeof(value));
+}
+
+static int32_t getI32(const uint8_t* p) {
+    int32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+Geofence::Geofence() {
+    clear();
+}
+
+void Geofence::clear() {
+    fenceCount = 0;
+    vertexCount = 0;
+    defining = false;
+    active = false;
+    confirmedInside = 0;
+    confirmedKnown = 0;
+    memset(pendingFixes, 0, sizeof(pendingFixes));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool Geofence::beginFence(uint8_t id, const GeofencePoint& origin) {
+    active = false;
+    defining = false;
+
+    // A fence with the same id is replaced
+    for (uint8_t slot = 0; slot < fenceCount; slot++) {
+        if (fences[slot].id != id) {
+            continue;
+        }
+
+        uint16_t first = fences[slot].firstVertex;
+        uint16_t count = fences[slot].vertexCount;
+        memmove(&vertices[first], &vertices[first + count],
+                (vertexCount - first - count) * sizeof(GeofencePoint));
+        vertexCount -= count;
+
+        for (uint8_t next = slot + 1; next < fenceCount; next++) {
+            fences[next - 1] = fences[next];
+            fences[next - 1].firstVertex -= count;
+        }
+        fenceCount--;
+        break;
+    }
+
+    if (fenceCount == GEOFENCE_MAX_FENCES) {
+        return false;
+    }
+
+    GeofenceInfo& fence = fences[fenceCount++];
+    fence.id = id;
+    fence.origin = origin;
+    fence.firstVertex = vertexCount;
+    fence.vertexCount = 0;
+    defining = true;
+    return true;
+}
+
+bool Geofence::addVertex(const GeofenceWireVertex& offset) {
+    if (!defining || vertexCount == GEOFENCE_MAX_VERTICES) {
+        return false;
+    }
+
+    GeofenceInfo& fence = fences[fenceCount - 1];
+    vertices[vertexCount].lat = fence.origin.lat + offset.lat;
+    vertices[vertexCount].lon = fence.origin.lon + offset.lon;
+    vertexCount++;
+    fence.vertexCount++;
+    return true;
+}
+
+uint16_t Geofence::edgeEnd(uint16_t edge) {
+    const GeofenceInfo& fence = fences[vertexFence[edge]];
+    return edge + 1 == fence.firstVertex + fence.vertexCount ? fence.firstVertex : edge + 1;
+}
+
+int Geofence::cellOf(const GeofencePoint& point) {
+    if (point.lat < gridOrigin.lat || point.lon < gridOrigin.lon) {
+        return -1;
+    }
+
+    int32_t row = (point.lat - gridOrigin.lat) / cellHeight;
+    int32_t column = (point.lon - gridOrigin.lon) / cellWidth;
+    if (row >= GEOFENCE_GRID_DIM || column >= GEOFENCE_GRID_DIM) {
+        return -1;
+    }
+    return row * GEOFENCE_GRID_DIM + column;
+}
+
+uint16_t Geofence::assignEdges(bool fill, uint16_t* cursor) {
+    uint32_t total = 0;
+
+    for (uint16_t edge = 0; edge < vertexCount; edge++) {
+        const GeofencePoint& a = vertices[edge];
+        const GeofencePoint& b = vertices[edgeEnd(edge)];
+
+        // Every cell within the margin of the edge lists it
+        int32_t low = min(a.lat, b.lat) - marginLat - gridOrigin.lat;
+        int32_t high = max(a.lat, b.lat) + marginLat - gridOrigin.lat;
+        int32_t firstRow = constrain(low / cellHeight, 0, GEOFENCE_GRID_DIM - 1);
+        int32_t lastRow = constrain(high / cellHeight, 0, GEOFENCE_GRID_DIM - 1);
+
+        for (int32_t row = firstRow; row <= lastRow; row++) {
+            // Longitude extent of the part of the edge within the row band
+            double bandLow = gridOrigin.lat + (double)row * cellHeight - marginLat;
+            double bandHigh = bandLow + cellHeight + 2.0 * marginLat;
+            double west, east;
+            if (a.lat == b.lat) {
+                west = min(a.lon, b.lon);
+                east = max(a.lon, b.lon);
+            } else {
+                double t0 = (bandLow - a.lat) / (double)(b.lat - a.lat);
+                double t1 = (bandHigh - a.lat) / (double)(b.lat - a.lat);
+                if (t0 > t1) {
+                    double swap = t0;
+                    t0 = t1;
+                    t1 = swap;
+                }
+                t0 = max(t0, 0.0);
+                t1 = min(t1, 1.0);
+                if (t0 > t1) {
+                    continue;
+                }
+                double lon0 = a.lon + t0 * (b.lon - a.lon);
+                double lon1 = a.lon + t1 * (b.lon - a.lon);
+                west = min(lon0, lon1);
+                east = max(lon0, lon1);
+            }
+
+            // One extra unit each side absorbs rounding
+            int32_t firstColumn = (int32_t)floor((west - marginLon - 1 - gridOrigin.lon) / cellWidth);
+            int32_t lastColumn = (int32_t)floor((east + marginLon + 1 - gridOrigin.lon) / cellWidth);
+            firstColumn = constrain(firstColumn, 0, GEOFENCE_GRID_DIM - 1);
+            lastColumn = constrain(lastColumn, 0, GEOFENCE_GRID_DIM - 1);
+
+            for (int32_t column = firstColumn; column <= lastColumn; column++) {
+                int cell = row * GEOFENCE_GRID_DIM + column;
+                if (fill) {
+                    cellEdges[cursor[cell]++] = edge;
+                } else {
+                    cellStart[cell + 1]++;
+                }
+                total++;
+            }
+        }
+
+        if (total > GEOFENCE_MAX_CELL_EDGES) {
+            return UINT16_MAX;
+        }
+    }
+
+    return total;
+}
+
+bool Geofence::commit() {
+    defining = false;
+    active = false;
+    confirmedInside = 0;
+    confirmedKnown = 0;
+    memset(pendingFixes, 0, sizeof(pendingFixes));
+
+    if (fenceCount == 0) {
+        return true;
+    }
+
+    // Every fence must be a polygon
+    GeofencePoint low = vertices[0];
+    GeofencePoint high = vertices[0];
+    for (uint8_t slot = 0; slot < fenceCount; slot++) {
+        const GeofenceInfo& fence = fences[slot];
+        if (fence.vertexCount < 3) {
+            Serial.printf("Geofence %u has only %u vertices\n", fence.id, fence.vertexCount);
+            return false;
+        }
+        for (uint16_t i = fence.firstVertex; i < fence.firstVertex + fence.vertexCount; i++) {
+            vertexFence[i] = slot;
+            low.lat = min(low.lat, vertices[i].lat);
+            low.lon = min(low.lon, vertices[i].lon);
+            high.lat = max(high.lat, vertices[i].lat);
+            high.lon = max(high.lon, vertices[i].lon);
+        }
+    }
+
+    // Grid over the fences plus the margin, so fixes outside it are clear
+    double midLatitude = (low.lat + high.lat) / 2.0 / GEOFENCE_UNITS_PER_DEGREE;
+    lonScale = max((float)cos(midLatitude * DEG_TO_RAD), 0.01f);
+    marginLat = (int32_t)ceil(GEOFENCE_HYSTERESIS_M / GEOFENCE_METRES_PER_UNIT);
+    marginLon = (int32_t)ceil(GEOFENCE_HYSTERESIS_M / (GEOFENCE_METRES_PER_UNIT * lonScale));
+    gridOrigin.lat = low.lat - marginLat;
+    gridOrigin.lon = low.lon - marginLon;
+    cellHeight = (high.lat - low.lat + 2 * marginLat) / GEOFENCE_GRID_DIM + 1;
+    cellWidth = (high.lon - low.lon + 2 * marginLon) / GEOFENCE_GRID_DIM + 1;
+
+    // Count edges per cell, then fill the lists
+    memset(cellStart, 0, sizeof(cellStart));
+    uint16_t total = assignEdges(false, nullptr);
+    if (total == UINT16_MAX) {
+        Serial.println("Geofence index full: simplify the fences");
+        return false;
+    }
+
+    uint16_t cursor[GEOFENCE_CELLS];
+    stats.maxCellEdges = 0;
+    for (int cell = 0; cell < GEOFENCE_CELLS; cell++) {
+        stats.maxCellEdges = max(stats.maxCellEdges, cellStart[cell + 1]);
+        cellStart[cell + 1] += cellStart[cell];
+        cursor[cell] = cellStart[cell];
+    }
+    assignEdges(true, cursor);
+    stats.cellEdges = total;
+
+    // Reference point per cell: the centre, moved off any edge through it
+    for (int cell = 0; cell < GEOFENCE_CELLS; cell++) {
+        GeofencePoint& reference = cellReference[cell];
+        reference.lat = gridOrigin.lat + (cell / GEOFENCE_GRID_DIM) * cellHeight + cellHeight / 2;
+        reference.lon = gridOrigin.lon + (cell % GEOFENCE_GRID_DIM) * cellWidth + cellWidth / 2;
+
+        for (int attempt = 0; attempt < GEOFENCE_NUDGE_TRIES; attempt++) {
+            bool onEdge = false;
+            for (uint16_t i = cellStart[cell]; i < cellStart[cell + 1] && !onEdge; i++) {
+                const GeofencePoint& a = vertices[cellEdges[i]];
+                const GeofencePoint& b = vertices[edgeEnd(cellEdges[i])];
+                onEdge = orient(a, b, reference) == 0 &&
+                         reference.lat >= min(a.lat, b.lat) && reference.lat <= max(a.lat, b.lat) &&
+                         reference.lon >= min(a.lon, b.lon) && reference.lon <= max(a.lon, b.lon);
+            }
+            GeofencePoint moved = { reference.lat + 1, reference.lon + 2 };
+            if (!onEdge || cellOf(moved) != cell) {
+                break;
+            }
+            reference = moved;
+        }
+
+        cellMask[cell] = containsLinear(reference);
+    }
+
+    active = true;
+    Serial.printf("Geofence: %u fences, %u vertices, %u cell entries (max %u per cell)\n",
+                  fenceCount, vertexCount, stats.cellEdges, stats.maxCellEdges);
+    return true;
+}
+
+bool Geofence::applyCommand(const uint8_t* payload, size_t length) {
+    if (length < 1) {
+        return false;
+    }
+
+    const uint8_t* args = payload + 1;
+    size_t argLength = length - 1;
+    size_t header;
+
+    switch (payload[0]) {
+        case GEOFENCE_OP_CLEAR:
+            clear();
+            return argLength == 0;
+
+        case GEOFENCE_OP_BEGIN: {
+            header = 1 + 2 * sizeof(int32_t);
+            if (argLength < header) {
+                return false;
+            }
+            GeofencePoint origin;
+            origin.lat = getI32(&args[1]);
+            origin.lon = getI32(&args[5]);
+            if (!beginFence(args[0], origin)) {
+                return false;
+            }
+            break;
+        }
+
+        case GEOFENCE_OP_APPEND:
+            header = 1;
+            if (argLength < header || !defining || fences[fenceCount - 1].id != args[0]) {
+                return false;
+            }
+            break;
+
+        case GEOFENCE_OP_COMMIT:
+            return argLength == 0 && commit();
+
+        default:
+            return false;
+    }
+
+    // BEGIN and APPEND carry vertices after their header
+    if ((argLength - header) % sizeof(GeofenceWireVertex) != 0) {
+        return false;
+    }
+    for (size_t offset = header; offset < argLength; offset += sizeof(GeofenceWireVertex)) {
+        GeofenceWireVertex vertex;
+        memcpy(&vertex, &args[offset], sizeof(vertex));
+        if (!addVertex(vertex)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t Geofence::encode(uint8_t* buffer, size_t maxLength) {
+    // u8 version, u8 fence count, then per fence u8 id, u16 vertex count,
+    // i32 origin lat, i32 origin lon and the vertex offsets
+    size_t length = 2 + fenceCount * 11 + vertexCount * sizeof(GeofenceWireVertex);
+    if (length > maxLength) {
+        return 0;
+    }
+
+    uint8_t* p = buffer;
+    *p++ = GEOFENCE_FORMAT_VERSION;
+    *p++ = fenceCount;
+    for (uint8_t slot = 0; slot < fenceCount; slot++) {
+        const GeofenceInfo& fence = fences[slot];
+        *p++ = fence.id;
+        memcpy(p, &fence.vertexCount, sizeof(uint16_t));
+        p += sizeof(uint16_t);
+        putI32(p, fence.origin.lat);
+        putI32(p + 4, fence.origin.lon);
+        p += 8;
+
+        for (uint16_t i = fence.firstVertex; i < fence.firstVertex + fence.vertexCount; i++) {
+            GeofenceWireVertex vertex;
+            vertex.lat = vertices[i].lat - fence.origin.lat;
+            vertex.lon = vertices[i].lon - fence.origin.lon;
+            memcpy(p, &vertex, sizeof(vertex));
+            p += sizeof(vertex);
+        }
+    }
+
+    return p - buffer;
+}
+
+bool Geofence::decode(const uint8_t* data, size_t length) {
+    clear();
+    if (length < 2 || data[0] != GEOFENCE_FORMAT_VERSION) {
+        return false;
+    }
+
+    const uint8_t* p = data + 2;
+    const uint8_t* end = data + length;
+    for (uint8_t fence = 0; fence < data[1]; fence++) {
+        if (end - p < 11) {
+            clear();
+            return false;
+        }
+
+        uint16_t count;
+        memcpy(&count, p + 1, sizeof(count));
+        GeofencePoint origin;
+        origin.lat = getI32(p + 3);
+        origin.lon = getI32(p + 7);
+        if (!beginFence(p[0], origin) ||
+            (size_t)(end - p - 11) < count * sizeof(GeofenceWireVertex)) {
+            clear();
+            return false;
+        }
+        p += 11;
+
+        for (uint16_t i = 0; i < count; i++) {
+            GeofenceWireVertex vertex;
+            memcpy(&vertex, p, sizeof(vertex));
+            p += sizeof(vertex);
+            if (!addVertex(vertex)) {
+                clear();
+                return false;
+            }
+        }
+    }
+
+    if (!commit()) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+uint16_t Geofence::containsLinear(const GeofencePoint& point) {
+    uint16_t mask = 0;
+
+    for (uint8_t slot = 0; slot < fenceCount; slot++) {
+        const GeofenceInfo& fence = fences[slot];
+        bool inside = false;
+
+        // Crossing number for a ray towards +longitude; half-open in
+        // latitude so a ray through a vertex counts once
+        uint16_t last = fence.firstVertex + fence.vertexCount - 1;
+        for (uint16_t i = fence.firstVertex; i <= last; i++) {
+            const GeofencePoint& a = vertices[i == fence.firstVertex ? last : i - 1];
+            const GeofencePoint& b = vertices[i];
+            if ((a.lat > point.lat) != (b.lat > point.lat)) {
+                int64_t side = orient(a, b, point);
+                if (b.lat > a.lat ? side > 0 : side < 0) {
+                    inside = !inside;
+                }
+            }
+        }
+
+        if (inside) {
+            mask |= 1 << slot;
+        }
+    }
+
+    return mask;
+}
+
+float Geofence::distanceToEdge(const GeofencePoint& point, uint16_t edge) {
+    // Local metric frame centred on the point
+    const GeofencePoint& a = vertices[edge];
+    const GeofencePoint& b = vertices[edgeEnd(edge)];
+    float ax = (a.lon - point.lon) * lonScale;
+    float ay = a.lat - point.lat;
+    float dx = (b.lon - a.lon) * lonScale;
+    float dy = b.lat - a.lat;
+
+    float lengthSq = dx * dx + dy * dy;
+    float t = lengthSq > 0 ? constrain(-(ax * dx + ay * dy) / lengthSq, 0.0f, 1.0f) : 0.0f;
+    float x = ax + t * dx;
+    float y = ay + t * dy;
+    return sqrtf(x * x + y * y) * GEOFENCE_METRES_PER_UNIT;
+}
+
+uint16_t Geofence::evaluate(const GeofencePoint& point, float* distanceM) {
+    stats.evaluations++;
+    if (distanceM) {
+        for (uint8_t slot = 0; slot < fenceCount; slot++) {
+            distanceM[slot] = GEOFENCE_FAR_M;
+        }
+    }
+
+    int cell = cellOf(point);
+    if (cell < 0) {
+        return 0;
+    }
+
+    // The inside state changes at each edge crossed on the way from the
+    // cell's reference point; both points are in the cell, so only its
+    // edges can be crossed. Vertices on the segment count as right of it.
+    const GeofencePoint& reference = cellReference[cell];
+    uint16_t mask = cellMask[cell];
+    for (uint16_t i = cellStart[cell]; i < cellStart[cell + 1]; i++) {
+        uint16_t edge = cellEdges[i];
+        const GeofencePoint& a = vertices[edge];
+        const GeofencePoint& b = vertices[edgeEnd(edge)];
+
+        bool leftA = orient(point, reference, a) > 0;
+        bool leftB = orient(point, reference, b) > 0;
+        if (leftA != leftB && (orient(a, b, point) > 0) != (orient(a, b, reference) > 0)) {
+            mask ^= 1 << vertexFence[edge];
+        }
+
+        if (distanceM) {
+            uint8_t slot = vertexFence[edge];
+            distanceM[slot] = min(distanceM[slot], distanceToEdge(point, edge));
+        }
+    }
+    stats.edgesTested += cellStart[cell + 1] - cellStart[cell];
+
+    return mask;
+}
+
+uint16_t Geofence::contains(const GeofencePoint& point) {
+    return active ? evaluate(point, nullptr) : 0;
+}
+
+uint8_t Geofence::update(const GPSData& fix, GeofenceEvent* events, uint8_t maxEvents) {
+    if (!active || !fix.valid) {
+        return 0;
+    }
+
+    GeofencePoint point;
+    point.lat = toUnits(fix.latitude);
+    point.lon = toUnits(fix.longitude);
+
+    float distance[GEOFENCE_MAX_FENCES];
+    uint16_t inside = evaluate(point, distance);
+
+    uint8_t count = 0;
+    for (uint8_t slot = 0; slot < fenceCount; slot++) {
+        uint16_t bit = 1 << slot;
+        bool nowInside = inside & bit;
+        bool known = confirmedKnown & bit;
+
+        if (known && nowInside == (bool)(confirmedInside & bit)) {
+            pendingFixes[slot] = 0;
+            continue;
+        }
+
+        // Fixes near the boundary neither confirm nor cancel a crossing
+        if (distance[slot] < GEOFENCE_HYSTERESIS_M ||
+            ++pendingFixes[slot] < GEOFENCE_CONFIRM_FIXES) {
+            continue;
+        }
+
+        pendingFixes[slot] = 0;
+        confirmedKnown |= bit;
+        if (nowInside) {
+            confirmedInside |= bit;
+        } else {
+            confirmedInside &= ~bit;
+        }
+
+        // The first classification after a commit is not a crossing
+        if (known && count < maxEvents) {
+            events[count].fenceId = fences[slot].id;
+            events[count].entered = nowInside;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+bool Geofence::isActive() {
+    return active;
+}
+
+uint8_t Geofence::getFenceCount() {
+    return fenceCount;
+}
+
+uint16_t Geofence::getVertexCount() {
+    return vertexCount;
+}
+
+GeofenceInfo Geofence::getFence(uint8_t slot) {
+    return fences[slot];
+}
+
+GeofenceStats Geofence::getStats() {
+    return stats;
+}
+
+int32_t Geofence::toUnits(double degrees) {
+    return (int32_t)lround(degrees * GEOFENCE_UNITS_PER_DEGREE);
+}
@@ -4,29 +4,20 @@
  */
 
 #include "IMU.h"
-#include <Wire.h>
 
-IMU::IMU() : initialized(false) {
+IMU::IMU(ImuHAL& sensor) : sensor(sensor), initialized(false) {
     memset(&currentData, 0, sizeof(IMUData));
 }
 
 bool IMU::begin() {
-    // Initialize I2C
-    Wire.begin(IMU_SDA_PIN, IMU_SCL_PIN);
-
-    // Initialize MPU6050
-    if (!mpu.begin()) {
+    // Initialize and configure the sensor
+    if (!sensor.begin()) {
         Serial.println("Failed to find MPU6050 chip");
         return false;
     }
 
     Serial.println("MPU6050 Found!");
 
-    // Configure MPU6050
-    mpu.setAccelerometerRange(MPU6050_RANGE_8_G);
-    mpu.setGyroRange(MPU6050_RANGE_500_DEG);
-    mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
-
     initialized = true;
     Serial.println("IMU initialized successfully");
     return true;
@@ -37,16 +28,18 @@ bool IMU::readSensor() {
         return false;
     }
 
-    sensors_event_t accel, gyro, temp;
-    mpu.getEvent(&accel, &gyro, &temp);
+    IMUReading reading;
+    if (!sensor.read(reading)) {
+        return false;
+    }
 
-    currentData.accelX = accel.acceleration.x;
-    currentData.accelY = accel.acceleration.y;
-    currentData.accelZ = accel.acceleration.z;
-    currentData.gyroX = gyro.gyro.x;
-    currentData.gyroY = gyro.gyro.y;
-    currentData.gyroZ = gyro.gyro.z;
-    currentData.temperature = temp.temperature;
+    currentData.accelX = reading.accel[0];
+    currentData.accelY = reading.accel[1];
+    currentData.accelZ = reading.accel[2];
+    currentData.gyroX = reading.gyro[0];
+    currentData.gyroY = reading.gyro[1];
+    currentData.gyroZ = reading.gyro[2];
+    currentData.temperature = reading.temperature;
     currentData.timestamp = millis();
 
     return true;
@@ -105,3 +98,20 @@ bool IMU::isInMotion(float threshold) {
     // Check if acceleration differs from gravity by more than threshold
     return abs(magnitude - 9.8) > threshold;
 }
+
+static int16_t saturate16(float value) {
+    if (value > 32767.0f) return 32767;
+    if (value < -32768.0f) return -32768;
+    return (int16_t)lroundf(value);
+}
+
+IMURawSample IMU::toRaw(const IMUData& data) {
+    IMURawSample raw;
+    raw.accelX = saturate16(data.accelX * IMU_RAW_ACCEL_SCALE);
+    raw.accelY = saturate16(data.accelY * IMU_RAW_ACCEL_SCALE);
+    raw.accelZ = saturate16(data.accelZ * IMU_RAW_ACCEL_SCALE);
+    raw.gyroX = saturate16(data.gyroX * IMU_RAW_GYRO_SCALE);
+    raw.gyroY = saturate16(data.gyroY * IMU_RAW_GYRO_SCALE);
+    raw.gyroZ = saturate16(data.gyroZ * IMU_RAW_GYRO_SCALE);
+    return raw;
+}
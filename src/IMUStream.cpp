@@ -0,0 +1,119 @@
+/**
+ * @file IMUStream.cpp
+ * @brief Live IMU sample streaming implementation
+ */
+
+#include "IMUStream.h"
+
+IMUStream::IMUStream() : writeIndex(0), readIndex(0), readyCount(0),
+                         batchSize(1), sequence(0), active(false) {
+    memset(&stats, 0, sizeof(stats));
+    stats.rateHz = IMU_STREAM_DEFAULT_RATE;
+}
+
+void IMUStream::start(size_t maxPacketSize) {
+    // Fit as many samples as the negotiated MTU allows
+    size_t fit = (maxPacketSize - sizeof(IMUStreamHeader)) / sizeof(IMURawSample);
+    batchSize = constrain(fit, (size_t)1, (size_t)IMU_STREAM_MAX_BATCH);
+
+    writeIndex = 0;
+    readIndex = 0;
+    readyCount = 0;
+    queue[0].header.count = 0;
+    stats.active = active = true;
+
+    Serial.printf("IMU stream started: %u Hz, %u samples/batch\n",
+                  stats.rateHz, batchSize);
+}
+
+void IMUStream::stop() {
+    if (active) {
+        Serial.println("IMU stream paused");
+    }
+    stats.active = active = false;
+    readyCount = 0;
+    queue[writeIndex].header.count = 0;
+}
+
+bool IMUStream::isActive() {
+    return active;
+}
+
+void IMUStream::setRate(uint16_t hz) {
+    stats.rateHz = constrain(hz, IMU_STREAM_MIN_RATE, IMU_STREAM_MAX_RATE);
+}
+
+uint8_t IMUStream::getPeriodMs() {
+    return 1000 / stats.rateHz;
+}
+
+void IMUStream::push(const IMUData& data) {
+    if (!active) {
+        return;
+    }
+
+    Batch& batch = queue[writeIndex];
+    if (batch.header.count == 0) {
+        batch.header.sequence = sequence++;
+        batch.header.baseTimestamp = data.timestamp;
+        batch.header.periodMs = getPeriodMs();
+    }
+
+    batch.samples[batch.header.count++] = IMU::toRaw(data);
+    stats.samples++;
+
+    if (batch.header.count >= batchSize) {
+        commitBatch();
+    }
+}
+
+void IMUStream::commitBatch() {
+    // Queue full: drop the oldest batch so the phone sees fresh data and a
+    // sequence gap, rather than ever making the sampler wait
+    if (readyCount == IMU_STREAM_QUEUE_BATCHES - 1) {
+        readIndex = (readIndex + 1) % IMU_STREAM_QUEUE_BATCHES;
+        readyCount--;
+        stats.droppedBatches++;
+    }
+
+    readyCount++;
+    writeIndex = (writeIndex + 1) % IMU_STREAM_QUEUE_BATCHES;
+    queue[writeIndex].header.count = 0;
+}
+
+size_t IMUStream::nextPacket(uint8_t* buffer, size_t maxLength) {
+    if (!active) {
+        return 0;
+    }
+
+    // Flush a partial batch once it gets stale
+    Batch& pending = queue[writeIndex];
+    if (readyCount == 0 && pending.header.count > 0 &&
+        millis() - pending.header.baseTimestamp >= IMU_STREAM_MAX_LATENCY) {
+        commitBatch();
+    }
+
+    if (readyCount == 0) {
+        return 0;
+    }
+
+    Batch& batch = queue[readIndex];
+    size_t sampleBytes = batch.header.count * sizeof(IMURawSample);
+    size_t length = sizeof(IMUStreamHeader) + sampleBytes;
+    if (length > maxLength) {
+        return 0;
+    }
+
+    memcpy(buffer, &batch.header, sizeof(IMUStreamHeader));
+    memcpy(buffer + sizeof(IMUStreamHeader), batch.samples, sampleBytes);
+
+    readIndex = (readIndex + 1) % IMU_STREAM_QUEUE_BATCHES;
+    readyCount--;
+    stats.sentBatches++;
+
+    return length;
+}
+
+IMUStreamStats IMUStream::getStats() {
+    return stats;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file LatencyTracker.cpp
+ * @brief Latency accounting implementation
+ */
+
+#include "LatencyTracker.h"
+
+static const char* const STAGE_NAMES[LATENCY_STAGE_COUNT] = {
+    "sample", "queue", "air", "network", "decode", "total"
+};
+
+LatencyTracker::LatencyTracker() : collars(nullptr), capacity(0), count(0), untracked(0) {
+}
+
+bool LatencyTracker::begin(uint8_t maxCollars) {
+    if (collars || maxCollars == 0) {
+        return false;
+    }
+
+    collars = (Collar*)calloc(maxCollars, sizeof(Collar));
+    if (!collars) {
+        return false;
+    }
+    capacity = maxCollars;
+    return true;
+}
+
+LatencyTracker::Collar* LatencyTracker::find(uint32_t collarId, const char* deviceId) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (collars[i].collarId == collarId) {
+            return &collars[i];
+        }
+    }
+
+    if (count == capacity) {
+        return nullptr;
+    }
+
+    Collar& collar = collars[count++];
+    memset(&collar, 0, sizeof(collar));
+    collar.collarId = collarId;
+    strncpy(collar.deviceId, deviceId, sizeof(collar.deviceId) - 1);
+    return &collar;
+}
+
+uint8_t LatencyTracker::bucketFor(uint32_t ms) {
+    if (ms < 4) {
+        return ms;
+    }
+    if (ms > LATENCY_MAX_MS) {
+        return LATENCY_BUCKETS - 1;
+    }
+
+    // Octave from the top bit, quarter of the octave from the next two
+    uint8_t octave = 31 - __builtin_clz(ms);
+    uint8_t quarter = (ms >> (octave - 2)) & 3;
+    return (octave - 1) * 4 + quarter;
+}
+
+uint32_t LatencyTracker::bucketMidMs(uint8_t bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+
+    uint8_t octave = bucket / 4 + 1;
+    uint8_t quarter = bucket % 4;
+    uint32_t width = 1UL << (octave - 2);
+    return (4 + quarter) * width + width / 2;
+}
+
+bool LatencyTracker::record(uint32_t collarId, const char* deviceId, LatencyStage stage,
+                            uint32_t ms) {
+    if (stage >= LATENCY_STAGE_COUNT) {
+        return false;
+    }
+
+    Collar* collar = collars ? find(collarId, deviceId) : nullptr;
+    if (!collar) {
+        untracked++;
+        return false;
+    }
+
+    Histogram& histogram = collar->stages[stage];
+    uint8_t bucket = bucketFor(ms);
+    if (histogram.buckets[bucket] == UINT16_MAX) {
+        for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+            histogram.buckets[i] /= 2;
+        }
+    }
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    return true;
+}
+
+uint8_t LatencyTracker::getCollarCount() {
+    return count;
+}
+
+const char* LatencyTracker::getCollar(uint8_t index, uint32_t& collarId) {
+    if (index >= count) {
+        return nullptr;
+    }
+    collarId = collars[index].collarId;
+    return collars[index].deviceId;
+}
+
+LatencyPercentiles LatencyTracker::percentiles(const uint32_t* buckets, uint32_t count) {
+    LatencyPercentiles result;
+    memset(&result, 0, sizeof(result));
+    result.count = count;
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        total += buckets[i];
+    }
+    if (total == 0) {
+        return result;
+    }
+
+    // Smallest bucket holding at least the percentile's share of samples
+    const uint8_t percents[3] = {50, 95, 99};
+    uint32_t* outputs[3] = {&result.p50Ms, &result.p95Ms, &result.p99Ms};
+    uint32_t seen = 0;
+    uint8_t next = 0;
+    for (uint8_t i = 0; i < LATENCY_BUCKETS && next < 3; i++) {
+        seen += buckets[i];
+        while (next < 3 && (uint64_t)seen * 100 >= (uint64_t)total * percents[next]) {
+            *outputs[next++] = bucketMidMs(i);
+        }
+    }
+    return result;
+}
+
+LatencyPercentiles LatencyTracker::getPercentiles(uint8_t index, LatencyStage stage) {
+    uint32_t buckets[LATENCY_BUCKETS];
+    memset(buckets, 0, sizeof(buckets));
+    if (index >= count || stage >= LATENCY_STAGE_COUNT) {
+        return percentiles(buckets, 0);
+    }
+
+    const Histogram& histogram = collars[index].stages[stage];
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+        buckets[i] = histogram.buckets[i];
+    }
+    return percentiles(buckets, histogram.count);
+}
+
+LatencyPercentiles LatencyTracker::getHerdPercentiles(LatencyStage stage) {
+    uint32_t buckets[LATENCY_BUCKETS];
+    memset(buckets, 0, sizeof(buckets));
+    uint32_t total = 0;
+    if (stage < LATENCY_STAGE_COUNT) {
+        for (uint8_t c = 0; c < count; c++) {
+            const Histogram& histogram = collars[c].stages[stage];
+            for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+                buckets[i] += histogram.buckets[i];
+            }
+            total += histogram.count;
+        }
+    }
+    return percentiles(buckets, total);
+}
+
+uint32_t LatencyTracker::getUntracked() {
+    return untracked;
+}
+
+void LatencyTracker::reset() {
+    count = 0;
+    untracked = 0;
+}
+
+const char* LatencyTracker::stageName(LatencyStage stage) {
+    return stage < LATENCY_STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
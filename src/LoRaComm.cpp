@@ -4,25 +4,52 @@
  */
 
 #include "LoRaComm.h"
+#include "Trace.h"
+
+LoRaComm::LoRaComm(RadioHAL& radio) : radio(radio), initialized(false), pendingPacketSize(0),
+                                       windowOpen(false), windowStart(0), windowLength(0),
+                                       frequency(LORA_BAND),
+                                       spreadingFactor(LORA_SPREAD), bandwidth(LORA_BANDWIDTH),
+                                       txPower(17), listening(false), listenStartUs(0),
+                                       txTimeUs(0), rxTimeUs(0), txPackets(0), rxPackets(0),
+                                       lastTxStartUs(0), lastTxDurationUs(0), lastRxUs(0) {
+}
 
-LoRaComm::LoRaComm() : initialized(false) {
+void LoRaComm::setListening(bool on) {
+    uint32_t now = micros();
+    if (listening) {
+        rxTimeUs += now - listenStartUs;
+    }
+    listening = on;
+    listenStartUs = now;
 }
 
-bool LoRaComm::begin() {
-    // Setup LoRa pins
-    SPI.begin(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_CS);
-    LoRa.setPins(LORA_CS, LORA_RST, LORA_DIO0);
+bool LoRaComm::finishPacket() {
+    // endPacket() blocks until TX done, leaving the radio in standby
+    setListening(false);
+    uint32_t start = micros();
+    TRACE_BEGIN(TRACE_LORA_TX);
+    bool sent = radio.endPacket();
+    TRACE_END(TRACE_LORA_TX);
+    lastTxStartUs = start;
+    lastTxDurationUs = micros() - start;
+    txTimeUs += lastTxDurationUs;
+    txPackets++;
+    return sent;
+}
 
+bool LoRaComm::begin() {
     // Initialize LoRa module
-    if (!LoRa.begin(LORA_BAND)) {
+    if (!radio.begin(frequency)) {
         Serial.println("LoRa init failed!");
         return false;
     }
 
     // Configure LoRa parameters
-    LoRa.setSpreadingFactor(LORA_SPREAD);
-    LoRa.setSignalBandwidth(LORA_BANDWIDTH);
-    LoRa.enableCrc();
+    radio.setSpreadingFactor(spreadingFactor);
+    radio.setSignalBandwidth(bandwidth);
+    radio.setTxPower(txPower);
+    radio.enableCrc();
 
     initialized = true;
     Serial.println("LoRa initialized successfully");
@@ -34,9 +61,9 @@ bool LoRaComm::sendData(const uint8_t* data, size_t length) {
         return false;
     }
 
-    LoRa.beginPacket();
-    LoRa.write(data, length);
-    return LoRa.endPacket();
+    radio.beginPacket();
+    radio.write(data, length);
+    return finishPacket();
 }
 
 bool LoRaComm::sendMessage(const String& message) {
@@ -44,9 +71,9 @@ bool LoRaComm::sendMessage(const String& message) {
         return false;
     }
 
-    LoRa.beginPacket();
-    LoRa.print(message);
-    return LoRa.endPacket();
+    radio.beginPacket();
+    radio.write((const uint8_t*)message.c_str(), message.length());
+    return finishPacket();
 }
 
 bool LoRaComm::available() {
@@ -54,7 +81,19 @@ bool LoRaComm::available() {
         return false;
     }
 
-    return LoRa.parsePacket() > 0;
+    // Parsing again would re-arm the receiver and lose the pending packet
+    if (pendingPacketSize == 0) {
+        if (!listening) {
+            setListening(true);
+        }
+        pendingPacketSize = radio.parsePacket();
+        if (pendingPacketSize > 0) {
+            lastRxUs = micros();
+            rxPackets++;
+        }
+    }
+
+    return pendingPacketSize > 0;
 }
 
 int LoRaComm::receiveData(uint8_t* buffer, size_t maxLength) {
@@ -62,13 +101,13 @@ int LoRaComm::receiveData(uint8_t* buffer, size_t maxLength) {
         return 0;
     }
 
-    int packetSize = LoRa.parsePacket();
-    int bytesRead = 0;
+    size_t bytesRead = 0;
 
-    while (LoRa.available() && bytesRead < maxLength) {
-        buffer[bytesRead++] = LoRa.read();
+    while (radio.available() && bytesRead < maxLength) {
+        buffer[bytesRead++] = radio.read();
     }
 
+    pendingPacketSize = 0;
     return bytesRead;
 }
 
@@ -77,18 +116,94 @@ String LoRaComm::receiveMessage() {
         return "";
     }
 
-    String message = "";
-    while (LoRa.available()) {
-        message += (char)LoRa.read();
+    // One allocation instead of one per grown character
+    String message;
+    message.reserve(pendingPacketSize);
+    while (radio.available()) {
+        message += (char)radio.read();
     }
 
+    pendingPacketSize = 0;
     return message;
 }
 
+void LoRaComm::openReceiveWindow(uint32_t durationMs) {
+    if (!initialized) {
+        return;
+    }
+
+    windowOpen = true;
+    windowStart = millis();
+    windowLength = durationMs;
+    // available() polls parsePacket(), which puts the radio in RX mode
+}
+
+bool LoRaComm::isReceiveWindowOpen() {
+    if (windowOpen && millis() - windowStart >= windowLength) {
+        windowOpen = false;
+        pendingPacketSize = 0;
+        setListening(false);
+        radio.sleep();
+    }
+
+    return windowOpen;
+}
+
 int LoRaComm::getRSSI() {
-    return LoRa.packetRssi();
+    return radio.packetRssi();
 }
 
 float LoRaComm::getSNR() {
-    return LoRa.packetSnr();
+    return radio.packetSnr();
+}
+
+bool LoRaComm::setPHY(long freq, uint8_t sf, long bw, int power) {
+    frequency = freq;
+    spreadingFactor = sf;
+    bandwidth = bw;
+    txPower = power;
+
+    if (!initialized) {
+        return false;
+    }
+
+    radio.setFrequency(frequency);
+    radio.setSpreadingFactor(spreadingFactor);
+    radio.setSignalBandwidth(bandwidth);
+    radio.setTxPower(txPower);
+    return true;
+}
+
+uint8_t LoRaComm::getSpreadingFactor() {
+    return spreadingFactor;
+}
+
+long LoRaComm::getBandwidth() {
+    return bandwidth;
+}
+
+uint32_t LoRaComm::getLastTxStartUs() {
+    return lastTxStartUs;
+}
+
+uint32_t LoRaComm::getLastTxDurationUs() {
+    return lastTxDurationUs;
+}
+
+uint32_t LoRaComm::getLastRxUs() {
+    return lastRxUs;
+}
+
+LoRaRadioStats LoRaComm::getRadioStats() {
+    // Fold in the current listening period
+    if (listening) {
+        setListening(true);
+    }
+
+    LoRaRadioStats stats;
+    stats.txTimeMs = txTimeUs / 1000;
+    stats.rxTimeMs = rxTimeUs / 1000;
+    stats.txPackets = txPackets;
+    stats.rxPackets = rxPackets;
+    return stats;
 }
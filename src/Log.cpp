@@ -0,0 +1,265 @@
+/**
+ * @file Log.cpp
+ * @brief Deferred-format logging implementation
+ */
+
+#include "Log.h"
+
+Logger logger;
+
+#define LOG_FORMAT_STRING(id, text) text,
+
+static const char* const FORMAT_STRINGS[LOG_FORMAT_COUNT] = {
+    LOG_FORMATS(LOG_FORMAT_STRING)
+};
+
+static const char LEVEL_CHARS[] = { '-', 'E', 'W', 'I', 'D' };
+
+Logger::Logger() : writeIndex(0), readIndex(0), written(0), dropped(0), reportedDropped(0),
+                   drained(0), binary(false) {
+    for (uint32_t i = 0; i < LOG_CAPACITY; i++) {
+        records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+#ifndef BRAVO_NATIVE
+static void logTask(void* parameter) {
+    Logger* log = (Logger*)parameter;
+    for (;;) {
+        log->drain(Serial);
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+#endif
+
+bool Logger::begin() {
+#ifndef BRAVO_NATIVE
+    // On the loop's core below its priority, so it only runs (and only
+    // waits on the UART) while the loop sleeps
+    return xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, this, LOG_TASK_PRIORITY,
+                                   nullptr, LOG_TASK_CORE) == pdPASS;
+#else
+    return false;
+#endif
+}
+
+bool IRAM_ATTR Logger::claim(uint32_t& slot) {
+    // A slot is free once the reader has moved its sequence a lap ahead
+    uint32_t index = writeIndex.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t sequence = records[index % LOG_CAPACITY].sequence.load(std::memory_order_acquire);
+        int32_t lag = (int32_t)(sequence - index);
+        if (lag == 0) {
+            if (writeIndex.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                slot = index;
+                written.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        } else if (lag < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            index = writeIndex.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::putWord(LogRecord& record, uint8_t tag, uint32_t word) {
+    if (record.length + 5 > LOG_ARGS_MAX) {
+        return;
+    }
+    uint8_t* p = record.args + record.length;
+    p[0] = tag;
+    memcpy(p + 1, &word, sizeof(word));
+    record.length += 5;
+}
+
+void Logger::put(LogRecord& record, const char* text) {
+    if (record.length + 2 > LOG_ARGS_MAX) {
+        return;
+    }
+    size_t length = text ? strlen(text) : 0;
+    length = min(length, (size_t)(LOG_ARGS_MAX - record.length - 2));
+    uint8_t* p = record.args + record.length;
+    p[0] = LOG_ARG_STRING;
+    p[1] = length;
+    memcpy(p + 2, text, length);
+    record.length += 2 + length;
+}
+
+void Logger::put(LogRecord& record, const String& text) {
+    put(record, text.c_str());
+}
+
+size_t Logger::formatRecord(const LogRecord& record, char* buffer, size_t maxLength) {
+    uint8_t level = record.level < sizeof(LEVEL_CHARS) ? record.level : 0;
+    int length = snprintf(buffer, maxLength, "%c [%u.%03u] ", LEVEL_CHARS[level],
+                          (unsigned)(record.timestampMs / 1000),
+                          (unsigned)(record.timestampMs % 1000));
+
+    const char* format = formatString(record.format);
+    uint8_t position = 0;
+    while (*format && length < (int)maxLength - 1) {
+        if (*format != '%') {
+            buffer[length++] = *format++;
+            continue;
+        }
+        if (format[1] == '%') {
+            buffer[length++] = '%';
+            format += 2;
+            continue;
+        }
+
+        // Copy flags, width and precision; length modifiers are dropped
+        // since every number is stored as 32 bits
+        char spec[16];
+        uint8_t specLength = 0;
+        spec[specLength++] = *format++;
+        while (*format && !strchr("diuxXcfeEgGs", *format)) {
+            if (!strchr("hlzjt", *format) && specLength < sizeof(spec) - 2) {
+                spec[specLength++] = *format;
+            }
+            format++;
+        }
+        if (!*format) {
+            break;
+        }
+        char conversion = *format++;
+        spec[specLength++] = conversion;
+        spec[specLength] = '\0';
+
+        const uint8_t* arg = record.args + position;
+        uint8_t tag = position < record.length ? arg[0] : 0;
+        uint32_t word = 0;
+        if (tag == LOG_ARG_STRING) {
+            position += 2 + arg[1];
+        } else if (tag != 0) {
+            memcpy(&word, arg + 1, sizeof(word));
+            position += 5;
+        }
+
+        size_t remaining = maxLength - length;
+        int printed;
+        if (tag == 0 || (tag == LOG_ARG_STRING) != (conversion == 's')) {
+            printed = snprintf(buffer + length, remaining, "?");
+        } else if (tag == LOG_ARG_STRING) {
+            // Stored without a terminator
+            printed = snprintf(buffer + length, remaining, "%.*s", arg[1], (const char*)arg + 2);
+        } else if (strchr("feEgG", conversion)) {
+            float value;
+            memcpy(&value, &word, sizeof(value));
+            if (tag != LOG_ARG_FLOAT) {
+                value = tag == LOG_ARG_INT ? (float)(int32_t)word : (float)word;
+            }
+            printed = snprintf(buffer + length, remaining, spec, (double)value);
+        } else {
+            if (tag == LOG_ARG_FLOAT) {
+                float value;
+                memcpy(&value, &word, sizeof(value));
+                word = (uint32_t)(int32_t)value;
+            }
+            printed = snprintf(buffer + length, remaining, spec, (unsigned)word);
+        }
+        if (printed > 0) {
+            length += min(printed, (int)remaining - 1);
+        }
+    }
+
+    if (length > (int)maxLength - 2) {
+        length = maxLength - 2;
+    }
+    buffer[length++] = '\n';
+    buffer[length] = '\0';
+    return length;
+}
+
+void Logger::emit(Print& output, const LogRecord& record) {
+    char line[LOG_LINE_MAX];
+    size_t length;
+    if (binary) {
+        // Timestamp, format, level, length and arguments as hex
+        uint8_t bytes[8 + LOG_ARGS_MAX];
+        memcpy(bytes, &record.timestampMs, 4);
+        memcpy(bytes + 4, &record.format, 2);
+        bytes[6] = record.level;
+        bytes[7] = record.length;
+        memcpy(bytes + 8, record.args, record.length);
+
+        length = snprintf(line, sizeof(line), "LOG ");
+        for (uint8_t i = 0; i < 8 + record.length; i++) {
+            length += snprintf(line + length, sizeof(line) - length, "%02x", bytes[i]);
+        }
+        line[length++] = '\n';
+    } else {
+        length = formatRecord(record, line, sizeof(line));
+    }
+    output.write((const uint8_t*)line, length);
+}
+
+bool Logger::next(LogRecord*& record) {
+    record = &records[readIndex % LOG_CAPACITY];
+    return record->sequence.load(std::memory_order_acquire) == readIndex + 1;
+}
+
+void Logger::release() {
+    // Hand the slot back to writers for the next lap
+    records[readIndex % LOG_CAPACITY].sequence.store(readIndex + LOG_CAPACITY,
+                                                     std::memory_order_release);
+    readIndex++;
+}
+
+size_t Logger::drain(Print& output) {
+    size_t count = 0;
+    LogRecord* record;
+    while (next(record)) {
+        emit(output, *record);
+        release();
+        count++;
+    }
+
+    // Report losses in the stream, where they happened
+    uint32_t lost = dropped.load(std::memory_order_relaxed);
+    if (lost != reportedDropped) {
+        LogRecord notice;
+        notice.timestampMs = millis();
+        notice.format = LOG_DROPPED;
+        notice.level = LOG_LEVEL_WARN;
+        notice.length = 0;
+        putWord(notice, LOG_ARG_UINT, lost - reportedDropped);
+        emit(output, notice);
+        reportedDropped = lost;
+    }
+
+    drained += count;
+    return count;
+}
+
+size_t Logger::discard() {
+    size_t count = 0;
+    LogRecord* record;
+    while (next(record)) {
+        release();
+        count++;
+    }
+    return count;
+}
+
+void Logger::setBinary(bool binary) {
+    this->binary = binary;
+}
+
+bool Logger::isBinary() {
+    return binary;
+}
+
+LogStats Logger::getStats() {
+    LogStats stats;
+    stats.written = written.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.drained = drained;
+    return stats;
+}
+
+const char* Logger::formatString(uint16_t format) {
+    return format < LOG_FORMAT_COUNT ? FORMAT_STRINGS[format] : "?";
+}
@@ -0,0 +1,168 @@
+/**
+ * @file MemoryMonitor.cpp
+ * @brief Heap health and per-subsystem allocation accounting implementation
+ */
+
+#include "MemoryMonitor.h"
+#include <assert.h>
+#ifndef BRAVO_NATIVE
+#include <esp_heap_caps.h>
+#endif
+
+MemoryMonitor memoryMonitor;
+
+static const char* const SUBSYSTEM_NAMES[MEM_SUBSYSTEM_COUNT] = {
+    "setup", "gps", "imu", "fusion", "telemetry", "lora_rx", "ble", "status", "loop", "tasks"
+};
+
+MemoryMonitor::MemoryMonitor() : failures(0), current(MEM_SETUP), loopTask(nullptr),
+                                 locked(false) {
+    for (uint8_t i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        allocations[i].store(0);
+        bytes[i].store(0);
+        freedBytes[i].store(0);
+    }
+}
+
+void MemoryMonitor::begin() {
+#ifndef BRAVO_NATIVE
+    // setup() and loop() share the Arduino loop task
+    loopTask = xTaskGetCurrentTaskHandle();
+#endif
+}
+
+void MemoryMonitor::lockHeap() {
+    current = MEM_LOOP;
+    locked = true;
+}
+
+bool MemoryMonitor::isHeapLocked() {
+    return locked;
+}
+
+MemorySubsystem MemoryMonitor::enter(MemorySubsystem subsystem) {
+    MemorySubsystem previous = (MemorySubsystem)current;
+    current = subsystem;
+    return previous;
+}
+
+uint8_t MemoryMonitor::charged() {
+    // Before begin() the scheduler may not be running yet
+    if (!loopTask) {
+        return MEM_SETUP;
+    }
+#ifndef BRAVO_NATIVE
+    return xTaskGetCurrentTaskHandle() == loopTask ? current : MEM_TASKS;
+#else
+    return current;
+#endif
+}
+
+void MemoryMonitor::onAllocate(size_t size) {
+    uint8_t subsystem = charged();
+    allocations[subsystem].fetch_add(1, std::memory_order_relaxed);
+    bytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+
+#if BRAVO_MEMORY_STRICT
+    assert(!locked || subsystem == MEM_TASKS);
+#endif
+}
+
+void MemoryMonitor::onFree(size_t size) {
+    freedBytes[charged()].fetch_add(size, std::memory_order_relaxed);
+}
+
+void MemoryMonitor::onFailure() {
+    failures.fetch_add(1, std::memory_order_relaxed);
+}
+
+MemoryStats MemoryMonitor::getStats() {
+    MemoryStats stats;
+#ifndef BRAVO_NATIVE
+    stats.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    stats.largestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    stats.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+#else
+    // The host heap has no fixed size
+    stats.freeHeap = 0;
+    stats.largestFreeBlock = 0;
+    stats.minFreeHeap = 0;
+#endif
+    stats.fragmentation = stats.freeHeap ?
+                          100 - (uint64_t)stats.largestFreeBlock * 100 / stats.freeHeap : 0;
+    stats.allocations = 0;
+    stats.bytes = 0;
+    stats.failures = failures.load(std::memory_order_relaxed);
+
+    for (uint8_t i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        MemorySubsystemStats& s = stats.subsystems[i];
+        s.allocations = allocations[i].load(std::memory_order_relaxed);
+        s.bytes = bytes[i].load(std::memory_order_relaxed);
+        s.netBytes = (int32_t)(s.bytes - freedBytes[i].load(std::memory_order_relaxed));
+        stats.allocations += s.allocations;
+        stats.bytes += s.bytes;
+    }
+    return stats;
+}
+
+const char* MemoryMonitor::subsystemName(uint8_t subsystem) {
+    return subsystem < MEM_SUBSYSTEM_COUNT ? SUBSYSTEM_NAMES[subsystem] : "?";
+}
+
+// ---------------------------------------------------------------------------
+// Allocator wrappers
+// ---------------------------------------------------------------------------
+
+// The benchmark harness installs its own wrappers; host builds are not wrapped
+#if !defined(BRAVO_BENCH) && !defined(BRAVO_NATIVE)
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    if (ptr) {
+        memoryMonitor.onAllocate(heap_caps_get_allocated_size(ptr));
+    } else if (size > 0) {
+        memoryMonitor.onFailure();
+    }
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    if (ptr) {
+        memoryMonitor.onAllocate(heap_caps_get_allocated_size(ptr));
+    } else if (count > 0 && size > 0) {
+        memoryMonitor.onFailure();
+    }
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    size_t oldSize = ptr ? heap_caps_get_allocated_size(ptr) : 0;
+    void* result = __real_realloc(ptr, size);
+    if (result) {
+        // A resize counts as freeing the old block and allocating the new one
+        if (oldSize > 0) {
+            memoryMonitor.onFree(oldSize);
+        }
+        memoryMonitor.onAllocate(heap_caps_get_allocated_size(result));
+    } else if (size > 0) {
+        memoryMonitor.onFailure();
+    } else if (oldSize > 0) {
+        memoryMonitor.onFree(oldSize);
+    }
+    return result;
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) {
+        memoryMonitor.onFree(heap_caps_get_allocated_size(ptr));
+    }
+    __real_free(ptr);
+}
+}
+#endif
@@ -3,6 +3,11 @@
  * @brief OTA update module implementation
  */
 
+#include "Role.h"
+
+// Without OTA the WiFi stack is left out of the build altogether
+#if BRAVO_OTA
+
 #include "OTA.h"
 
 OTA::OTA() : initialized(false), enabled(false) {
@@ -125,3 +130,5 @@ void OTA::onError(ota_error_t error) {
         Serial.println("End Failed");
     }
 }
+
+#endif // BRAVO_OTA
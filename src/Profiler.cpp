@@ -0,0 +1,141 @@
+/**
+ * @file Profiler.cpp
+ * @brief Per-subsystem timing and energy accounting implementation
+ */
+
+#include "Profiler.h"
+#include "Log.h"
+
+static const char* const SECTION_NAMES[PROF_SECTION_COUNT] = {
+    "gps", "imu", "telemetry", "lora_rx", "fusion"
+};
+
+static const char* const CONSUMER_NAMES[ENERGY_CONSUMER_COUNT] = {
+    "cpu", "lora_tx", "lora_rx", "gps", "ble"
+};
+
+static uint8_t bucketFor(uint32_t us) {
+    if (us < 2) {
+        return 0;
+    }
+    uint8_t bucket = 31 - __builtin_clz(us);
+    return bucket < PROFILER_BUCKETS ? bucket : PROFILER_BUCKETS - 1;
+}
+
+Profiler::Profiler() : startTime(0) {
+    model.currentMa[ENERGY_CPU] = PROFILER_CPU_ACTIVE_MA;
+    model.currentMa[ENERGY_LORA_TX] = PROFILER_LORA_TX_MA;
+    model.currentMa[ENERGY_LORA_RX] = PROFILER_LORA_RX_MA;
+    model.currentMa[ENERGY_GPS] = PROFILER_GPS_MA;
+    model.currentMa[ENERGY_BLE] = PROFILER_BLE_MA;
+    begin();
+}
+
+void Profiler::begin() {
+    memset(histograms, 0, sizeof(histograms));
+    memset(onTimeMs, 0, sizeof(onTimeMs));
+    startTime = millis();
+}
+
+uint32_t Profiler::now() {
+    return (uint32_t)esp_timer_get_time();
+}
+
+void Profiler::record(ProfileSection section, uint32_t startUs) {
+    uint32_t us = now() - startUs;
+    ProfileHistogram& h = histograms[section];
+
+    h.count++;
+    h.totalUs += us;
+    if (us > h.maxUs) {
+        h.maxUs = us;
+    }
+    h.buckets[bucketFor(us)]++;
+}
+
+void Profiler::setOnTime(EnergyConsumer consumer, uint32_t ms) {
+    onTimeMs[consumer] = ms;
+}
+
+void Profiler::setCurrentModel(const CurrentModel& currentModel) {
+    model = currentModel;
+}
+
+CurrentModel Profiler::getCurrentModel() {
+    return model;
+}
+
+const ProfileHistogram& Profiler::getHistogram(ProfileSection section) {
+    return histograms[section];
+}
+
+uint32_t Profiler::getPercentileUs(ProfileSection section, uint8_t percent) {
+    const ProfileHistogram& h = histograms[section];
+    if (h.count == 0) {
+        return 0;
+    }
+
+    // Rank of the requested sample, rounded up
+    uint32_t rank = ((uint64_t)h.count * percent + 99) / 100;
+    uint32_t seen = 0;
+
+    for (uint8_t i = 0; i < PROFILER_BUCKETS - 1; i++) {
+        seen += h.buckets[i];
+        if (seen >= rank) {
+            // Never report more than was actually observed
+            uint32_t upper = 2UL << i;
+            return upper < h.maxUs ? upper : h.maxUs;
+        }
+    }
+
+    return h.maxUs;
+}
+
+EnergySummary Profiler::getEnergy() {
+    EnergySummary summary;
+    memset(&summary, 0, sizeof(summary));
+    summary.elapsedMs = millis() - startTime;
+
+    // CPU busy time is what the timed sections consumed
+    uint64_t cpuUs = 0;
+    for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++) {
+        cpuUs += histograms[i].totalUs;
+    }
+    onTimeMs[ENERGY_CPU] = cpuUs / 1000;
+
+    for (uint8_t i = 0; i < ENERGY_CONSUMER_COUNT; i++) {
+        summary.onTimeMs[i] = onTimeMs[i];
+        summary.mAh[i] = model.currentMa[i] * onTimeMs[i] / 3600000.0f;
+        summary.totalMAh += summary.mAh[i];
+    }
+
+    if (summary.elapsedMs > 0) {
+        summary.avgCurrentMa = summary.totalMAh * 3600000.0f / summary.elapsedMs;
+    }
+
+    return summary;
+}
+
+const char* Profiler::sectionName(ProfileSection section) {
+    return section < PROF_SECTION_COUNT ? SECTION_NAMES[section] : "?";
+}
+
+const char* Profiler::consumerName(EnergyConsumer consumer) {
+    return consumer < ENERGY_CONSUMER_COUNT ? CONSUMER_NAMES[consumer] : "?";
+}
+
+void Profiler::logSummary() {
+    for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++) {
+        const ProfileHistogram& h = histograms[i];
+        // Call counts are in the status packet; a record holds 28 bytes of args
+        LOG_INFO(LOG_PROFILE_TIMING, SECTION_NAMES[i],
+                 h.count ? (uint32_t)(h.totalUs / h.count) : 0,
+                 getPercentileUs((ProfileSection)i, 95), h.maxUs);
+    }
+
+    EnergySummary energy = getEnergy();
+    for (uint8_t i = 0; i < ENERGY_CONSUMER_COUNT; i++) {
+        LOG_INFO(LOG_PROFILE_ENERGY, CONSUMER_NAMES[i], energy.onTimeMs[i], energy.mAh[i]);
+    }
+    LOG_INFO(LOG_PROFILE_TOTAL, energy.totalMAh, energy.avgCurrentMa);
+}
@@ -0,0 +1,388 @@
+/**
+ * @file ProximityIndex.cpp
+ * @brief Collar proximity index implementation
+ */
+
+#include "ProximityIndex.h"
+#include <math.h>
+
+#define METRES_PER_DEGREE_LAT   111320.0f
+
+/**
+ * @brief Insert a candidate into results sorted by distance, keeping the nearest
+ * @return New result count
+ */
+static size_t offer(ProximityResult* results, size_t found, size_t maxResults,
+                    uint16_t index, float distanceM) {
+    if (found == maxResults) {
+        if (maxResults == 0 || distanceM >= results[found - 1].distanceM) {
+            return found;
+        }
+        found--;
+    }
+
+    size_t position = found;
+    while (position > 0 && results[position - 1].distanceM > distanceM) {
+        results[position] = results[position - 1];
+        position--;
+    }
+    results[position].index = index;
+    results[position].distanceM = distanceM;
+    return found + 1;
+}
+
+ProximityIndex::ProximityIndex() : entries(nullptr), nodes(nullptr), cellBuckets(nullptr),
+                                   idBuckets(nullptr), capacity(0), bucketMask(0), count(0),
+                                   freeList(PROXIMITY_NONE), cellSize(PROXIMITY_CELL_M),
+                                   hasOrigin(false), originLat(0), originLon(0),
+                                   metresPerDegreeLon(METRES_PER_DEGREE_LAT) {
+}
+
+bool ProximityIndex::begin(uint16_t maxCollars, float cellSizeM) {
+    if (entries || maxCollars == 0 || maxCollars > 16384 || cellSizeM <= 0) {
+        return false;
+    }
+
+    // Twice as many buckets as collars keeps chains short
+    uint32_t buckets = 1;
+    while (buckets < (uint32_t)maxCollars * 2) {
+        buckets <<= 1;
+    }
+
+    entries = (ProximityEntry*)calloc(maxCollars, sizeof(ProximityEntry));
+    nodes = (Node*)calloc(maxCollars, sizeof(Node));
+    cellBuckets = (uint16_t*)malloc(buckets * sizeof(uint16_t));
+    idBuckets = (uint16_t*)malloc(buckets * sizeof(uint16_t));
+    if (!entries || !nodes || !cellBuckets || !idBuckets) {
+        free(entries);
+        free(nodes);
+        free(cellBuckets);
+        free(idBuckets);
+        entries = nullptr;
+        return false;
+    }
+
+    capacity = maxCollars;
+    bucketMask = buckets - 1;
+    cellSize = cellSizeM;
+    for (uint32_t i = 0; i < buckets; i++) {
+        cellBuckets[i] = PROXIMITY_NONE;
+        idBuckets[i] = PROXIMITY_NONE;
+    }
+    for (uint16_t i = 0; i < capacity; i++) {
+        nodes[i].idNext = i + 1 < capacity ? i + 1 : PROXIMITY_NONE;
+    }
+    freeList = 0;
+    return true;
+}
+
+void ProximityIndex::project(double latitude, double longitude, float& x, float& y) {
+    // Equirectangular around the first position: well under 1% error
+    // across a few tens of kilometres
+    x = (float)((longitude - originLon) * metresPerDegreeLon);
+    y = (float)((latitude - originLat) * METRES_PER_DEGREE_LAT);
+}
+
+int16_t ProximityIndex::toCell(float metres) {
+    float cell = floorf(metres / cellSize);
+    return (int16_t)constrain(cell, -32767.0f, 32767.0f);
+}
+
+uint16_t ProximityIndex::cellBucket(int16_t cellX, int16_t cellY) {
+    uint32_t hash = ((uint32_t)(int32_t)cellX * 73856093u) ^ ((uint32_t)(int32_t)cellY * 19349663u);
+    return (hash ^ (hash >> 16)) & bucketMask;
+}
+
+uint16_t ProximityIndex::idBucket(uint32_t collarId) {
+    return ((collarId * 2654435761u) >> 16) & bucketMask;
+}
+
+void ProximityIndex::link(uint16_t index) {
+    Node& node = nodes[index];
+    uint16_t bucket = cellBucket(node.cellX, node.cellY);
+    node.cellPrev = PROXIMITY_NONE;
+    node.cellNext = cellBuckets[bucket];
+    if (node.cellNext != PROXIMITY_NONE) {
+        nodes[node.cellNext].cellPrev = index;
+    }
+    cellBuckets[bucket] = index;
+}
+
+void ProximityIndex::unlink(uint16_t index) {
+    Node& node = nodes[index];
+    if (node.cellPrev != PROXIMITY_NONE) {
+        nodes[node.cellPrev].cellNext = node.cellNext;
+    } else {
+        cellBuckets[cellBucket(node.cellX, node.cellY)] = node.cellNext;
+    }
+    if (node.cellNext != PROXIMITY_NONE) {
+        nodes[node.cellNext].cellPrev = node.cellPrev;
+    }
+}
+
+uint16_t ProximityIndex::find(uint32_t collarId) {
+    if (!entries) {
+        return PROXIMITY_NONE;
+    }
+    for (uint16_t i = idBuckets[idBucket(collarId)]; i != PROXIMITY_NONE; i = nodes[i].idNext) {
+        if (entries[i].collarId == collarId) {
+            return i;
+        }
+    }
+    return PROXIMITY_NONE;
+}
+
+bool ProximityIndex::update(uint32_t collarId, const char* deviceId, uint64_t timeMs,
+                            double latitude, double longitude) {
+    if (!entries) {
+        return false;
+    }
+
+    if (!hasOrigin) {
+        originLat = latitude;
+        originLon = longitude;
+        metresPerDegreeLon = METRES_PER_DEGREE_LAT * cosf(latitude * DEG_TO_RAD);
+        hasOrigin = true;
+    }
+
+    uint16_t index = find(collarId);
+    if (index == PROXIMITY_NONE) {
+        if (freeList == PROXIMITY_NONE) {
+            return false;
+        }
+        index = freeList;
+        freeList = nodes[index].idNext;
+
+        uint16_t bucket = idBucket(collarId);
+        nodes[index].idNext = idBuckets[bucket];
+        idBuckets[bucket] = index;
+        nodes[index].used = true;
+
+        ProximityEntry& entry = entries[index];
+        entry.collarId = collarId;
+        strncpy(entry.deviceId, deviceId, sizeof(entry.deviceId) - 1);
+        entry.deviceId[sizeof(entry.deviceId) - 1] = '\0';
+        entry.neighbours = 0;
+        entry.previousNeighbours = 0;
+        count++;
+    } else {
+        unlink(index);
+    }
+
+    ProximityEntry& entry = entries[index];
+    entry.latitude = latitude;
+    entry.longitude = longitude;
+    entry.timeMs = timeMs;
+
+    Node& node = nodes[index];
+    project(latitude, longitude, node.x, node.y);
+    node.cellX = toCell(node.x);
+    node.cellY = toCell(node.y);
+    link(index);
+    return true;
+}
+
+void ProximityIndex::remove(uint16_t index) {
+    unlink(index);
+
+    uint16_t bucket = idBucket(entries[index].collarId);
+    if (idBuckets[bucket] == index) {
+        idBuckets[bucket] = nodes[index].idNext;
+    } else {
+        uint16_t i = idBuckets[bucket];
+        while (nodes[i].idNext != index) {
+            i = nodes[i].idNext;
+        }
+        nodes[i].idNext = nodes[index].idNext;
+    }
+
+    nodes[index].used = false;
+    nodes[index].idNext = freeList;
+    freeList = index;
+    count--;
+}
+
+uint16_t ProximityIndex::expire(uint64_t nowMs) {
+    uint16_t removed = 0;
+    for (uint16_t i = 0; i < capacity; i++) {
+        if (nodes[i].used && nowMs - entries[i].timeMs > PROXIMITY_MAX_AGE_MS) {
+            remove(i);
+            removed++;
+        }
+    }
+    return removed;
+}
+
+size_t ProximityIndex::visitCell(int16_t cellX, int16_t cellY, float x, float y, float radiusM,
+                                 ProximityResult* results, size_t found, size_t maxResults) {
+    // Other cells can share the bucket
+    for (uint16_t i = cellBuckets[cellBucket(cellX, cellY)]; i != PROXIMITY_NONE;
+         i = nodes[i].cellNext) {
+        const Node& node = nodes[i];
+        if (node.cellX != cellX || node.cellY != cellY) {
+            continue;
+        }
+        float distance = sqrtf((node.x - x) * (node.x - x) + (node.y - y) * (node.y - y));
+        if (distance <= radiusM) {
+            found = offer(results, found, maxResults, i, distance);
+        }
+    }
+    return found;
+}
+
+size_t ProximityIndex::scanAll(float x, float y, float radiusM, ProximityResult* results,
+                               size_t maxResults) {
+    size_t found = 0;
+    for (uint16_t i = 0; i < capacity; i++) {
+        if (!nodes[i].used) {
+            continue;
+        }
+        float distance = sqrtf((nodes[i].x - x) * (nodes[i].x - x) +
+                               (nodes[i].y - y) * (nodes[i].y - y));
+        if (distance <= radiusM) {
+            found = offer(results, found, maxResults, i, distance);
+        }
+    }
+    return found;
+}
+
+size_t ProximityIndex::findWithin(double latitude, double longitude, float radiusM,
+                                  ProximityResult* results, size_t maxResults) {
+    if (!entries || !hasOrigin || count == 0) {
+        return 0;
+    }
+
+    float x, y;
+    project(latitude, longitude, x, y);
+    int16_t cellX0 = toCell(x - radiusM);
+    int16_t cellX1 = toCell(x + radiusM);
+    int16_t cellY0 = toCell(y - radiusM);
+    int16_t cellY1 = toCell(y + radiusM);
+
+    // A circle covering more cells than there are collars is cheaper to scan
+    uint32_t cells = (uint32_t)(cellX1 - cellX0 + 1) * (cellY1 - cellY0 + 1);
+    if (cells > count) {
+        return scanAll(x, y, radiusM, results, maxResults);
+    }
+
+    size_t found = 0;
+    for (int16_t cellY = cellY0; cellY <= cellY1; cellY++) {
+        for (int16_t cellX = cellX0; cellX <= cellX1; cellX++) {
+            found = visitCell(cellX, cellY, x, y, radiusM, results, found, maxResults);
+        }
+    }
+    return found;
+}
+
+size_t ProximityIndex::findNearest(double latitude, double longitude, size_t k,
+                                   ProximityResult* results) {
+    if (!entries || !hasOrigin || count == 0 || k == 0) {
+        return 0;
+    }
+
+    float x, y;
+    project(latitude, longitude, x, y);
+    int16_t centreX = toCell(x);
+    int16_t centreY = toCell(y);
+
+    // Rings of cells outwards; after ring r everything unseen is at least
+    // r cells away. Past a few cells per collar a full scan is cheaper.
+    size_t found = 0;
+    for (int32_t ring = 0; (uint32_t)(2 * ring + 1) * (2 * ring + 1) <= 4u * count + 9; ring++) {
+        for (int32_t dy = -ring; dy <= ring; dy++) {
+            bool edge = dy == -ring || dy == ring;
+            for (int32_t dx = -ring; dx <= ring; dx += edge ? 1 : 2 * ring) {
+                found = visitCell(centreX + dx, centreY + dy, x, y, INFINITY, results, found, k);
+                if (ring == 0) {
+                    break;
+                }
+            }
+        }
+        if (found == k && results[k - 1].distanceM <= ring * cellSize) {
+            return found;
+        }
+    }
+    return scanAll(x, y, INFINITY, results, k);
+}
+
+size_t ProximityIndex::findPairs(float distanceM, ProximityPair* pairs, size_t maxPairs) {
+    if (!entries) {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < capacity; i++) {
+        entries[i].previousNeighbours = entries[i].neighbours;
+        entries[i].neighbours = 0;
+    }
+
+    // Each collar against its own and neighbouring cells; a pair is
+    // counted from its lower index only
+    int16_t span = (int16_t)ceilf(distanceM / cellSize);
+    size_t found = 0;
+    for (uint16_t i = 0; i < capacity; i++) {
+        const Node& a = nodes[i];
+        if (!a.used) {
+            continue;
+        }
+        for (int16_t cellY = a.cellY - span; cellY <= a.cellY + span; cellY++) {
+            for (int16_t cellX = a.cellX - span; cellX <= a.cellX + span; cellX++) {
+                for (uint16_t j = cellBuckets[cellBucket(cellX, cellY)]; j != PROXIMITY_NONE;
+                     j = nodes[j].cellNext) {
+                    const Node& b = nodes[j];
+                    if (j <= i || b.cellX != cellX || b.cellY != cellY) {
+                        continue;
+                    }
+                    float distance = sqrtf((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y));
+                    if (distance > distanceM) {
+                        continue;
+                    }
+                    if (pairs && found < maxPairs) {
+                        pairs[found].a = i;
+                        pairs[found].b = j;
+                        pairs[found].distanceM = distance;
+                    }
+                    entries[i].neighbours++;
+                    entries[j].neighbours++;
+                    found++;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+size_t ProximityIndex::findPairsBruteForce(float distanceM) {
+    if (!entries) {
+        return 0;
+    }
+
+    size_t found = 0;
+    for (uint16_t i = 0; i < capacity; i++) {
+        if (!nodes[i].used) {
+            continue;
+        }
+        for (uint16_t j = i + 1; j < capacity; j++) {
+            if (!nodes[j].used) {
+                continue;
+            }
+            float dx = nodes[i].x - nodes[j].x;
+            float dy = nodes[i].y - nodes[j].y;
+            if (sqrtf(dx * dx + dy * dy) <= distanceM) {
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+const ProximityEntry* ProximityIndex::getEntry(uint16_t index) {
+    return index < capacity && nodes[index].used ? &entries[index] : nullptr;
+}
+
+uint16_t ProximityIndex::getCount() {
+    return count;
+}
+
+uint16_t ProximityIndex::getCapacity() {
+    return capacity;
+}
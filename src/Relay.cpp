@@ -0,0 +1,263 @@
+/**
+ * @file Relay.cpp
+ * @brief Multi-hop uplink forwarding implementation
+ */
+
+#include "Relay.h"
+#include "Downlink.h"
+
+Relay::Relay(const char* deviceId, bool dongle)
+    : ownId(Downlink::hashDeviceId(deviceId)), dongle(dongle), enabled(false),
+      slotMs(RELAY_SLOT_MS), floorDbm(RELAY_RSSI_FLOOR_DBM), level(dongle ? 0 : RELAY_LEVEL_UNKNOWN), levelMs(0),
+      seenCount(0), seenNext(0) {
+    // A collar restarting at sequence 0 would be taken for its own old
+    // frames by caches that still remember them
+    sequence = random(0x10000);
+    memset(pending, 0, sizeof(pending));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool Relay::isFrame(const uint8_t* data, size_t length) {
+    return length >= sizeof(RelayHeader) && data[0] == RELAY_MAGIC;
+}
+
+void Relay::setEnabled(bool on) {
+    enabled = on;
+    if (!enabled) {
+        memset(pending, 0, sizeof(pending));
+    }
+}
+
+bool Relay::isEnabled() {
+    return enabled;
+}
+
+void Relay::setPHY(uint8_t spreadingFactor, long bandwidth) {
+    // Time on air doubles with every SF step and halves with every
+    // doubling of bandwidth; sensitivity gains about 2.5 dB per SF step and
+    // loses 3 dB per doubling of bandwidth
+    uint8_t steps = spreadingFactor > 7 ? spreadingFactor - 7 : 0;
+    bandwidth = max(bandwidth, 1L);
+    slotMs = (uint32_t)((uint64_t)RELAY_SLOT_MS * (1UL << steps) * 125000L / bandwidth);
+    slotMs = max(slotMs, (uint32_t)1);
+    floorDbm = RELAY_RSSI_FLOOR_DBM - (int)(2.5f * steps) +
+               (int)lroundf(10.0f * log10f(bandwidth / 125000.0f));
+}
+
+uint8_t Relay::getLevel() {
+    return level;
+}
+
+size_t Relay::beacon(uint8_t* frame) {
+    RelayHeader header;
+    header.magic = RELAY_MAGIC;
+    header.type = RELAY_TYPE_BEACON;
+    // Collars at the last level forward uplinks but not beacons
+    header.ttl = RELAY_MAX_HOPS - 1;
+    header.hops = 0;
+    header.level = 0;
+    header.origin = ownId;
+    header.sequence = sequence++;
+
+    memcpy(frame, &header, sizeof(header));
+    return sizeof(header);
+}
+
+size_t Relay::wrap(const uint8_t* payload, size_t length, uint8_t* frame, size_t maxLength) {
+    size_t frameLength = sizeof(RelayHeader) + length;
+    if (frameLength > maxLength || frameLength > RELAY_MAX_FRAME) {
+        return 0;
+    }
+
+    RelayHeader header;
+    header.magic = RELAY_MAGIC;
+    header.type = RELAY_TYPE_UPLINK;
+    header.ttl = RELAY_MAX_HOPS;
+    header.hops = 0;
+    header.level = level;
+    header.origin = ownId;
+    header.sequence = sequence++;
+
+    // Our own frame coming back from a relay is a duplicate
+    remember(header.origin, header.sequence);
+
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), payload, length);
+    return frameLength;
+}
+
+bool Relay::receive(const uint8_t* frame, size_t length, int rssi, uint32_t nowMs,
+                    RelayHeader& header) {
+    if (!isFrame(frame, length) || length > RELAY_MAX_FRAME) {
+        return false;
+    }
+    memcpy(&header, frame, sizeof(header));
+    stats.received++;
+
+    // A level reached over a marginal link is one we could not serve; a
+    // stronger copy of the same beacon may still follow
+    if (header.type == RELAY_TYPE_BEACON && rssi < floorDbm + RELAY_LINK_MARGIN_DB) {
+        stats.weakBeacons++;
+        return false;
+    }
+
+    if (wasSeen(header.origin, header.sequence)) {
+        stats.duplicates++;
+
+        // A collar at least as close to the dongle already forwarded this
+        // frame: drop our copy
+        for (uint8_t i = 0; i < RELAY_QUEUE_SIZE && header.level <= level; i++) {
+            if (pending[i].length == 0) {
+                continue;
+            }
+            RelayHeader queued;
+            memcpy(&queued, pending[i].data, sizeof(queued));
+            if (queued.origin == header.origin && queued.sequence == header.sequence) {
+                pending[i].length = 0;
+                stats.suppressedHeard++;
+            }
+        }
+        return false;
+    }
+
+    // The dongle remembers an uplink only once it authenticates (accept()),
+    // so a forged copy cannot shadow the genuine frame
+    if (!dongle || header.type != RELAY_TYPE_UPLINK) {
+        remember(header.origin, header.sequence);
+    }
+
+    if (header.type == RELAY_TYPE_BEACON) {
+        if (dongle) {
+            return false;
+        }
+        // Keep the best level heard recently: fading makes us miss the
+        // direct copy of some beacons and hear only a relayed one
+        stats.beacons++;
+        uint8_t heard = header.hops + 1;
+        if (heard <= level || nowMs - levelMs > RELAY_LEVEL_TIMEOUT_MS) {
+            level = heard;
+            levelMs = nowMs;
+        }
+        if (enabled) {
+            queue(header, frame, sizeof(header), rssi, nowMs);
+        }
+        return false;
+    }
+    if (header.type != RELAY_TYPE_UPLINK) {
+        return false;
+    }
+    if (dongle) {
+        return true;
+    }
+
+    countFirst(header);
+    if (!enabled) {
+        return true;
+    }
+    // Only move frames towards the dongle
+    if (level >= header.level) {
+        stats.notCloser++;
+        return true;
+    }
+    queue(header, frame, length, rssi, nowMs);
+    return true;
+}
+
+void Relay::accept(const RelayHeader& header) {
+    remember(header.origin, header.sequence);
+    countFirst(header);
+}
+
+void Relay::countFirst(const RelayHeader& header) {
+    if (header.hops == 0) {
+        stats.firstDirect++;
+    } else {
+        stats.firstRelayed++;
+    }
+}
+
+size_t Relay::poll(uint32_t nowMs, uint8_t* frame, size_t maxLength) {
+    if (!dongle && level != RELAY_LEVEL_UNKNOWN && nowMs - levelMs > RELAY_LEVEL_TIMEOUT_MS) {
+        level = RELAY_LEVEL_UNKNOWN;
+    }
+
+    // Earliest due frame first
+    int next = -1;
+    for (uint8_t i = 0; i < RELAY_QUEUE_SIZE; i++) {
+        if (pending[i].length > 0 && (int32_t)(nowMs - pending[i].dueMs) >= 0 &&
+            (next < 0 || (int32_t)(pending[i].dueMs - pending[next].dueMs) < 0)) {
+            next = i;
+        }
+    }
+    if (next < 0 || pending[next].length > maxLength) {
+        return 0;
+    }
+
+    size_t length = pending[next].length;
+    memcpy(frame, pending[next].data, length);
+    pending[next].length = 0;
+
+    stats.forwarded++;
+    stats.forwardedBytes += length;
+    return length;
+}
+
+RelayStats Relay::getStats() {
+    return stats;
+}
+
+bool Relay::wasSeen(uint32_t origin, uint16_t seq) {
+    for (uint8_t i = 0; i < seenCount; i++) {
+        if (seen[i].origin == origin && seen[i].sequence == seq) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Relay::remember(uint32_t origin, uint16_t seq) {
+    seen[seenNext].origin = origin;
+    seen[seenNext].sequence = seq;
+    seenNext = (seenNext + 1) % RELAY_CACHE_SIZE;
+    if (seenCount < RELAY_CACHE_SIZE) {
+        seenCount++;
+    }
+}
+
+void Relay::queue(const RelayHeader& header, const uint8_t* frame, size_t length, int rssi,
+                  uint32_t nowMs) {
+    if (header.ttl == 0) {
+        stats.hopLimit++;
+        return;
+    }
+    if (rssi >= RELAY_RSSI_SUPPRESS_DBM) {
+        stats.suppressedRssi++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < RELAY_QUEUE_SIZE; i++) {
+        if (pending[i].length == 0) {
+            RelayHeader forward = header;
+            forward.ttl--;
+            forward.hops++;
+            forward.level = level;
+
+            memcpy(pending[i].data, &forward, sizeof(forward));
+            memcpy(pending[i].data + sizeof(forward), frame + sizeof(forward),
+                   length - sizeof(forward));
+            pending[i].length = length;
+            pending[i].dueMs = nowMs + rebroadcastDelay(rssi);
+            return;
+        }
+    }
+
+    stats.queueFull++;
+}
+
+uint32_t Relay::rebroadcastDelay(int rssi) {
+    // 0 at the sensitivity floor, 1 at the suppression threshold
+    float strength = constrain((float)(rssi - floorDbm) / (RELAY_RSSI_SUPPRESS_DBM - floorDbm),
+                               0.0f, 1.0f);
+    return slotMs * RELAY_DELAY_MIN_SLOTS +
+           (uint32_t)(strength * RELAY_DELAY_SPREAD_SLOTS * slotMs) + random(slotMs);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Periodic task scheduler implementation
+ */
+
+#include "Scheduler.h"
+
+Scheduler::Scheduler() {
+    memset(intervals, 0, sizeof(intervals));
+    memset(lastRun, 0, sizeof(lastRun));
+}
+
+void Scheduler::setInterval(uint8_t task, uint32_t intervalMs) {
+    if (task < SCHEDULER_MAX_TASKS) {
+        intervals[task] = intervalMs;
+    }
+}
+
+uint32_t Scheduler::getInterval(uint8_t task) {
+    return task < SCHEDULER_MAX_TASKS ? intervals[task] : 0;
+}
+
+bool Scheduler::isDue(uint8_t task) {
+    if (task >= SCHEDULER_MAX_TASKS) {
+        return false;
+    }
+
+    uint32_t now = millis();
+    if (now - lastRun[task] >= intervals[task]) {
+        lastRun[task] = now;
+        return true;
+    }
+
+    return false;
+}
+
+void Scheduler::trigger(uint8_t task) {
+    if (task < SCHEDULER_MAX_TASKS) {
+        lastRun[task] = millis() - intervals[task];
+    }
+}
+
+void Scheduler::setNextDue(uint8_t task, uint32_t delayMs) {
+    if (task < SCHEDULER_MAX_TASKS) {
+        lastRun[task] = millis() - intervals[task] + delayMs;
+    }
+}
+
+uint32_t Scheduler::getTimeUntilDue(uint8_t task) {
+    if (task >= SCHEDULER_MAX_TASKS) {
+        return 0;
+    }
+
+    uint32_t elapsed = millis() - lastRun[task];
+    return elapsed >= intervals[task] ? 0 : intervals[task] - elapsed;
+}
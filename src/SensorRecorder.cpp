@@ -0,0 +1,260 @@
+/**
+ * @file SensorRecorder.cpp
+ * @brief Sensor stream recorder implementation
+ */
+
+#include "SensorRecorder.h"
+
+#ifndef BRAVO_NATIVE
+#include <LittleFS.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Sinks and sources
+// ---------------------------------------------------------------------------
+
+SerialRecordSink::SerialRecordSink(Print& out) : out(out) {
+}
+
+size_t SerialRecordSink::write(const uint8_t* data, size_t length) {
+    static const char hex[] = "0123456789abcdef";
+    char line[2 * 64 + 1];
+
+    // Short lines survive serial monitors and interleaved log output
+    for (size_t offset = 0; offset < length; offset += 64) {
+        size_t count = min(length - offset, (size_t)64);
+        for (size_t i = 0; i < count; i++) {
+            line[2 * i] = hex[data[offset + i] >> 4];
+            line[2 * i + 1] = hex[data[offset + i] & 0x0F];
+        }
+        line[2 * count] = '\0';
+        out.print(RECORDER_SERIAL_PREFIX);
+        out.println(line);
+    }
+
+    return length;
+}
+
+#ifdef BRAVO_NATIVE
+RecordFile::RecordFile() : file(nullptr) {
+}
+
+RecordFile::~RecordFile() {
+    close();
+}
+
+bool RecordFile::open(const char* path, bool writing) {
+    close();
+    file = fopen(path, writing ? "wb" : "rb");
+    return file != nullptr;
+}
+
+void RecordFile::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+size_t RecordFile::size() {
+    if (!file) {
+        return 0;
+    }
+    long position = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    fseek(file, position, SEEK_SET);
+    return end;
+}
+
+size_t RecordFile::write(const uint8_t* data, size_t length) {
+    return file ? fwrite(data, 1, length, file) : 0;
+}
+
+void RecordFile::flush() {
+    if (file) {
+        fflush(file);
+    }
+}
+
+size_t RecordFile::read(uint8_t* data, size_t length) {
+    return file ? fread(data, 1, length, file) : 0;
+}
+#else
+RecordFile::RecordFile() {
+}
+
+RecordFile::~RecordFile() {
+    close();
+}
+
+bool RecordFile::open(const char* path, bool writing) {
+    close();
+
+    // Format on first use: the partition is only used for recordings
+    static bool mounted = false;
+    if (!mounted) {
+        mounted = LittleFS.begin(true);
+        if (!mounted) {
+            Serial.println("LittleFS mount failed");
+            return false;
+        }
+    }
+
+    file = LittleFS.open(path, writing ? FILE_WRITE : FILE_READ);
+    return (bool)file;
+}
+
+void RecordFile::close() {
+    if (file) {
+        file.close();
+    }
+}
+
+size_t RecordFile::size() {
+    return file ? file.size() : 0;
+}
+
+size_t RecordFile::write(const uint8_t* data, size_t length) {
+    return file ? file.write(data, length) : 0;
+}
+
+void RecordFile::flush() {
+    if (file) {
+        file.flush();
+    }
+}
+
+size_t RecordFile::read(uint8_t* data, size_t length) {
+    return file ? file.read(data, length) : 0;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Recorder
+// ---------------------------------------------------------------------------
+
+SensorRecorder::SensorRecorder() : sink(nullptr), chunkLength(0), chunkStartUs(0),
+                                   bufferLength(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SensorRecorder::begin(RecordSink& recordSink) {
+    end();
+
+    sink = &recordSink;
+    chunkLength = 0;
+    bufferLength = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    RecordingHeader header;
+    header.magic = RECORDING_MAGIC;
+    header.version = RECORDING_VERSION;
+    header.imuReadingSize = sizeof(IMUReading);
+    header.reserved = 0;
+
+    if (sink->write((const uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        sink = nullptr;
+        return false;
+    }
+
+    stats.active = true;
+    stats.bytes = sizeof(header);
+    return true;
+}
+
+void SensorRecorder::end() {
+    if (!sink) {
+        return;
+    }
+
+    endUartBurst();
+    flush();
+    sink->flush();
+    sink = nullptr;
+    stats.active = false;
+}
+
+bool SensorRecorder::isRecording() {
+    return sink != nullptr;
+}
+
+void SensorRecorder::writeToSink(const uint8_t* data, size_t length) {
+    size_t written = sink->write(data, length);
+    stats.bytes += written;
+    stats.dropped += length - written;
+}
+
+void SensorRecorder::append(uint8_t type, uint32_t timestampUs, const void* payload,
+                            uint8_t length) {
+    if (!sink) {
+        return;
+    }
+
+    size_t recordLength = sizeof(RecordHeader) + length;
+    if (bufferLength + recordLength > sizeof(buffer)) {
+        flush();
+    }
+
+    RecordHeader header;
+    header.timestampUs = timestampUs;
+    header.type = type;
+    header.length = length;
+    memcpy(&buffer[bufferLength], &header, sizeof(header));
+    if (length > 0) {
+        memcpy(&buffer[bufferLength + sizeof(header)], payload, length);
+    }
+    bufferLength += recordLength;
+    stats.records++;
+}
+
+void SensorRecorder::recordUartByte(uint8_t value) {
+    if (!sink) {
+        return;
+    }
+
+    if (chunkLength == 0) {
+        chunkStartUs = micros();
+    }
+
+    chunk[chunkLength++] = value;
+    if (chunkLength == sizeof(chunk)) {
+        endUartBurst();
+    }
+}
+
+void SensorRecorder::endUartBurst() {
+    if (chunkLength == 0) {
+        return;
+    }
+
+    append(RECORD_NMEA, chunkStartUs, chunk, chunkLength);
+    chunkLength = 0;
+}
+
+void SensorRecorder::recordImu(const IMUReading& reading) {
+    append(RECORD_IMU, micros(), &reading, sizeof(reading));
+}
+
+void SensorRecorder::recordImuFailure() {
+    append(RECORD_IMU_FAIL, micros(), nullptr, 0);
+}
+
+void SensorRecorder::recordActivity(uint8_t activity, bool inMotion, float motionThreshold) {
+    ActivityRecord record;
+    record.activity = activity;
+    record.inMotion = inMotion ? 1 : 0;
+    record.motionThreshold = motionThreshold;
+    append(RECORD_ACTIVITY, micros(), &record, sizeof(record));
+}
+
+void SensorRecorder::flush() {
+    if (sink && bufferLength > 0) {
+        writeToSink(buffer, bufferLength);
+        bufferLength = 0;
+    }
+}
+
+RecorderStats SensorRecorder::getStats() {
+    return stats;
+}
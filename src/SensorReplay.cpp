@@ -0,0 +1,155 @@
+/**
+ * @file SensorReplay.cpp
+ * @brief Sensor stream replay implementation
+ */
+
+#include "SensorReplay.h"
+
+SensorReplay::SensorReplay(RecordSource& source, ReplayUart& uart, ReplayImu& sensor,
+                           GPS& gps, IMU& imu, ClockHAL& clock)
+    : source(source), uart(uart), sensor(sensor), gps(gps), imu(imu), clock(clock),
+      speed(REPLAY_FAST), started(false), lastTimestampUs(0), recordUs(0), lastClockUs(0),
+      clockElapsedUs(0) {
+    memset(&lastDecision, 0, sizeof(lastDecision));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SensorReplay::begin(ReplaySpeed replaySpeed) {
+    RecordingHeader header;
+    if (source.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        Serial.println("Replay: recording is empty");
+        return false;
+    }
+
+    if (header.magic != RECORDING_MAGIC || header.version != RECORDING_VERSION) {
+        Serial.println("Replay: not a sensor recording");
+        return false;
+    }
+
+    // Readings are stored as raw structs; a different layout cannot be replayed
+    if (header.imuReadingSize != sizeof(IMUReading)) {
+        Serial.println("Replay: IMU reading layout differs from recorder");
+        return false;
+    }
+
+    speed = replaySpeed;
+    started = false;
+    recordUs = 0;
+    memset(&lastDecision, 0, sizeof(lastDecision));
+    memset(&stats, 0, sizeof(stats));
+    return true;
+}
+
+void SensorReplay::waitUntil(uint64_t elapsedUs) {
+    while (true) {
+        uint32_t now = clock.micros();
+        clockElapsedUs += (uint32_t)(now - lastClockUs);
+        lastClockUs = now;
+        if (clockElapsedUs >= elapsedUs) {
+            return;
+        }
+        // Millisecond resolution is plenty for 1 Hz fixes and 10 Hz samples
+        clock.delay((elapsedUs - clockElapsedUs + 999) / 1000);
+    }
+}
+
+uint8_t SensorReplay::step() {
+    RecordHeader header;
+    if (source.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        return 0;
+    }
+    if (header.length > 0 && source.read(payload, header.length) != header.length) {
+        return 0;
+    }
+
+    // Unwrap the 32-bit timestamps into time since the first record
+    if (!started) {
+        started = true;
+        lastTimestampUs = header.timestampUs;
+        lastClockUs = clock.micros();
+        clockElapsedUs = 0;
+    }
+    recordUs += (uint32_t)(header.timestampUs - lastTimestampUs);
+    lastTimestampUs = header.timestampUs;
+    stats.durationUs = recordUs;
+    stats.records++;
+
+    if (speed == REPLAY_REALTIME) {
+        waitUntil(recordUs);
+    }
+
+    switch (header.type) {
+        case RECORD_NMEA:
+            uart.feed(payload, header.length);
+            gps.update();
+            stats.nmeaBytes += header.length;
+            break;
+
+        case RECORD_IMU: {
+            if (header.length != sizeof(IMUReading)) {
+                stats.skipped++;
+                break;
+            }
+            IMUReading reading;
+            memcpy(&reading, payload, sizeof(reading));
+            sensor.setReading(reading, true);
+            imu.readSensor();
+            stats.imuSamples++;
+            break;
+        }
+
+        case RECORD_IMU_FAIL: {
+            IMUReading none;
+            memset(&none, 0, sizeof(none));
+            sensor.setReading(none, false);
+            imu.readSensor();
+            stats.imuFailures++;
+            break;
+        }
+
+        case RECORD_ACTIVITY: {
+            if (header.length != sizeof(ActivityRecord)) {
+                stats.skipped++;
+                break;
+            }
+            ActivityRecord record;
+            memcpy(&record, payload, sizeof(record));
+
+            lastDecision.timestampUs = recordUs;
+            lastDecision.recordedActivity = record.activity;
+            lastDecision.recordedInMotion = record.inMotion != 0;
+            lastDecision.replayedActivity = imu.getActivityLevel();
+            lastDecision.replayedInMotion = imu.isInMotion(record.motionThreshold);
+            stats.decisions++;
+
+            if (lastDecision.replayedActivity != lastDecision.recordedActivity ||
+                lastDecision.replayedInMotion != lastDecision.recordedInMotion) {
+                if (stats.mismatches == 0) {
+                    stats.firstMismatchUs = recordUs;
+                }
+                stats.mismatches++;
+            }
+            break;
+        }
+
+        default:
+            stats.skipped++;
+            break;
+    }
+
+    return header.type;
+}
+
+bool SensorReplay::run() {
+    while (step() != 0) {
+    }
+    return stats.mismatches == 0;
+}
+
+ReplayDecision SensorReplay::getLastDecision() {
+    return lastDecision;
+}
+
+ReplayStats SensorReplay::getStats() {
+    return stats;
+}
@@ -5,27 +5,27 @@
 
 #include "Telemetry.h"
 
-Telemetry::Telemetry() : lastType(TELEMETRY_FULL) {
+Telemetry::Telemetry() : lastType(TELEMETRY_FULL), timeService(nullptr) {
+    lastDeviceId[0] = '\0';
+}
+
+void Telemetry::setTimeService(TimeService* timeService) {
+    this->timeService = timeService;
 }
 
 void Telemetry::addTimestamp() {
-    doc["timestamp"] = millis();
+    if (timeService && timeService->isSynced()) {
+        doc["ts"] = timeService->getHourMs();
+    } else {
+        doc["timestamp"] = millis();
+    }
 }
 
 void Telemetry::addDeviceInfo(const char* deviceId) {
     doc["device_id"] = deviceId;
 }
 
-String Telemetry::createFullTelemetry(const GPSData& gpsData, const IMUData& imuData, 
-                                      const char* deviceId, uint8_t battery) {
-    doc.clear();
-    
-    addDeviceInfo(deviceId);
-    addTimestamp();
-    doc["type"] = "full";
-    doc["battery"] = battery;
-
-    // GPS data
+void Telemetry::addPosition(const GPSData& gpsData, const DeadReckoningEstimate* estimate) {
     JsonObject gps = doc.createNestedObject("gps");
     gps["valid"] = gpsData.valid;
     gps["lat"] = gpsData.latitude;
@@ -35,6 +35,28 @@ String Telemetry::createFullTelemetry(const GPSData& gpsData, const IMUData& imu
     gps["course"] = gpsData.course;
     gps["satellites"] = gpsData.satellites;
 
+    // Dead-reckoned position since the last fix, with its uncertainty
+    if (estimate && estimate->valid && estimate->steps > 0) {
+        JsonObject dr = doc.createNestedObject("dr");
+        dr["lat"] = estimate->latitude;
+        dr["lon"] = estimate->longitude;
+        dr["err_m"] = roundf(estimate->uncertaintyM * 10) / 10;
+        dr["steps"] = estimate->steps;
+    }
+}
+
+String Telemetry::createFullTelemetry(const GPSData& gpsData, const IMUData& imuData, 
+                                      const char* deviceId, uint8_t battery,
+                                      const DeadReckoningEstimate* estimate) {
+    doc.clear();
+    
+    addDeviceInfo(deviceId);
+    addTimestamp();
+    doc["type"] = "full";
+    doc["battery"] = battery;
+
+    addPosition(gpsData, estimate);
+
     // IMU data
     JsonObject imu = doc.createNestedObject("imu");
     JsonObject accel = imu.createNestedObject("accel");
@@ -54,6 +76,211 @@ String Telemetry::createFullTelemetry(const GPSData& gpsData, const IMUData& imu
     return output;
 }
 
+size_t Telemetry::createActivityTelemetry(const GPSData* gpsData,
+                                          const ActivitySummaryData& summary,
+                                          const char* deviceId, uint8_t battery,
+                                          const DeadReckoningEstimate* estimate,
+                                          const LatencyReport* latency,
+                                          char* output, size_t maxLength) {
+    doc.clear();
+
+    addDeviceInfo(deviceId);
+    addTimestamp();
+    doc["type"] = "activity";
+    doc["battery"] = battery;
+
+    // Sample age, then queue and air time of the previous uplink
+    if (latency) {
+        JsonArray lat = doc.createNestedArray("lat");
+        lat.add(latency->sampleMs);
+        lat.add(latency->queueMs);
+        lat.add(latency->airMs);
+    }
+
+    // Heartbeats carry no position
+    if (gpsData) {
+        addPosition(*gpsData, estimate);
+    }
+
+    // Summary of the IMU stream since the previous report
+    JsonObject activity = doc.createNestedObject("activity");
+    activity["period_s"] = roundf(summary.durationMs / 100.0f) / 10;
+    activity["mean"] = summary.meanActivity;
+
+    // Histogram as the percentage of samples per bin, independent of the
+    // interval length and sample rate
+    JsonArray histogram = activity.createNestedArray("hist");
+    for (uint8_t i = 0; i < ACTIVITY_HISTOGRAM_BINS; i++) {
+        histogram.add(histogramPercent(summary, i));
+    }
+
+    activity["rest_s"] = roundf(summary.classMs[ACTIVITY_REST] / 100.0f) / 10;
+    activity["walk_s"] = roundf(summary.classMs[ACTIVITY_WALK] / 100.0f) / 10;
+    activity["run_s"] = roundf(summary.classMs[ACTIVITY_RUN] / 100.0f) / 10;
+    activity["peak"] = roundf(summary.peakAccel * 10) / 10;
+    activity["events"] = summary.motionEvents;
+    activity["steps"] = summary.steps;
+
+    return serialize(output, maxLength);
+}
+
+size_t Telemetry::serialize(char* output, size_t maxLength) {
+    // Measured first, so a packet is never sent cut short
+    size_t length = measureJson(doc);
+    if (length >= maxLength) {
+        if (maxLength > 0) {
+            output[0] = '\0';
+        }
+        return 0;
+    }
+    return serializeJson(doc, output, maxLength);
+}
+
+uint8_t Telemetry::histogramPercent(const ActivitySummaryData& summary, uint8_t bin) {
+    if (summary.samples == 0) {
+        return 0;
+    }
+    return (uint8_t)(((uint64_t)summary.histogram[bin] * 100 + summary.samples / 2) / summary.samples);
+}
+
+size_t Telemetry::encodeActivityUplink(const GPSData* gpsData,
+                                       const ActivitySummaryData& summary,
+                                       const char* deviceId, uint8_t battery,
+                                       const DeadReckoningEstimate* estimate,
+                                       const LatencyReport* latency,
+                                       uint8_t* record, size_t maxLength) {
+    size_t nameLength = strnlen(deviceId, sizeof(lastDeviceId) - 1);
+    size_t length = sizeof(ActivityUplink) + nameLength;
+    if (length > maxLength) {
+        return 0;
+    }
+
+    ActivityUplink r;
+    memset(&r, 0, sizeof(r));
+    r.magic = ACTIVITY_UPLINK_MAGIC;
+    r.battery = battery;
+
+    if (timeService && timeService->isSynced()) {
+        r.flags |= ACTIVITY_UPLINK_ABS_TIME;
+        r.time = timeService->getHourMs();
+    } else {
+        r.time = millis();
+    }
+
+    if (latency) {
+        r.flags |= ACTIVITY_UPLINK_LATENCY;
+        r.sampleMs = min(latency->sampleMs, (uint32_t)LATENCY_MAX_MS);
+        r.queueMs = (uint16_t)min(latency->queueMs, (uint32_t)UINT16_MAX);
+        r.airMs = (uint16_t)min(latency->airMs, (uint32_t)UINT16_MAX);
+    }
+
+    if (gpsData && gpsData->valid) {
+        r.flags |= ACTIVITY_UPLINK_FIX;
+        r.latitude = (int32_t)lround(gpsData->latitude * 1e7);
+        r.longitude = (int32_t)lround(gpsData->longitude * 1e7);
+        r.altitudeM = (int16_t)constrain(lround(gpsData->altitude), (long)INT16_MIN, (long)INT16_MAX);
+        r.speed = (uint16_t)constrain(lroundf(gpsData->speed * 10), 0L, (long)UINT16_MAX);
+        r.course = (uint16_t)constrain(lroundf(gpsData->course * 100), 0L, 35999L);
+        r.satellites = gpsData->satellites;
+
+        // Same rule as addPosition(): only once it has moved on from the fix
+        if (estimate && estimate->valid && estimate->steps > 0) {
+            r.flags |= ACTIVITY_UPLINK_DR;
+            r.drLatitude = (int32_t)lround(estimate->latitude * 1e7);
+            r.drLongitude = (int32_t)lround(estimate->longitude * 1e7);
+            r.drErrorDm = (uint16_t)constrain(lroundf(estimate->uncertaintyM * 10), 0L, (long)UINT16_MAX);
+            r.drSteps = estimate->steps;
+        }
+    }
+
+    // Rounded in 64 bits, as adding half a unit would wrap near UINT32_MAX
+    r.periodDs = (uint32_t)(((uint64_t)summary.durationMs + 50) / 100);
+    for (uint8_t i = 0; i < ACTIVITY_CLASS_COUNT; i++) {
+        r.classDs[i] = (uint32_t)(((uint64_t)summary.classMs[i] + 50) / 100);
+    }
+    r.mean = summary.meanActivity;
+    for (uint8_t i = 0; i < ACTIVITY_HISTOGRAM_BINS; i++) {
+        r.histogram[i] = histogramPercent(summary, i);
+    }
+    r.peak = (uint16_t)constrain(lroundf(summary.peakAccel * 10), 0L, (long)UINT16_MAX);
+    r.motionEvents = summary.motionEvents;
+    r.steps = summary.steps;
+    r.nameLength = (uint8_t)nameLength;
+
+    memcpy(record, &r, sizeof(r));
+    memcpy(record + sizeof(r), deviceId, nameLength);
+    return length;
+}
+
+bool Telemetry::isActivityUplink(const uint8_t* data, size_t length) {
+    return length >= sizeof(ActivityUplink) && data[0] == ACTIVITY_UPLINK_MAGIC;
+}
+
+bool Telemetry::parseActivityUplink(const uint8_t* data, size_t length) {
+    if (!isActivityUplink(data, length)) {
+        return false;
+    }
+
+    ActivityUplink r;
+    memcpy(&r, data, sizeof(r));
+    if (r.nameLength >= sizeof(lastDeviceId) || sizeof(r) + r.nameLength != length) {
+        return false;
+    }
+
+    memcpy(lastDeviceId, data + sizeof(r), r.nameLength);
+    lastDeviceId[r.nameLength] = '\0';
+    lastType = TELEMETRY_ACTIVITY;
+
+    // Rebuild the JSON packet's fields so the getters work on either form
+    doc.clear();
+    doc["device_id"] = (const char*)lastDeviceId;
+    doc[(r.flags & ACTIVITY_UPLINK_ABS_TIME) ? "ts" : "timestamp"] = r.time;
+    doc["type"] = "activity";
+    doc["battery"] = r.battery;
+
+    if (r.flags & ACTIVITY_UPLINK_LATENCY) {
+        JsonArray lat = doc.createNestedArray("lat");
+        lat.add(r.sampleMs);
+        lat.add(r.queueMs);
+        lat.add(r.airMs);
+    }
+
+    if (r.flags & ACTIVITY_UPLINK_FIX) {
+        JsonObject gps = doc.createNestedObject("gps");
+        gps["valid"] = true;
+        gps["lat"] = r.latitude / 1e7;
+        gps["lon"] = r.longitude / 1e7;
+        gps["alt"] = r.altitudeM;
+        gps["speed"] = r.speed / 10.0f;
+        gps["course"] = r.course / 100.0f;
+        gps["satellites"] = r.satellites;
+    }
+
+    if (r.flags & ACTIVITY_UPLINK_DR) {
+        JsonObject dr = doc.createNestedObject("dr");
+        dr["lat"] = r.drLatitude / 1e7;
+        dr["lon"] = r.drLongitude / 1e7;
+        dr["err_m"] = r.drErrorDm / 10.0f;
+        dr["steps"] = r.drSteps;
+    }
+
+    JsonObject activity = doc.createNestedObject("activity");
+    activity["period_s"] = r.periodDs / 10.0f;
+    activity["mean"] = r.mean;
+    JsonArray histogram = activity.createNestedArray("hist");
+    for (uint8_t i = 0; i < ACTIVITY_HISTOGRAM_BINS; i++) {
+        histogram.add(r.histogram[i]);
+    }
+    activity["rest_s"] = r.classDs[ACTIVITY_REST] / 10.0f;
+    activity["walk_s"] = r.classDs[ACTIVITY_WALK] / 10.0f;
+    activity["run_s"] = r.classDs[ACTIVITY_RUN] / 10.0f;
+    activity["peak"] = r.peak / 10.0f;
+    activity["events"] = r.motionEvents;
+    activity["steps"] = r.steps;
+
+    return true;
+}
+
 String Telemetry::createGPSTelemetry(const GPSData& gpsData, const char* deviceId) {
     doc.clear();
     
@@ -98,8 +325,13 @@ String Telemetry::createIMUTelemetry(const IMUData& imuData, const char* deviceI
     return output;
 }
 
-String Telemetry::createStatusTelemetry(const char* deviceId, uint8_t battery, 
-                                        uint32_t uptime, int rssi) {
+size_t Telemetry::createStatusTelemetry(const char* deviceId, uint8_t battery, 
+                                        uint32_t uptime, int rssi,
+                                        Profiler* profiler,
+                                        const BatteryStatus* batteryStatus,
+                                        const TrackStats* trackStats,
+                                        const MemoryStats* memoryStats,
+                                        char* output, size_t maxLength) {
     doc.clear();
     
     addDeviceInfo(deviceId);
@@ -109,13 +341,76 @@ String Telemetry::createStatusTelemetry(const char* deviceId, uint8_t battery,
     doc["uptime"] = uptime;
     doc["rssi"] = rssi;
 
-    String output;
-    serializeJson(doc, output);
-    return output;
+    if (batteryStatus && batteryStatus->present) {
+        JsonObject power = doc.createNestedObject("power");
+        power["mv"] = batteryStatus->millivolts;
+        power["tier"] = BatteryMonitor::tierName(batteryStatus->tier);
+        power["runtime_h"] = roundf(batteryStatus->runtimeHours * 10) / 10;
+    }
+
+    if (trackStats) {
+        JsonObject track = doc.createNestedObject("track");
+        track["fixes"] = trackStats->received;
+        track["kept"] = trackStats->kept;
+        track["max_err_m"] = roundf(trackStats->maxErrorM * 10) / 10;
+        if (trackStats->unsent > 0) {
+            track["unsent"] = trackStats->unsent;
+        }
+    }
+
+    if (profiler) {
+        // Handler timing: [count, avg us, p95 us, max us]
+        JsonObject timing = doc.createNestedObject("timing");
+        for (uint8_t i = 0; i < PROF_SECTION_COUNT; i++) {
+            ProfileSection section = (ProfileSection)i;
+            const ProfileHistogram& h = profiler->getHistogram(section);
+            JsonArray entry = timing.createNestedArray(Profiler::sectionName(section));
+            entry.add(h.count);
+            entry.add(h.count ? (uint32_t)(h.totalUs / h.count) : 0);
+            entry.add(profiler->getPercentileUs(section, 95));
+            entry.add(h.maxUs);
+        }
+
+        // Energy per consumer: [on-time ms, mAh]
+        EnergySummary summary = profiler->getEnergy();
+        JsonObject energy = doc.createNestedObject("energy");
+        for (uint8_t i = 0; i < ENERGY_CONSUMER_COUNT; i++) {
+            JsonArray entry = energy.createNestedArray(Profiler::consumerName((EnergyConsumer)i));
+            entry.add(summary.onTimeMs[i]);
+            entry.add(summary.mAh[i]);
+        }
+        energy["total_mah"] = summary.totalMAh;
+        energy["avg_ma"] = summary.avgCurrentMa;
+    }
+
+    if (memoryStats) {
+        JsonObject mem = doc.createNestedObject("mem");
+        mem["free"] = memoryStats->freeHeap;
+        mem["largest"] = memoryStats->largestFreeBlock;
+        mem["min"] = memoryStats->minFreeHeap;
+        mem["frag"] = memoryStats->fragmentation;
+        mem["allocs"] = memoryStats->allocations;
+        mem["fails"] = memoryStats->failures;
+
+        // Allocations per subsystem: [count, bytes, net bytes held]
+        JsonObject subsystems = mem.createNestedObject("sub");
+        for (uint8_t i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+            const MemorySubsystemStats& s = memoryStats->subsystems[i];
+            if (s.allocations == 0) {
+                continue;
+            }
+            JsonArray entry = subsystems.createNestedArray(MemoryMonitor::subsystemName(i));
+            entry.add(s.allocations);
+            entry.add(s.bytes);
+            entry.add(s.netBytes);
+        }
+    }
+
+    return serialize(output, maxLength);
 }
 
-String Telemetry::createAlertTelemetry(const char* deviceId, const char* alertType, 
-                                       const char* message) {
+size_t Telemetry::createAlertTelemetry(const char* deviceId, const char* alertType, 
+                                       const char* message, char* output, size_t maxLength) {
     doc.clear();
     
     addDeviceInfo(deviceId);
@@ -124,23 +419,25 @@ String Telemetry::createAlertTelemetry(const char* deviceId, const char* alertTy
     doc["alert_type"] = alertType;
     doc["message"] = message;
 
-    String output;
-    serializeJson(doc, output);
-    return output;
+    return serialize(output, maxLength);
 }
 
-bool Telemetry::parseTelemetry(const String& json) {
+bool Telemetry::parseTelemetry(const char* json, size_t length) {
     doc.clear();
     
-    DeserializationError error = deserializeJson(doc, json);
+    DeserializationError error = deserializeJson(doc, json, length);
     if (error) {
         Serial.print("JSON parse error: ");
         Serial.println(error.c_str());
         return false;
     }
 
+    const char* deviceId = doc["device_id"] | "";
+    strncpy(lastDeviceId, deviceId, sizeof(lastDeviceId) - 1);
+    lastDeviceId[sizeof(lastDeviceId) - 1] = '\0';
+
     // Determine type
-    const char* type = doc["type"];
+    const char* type = doc["type"] | "";
     if (strcmp(type, "full") == 0) {
         lastType = TELEMETRY_FULL;
     } else if (strcmp(type, "gps") == 0) {
@@ -151,6 +448,8 @@ bool Telemetry::parseTelemetry(const String& json) {
         lastType = TELEMETRY_STATUS;
     } else if (strcmp(type, "alert") == 0) {
         lastType = TELEMETRY_ALERT;
+    } else if (strcmp(type, "activity") == 0) {
+        lastType = TELEMETRY_ACTIVITY;
     }
 
     return true;
@@ -159,3 +458,40 @@ bool Telemetry::parseTelemetry(const String& json) {
 TelemetryType Telemetry::getLastType() {
     return lastType;
 }
+
+const char* Telemetry::getLastDeviceId() {
+    return lastDeviceId;
+}
+
+bool Telemetry::getLastPosition(double& latitude, double& longitude) {
+    // The parsed document stays in doc until the next packet is built;
+    // GPS packets carry the fix at the top level, the others in "gps"
+    JsonObjectConst gps = lastType == TELEMETRY_GPS ? doc.as<JsonObjectConst>()
+                                                    : doc["gps"].as<JsonObjectConst>();
+    if (gps.isNull() || !(gps["valid"] | false)) {
+        return false;
+    }
+    latitude = gps["lat"] | 0.0;
+    longitude = gps["lon"] | 0.0;
+    return true;
+}
+
+bool Telemetry::getLastTime(uint32_t& hourMs) {
+    JsonVariantConst ts = doc["ts"];
+    if (!ts.is<uint32_t>() || ts.as<uint32_t>() >= TIME_HOUR_MS) {
+        return false;
+    }
+    hourMs = ts.as<uint32_t>();
+    return true;
+}
+
+bool Telemetry::getLastLatency(LatencyReport& report) {
+    JsonArrayConst lat = doc["lat"];
+    if (lat.size() != 3) {
+        return false;
+    }
+    report.sampleMs = lat[0] | 0UL;
+    report.queueMs = lat[1] | 0UL;
+    report.airMs = lat[2] | 0UL;
+    return true;
+}
@@ -0,0 +1,483 @@
+/**
+ * @file TimeSeriesStore.cpp
+ * @brief Compressed per-collar position history implementation
+ */
+
+#include "TimeSeriesStore.h"
+#include <math.h>
+
+struct __attribute__((packed)) TimeSeriesBlockHeader {
+    uint64_t firstTime;     // TSDB_TIME_UNIT_MS units
+    int32_t latitude;
+    int32_t longitude;
+    uint8_t count;
+    uint16_t latitudeBit;   // Column start, in bits after the header
+    uint16_t longitudeBit;
+};
+
+#define TSDB_PAYLOAD_BITS   ((TSDB_BLOCK_SIZE - sizeof(TimeSeriesBlockHeader)) * 8)
+
+// ---------------------------------------------------------------------------
+// Variable-width integers
+//
+// Values are zigzag-mapped and written as a unary width class followed by
+// that many bits: 0 -> "0", then "10"+3, "110"+8, "1110"+14, "11110"+20,
+// "11111"+32. Steady report intervals give a zero delta-of-delta (1 bit); a
+// grazing animal's fix-to-fix movement lands in the 8 or 14 bit classes.
+// ---------------------------------------------------------------------------
+
+static const uint8_t CLASS_BITS[] = { 0, 3, 8, 14, 20, 32 };
+#define CLASS_COUNT (sizeof(CLASS_BITS) / sizeof(CLASS_BITS[0]))
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t valueClass(uint32_t value) {
+    uint8_t c = 0;
+    while (c < CLASS_COUNT - 1 && (value >> CLASS_BITS[c]) != 0) {
+        c++;
+    }
+    return c;
+}
+
+static uint8_t codeBits(int32_t value) {
+    uint8_t c = valueClass(zigzag(value));
+    // The last class needs no terminating zero
+    return (c < CLASS_COUNT - 1 ? c + 1 : c) + CLASS_BITS[c];
+}
+
+struct BitWriter {
+    uint8_t* data;
+    uint16_t bit;
+
+    void write(uint32_t value, uint8_t bits) {
+        for (int8_t i = bits - 1; i >= 0; i--) {
+            uint8_t mask = 0x80 >> (bit & 7);
+            if (value & ((uint32_t)1 << i)) {
+                data[bit >> 3] |= mask;
+            } else {
+                data[bit >> 3] &= ~mask;
+            }
+            bit++;
+        }
+    }
+
+    void writeCode(int32_t value) {
+        uint32_t z = zigzag(value);
+        uint8_t c = valueClass(z);
+        for (uint8_t i = 0; i < c; i++) {
+            write(1, 1);
+        }
+        if (c < CLASS_COUNT - 1) {
+            write(0, 1);
+        }
+        write(z, CLASS_BITS[c]);
+    }
+};
+
+struct BitReader {
+    const uint8_t* data;
+    uint16_t bit;
+
+    uint32_t read(uint8_t bits) {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bits; i++) {
+            value = (value << 1) | ((data[bit >> 3] >> (7 - (bit & 7))) & 1);
+            bit++;
+        }
+        return value;
+    }
+
+    int32_t readCode() {
+        uint8_t c = 0;
+        while (c < CLASS_COUNT - 1 && read(1)) {
+            c++;
+        }
+        return unzigzag(read(CLASS_BITS[c]));
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Store
+// ---------------------------------------------------------------------------
+
+TimeSeriesStore::TimeSeriesStore() : pool(nullptr), blockInfo(nullptr), heads(nullptr),
+                                     blockCount(0), freeList(TSDB_NO_BLOCK), blocksUsed(0),
+                                     seriesCount(0), evictedPoints(0), sealedPoints(0),
+                                     sealedBytes(0), queries(0), lastQueryUs(0),
+                                     maxQueryUs(0) {
+}
+
+bool TimeSeriesStore::begin() {
+    if (pool) {
+        return true;
+    }
+
+    // Block summaries, series heads and blocks in one allocation
+    uint16_t count = TSDB_BLOCK_COUNT;
+    size_t headBytes = sizeof(TimeSeriesPoint) * TSDB_HEAD_POINTS * TSDB_MAX_SERIES;
+    uint8_t* memory = nullptr;
+#ifndef BRAVO_NATIVE
+    if (psramFound()) {
+        count = TSDB_PSRAM_BLOCK_COUNT;
+        memory = (uint8_t*)ps_malloc((sizeof(BlockInfo) + TSDB_BLOCK_SIZE) * count + headBytes);
+    }
+#endif
+    if (!memory) {
+        count = TSDB_BLOCK_COUNT;
+        memory = (uint8_t*)malloc((sizeof(BlockInfo) + TSDB_BLOCK_SIZE) * count + headBytes);
+    }
+    if (!memory) {
+        return false;
+    }
+
+    blockInfo = (BlockInfo*)memory;
+    heads = (TimeSeriesPoint*)(memory + sizeof(BlockInfo) * count);
+    pool = memory + sizeof(BlockInfo) * count + headBytes;
+    blockCount = count;
+    clear();
+    return true;
+}
+
+void TimeSeriesStore::clear() {
+    seriesCount = 0;
+    blocksUsed = 0;
+    evictedPoints = 0;
+    sealedPoints = 0;
+    sealedBytes = 0;
+
+    freeList = blockCount > 0 ? 0 : TSDB_NO_BLOCK;
+    for (uint16_t i = 0; i < blockCount; i++) {
+        blockInfo[i].next = i + 1 < blockCount ? i + 1 : TSDB_NO_BLOCK;
+    }
+}
+
+int TimeSeriesStore::findSeries(uint32_t collarId) {
+    for (uint8_t i = 0; i < seriesCount; i++) {
+        if (series[i].collarId == collarId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool TimeSeriesStore::append(uint32_t collarId, const char* deviceId, uint64_t timeMs,
+                             double latitude, double longitude) {
+    if (!pool) {
+        return false;
+    }
+
+    int index = findSeries(collarId);
+    if (index < 0) {
+        if (seriesCount >= TSDB_MAX_SERIES) {
+            return false;
+        }
+        index = seriesCount++;
+        Series& s = series[index];
+        s.collarId = collarId;
+        strncpy(s.deviceId, deviceId, sizeof(s.deviceId) - 1);
+        s.deviceId[sizeof(s.deviceId) - 1] = '\0';
+        s.oldest = TSDB_NO_BLOCK;
+        s.newest = TSDB_NO_BLOCK;
+        s.blocks = 0;
+        s.blockPoints = 0;
+        s.headCount = 0;
+        s.head = heads + index * TSDB_HEAD_POINTS;
+    }
+
+    Series& s = series[index];
+    if (s.headCount >= TSDB_HEAD_POINTS) {
+        seal(index);
+    }
+
+    TimeSeriesPoint& point = s.head[s.headCount++];
+    point.timeMs = timeMs / TSDB_TIME_UNIT_MS * TSDB_TIME_UNIT_MS;
+    point.latitude = (int32_t)lround(latitude * 1e7);
+    point.longitude = (int32_t)lround(longitude * 1e7);
+    return true;
+}
+
+uint16_t TimeSeriesStore::allocateBlock() {
+    if (freeList == TSDB_NO_BLOCK) {
+        // Take from the collar with the longest history
+        uint8_t victim = 0;
+        for (uint8_t i = 1; i < seriesCount; i++) {
+            if (series[i].blocks > series[victim].blocks) {
+                victim = i;
+            }
+        }
+        if (seriesCount == 0 || series[victim].blocks == 0) {
+            return TSDB_NO_BLOCK;
+        }
+        evictOldest(victim);
+    }
+
+    uint16_t block = freeList;
+    freeList = blockInfo[block].next;
+    blocksUsed++;
+    return block;
+}
+
+void TimeSeriesStore::evictOldest(uint8_t index) {
+    Series& s = series[index];
+    uint16_t block = s.oldest;
+    BlockInfo& info = blockInfo[block];
+
+    s.oldest = info.next;
+    if (s.oldest == TSDB_NO_BLOCK) {
+        s.newest = TSDB_NO_BLOCK;
+    } else {
+        blockInfo[s.oldest].prev = TSDB_NO_BLOCK;
+    }
+    s.blocks--;
+    s.blockPoints -= info.count;
+
+    evictedPoints += info.count;
+    sealedPoints -= info.count;
+    sealedBytes -= info.encodedBytes;
+
+    info.next = freeList;
+    freeList = block;
+    blocksUsed--;
+}
+
+void TimeSeriesStore::seal(uint8_t index) {
+    Series& s = series[index];
+    const TimeSeriesPoint* points = s.head;
+    uint16_t block = allocateBlock();
+    if (block == TSDB_NO_BLOCK) {
+        // No pool: keep the newest raw points only
+        memmove(s.head, s.head + 1, sizeof(TimeSeriesPoint) * (s.headCount - 1));
+        s.headCount--;
+        evictedPoints++;
+        return;
+    }
+
+    // As many points as fit; the first one is in the header. A time jump
+    // too large to code (the switch from millis() to Unix time) ends the block.
+    uint32_t used = 0;
+    uint8_t count = 1;
+    int32_t previousDelta = 0;
+    for (; count < s.headCount; count++) {
+        const TimeSeriesPoint& a = points[count - 1];
+        const TimeSeriesPoint& b = points[count];
+        int64_t step = ((int64_t)b.timeMs - (int64_t)a.timeMs) / TSDB_TIME_UNIT_MS;
+        if (step > INT32_MAX / 2 || step < INT32_MIN / 2) {
+            break;
+        }
+        int32_t delta = (int32_t)step;
+        uint32_t cost = codeBits(delta - previousDelta) +
+                        codeBits(b.latitude - a.latitude) +
+                        codeBits(b.longitude - a.longitude);
+        if (used + cost > TSDB_PAYLOAD_BITS) {
+            break;
+        }
+        used += cost;
+        previousDelta = delta;
+    }
+
+    uint8_t* data = pool + (size_t)block * TSDB_BLOCK_SIZE;
+    TimeSeriesBlockHeader header;
+    header.firstTime = points[0].timeMs / TSDB_TIME_UNIT_MS;
+    header.latitude = points[0].latitude;
+    header.longitude = points[0].longitude;
+    header.count = count;
+
+    // Columns: time delta-of-delta, then latitude and longitude deltas
+    BitWriter writer = { data + sizeof(header), 0 };
+    previousDelta = 0;
+    for (uint8_t i = 1; i < count; i++) {
+        int32_t delta = (int32_t)(((int64_t)points[i].timeMs - (int64_t)points[i - 1].timeMs) /
+                                  TSDB_TIME_UNIT_MS);
+        writer.writeCode(delta - previousDelta);
+        previousDelta = delta;
+    }
+    header.latitudeBit = writer.bit;
+    for (uint8_t i = 1; i < count; i++) {
+        writer.writeCode(points[i].latitude - points[i - 1].latitude);
+    }
+    header.longitudeBit = writer.bit;
+    for (uint8_t i = 1; i < count; i++) {
+        writer.writeCode(points[i].longitude - points[i - 1].longitude);
+    }
+    memcpy(data, &header, sizeof(header));
+
+    BlockInfo& info = blockInfo[block];
+    info.firstTime = points[0].timeMs;
+    info.lastTime = points[count - 1].timeMs;
+    info.series = index;
+    info.count = count;
+    info.encodedBytes = sizeof(header) + (writer.bit + 7) / 8;
+    info.prev = s.newest;
+    info.next = TSDB_NO_BLOCK;
+    if (s.newest != TSDB_NO_BLOCK) {
+        blockInfo[s.newest].next = block;
+    } else {
+        s.oldest = block;
+    }
+    s.newest = block;
+    s.blocks++;
+    s.blockPoints += count;
+
+    sealedPoints += count;
+    sealedBytes += info.encodedBytes;
+
+    memmove(s.head, s.head + count, sizeof(TimeSeriesPoint) * (s.headCount - count));
+    s.headCount -= count;
+}
+
+uint8_t TimeSeriesStore::decodeBlock(uint16_t block, TimeSeriesPoint* points) {
+    const uint8_t* data = pool + (size_t)block * TSDB_BLOCK_SIZE;
+    TimeSeriesBlockHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    BitReader reader = { data + sizeof(header), 0 };
+    uint64_t time = header.firstTime;
+    int32_t delta = 0;
+    points[0].timeMs = time * TSDB_TIME_UNIT_MS;
+    for (uint8_t i = 1; i < header.count; i++) {
+        delta += reader.readCode();
+        time += delta;
+        points[i].timeMs = time * TSDB_TIME_UNIT_MS;
+    }
+
+    reader.bit = header.latitudeBit;
+    points[0].latitude = header.latitude;
+    for (uint8_t i = 1; i < header.count; i++) {
+        points[i].latitude = points[i - 1].latitude + reader.readCode();
+    }
+
+    reader.bit = header.longitudeBit;
+    points[0].longitude = header.longitude;
+    for (uint8_t i = 1; i < header.count; i++) {
+        points[i].longitude = points[i - 1].longitude + reader.readCode();
+    }
+    return header.count;
+}
+
+void TimeSeriesStore::finishQuery(uint32_t startUs) {
+    lastQueryUs = micros() - startUs;
+    maxQueryUs = max(maxQueryUs, lastQueryUs);
+    queries++;
+}
+
+size_t TimeSeriesStore::queryLast(uint32_t collarId, size_t count, TimeSeriesPoint* points) {
+    uint32_t startUs = micros();
+    int index = findSeries(collarId);
+    if (index < 0) {
+        finishQuery(startUs);
+        return 0;
+    }
+
+    Series& s = series[index];
+    size_t wanted = min(count, (size_t)(s.blockPoints + s.headCount));
+    size_t fromHead = min(wanted, (size_t)s.headCount);
+    size_t fromBlocks = wanted - fromHead;
+
+    // Walk back to the oldest block needed, then decode forward
+    uint16_t block = s.newest;
+    size_t covered = 0;
+    while (covered < fromBlocks) {
+        covered += blockInfo[block].count;
+        if (covered < fromBlocks) {
+            block = blockInfo[block].prev;
+        }
+    }
+
+    size_t written = 0;
+    size_t skip = covered - fromBlocks;
+    TimeSeriesPoint decoded[TSDB_HEAD_POINTS];     // A block holds one head at most
+    while (written < fromBlocks) {
+        uint8_t decodedCount = decodeBlock(block, decoded);
+        memcpy(points + written, decoded + skip, sizeof(TimeSeriesPoint) * (decodedCount - skip));
+        written += decodedCount - skip;
+        skip = 0;
+        block = blockInfo[block].next;
+    }
+
+    memcpy(points + written, s.head + s.headCount - fromHead, sizeof(TimeSeriesPoint) * fromHead);
+    written += fromHead;
+
+    finishQuery(startUs);
+    return written;
+}
+
+size_t TimeSeriesStore::queryRange(uint32_t collarId, uint64_t startMs, uint64_t endMs,
+                                   TimeSeriesPoint* points, size_t maxPoints) {
+    uint32_t startUs = micros();
+    int index = findSeries(collarId);
+    if (index < 0) {
+        finishQuery(startUs);
+        return 0;
+    }
+
+    Series& s = series[index];
+    size_t written = 0;
+    TimeSeriesPoint decoded[TSDB_HEAD_POINTS];     // A block holds one head at most
+    for (uint16_t block = s.oldest; block != TSDB_NO_BLOCK && written < maxPoints;
+         block = blockInfo[block].next) {
+        const BlockInfo& info = blockInfo[block];
+        if (info.lastTime < startMs) {
+            continue;
+        }
+        if (info.firstTime > endMs) {
+            break;
+        }
+
+        uint8_t decodedCount = decodeBlock(block, decoded);
+        for (uint8_t i = 0; i < decodedCount && written < maxPoints; i++) {
+            if (decoded[i].timeMs >= startMs && decoded[i].timeMs <= endMs) {
+                points[written++] = decoded[i];
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < s.headCount && written < maxPoints; i++) {
+        if (s.head[i].timeMs >= startMs && s.head[i].timeMs <= endMs) {
+            points[written++] = s.head[i];
+        }
+    }
+
+    finishQuery(startUs);
+    return written;
+}
+
+uint8_t TimeSeriesStore::getSeriesCount() {
+    return seriesCount;
+}
+
+const char* TimeSeriesStore::getSeries(uint8_t index, uint32_t& collarId, uint32_t& points) {
+    if (index >= seriesCount) {
+        collarId = 0;
+        points = 0;
+        return "";
+    }
+    collarId = series[index].collarId;
+    points = series[index].blockPoints + series[index].headCount;
+    return series[index].deviceId;
+}
+
+TimeSeriesStats TimeSeriesStore::getStats() {
+    TimeSeriesStats stats;
+    stats.series = seriesCount;
+    stats.points = 0;
+    for (uint8_t i = 0; i < seriesCount; i++) {
+        stats.points += series[i].blockPoints + series[i].headCount;
+    }
+    stats.evictedPoints = evictedPoints;
+    stats.blocksUsed = blocksUsed;
+    stats.blockCount = blockCount;
+
+    float rawBytes = (float)sealedPoints * sizeof(TimeSeriesPoint);
+    stats.compressionRatio = sealedBytes ? rawBytes / sealedBytes : 0;
+    stats.storageRatio = blocksUsed ? rawBytes / ((uint32_t)blocksUsed * TSDB_BLOCK_SIZE) : 0;
+    stats.queries = queries;
+    stats.lastQueryUs = lastQueryUs;
+    stats.maxQueryUs = maxQueryUs;
+    return stats;
+}
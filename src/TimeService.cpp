@@ -0,0 +1,296 @@
+/**
+ * @file TimeService.cpp
+ * @brief GPS-disciplined time implementation
+ */
+
+#include "TimeService.h"
+
+#ifndef BRAVO_NATIVE
+#include <sys/time.h>
+#include "esp_attr.h"
+
+#define TIME_RTC_MAGIC  0x54494D45  // "TIME"
+
+// The mapping to UTC, against the system clock that keeps counting on the
+// RTC timer through deep sleep
+struct TimeRtcState {
+    uint32_t magic;
+    int64_t unixMinusSystemUs;
+    int64_t systemUs;           // When saved
+    float driftPpm;
+    bool driftKnown;
+    uint32_t uncertaintyUs;
+};
+
+static RTC_DATA_ATTR TimeRtcState rtcState;
+
+static int64_t systemUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+// One PPS input per device; native builds call onPPS() directly
+static TimeService* ppsTarget = nullptr;
+
+static void IRAM_ATTR onPPSInterrupt() {
+    ppsTarget->onPPS(micros());
+}
+#endif
+
+/**
+ * @brief Spread a seed over all 32 bits (MurmurHash3 finalizer)
+ */
+static uint32_t mix(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6BUL;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35UL;
+    x ^= x >> 16;
+    return x;
+}
+
+TimeService::TimeService()
+    : lastMicros(0), microsHigh(0), ppsEdgeUs(0), ppsPending(false), ppsLocalUs(0),
+      ppsSeen(false), synced(false), restored(false), lastPps(false), baseLocalUs(0),
+      baseUnixUs(0), driftPpm(0), driftKnown(false), syncErrorUs(0), lastSampleUnixUs(0),
+      anchorLocalUs(0), anchorUnixUs(0), anchorPps(false), lastErrorUs(0), samples(0),
+      steps(0), ppsEdges(0) {
+}
+
+void TimeService::begin(int ppsPin) {
+    lastMicros = micros();
+
+#ifndef BRAVO_NATIVE
+    // A system clock behind the saved one was reset along with the chip
+    int64_t system = systemUs();
+    if (rtcState.magic == TIME_RTC_MAGIC && system >= rtcState.systemUs) {
+        uint64_t elapsedUs = (uint64_t)(system - rtcState.systemUs);
+        baseLocalUs = localUs();
+        baseUnixUs = system + rtcState.unixMinusSystemUs;
+        driftPpm = rtcState.driftPpm;
+        driftKnown = rtcState.driftKnown;
+        uint64_t errorUs = rtcState.uncertaintyUs + elapsedUs * TIME_SLEEP_DRIFT_PPM / 1000000;
+        syncErrorUs = errorUs < UINT32_MAX ? (uint32_t)errorUs : UINT32_MAX - 1;
+        synced = true;
+        restored = true;
+    }
+
+    if (ppsPin != TIME_PPS_PIN_NONE) {
+        ppsTarget = this;
+        pinMode(ppsPin, INPUT);
+        attachInterrupt(digitalPinToInterrupt(ppsPin), onPPSInterrupt, RISING);
+    }
+#endif
+}
+
+void IRAM_ATTR TimeService::onPPS(uint32_t edgeUs) {
+    ppsEdgeUs = edgeUs;
+    ppsPending = true;
+}
+
+void TimeService::onGpsTime(uint32_t unixSeconds, uint16_t millisecond, uint32_t receivedUs) {
+    update();
+
+    // GGA and RMC carry the same epoch
+    int64_t utc = (int64_t)unixSeconds * 1000000LL + (int64_t)millisecond * 1000;
+    if ((uint64_t)utc == lastSampleUnixUs) {
+        return;
+    }
+    lastSampleUnixUs = utc;
+
+    // The sentence for a whole second follows the PPS edge that marks it
+    uint64_t received = extend(receivedUs);
+    if (ppsSeen && millisecond == 0 && received > ppsLocalUs &&
+        received - ppsLocalUs < TIME_PPS_MAX_AGE_US) {
+        discipline(ppsLocalUs, utc, true);
+    } else {
+        discipline(received - TIME_NMEA_LAG_US, utc, false);
+    }
+}
+
+void TimeService::update() {
+    localUs();
+
+    if (ppsPending) {
+        ppsPending = false;
+        ppsLocalUs = extend(ppsEdgeUs);
+        ppsSeen = true;
+        ppsEdges++;
+    }
+}
+
+bool TimeService::isSynced() {
+    return synced;
+}
+
+uint64_t TimeService::localUs() {
+    uint32_t now = micros();
+    if (now < lastMicros) {
+        microsHigh++;
+    }
+    lastMicros = now;
+    return ((uint64_t)microsHigh << 32) | now;
+}
+
+uint64_t TimeService::nowUnixUs() {
+    return synced ? (uint64_t)toUnixUs(localUs()) : 0;
+}
+
+uint64_t TimeService::nowUnixMs() {
+    return nowUnixUs() / 1000;
+}
+
+uint64_t TimeService::toUnixMs(uint32_t localMs) {
+    if (!synced) {
+        return 0;
+    }
+    uint32_t ageMs = millis() - localMs;
+    return nowUnixMs() - ageMs;
+}
+
+uint32_t TimeService::getHourMs() {
+    return (uint32_t)(nowUnixMs() % TIME_HOUR_MS);
+}
+
+uint64_t TimeService::resolveHourMs(uint32_t hourMs) {
+    if (!synced) {
+        return 0;
+    }
+
+    // The hour that puts the stamp nearest to now
+    uint64_t now = nowUnixMs();
+    uint64_t stamp = now - now % TIME_HOUR_MS + hourMs;
+    if (stamp > now + TIME_HOUR_MS / 2) {
+        stamp -= TIME_HOUR_MS;
+    } else if (stamp + TIME_HOUR_MS / 2 < now) {
+        stamp += TIME_HOUR_MS;
+    }
+    return stamp;
+}
+
+int32_t TimeService::msUntilSlot(uint32_t periodMs, uint32_t slotMs, uint32_t seed,
+                                 uint32_t minDelayMs) {
+    if (!synced || periodMs == 0) {
+        return -1;
+    }
+
+    uint32_t slots = max(periodMs / max(slotMs, (uint32_t)1), (uint32_t)1);
+    uint64_t now = nowUnixMs();
+    uint64_t earliest = now + minDelayMs;
+    for (uint64_t period = now / periodMs; ; period++) {
+        uint32_t slot = mix(seed ^ (uint32_t)period) % slots;
+        uint64_t start = period * periodMs + (uint64_t)slot * slotMs;
+        if (start >= earliest) {
+            return (int32_t)(start - now);
+        }
+    }
+}
+
+uint32_t TimeService::getUncertaintyUs() {
+    if (!synced) {
+        return UINT32_MAX;
+    }
+
+    // Until the drift is measured, the crystal could be anywhere in range
+    uint64_t ageUs = localUs() - baseLocalUs;
+    uint64_t ppm = driftKnown ? TIME_HOLDOVER_PPM : (uint64_t)TIME_MAX_DRIFT_PPM;
+    uint64_t errorUs = syncErrorUs + ageUs * ppm / 1000000;
+    return errorUs < UINT32_MAX ? (uint32_t)errorUs : UINT32_MAX - 1;
+}
+
+TimeStats TimeService::getStats() {
+    TimeStats stats;
+    stats.synced = synced;
+    stats.pps = lastPps;
+    stats.restored = restored;
+    stats.driftPpm = driftPpm;
+    stats.uncertaintyUs = getUncertaintyUs();
+    stats.lastErrorUs = lastErrorUs;
+    stats.samples = samples;
+    stats.steps = steps;
+    stats.ppsEdges = ppsEdges;
+    return stats;
+}
+
+uint64_t TimeService::extend(uint32_t us) {
+    // us is at or before now, within the last wrap
+    uint64_t now = localUs();
+    return now - (uint32_t)(lastMicros - us);
+}
+
+int64_t TimeService::toUnixUs(uint64_t local) {
+    int64_t elapsed = (int64_t)(local - baseLocalUs);
+    return baseUnixUs + elapsed + (int64_t)((double)elapsed * driftPpm * 1e-6);
+}
+
+void TimeService::discipline(uint64_t local, int64_t utc, bool pps) {
+    samples++;
+
+    // Time carried through a sleep is too rough to steer by
+    if (!synced || restored) {
+        step(local, utc, pps);
+        return;
+    }
+
+    int64_t predicted = toUnixUs(local);
+    int64_t error = utc - predicted;
+    lastErrorUs = (int32_t)constrain(error, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+    if (error > TIME_STEP_THRESHOLD_US || error < -TIME_STEP_THRESHOLD_US) {
+        steps++;
+        step(local, utc, pps);
+        return;
+    }
+
+    float gain = pps ? 1.0f : TIME_NMEA_PHASE_GAIN;
+    baseLocalUs = local;
+    baseUnixUs = predicted + (int64_t)(error * gain);
+    lastPps = pps;
+    syncErrorUs = pps ? TIME_PPS_ERROR_US : TIME_NMEA_ERROR_US;
+
+    // Drift from two samples of the same kind far enough apart for their
+    // timing error not to matter
+    uint64_t span = local - anchorLocalUs;
+    if (pps != anchorPps) {
+        anchorLocalUs = local;
+        anchorUnixUs = utc;
+        anchorPps = pps;
+    } else if (span >= (pps ? TIME_DRIFT_INTERVAL_PPS_US : TIME_DRIFT_INTERVAL_NMEA_US)) {
+        float measured = (float)((double)((utc - anchorUnixUs) - (int64_t)span) * 1e6 /
+                                 (double)span);
+        if (fabsf(measured) <= TIME_MAX_DRIFT_PPM) {
+            driftPpm = driftKnown ? driftPpm + (measured - driftPpm) * TIME_DRIFT_GAIN
+                                  : measured;
+            driftKnown = true;
+        }
+        anchorLocalUs = local;
+        anchorUnixUs = utc;
+    }
+
+    save();
+}
+
+void TimeService::step(uint64_t local, int64_t utc, bool pps) {
+    baseLocalUs = local;
+    baseUnixUs = utc;
+    anchorLocalUs = local;
+    anchorUnixUs = utc;
+    anchorPps = pps;
+    lastPps = pps;
+    syncErrorUs = pps ? TIME_PPS_ERROR_US : TIME_NMEA_ERROR_US;
+    synced = true;
+    restored = false;
+    save();
+}
+
+void TimeService::save() {
+#ifndef BRAVO_NATIVE
+    int64_t system = systemUs();
+    rtcState.unixMinusSystemUs = toUnixUs(localUs()) - system;
+    rtcState.systemUs = system;
+    rtcState.driftPpm = driftPpm;
+    rtcState.driftKnown = driftKnown;
+    rtcState.uncertaintyUs = getUncertaintyUs();
+    rtcState.magic = TIME_RTC_MAGIC;
+#endif
+}
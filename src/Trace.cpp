@@ -0,0 +1,142 @@
+/**
+ * @file Trace.cpp
+ * @brief Hot-path trace ring buffer and loop-overrun monitor implementation
+ */
+
+#include "Trace.h"
+
+#if BRAVO_TRACE
+Trace trace;
+#endif
+
+static const char* const POINT_NAMES[TRACE_POINT_COUNT] = {
+    "loop", "gps", "imu", "telemetry", "lora_rx", "lora_tx",
+    "ble_update", "status", "fusion", "overrun"
+};
+
+static const char PHASE_CHARS[] = { 'B', 'E', 'I' };
+
+Trace::Trace() : writeIndex(0), recording(true) {
+    memset(events, 0, sizeof(events));
+    memset(beginUs, 0, sizeof(beginUs));
+    memset(stats, 0, sizeof(stats));
+    memset(&lastOverrun, 0, sizeof(lastOverrun));
+}
+
+void IRAM_ATTR Trace::record(TracePoint point, TracePhase phase, uint16_t arg, uint32_t timestampUs) {
+    if (!recording.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Claiming a slot is the only shared step; writers never wait
+    uint32_t slot = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& event = events[slot % TRACE_CAPACITY];
+    event.timestampUs = timestampUs;
+    event.point = point;
+    event.flags = phase | (xPortGetCoreID() ? 0x80 : 0);
+    event.arg = arg;
+}
+
+void Trace::begin(TracePoint point) {
+    uint32_t now = micros();
+    beginUs[point] = now;
+    record(point, TRACE_PHASE_BEGIN, 0, now);
+}
+
+void Trace::end(TracePoint point) {
+    uint32_t now = micros();
+    uint32_t duration = now - beginUs[point];
+    record(point, TRACE_PHASE_END, 0, now);
+
+    TracePointStats& s = stats[point];
+    s.count++;
+    if (duration > s.maxUs) {
+        s.maxUs = duration;
+    }
+
+    if (s.budgetUs > 0 && duration > s.budgetUs) {
+        s.overruns++;
+        lastOverrun.point = point;
+        lastOverrun.durationUs = duration;
+        lastOverrun.timestampMs = millis();
+        record(TRACE_OVERRUN, TRACE_PHASE_INSTANT, point, now);
+    }
+}
+
+void Trace::instant(TracePoint point, uint16_t arg) {
+    record(point, TRACE_PHASE_INSTANT, arg, micros());
+}
+
+void Trace::setBudget(TracePoint point, uint32_t budgetUs) {
+    stats[point].budgetUs = budgetUs;
+}
+
+TracePointStats Trace::getStats(TracePoint point) {
+    return stats[point];
+}
+
+uint32_t Trace::getOverrunCount() {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < TRACE_POINT_COUNT; i++) {
+        total += stats[i].overruns;
+    }
+    return total;
+}
+
+TraceOverrun Trace::getLastOverrun() {
+    return lastOverrun;
+}
+
+uint32_t Trace::startDump() {
+    // Freeze the ring so the dump is a consistent snapshot
+    recording.store(false);
+    uint32_t end = writeIndex.load();
+    return end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+}
+
+size_t Trace::formatDump(uint32_t& cursor, char* buffer, size_t maxLength) {
+    uint32_t end = writeIndex.load();
+    size_t length = 0;
+
+    while (cursor < end && maxLength - length >= TRACE_LINE_MAX) {
+        const TraceEvent& event = events[cursor % TRACE_CAPACITY];
+        length += snprintf(buffer + length, maxLength - length, "T %u %u %c %s %u\n",
+                           event.timestampUs, event.flags >> 7,
+                           PHASE_CHARS[event.flags & 0x03], pointName(event.point),
+                           event.arg);
+        cursor++;
+    }
+
+    if (length == 0) {
+        recording.store(true);
+    }
+
+    return length;
+}
+
+void Trace::dumpToSerial() {
+    uint32_t cursor = startDump();
+    uint32_t end = writeIndex.load();
+    Serial.printf("TRACE START events=%u overwritten=%u\n",
+                  end - cursor, cursor);
+
+    char buffer[256];
+    size_t length;
+    while ((length = formatDump(cursor, buffer, sizeof(buffer))) > 0) {
+        Serial.write((const uint8_t*)buffer, length);
+    }
+
+    Serial.println("TRACE END");
+}
+
+const char* Trace::pointName(uint8_t point) {
+    return point < TRACE_POINT_COUNT ? POINT_NAMES[point] : "?";
+}
+
+TraceScope::TraceScope(Trace& trace, TracePoint point) : trace(trace), point(point) {
+    trace.begin(point);
+}
+
+TraceScope::~TraceScope() {
+    trace.end(point);
+}
@@ -0,0 +1,120 @@
+/**
+ * @file TrackFilter.cpp
+ * @brief Streaming track simplification implementation
+ */
+
+#include "TrackFilter.h"
+
+TrackFilter::TrackFilter() : tolerance(TRACK_DEFAULT_TOLERANCE_M), maxGapMs(TRACK_MAX_GAP_MS) {
+    reset();
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TrackFilter::setTolerance(float metres) {
+    tolerance = max(metres, 0.0f);
+}
+
+float TrackFilter::getTolerance() {
+    return tolerance;
+}
+
+void TrackFilter::setMaxGap(uint32_t ms) {
+    maxGapMs = ms;
+}
+
+void TrackFilter::reset() {
+    hasAnchor = false;
+    hasPrevious = false;
+    interiorCount = 0;
+    nearMaxM = 0;
+    segmentErrorM = 0;
+}
+
+void TrackFilter::startSegment(const GPSData& fix) {
+    anchor = fix;
+    hasAnchor = true;
+    lonScale = TRACK_METRES_PER_DEGREE * cos(fix.latitude * DEG_TO_RAD);
+    interiorCount = 0;
+    nearMaxM = 0;
+    segmentErrorM = 0;
+}
+
+TrackOffset TrackFilter::offsetOf(const GPSData& fix) {
+    // Equirectangular about the anchor: exact enough over a segment
+    TrackOffset offset;
+    offset.x = (fix.longitude - anchor.longitude) * lonScale;
+    offset.y = (fix.latitude - anchor.latitude) * TRACK_METRES_PER_DEGREE;
+    return offset;
+}
+
+float TrackFilter::distanceToSegment(const TrackOffset& point, const TrackOffset& end) {
+    // The segment runs from the origin (anchor) to end
+    float lengthSq = end.x * end.x + end.y * end.y;
+    float t = 0;
+    if (lengthSq > 0) {
+        t = constrain((point.x * end.x + point.y * end.y) / lengthSq, 0.0f, 1.0f);
+    }
+    float dx = point.x - t * end.x;
+    float dy = point.y - t * end.y;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+bool TrackFilter::push(const GPSData& fix, GPSData& kept) {
+    if (!fix.valid) {
+        return false;
+    }
+    stats.received++;
+
+    if (!hasAnchor || tolerance <= 0) {
+        startSegment(fix);
+        hasPrevious = false;
+        kept = fix;
+        stats.kept++;
+        return true;
+    }
+
+    if (!hasPrevious) {
+        previous = fix;
+        hasPrevious = true;
+        return false;
+    }
+
+    // Would anchor -> fix still pass near every fix since the anchor? Fixes
+    // within the tolerance of the anchor always do, so only their distance
+    // from it is remembered (an upper bound on their error).
+    TrackOffset end = offsetOf(fix);
+    TrackOffset middle = offsetOf(previous);
+    float middleFromAnchor = sqrtf(middle.x * middle.x + middle.y * middle.y);
+    bool holdMiddle = middleFromAnchor > tolerance;
+
+    float error = max(nearMaxM, distanceToSegment(middle, end));
+    for (uint8_t i = 0; i < interiorCount && error <= tolerance; i++) {
+        error = max(error, distanceToSegment(interior[i], end));
+    }
+
+    bool fits = error <= tolerance &&
+                (!holdMiddle || interiorCount < TRACK_WINDOW_MAX) &&
+                (maxGapMs == 0 || fix.timestamp - anchor.timestamp <= maxGapMs);
+    if (fits) {
+        if (holdMiddle) {
+            interior[interiorCount++] = middle;
+        } else {
+            nearMaxM = max(nearMaxM, middleFromAnchor);
+        }
+        previous = fix;
+        segmentErrorM = error;
+        return false;
+    }
+
+    // The segment ends at the previous fix, which starts the next one
+    stats.maxErrorM = max(stats.maxErrorM, segmentErrorM);
+    kept = previous;
+    stats.kept++;
+    startSegment(previous);
+    previous = fix;
+    return true;
+}
+
+TrackStats TrackFilter::getStats() {
+    return stats;
+}
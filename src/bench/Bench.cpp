@@ -0,0 +1,197 @@
+/**
+ * @file Bench.cpp
+ * @brief Microbenchmark harness implementation
+ */
+
+#ifdef BRAVO_BENCH
+
+#include "bench/Bench.h"
+#include <new>
+
+#ifdef BRAVO_NATIVE
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLE_SOURCE "tsc"
+static uint64_t readCycles() { return __rdtsc(); }
+#else
+#define BENCH_CYCLE_SOURCE "none"
+static uint64_t readCycles() { return 0; }
+#endif
+#define BENCH_TARGET "native"
+
+static uint64_t readNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t cyclesBetween(uint64_t start, uint64_t end) {
+    return end - start;
+}
+
+// Linker-provided bounds of the program text
+extern char __executable_start;
+extern char etext;
+
+static uint32_t codeSize() {
+    return &etext - &__executable_start;
+}
+
+static uint32_t cpuMHz() {
+    return 0;
+}
+#else
+#include <esp_timer.h>
+#define BENCH_CYCLE_SOURCE "ccount"
+#define BENCH_TARGET "esp32"
+
+static uint64_t readCycles() {
+    return ESP.getCycleCount();
+}
+
+static uint64_t readNs() {
+    return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+static uint64_t cyclesBetween(uint64_t start, uint64_t end) {
+    // CCOUNT is 32 bits and wraps every ~18 s at 240 MHz
+    return (uint32_t)(end - start);
+}
+
+static uint32_t codeSize() {
+    return ESP.getSketchSize();
+}
+
+static uint32_t cpuMHz() {
+    return ESP.getCpuFreqMHz();
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Allocation accounting
+// ---------------------------------------------------------------------------
+
+static volatile uint64_t allocCount = 0;
+static volatile uint64_t allocBytes = 0;
+
+static inline void countAllocation(size_t size) {
+    allocCount = allocCount + 1;
+    allocBytes = allocBytes + size;
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+    countAllocation(size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    countAllocation(count * size);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    countAllocation(size);
+    return __real_realloc(ptr, size);
+}
+
+// Wrapped by the firmware's memory monitor; frees are not counted here
+void __wrap_free(void* ptr) {
+    __real_free(ptr);
+}
+}
+
+// operator new goes straight to the real allocator so it is counted once
+void* operator new(size_t size) {
+    countAllocation(size);
+    void* ptr = __real_malloc(size ? size : 1);
+    if (!ptr) {
+        abort();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+uint64_t Bench::getAllocatedBytes() {
+    return allocBytes;
+}
+
+uint64_t Bench::getAllocationCount() {
+    return allocCount;
+}
+
+// ---------------------------------------------------------------------------
+// Runner
+// ---------------------------------------------------------------------------
+
+void Bench::printHeader() {
+    Serial.printf("BENCH {\"suite\":\"bravo\",\"target\":\"%s\",\"cpu_mhz\":%u,"
+                  "\"cycle_source\":\"%s\",\"code_bytes\":%u,\"min_time_us\":%u}\n",
+                  BENCH_TARGET, cpuMHz(), BENCH_CYCLE_SOURCE, codeSize(),
+                  (uint32_t)BENCH_MIN_TIME_US);
+}
+
+BenchResult Bench::run(const char* name, BenchFunction op) {
+    for (int i = 0; i < BENCH_WARMUP_ITERATIONS; i++) {
+        op();
+    }
+
+    BenchResult result;
+    result.name = name;
+    uint32_t iterations = 1;
+
+    while (true) {
+        uint64_t allocsBefore = allocCount;
+        uint64_t bytesBefore = allocBytes;
+        uint64_t startNs = readNs();
+        uint64_t startCycles = readCycles();
+
+        for (uint32_t i = 0; i < iterations; i++) {
+            op();
+        }
+
+        uint64_t cycles = cyclesBetween(startCycles, readCycles());
+        uint64_t elapsedNs = readNs() - startNs;
+
+        if (elapsedNs >= (uint64_t)BENCH_MIN_TIME_US * 1000) {
+            result.iterations = iterations;
+            result.nsPerOp = (double)elapsedNs / iterations;
+            result.cyclesPerOp = (double)cycles / iterations;
+            result.allocsPerOp = (double)(allocCount - allocsBefore) / iterations;
+            result.allocBytesPerOp = (double)(allocBytes - bytesBefore) / iterations;
+            break;
+        }
+
+        // Aim past the minimum time on the next attempt
+        uint64_t scale = elapsedNs > 0 ? (uint64_t)BENCH_MIN_TIME_US * 1200 / elapsedNs : 100;
+        iterations *= constrain(scale, (uint64_t)2, (uint64_t)100);
+    }
+
+    Serial.printf("BENCH {\"bench\":\"%s\",\"iterations\":%u,\"ns_per_op\":%.1f,"
+                  "\"cycles_per_op\":%.1f,\"allocs_per_op\":%.2f,\"alloc_bytes_per_op\":%.1f}\n",
+                  result.name, result.iterations, result.nsPerOp, result.cyclesPerOp,
+                  result.allocsPerOp, result.allocBytesPerOp);
+    return result;
+}
+
+void Bench::printFooter(uint16_t count) {
+    Serial.printf("BENCH {\"done\":true,\"count\":%u}\n", count);
+}
+
+#endif // BRAVO_BENCH
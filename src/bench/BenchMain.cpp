@@ -0,0 +1,583 @@
+/**
+ * @file BenchMain.cpp
+ * @brief Benchmark cases and entry point (native main() or device setup())
+ *
+ * Names are part of the output format: keep them stable so results can be
+ * compared across builds.
+ */
+
+#ifdef BRAVO_BENCH
+
+#include <Arduino.h>
+#include "bench/Bench.h"
+#include "hal/HAL.h"
+#include "LoRaComm.h"
+#include "GPS.h"
+#include "IMU.h"
+#include "Telemetry.h"
+#include "Downlink.h"
+#include "Geofence.h"
+#include "DeadReckoning.h"
+#include "ActivitySummary.h"
+#include "Log.h"
+#include "TimeSeriesStore.h"
+#include "ProximityIndex.h"
+#include "FrameCrypto.h"
+#include "LatencyTracker.h"
+
+#ifdef BRAVO_NATIVE
+#include "hal/LinuxHAL.h"
+#endif
+
+#define BENCH_DEVICE_ID "BRAVO_001"
+
+// Geofence fixture: a pasture outline plus small exclusion zones inside it
+#define BENCH_FENCE_VERTICES    400
+#define BENCH_FENCE_ZONES       4
+#define BENCH_FENCE_POINTS      64
+
+// History fixture: a herd reporting once a minute for a few hours
+#define BENCH_HISTORY_COLLARS   16
+#define BENCH_HISTORY_POINTS    240
+
+// Proximity fixture: herds of grazing collars spread over a ranch
+#define BENCH_PROXIMITY_COLLARS 4096
+#define BENCH_PROXIMITY_HERDS   40
+#define BENCH_PROXIMITY_PAIR_M  25.0f
+
+// Herd key for the crypto cases
+static const uint8_t BENCH_LORA_KEY[CRYPTO_KEY_SIZE] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+// One fix: GGA + RMC, as a u-blox receiver sends each second
+static const char NMEA_FIX[] =
+    "$GPGGA,123519.00,4807.03800,N,01131.00000,E,1,08,0.9,545.4,M,46.9,M,,*69\r\n"
+    "$GPRMC,123519.00,A,4807.03800,N,01131.00000,E,2.2,54.7,230394,3.1,W,A*13\r\n";
+
+/**
+ * @brief Output that discards everything
+ */
+class NullPrint : public Print {
+public:
+    size_t write(uint8_t c) override { return 1; }
+    size_t write(const uint8_t* buffer, size_t size) override { return size; }
+};
+
+/**
+ * @brief UART serving bytes from memory
+ */
+class MemoryUart : public UartHAL {
+public:
+    MemoryUart() : data(nullptr), length(0), position(0) {}
+
+    bool begin(uint32_t baud) override { return true; }
+    int available() override { return length - position; }
+    int read() override { return position < length ? (uint8_t)data[position++] : -1; }
+    size_t write(const uint8_t* bytes, size_t count) override { return count; }
+
+    void load(const char* bytes, size_t count) {
+        data = bytes;
+        length = count;
+        position = 0;
+    }
+
+private:
+    const char* data;
+    size_t length;
+    size_t position;
+};
+
+/**
+ * @brief Radio that hands out the same received packet on every poll
+ */
+class LoopbackRadio : public RadioHAL {
+public:
+    LoopbackRadio() : length(0), position(0) {}
+
+    bool begin(long frequency) override { return true; }
+    void setFrequency(long frequency) override {}
+    void setSpreadingFactor(int spreadingFactor) override {}
+    void setSignalBandwidth(long bandwidth) override {}
+    void setTxPower(int txPower) override {}
+    void enableCrc() override {}
+    bool beginPacket() override { return true; }
+    size_t write(const uint8_t* bytes, size_t count) override { return count; }
+    bool endPacket() override { return true; }
+    int parsePacket() override { position = 0; return length; }
+    int available() override { return length - position; }
+    int read() override { return position < length ? packet[position++] : -1; }
+    int packetRssi() override { return -90; }
+    float packetSnr() override { return 7.5f; }
+    void sleep() override {}
+
+    void load(const uint8_t* bytes, size_t count) {
+        memcpy(packet, bytes, count);
+        length = count;
+    }
+
+private:
+    uint8_t packet[256];
+    size_t length;
+    size_t position;
+};
+
+/**
+ * @brief IMU returning a fixed in-motion reading
+ */
+class FixedImu : public ImuHAL {
+public:
+    bool begin() override { return true; }
+    bool read(IMUReading& reading) override {
+        static const IMUReading sample = { { 1.2f, -0.4f, 10.9f }, { 0.05f, 0.01f, -0.2f }, 24.5f };
+        reading = sample;
+        return true;
+    }
+};
+
+// Fixture
+static MemoryUart gpsUart;
+static LoopbackRadio radio;
+static FixedImu imuSensor;
+static GPS gps(gpsUart);
+static IMU imu(imuSensor);
+static LoRaComm lora(radio);
+static Telemetry telemetry;
+static DownlinkQueue downlinkQueue;
+static DownlinkHandler downlinkHandler(BENCH_DEVICE_ID);
+static GPSData gpsData;
+static IMUData imuData;
+static String fullJson;
+static uint8_t activityUplink[TELEMETRY_MAX_UPLINK];
+static size_t activityUplinkLength;
+static uint8_t downlinkFrame[DOWNLINK_MAX_FRAME];
+static size_t downlinkFrameLength;
+static Geofence geofence;
+static GeofencePoint fencePoints[BENCH_FENCE_POINTS];
+static GPSData fenceFixes[BENCH_FENCE_POINTS];
+static uint8_t fencePoint;
+static DeadReckoning deadReckoning;
+static IMUData fusionSample;
+static ActivitySummary activitySummary;
+static Logger benchLog;
+static NullPrint nullOutput;
+static uint32_t logWrites;
+static TimeSeriesStore history;
+static TimeSeriesPoint historyPoints[HISTORY_MAX_POINTS];
+static uint32_t historyTime;
+static uint32_t historyAppends;
+static ProximityIndex proximity;
+static ProximityResult proximityResults[PROXIMITY_MAX_RESULTS];
+static uint32_t proximityMoves;
+static FrameCrypto collarCrypto(BENCH_DEVICE_ID, false);
+static FrameCrypto dongleCrypto("BENCH_DONGLE", true);
+static uint8_t ackFrame[DOWNLINK_MAX_FRAME];
+static size_t ackLength;
+static LatencyTracker latencyTracker;
+static uint32_t latencyUplinks;
+static volatile uint32_t sink;
+
+static uint8_t acceptCommand(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    return DL_STATUS_OK;
+}
+
+/**
+ * @brief Store the next collar's next position in the history fixture
+ */
+static void appendHistoryFix() {
+    uint32_t collar = historyAppends % BENCH_HISTORY_COLLARS;
+    uint32_t step = historyAppends / BENCH_HISTORY_COLLARS;
+    historyTime += 60000 / BENCH_HISTORY_COLLARS + (historyAppends * 7919 % 13) * 10;
+    double noise = ((int)(historyAppends * 2654435761u % 41) - 20) * 1e-6;
+    double latitude = gpsData.latitude + collar * 1e-3 + 2e-5 * sin(step * 0.05) + noise;
+    double longitude = gpsData.longitude + 3e-5 * cos(step * 0.03) - noise;
+    history.append(collar, BENCH_DEVICE_ID, historyTime, latitude, longitude);
+    historyAppends++;
+}
+
+/**
+ * @brief Position of a collar in the proximity fixture: herds 300 m across
+ *        scattered over about 10 x 10 km
+ */
+static void proximityPosition(uint32_t collar, uint32_t step, double& latitude,
+                              double& longitude) {
+    uint32_t herd = collar % BENCH_PROXIMITY_HERDS;
+    double herdLat = gpsData.latitude + (herd * 7919 % 97) * 0.001;
+    double herdLon = gpsData.longitude + (herd * 104729 % 89) * 0.0015;
+    uint32_t spread = collar * 2654435761u + step * 40503u;
+    latitude = herdLat + ((spread >> 8) % 2700) * 1e-6;
+    longitude = herdLon + ((spread >> 20) % 4000) * 1e-6;
+}
+
+static void setupFixture() {
+    gps.begin();
+    imu.begin();
+    lora.begin();
+
+    gpsUart.load(NMEA_FIX, sizeof(NMEA_FIX) - 1);
+    gps.update();
+    gpsData = gps.getData();
+    imu.readSensor();
+    imuData = imu.getData();
+
+    fullJson = telemetry.createFullTelemetry(gpsData, imuData, BENCH_DEVICE_ID, 85);
+    // The uplink as the collar sends it, sealed and opened by the crypto benches
+    LatencyReport latency = { 2140, 4, 62 };
+    activityUplinkLength = telemetry.encodeActivityUplink(
+        &gpsData, activitySummary.getSummary(millis()), BENCH_DEVICE_ID, 85, nullptr, &latency,
+        activityUplink, sizeof(activityUplink));
+
+    // A config downlink frame addressed to the benchmark collar
+    uint32_t collarId = Downlink::hashDeviceId(BENCH_DEVICE_ID);
+    uint8_t powerMode = 1;
+    downlinkQueue.enqueue(collarId, DL_CMD_POWER_MODE, &powerMode, 1);
+    downlinkFrameLength = downlinkQueue.onUplink(collarId, downlinkFrame);
+    downlinkHandler.setCommandHandler(acceptCommand);
+
+    // Irregular ~2 km pasture around the fix, with four 100 m zones inside
+    GeofencePoint origin = { Geofence::toUnits(gpsData.latitude),
+                             Geofence::toUnits(gpsData.longitude) };
+    geofence.beginFence(1, origin);
+    for (int i = 0; i < BENCH_FENCE_VERTICES; i++) {
+        float angle = 2 * PI * i / BENCH_FENCE_VERTICES;
+        float radius = 900 + 150 * sinf(7 * angle) + 40 * sinf(31 * angle);
+        GeofenceWireVertex vertex = { (int16_t)(radius * sinf(angle)),
+                                      (int16_t)(1.5f * radius * cosf(angle)) };
+        geofence.addVertex(vertex);
+    }
+    for (int zone = 0; zone < BENCH_FENCE_ZONES; zone++) {
+        GeofencePoint centre = { origin.lat + 400 * (zone % 2 ? 1 : -1),
+                                 origin.lon + 600 * (zone < 2 ? 1 : -1) };
+        geofence.beginFence(10 + zone, centre);
+        for (int i = 0; i < 12; i++) {
+            float angle = 2 * PI * i / 12;
+            GeofenceWireVertex vertex = { (int16_t)(90 * sinf(angle)),
+                                          (int16_t)(135 * cosf(angle)) };
+            geofence.addVertex(vertex);
+        }
+    }
+    geofence.commit();
+
+    // Walking fix so steps advance the estimate
+    fusionSample = imuData;
+    deadReckoning.updateFix(gpsData);
+
+    // Fixes spread over the pasture and its surroundings
+    for (int i = 0; i < BENCH_FENCE_POINTS; i++) {
+        fencePoints[i].lat = origin.lat - 1100 + (i * 37 % BENCH_FENCE_POINTS) * 2200 / BENCH_FENCE_POINTS;
+        fencePoints[i].lon = origin.lon - 1600 + (i * 23 % BENCH_FENCE_POINTS) * 3200 / BENCH_FENCE_POINTS;
+        fenceFixes[i] = gpsData;
+        fenceFixes[i].valid = true;
+        fenceFixes[i].latitude = (double)fencePoints[i].lat / GEOFENCE_UNITS_PER_DEGREE;
+        fenceFixes[i].longitude = (double)fencePoints[i].lon / GEOFENCE_UNITS_PER_DEGREE;
+    }
+
+    // Grazing walks with a few metres of fix noise
+    history.begin();
+    for (int i = 0; i < BENCH_HISTORY_COLLARS * BENCH_HISTORY_POINTS; i++) {
+        appendHistoryFix();
+    }
+
+    proximity.begin(BENCH_PROXIMITY_COLLARS);
+    for (uint32_t i = 0; i < BENCH_PROXIMITY_COLLARS; i++) {
+        double latitude, longitude;
+        proximityPosition(i, 0, latitude, longitude);
+        proximity.update(i, BENCH_DEVICE_ID, 0, latitude, longitude);
+    }
+
+    // Counters in RAM only: nothing to persist between runs
+    uint8_t collarKey[CRYPTO_KEY_SIZE];
+    collarCrypto.provisionKey(BENCH_LORA_KEY, collarKey);
+    collarCrypto.begin(collarKey, 0, 0);
+    dongleCrypto.begin(BENCH_LORA_KEY, 0, 0);
+    ackLength = downlinkHandler.handleFrame(downlinkFrame, downlinkFrameLength, ackFrame);
+
+    latencyTracker.begin();
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+static void benchTelemetryCreateFull() {
+    String json = telemetry.createFullTelemetry(gpsData, imuData, BENCH_DEVICE_ID, 85);
+    sink = json.length();
+}
+
+static void benchTelemetryCreateActivity() {
+    char json[TELEMETRY_JSON_MAX];
+    sink = telemetry.createActivityTelemetry(&gpsData, activitySummary.getSummary(millis()),
+                                             BENCH_DEVICE_ID, 85, nullptr, nullptr,
+                                             json, sizeof(json));
+}
+
+static void benchTelemetryEncodeActivity() {
+    uint8_t record[TELEMETRY_MAX_UPLINK];
+    sink = telemetry.encodeActivityUplink(&gpsData, activitySummary.getSummary(millis()),
+                                          BENCH_DEVICE_ID, 85, nullptr, nullptr,
+                                          record, sizeof(record));
+}
+
+static void benchTelemetryCreateGPS() {
+    String json = telemetry.createGPSTelemetry(gpsData, BENCH_DEVICE_ID);
+    sink = json.length();
+}
+
+static void benchTelemetryCreateIMU() {
+    String json = telemetry.createIMUTelemetry(imuData, BENCH_DEVICE_ID);
+    sink = json.length();
+}
+
+static void benchTelemetryCreateStatus() {
+    char json[TELEMETRY_JSON_MAX];
+    sink = telemetry.createStatusTelemetry(BENCH_DEVICE_ID, 85, 3600, -92, nullptr, nullptr,
+                                           nullptr, nullptr, json, sizeof(json));
+}
+
+static void benchTelemetryParse() {
+    sink = telemetry.parseTelemetry(fullJson.c_str(), fullJson.length());
+}
+
+static void benchTelemetryParseActivity() {
+    sink = telemetry.parseActivityUplink(activityUplink, activityUplinkLength);
+}
+
+static void benchGPSUpdateNMEA() {
+    gpsUart.load(NMEA_FIX, sizeof(NMEA_FIX) - 1);
+    gps.update();
+    sink = gps.hasFix();
+}
+
+static void benchIMUActivity() {
+    sink = imu.getActivityLevel() + imu.isInMotion(1.0);
+}
+
+static void benchIMUToRaw() {
+    IMURawSample raw = IMU::toRaw(imuData);
+    sink = raw.accelZ;
+}
+
+static void benchLoRaCollarDownlink() {
+    // Receive, handle and acknowledge a downlink frame
+    uint8_t packet[256];
+    uint8_t ack[DOWNLINK_MAX_FRAME];
+    radio.load(downlinkFrame, downlinkFrameLength);
+    if (lora.available()) {
+        int length = lora.receiveData(packet, sizeof(packet));
+        if (Downlink::isFrame(packet, length)) {
+            size_t ackLength = downlinkHandler.handleFrame(packet, length, ack);
+            lora.sendData(ack, ackLength);
+        }
+    }
+}
+
+static void benchLoRaDongleUplink() {
+    // Receive an activity uplink and look up queued downlinks for the sender
+    uint8_t packet[256];
+    uint8_t frame[DOWNLINK_MAX_FRAME];
+    radio.load(activityUplink, activityUplinkLength);
+    if (lora.available()) {
+        int length = lora.receiveData(packet, sizeof(packet));
+        if (telemetry.parseActivityUplink(packet, length)) {
+            uint32_t collarId = Downlink::hashDeviceId(telemetry.getLastDeviceId());
+            sink = downlinkQueue.onUplink(collarId, frame);
+        }
+    }
+}
+
+static void benchCryptoSealUplink() {
+    // Encrypt and authenticate the collar's activity uplink
+    uint8_t frame[CRYPTO_MAX_FRAME];
+    sink = collarCrypto.seal(activityUplink, activityUplinkLength, frame, sizeof(frame));
+}
+
+static void benchCryptoSealAck() {
+    uint8_t frame[CRYPTO_MAX_FRAME];
+    sink = collarCrypto.seal(ackFrame, ackLength, frame, sizeof(frame));
+}
+
+static void benchCryptoRoundtripUplink() {
+    // Seal on the collar, then authenticate and decrypt on the dongle; a
+    // frame opens only once, so opening is measured together with sealing
+    uint8_t frame[CRYPTO_MAX_FRAME];
+    size_t length = collarCrypto.seal(activityUplink, activityUplinkLength,
+                                      frame, sizeof(frame));
+    uint32_t collarId;
+    sink = dongleCrypto.open(frame, length, collarId) ? length : 0;
+}
+
+static void benchDeadReckoningImu() {
+    // One 10 Hz sample: orientation filter and step detector
+    fusionSample.timestamp += 100;
+    fusionSample.accelZ = (fusionSample.timestamp / 100) % 7 == 0 ? 12.5f : 9.6f;
+    sink = deadReckoning.updateImu(fusionSample);
+}
+
+static void benchActivitySummarySample() {
+    // One 10 Hz sample folded into the report interval
+    fusionSample.timestamp += 100;
+    fusionSample.accelZ = (fusionSample.timestamp / 100) % 7 == 0 ? 12.5f : 9.6f;
+    activitySummary.addSample(fusionSample, (fusionSample.timestamp / 100) % 101);
+    sink = activitySummary.getCurrentClass();
+}
+
+static void benchLogWrite() {
+    // The hot-path cost; records are discarded unformatted before the ring fills
+    benchLog.write(LOG_LEVEL_INFO, LOG_LORA_RX, 120, -92, 7.25f);
+    if (++logWrites % LOG_CAPACITY == 0) {
+        sink = benchLog.discard();
+    }
+}
+
+static void benchLogWriteDrain() {
+    // Write plus the deferred cost paid in the log task: format and output
+    benchLog.write(LOG_LEVEL_INFO, LOG_LORA_RX, 120, -92, 7.25f);
+    sink = benchLog.drain(nullOutput);
+}
+
+static void benchGeofenceContainsGrid() {
+    sink = geofence.contains(fencePoints[fencePoint++ % BENCH_FENCE_POINTS]);
+}
+
+static void benchGeofenceContainsLinear() {
+    sink = geofence.containsLinear(fencePoints[fencePoint++ % BENCH_FENCE_POINTS]);
+}
+
+static void benchHistoryAppend() {
+    appendHistoryFix();
+}
+
+static void benchHistoryQueryLast() {
+    sink = history.queryLast(3, HISTORY_MAX_POINTS, historyPoints);
+}
+
+static void benchHistoryQueryRange() {
+    // The last half hour of one collar
+    sink = history.queryRange(5, historyTime - 30 * 60000, historyTime, historyPoints,
+                              HISTORY_MAX_POINTS);
+}
+
+static void benchProximityUpdate() {
+    // A received packet moves one collar
+    double latitude, longitude;
+    uint32_t collar = proximityMoves % BENCH_PROXIMITY_COLLARS;
+    proximityPosition(collar, ++proximityMoves / BENCH_PROXIMITY_COLLARS, latitude, longitude);
+    sink = proximity.update(collar, BENCH_DEVICE_ID, proximityMoves, latitude, longitude);
+}
+
+static void benchProximityRadius() {
+    double latitude, longitude;
+    proximityPosition(proximityMoves++ % BENCH_PROXIMITY_COLLARS, 1, latitude, longitude);
+    sink = proximity.findWithin(latitude, longitude, 100, proximityResults,
+                                PROXIMITY_MAX_RESULTS);
+}
+
+static void benchProximityNearest() {
+    double latitude, longitude;
+    proximityPosition(proximityMoves++ % BENCH_PROXIMITY_COLLARS, 1, latitude, longitude);
+    sink = proximity.findNearest(latitude, longitude, 8, proximityResults);
+}
+
+static void benchProximityPairs() {
+    sink = proximity.findPairs(BENCH_PROXIMITY_PAIR_M, nullptr, 0);
+}
+
+static void benchProximityPairsBruteForce() {
+    sink = proximity.findPairsBruteForce(BENCH_PROXIMITY_PAIR_M);
+}
+
+static void benchGeofenceUpdate() {
+    GeofenceEvent events[GEOFENCE_MAX_FENCES];
+    sink = geofence.update(fenceFixes[fencePoint++ % BENCH_FENCE_POINTS], events,
+                           GEOFENCE_MAX_FENCES);
+}
+
+static void benchLatencyRecord() {
+    // All stages of one uplink, herd spread over the whole table
+    uint32_t collar = latencyUplinks % LATENCY_MAX_COLLARS;
+    uint32_t spread = ++latencyUplinks * 7919 % 1000;
+    for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        sink = latencyTracker.record(collar, BENCH_DEVICE_ID, (LatencyStage)stage,
+                                     spread * (stage + 1));
+    }
+}
+
+static void benchLatencyHerdPercentiles() {
+    sink = latencyTracker.getHerdPercentiles(LATENCY_TOTAL).p99Ms;
+}
+
+struct BenchCase {
+    const char* name;
+    BenchFunction op;
+};
+
+static const BenchCase BENCH_CASES[] = {
+    { "telemetry_create_full",   benchTelemetryCreateFull },
+    { "telemetry_create_activity", benchTelemetryCreateActivity },
+    { "telemetry_encode_activity", benchTelemetryEncodeActivity },
+    { "telemetry_create_gps",    benchTelemetryCreateGPS },
+    { "telemetry_create_imu",    benchTelemetryCreateIMU },
+    { "telemetry_create_status", benchTelemetryCreateStatus },
+    { "telemetry_parse_full",    benchTelemetryParse },
+    { "telemetry_parse_activity", benchTelemetryParseActivity },
+    { "gps_update_nmea_fix",     benchGPSUpdateNMEA },
+    { "imu_activity_motion",     benchIMUActivity },
+    { "imu_to_raw",              benchIMUToRaw },
+    { "lora_collar_downlink",    benchLoRaCollarDownlink },
+    { "lora_dongle_uplink",      benchLoRaDongleUplink },
+    { "crypto_seal_uplink",      benchCryptoSealUplink },
+    { "crypto_seal_ack",         benchCryptoSealAck },
+    { "crypto_roundtrip_uplink", benchCryptoRoundtripUplink },
+    { "dr_update_imu",           benchDeadReckoningImu },
+    { "activity_add_sample",     benchActivitySummarySample },
+    { "log_write",               benchLogWrite },
+    { "log_write_drain",         benchLogWriteDrain },
+    { "geofence_contains_grid",  benchGeofenceContainsGrid },
+    { "geofence_contains_linear", benchGeofenceContainsLinear },
+    { "geofence_update",         benchGeofenceUpdate },
+    { "history_append",          benchHistoryAppend },
+    { "history_query_last",      benchHistoryQueryLast },
+    { "history_query_range",     benchHistoryQueryRange },
+    { "proximity_update",        benchProximityUpdate },
+    { "proximity_radius",        benchProximityRadius },
+    { "proximity_nearest",       benchProximityNearest },
+    { "proximity_pairs",         benchProximityPairs },
+    { "proximity_pairs_bruteforce", benchProximityPairsBruteForce },
+    { "latency_record_uplink",   benchLatencyRecord },
+    { "latency_herd_percentiles", benchLatencyHerdPercentiles },
+};
+
+static void runAll() {
+    setupFixture();
+    Bench::printHeader();
+
+    uint16_t count = sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]);
+    for (uint16_t i = 0; i < count; i++) {
+        Bench::run(BENCH_CASES[i].name, BENCH_CASES[i].op);
+    }
+
+    Bench::printFooter(count);
+}
+
+#ifdef BRAVO_NATIVE
+int main() {
+    // Modules read time through the HAL clock; benchmarks time themselves
+    SimClock clock;
+    setNativeClock(clock);
+    runAll();
+    return 0;
+}
+#else
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+    runAll();
+}
+
+void loop() {
+    delay(1000);
+}
+#endif
+
+#endif // BRAVO_BENCH
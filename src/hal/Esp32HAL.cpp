@@ -0,0 +1,203 @@
+/**
+ * @file Esp32HAL.cpp
+ * @brief ESP32 hardware abstraction implementation
+ */
+
+#ifndef BRAVO_NATIVE
+
+#include "hal/Esp32HAL.h"
+#include <LoRa.h>
+#include <SPI.h>
+
+#if BRAVO_ROLE_COLLAR
+#include <Wire.h>
+#endif
+
+// ---------------------------------------------------------------------------
+// Clock
+// ---------------------------------------------------------------------------
+
+uint32_t Esp32Clock::millis() {
+    return ::millis();
+}
+
+uint32_t Esp32Clock::micros() {
+    return ::micros();
+}
+
+void Esp32Clock::delay(uint32_t ms) {
+    ::delay(ms);
+}
+
+// ---------------------------------------------------------------------------
+// UART
+// ---------------------------------------------------------------------------
+
+Esp32Uart::Esp32Uart(HardwareSerial& serial, int8_t rxPin, int8_t txPin)
+    : serial(serial), rxPin(rxPin), txPin(txPin) {
+}
+
+bool Esp32Uart::begin(uint32_t baud) {
+    serial.begin(baud, SERIAL_8N1, rxPin, txPin);
+    return true;
+}
+
+int Esp32Uart::available() {
+    return serial.available();
+}
+
+int Esp32Uart::read() {
+    return serial.read();
+}
+
+size_t Esp32Uart::write(const uint8_t* data, size_t length) {
+    return serial.write(data, length);
+}
+
+// ---------------------------------------------------------------------------
+// Radio
+// ---------------------------------------------------------------------------
+
+Esp32Radio::Esp32Radio(int8_t sck, int8_t miso, int8_t mosi, int8_t cs, int8_t reset, int8_t dio0)
+    : sck(sck), miso(miso), mosi(mosi), cs(cs), reset(reset), dio0(dio0) {
+}
+
+bool Esp32Radio::begin(long frequency) {
+    SPI.begin(sck, miso, mosi, cs);
+    LoRa.setPins(cs, reset, dio0);
+    return LoRa.begin(frequency);
+}
+
+void Esp32Radio::setFrequency(long frequency) {
+    LoRa.setFrequency(frequency);
+}
+
+void Esp32Radio::setSpreadingFactor(int spreadingFactor) {
+    LoRa.setSpreadingFactor(spreadingFactor);
+}
+
+void Esp32Radio::setSignalBandwidth(long bandwidth) {
+    LoRa.setSignalBandwidth(bandwidth);
+}
+
+void Esp32Radio::setTxPower(int txPower) {
+    LoRa.setTxPower(txPower);
+}
+
+void Esp32Radio::enableCrc() {
+    LoRa.enableCrc();
+}
+
+bool Esp32Radio::beginPacket() {
+    return LoRa.beginPacket();
+}
+
+size_t Esp32Radio::write(const uint8_t* data, size_t length) {
+    return LoRa.write(data, length);
+}
+
+bool Esp32Radio::endPacket() {
+    return LoRa.endPacket();
+}
+
+int Esp32Radio::parsePacket() {
+    return LoRa.parsePacket();
+}
+
+int Esp32Radio::available() {
+    return LoRa.available();
+}
+
+int Esp32Radio::read() {
+    return LoRa.read();
+}
+
+int Esp32Radio::packetRssi() {
+    return LoRa.packetRssi();
+}
+
+float Esp32Radio::packetSnr() {
+    return LoRa.packetSnr();
+}
+
+void Esp32Radio::sleep() {
+    LoRa.sleep();
+}
+
+// ---------------------------------------------------------------------------
+// IMU
+// ---------------------------------------------------------------------------
+
+#if BRAVO_ROLE_COLLAR
+Esp32Imu::Esp32Imu(int8_t sda, int8_t scl) : sda(sda), scl(scl) {
+}
+
+bool Esp32Imu::begin() {
+    Wire.begin(sda, scl);
+    // Fast-mode I2C keeps a full read well under the 5 ms stream period
+    Wire.setClock(400000);
+
+    if (!mpu.begin()) {
+        return false;
+    }
+
+    mpu.setAccelerometerRange(MPU6050_RANGE_8_G);
+    mpu.setGyroRange(MPU6050_RANGE_500_DEG);
+    mpu.setFilterBandwidth(MPU6050_BAND_21_HZ);
+    return true;
+}
+
+bool Esp32Imu::read(IMUReading& reading) {
+    sensors_event_t accel, gyro, temp;
+    if (!mpu.getEvent(&accel, &gyro, &temp)) {
+        return false;
+    }
+
+    reading.accel[0] = accel.acceleration.x;
+    reading.accel[1] = accel.acceleration.y;
+    reading.accel[2] = accel.acceleration.z;
+    reading.gyro[0] = gyro.gyro.x;
+    reading.gyro[1] = gyro.gyro.y;
+    reading.gyro[2] = gyro.gyro.z;
+    reading.temperature = temp.temperature;
+    return true;
+}
+#endif // BRAVO_ROLE_COLLAR
+
+// ---------------------------------------------------------------------------
+// Battery
+// ---------------------------------------------------------------------------
+
+// Nominal reference used when the chip carries no eFuse calibration
+#define ADC_DEFAULT_VREF_MV 1100
+
+Esp32Battery::Esp32Battery(adc1_channel_t channel, float dividerRatio)
+    : channel(channel), dividerRatio(dividerRatio) {
+    memset(&calibration, 0, sizeof(calibration));
+}
+
+bool Esp32Battery::begin() {
+    // 11 dB attenuation covers up to ~2.6 V at the pin with good linearity
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+
+    esp_adc_cal_value_t source = esp_adc_cal_characterize(
+        ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, ADC_DEFAULT_VREF_MV, &calibration);
+
+    static const char* sourceNames[] = { "eFuse Vref", "eFuse two-point", "default Vref" };
+    Serial.printf("Battery ADC calibration: %s\n",
+                  source <= ESP_ADC_CAL_VAL_DEFAULT_VREF ? sourceNames[source] : "unknown");
+    return true;
+}
+
+uint32_t Esp32Battery::readMillivolts() {
+    int raw = adc1_get_raw(channel);
+    if (raw < 0) {
+        return 0;
+    }
+
+    uint32_t pinMillivolts = esp_adc_cal_raw_to_voltage(raw, &calibration);
+    return (uint32_t)(pinMillivolts * dividerRatio + 0.5f);
+}
+
+#endif // BRAVO_NATIVE
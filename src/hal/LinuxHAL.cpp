@@ -0,0 +1,304 @@
+/**
+ * @file LinuxHAL.cpp
+ * @brief Linux host hardware abstraction implementation
+ */
+
+#ifdef BRAVO_NATIVE
+
+#include "hal/LinuxHAL.h"
+#include <algorithm>
+
+// ---------------------------------------------------------------------------
+// Clock
+// ---------------------------------------------------------------------------
+
+static SimClock defaultClock;
+static ClockHAL* activeClock = &defaultClock;
+
+void setNativeClock(ClockHAL& clock) {
+    activeClock = &clock;
+}
+
+// Arduino time functions used by the modules resolve to the active clock
+uint32_t millis() {
+    return activeClock->millis();
+}
+
+uint32_t micros() {
+    return activeClock->micros();
+}
+
+void delay(uint32_t ms) {
+    activeClock->delay(ms);
+}
+
+SimClock::SimClock() : nowUs(0) {
+}
+
+uint32_t SimClock::millis() {
+    return nowUs / 1000;
+}
+
+uint32_t SimClock::micros() {
+    return (uint32_t)nowUs;
+}
+
+void SimClock::delay(uint32_t ms) {
+    advance((uint64_t)ms * 1000);
+}
+
+void SimClock::advance(uint64_t us) {
+    nowUs += us;
+}
+
+uint64_t SimClock::getTimeUs() {
+    return nowUs;
+}
+
+// ---------------------------------------------------------------------------
+// UART
+// ---------------------------------------------------------------------------
+
+FileUart::FileUart(const char* rxPath, const char* txPath)
+    : rxPath(rxPath), txPath(txPath), rxFile(nullptr), txFile(nullptr),
+      baud(0), startUs(0), bytesRead(0), peeked(-1) {
+}
+
+FileUart::~FileUart() {
+    if (rxFile) {
+        fclose(rxFile);
+    }
+    if (txFile) {
+        fclose(txFile);
+    }
+}
+
+bool FileUart::begin(uint32_t baudRate) {
+    baud = baudRate;
+    startUs = micros();
+    bytesRead = 0;
+
+    if (rxPath && !rxFile) {
+        rxFile = fopen(rxPath, "rb");
+        if (!rxFile) {
+            return false;
+        }
+    }
+
+    if (txPath && !txFile) {
+        txFile = fopen(txPath, "wb");
+    }
+
+    return true;
+}
+
+int FileUart::available() {
+    if (!rxFile) {
+        return 0;
+    }
+
+    // Bytes a real port would have delivered by now (start + 8 data + stop)
+    uint64_t arrived = (uint64_t)(uint32_t)(micros() - startUs) * baud / 10 / 1000000;
+    if (arrived <= bytesRead) {
+        return 0;
+    }
+
+    if (peeked < 0) {
+        peeked = fgetc(rxFile);
+        if (peeked == EOF) {
+            peeked = -1;
+            return 0;
+        }
+    }
+
+    return (int)std::min<uint64_t>(arrived - bytesRead, INT16_MAX);
+}
+
+int FileUart::read() {
+    if (available() == 0) {
+        return -1;
+    }
+
+    int value = peeked;
+    peeked = -1;
+    bytesRead++;
+    return value;
+}
+
+size_t FileUart::write(const uint8_t* data, size_t length) {
+    if (txFile) {
+        return fwrite(data, 1, length, txFile);
+    }
+    return length;
+}
+
+// ---------------------------------------------------------------------------
+// Radio
+// ---------------------------------------------------------------------------
+
+void RadioChannel::attach(MemoryRadio* radio) {
+    radios.push_back(radio);
+}
+
+void RadioChannel::detach(MemoryRadio* radio) {
+    radios.erase(std::remove(radios.begin(), radios.end(), radio), radios.end());
+}
+
+void RadioChannel::transmit(MemoryRadio* sender, const std::vector<uint8_t>& packet) {
+    for (size_t i = 0; i < radios.size(); i++) {
+        if (radios[i] != sender && radios[i]->canHear(*sender)) {
+            radios[i]->deliver(packet);
+        }
+    }
+}
+
+MemoryRadio::MemoryRadio(RadioChannel& channel)
+    : channel(channel), frequency(0), spreadingFactor(7), bandwidth(125000),
+      receiving(false), rxPosition(0), rssi(-80), snr(9.0f) {
+    channel.attach(this);
+}
+
+MemoryRadio::~MemoryRadio() {
+    channel.detach(this);
+}
+
+bool MemoryRadio::begin(long freq) {
+    frequency = freq;
+    return true;
+}
+
+void MemoryRadio::setFrequency(long freq) {
+    frequency = freq;
+}
+
+void MemoryRadio::setSpreadingFactor(int sf) {
+    spreadingFactor = sf;
+}
+
+void MemoryRadio::setSignalBandwidth(long bw) {
+    bandwidth = bw;
+}
+
+void MemoryRadio::setTxPower(int txPower) {
+}
+
+void MemoryRadio::enableCrc() {
+}
+
+bool MemoryRadio::beginPacket() {
+    receiving = false;
+    txPacket.clear();
+    return true;
+}
+
+size_t MemoryRadio::write(const uint8_t* data, size_t length) {
+    size_t room = SIM_RADIO_MAX_PACKET - txPacket.size();
+    length = std::min(length, room);
+    txPacket.insert(txPacket.end(), data, data + length);
+    return length;
+}
+
+bool MemoryRadio::endPacket() {
+    channel.transmit(this, txPacket);
+    txPacket.clear();
+    return true;
+}
+
+int MemoryRadio::parsePacket() {
+    receiving = true;
+
+    if (rxQueue.empty()) {
+        return 0;
+    }
+
+    rxPacket = rxQueue.front();
+    rxQueue.pop_front();
+    rxPosition = 0;
+    return rxPacket.size();
+}
+
+int MemoryRadio::available() {
+    return rxPacket.size() - rxPosition;
+}
+
+int MemoryRadio::read() {
+    if (rxPosition >= rxPacket.size()) {
+        return -1;
+    }
+    return rxPacket[rxPosition++];
+}
+
+int MemoryRadio::packetRssi() {
+    return rssi;
+}
+
+float MemoryRadio::packetSnr() {
+    return snr;
+}
+
+void MemoryRadio::sleep() {
+    receiving = false;
+}
+
+void MemoryRadio::setLinkQuality(int packetRssi, float packetSnr) {
+    rssi = packetRssi;
+    snr = packetSnr;
+}
+
+bool MemoryRadio::canHear(const MemoryRadio& sender) {
+    return receiving && frequency == sender.frequency &&
+           spreadingFactor == sender.spreadingFactor &&
+           bandwidth == sender.bandwidth;
+}
+
+void MemoryRadio::deliver(const std::vector<uint8_t>& packet) {
+    if (rxQueue.size() >= SIM_RADIO_RX_QUEUE) {
+        rxQueue.pop_front();
+    }
+    rxQueue.push_back(packet);
+}
+
+// ---------------------------------------------------------------------------
+// IMU
+// ---------------------------------------------------------------------------
+
+SimImu::SimImu() {
+    // At rest, level
+    memset(&current, 0, sizeof(current));
+    current.accel[2] = 9.81f;
+    current.temperature = 25.0f;
+}
+
+bool SimImu::begin() {
+    return true;
+}
+
+bool SimImu::read(IMUReading& reading) {
+    reading = current;
+    return true;
+}
+
+void SimImu::setReading(const IMUReading& reading) {
+    current = reading;
+}
+
+// ---------------------------------------------------------------------------
+// Battery
+// ---------------------------------------------------------------------------
+
+SimBattery::SimBattery() : millivolts(4000) {
+}
+
+bool SimBattery::begin() {
+    return true;
+}
+
+uint32_t SimBattery::readMillivolts() {
+    return millivolts;
+}
+
+void SimBattery::setMillivolts(uint32_t value) {
+    millivolts = value;
+}
+
+#endif // BRAVO_NATIVE
@@ -0,0 +1,109 @@
+/**
+ * @file RecordHAL.cpp
+ * @brief Recording taps and replay sources implementation
+ */
+
+#include "hal/RecordHAL.h"
+
+// ---------------------------------------------------------------------------
+// Recording taps
+// ---------------------------------------------------------------------------
+
+RecordingUart::RecordingUart(UartHAL& inner, SensorRecorder& recorder)
+    : inner(inner), recorder(recorder) {
+}
+
+bool RecordingUart::begin(uint32_t baud) {
+    return inner.begin(baud);
+}
+
+int RecordingUart::available() {
+    int count = inner.available();
+    if (count <= 0) {
+        // GPS::update() drains the port, so an empty port ends the burst
+        recorder.endUartBurst();
+    }
+    return count;
+}
+
+int RecordingUart::read() {
+    int value = inner.read();
+    if (value >= 0) {
+        recorder.recordUartByte((uint8_t)value);
+    }
+    return value;
+}
+
+size_t RecordingUart::write(const uint8_t* data, size_t length) {
+    return inner.write(data, length);
+}
+
+RecordingImu::RecordingImu(ImuHAL& inner, SensorRecorder& recorder)
+    : inner(inner), recorder(recorder) {
+}
+
+bool RecordingImu::begin() {
+    return inner.begin();
+}
+
+bool RecordingImu::read(IMUReading& reading) {
+    if (!inner.read(reading)) {
+        recorder.recordImuFailure();
+        return false;
+    }
+
+    recorder.recordImu(reading);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Replay sources
+// ---------------------------------------------------------------------------
+
+ReplayUart::ReplayUart() : data(nullptr), length(0), position(0) {
+}
+
+bool ReplayUart::begin(uint32_t baud) {
+    return true;
+}
+
+int ReplayUart::available() {
+    return length - position;
+}
+
+int ReplayUart::read() {
+    return position < length ? data[position++] : -1;
+}
+
+size_t ReplayUart::write(const uint8_t* data, size_t length) {
+    // Receiver configuration commands are not part of the recording
+    return length;
+}
+
+void ReplayUart::feed(const uint8_t* bytes, size_t count) {
+    data = bytes;
+    length = count;
+    position = 0;
+}
+
+ReplayImu::ReplayImu() : ok(false) {
+    memset(&current, 0, sizeof(current));
+}
+
+bool ReplayImu::begin() {
+    return true;
+}
+
+bool ReplayImu::read(IMUReading& reading) {
+    if (!ok) {
+        return false;
+    }
+
+    reading = current;
+    return true;
+}
+
+void ReplayImu::setReading(const IMUReading& reading, bool readOk) {
+    current = reading;
+    ok = readOk;
+}
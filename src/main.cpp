@@ -4,59 +4,599 @@
  * 
  * This is the main entry point for the ESP32 firmware running on both collars and dongle.
  * It integrates LoRa communication, GPS tracking, IMU motion sensing, BLE configuration,
- * OTA updates, and JSON telemetry formatting.
+ * OTA updates, and JSON telemetry formatting. The role is fixed at compile time
+ * (see Role.h): each build only holds the modules and handlers its role uses.
  * 
  * @author B.R.A.V.O. Team
  * @date 2025
  */
 
 #include <Arduino.h>
+#include "Role.h"
 #include "LoRaComm.h"
 #include "GPS.h"
 #include "BLEConfig.h"
+#include "Telemetry.h"
+#include "ConfigStore.h"
+#include "Scheduler.h"
+#include "Downlink.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "Log.h"
+#include "MemoryMonitor.h"
+#include "BatteryMonitor.h"
+#include "Relay.h"
+#include "FrameCrypto.h"
+#include "TimeService.h"
+#include "hal/Esp32HAL.h"
+
+#if BRAVO_ROLE_COLLAR
 #include "IMU.h"
+#include "DataLog.h"
+#include "IMUStream.h"
+#include "Geofence.h"
+#include "TrackFilter.h"
+#include "DeadReckoning.h"
+#include "ActivitySummary.h"
+#include "SensorRecorder.h"
+#include "SensorReplay.h"
+#include "hal/RecordHAL.h"
+#else
+#include "TimeSeriesStore.h"
+#include "ProximityIndex.h"
+#include "LatencyTracker.h"
+#endif
+
+#if BRAVO_OTA
 #include "OTA.h"
-#include "Telemetry.h"
+#endif
 
-// Device configuration
+// Device configuration (the role is BRAVO_ROLE_COLLAR, see Role.h)
 #define DEVICE_ID           "BRAVO_001"
-#define DEVICE_TYPE_COLLAR  true  // Set to false for dongle
 
-// Timing intervals (milliseconds)
-#define GPS_UPDATE_INTERVAL         1000   // Update GPS every 1 second
+// Timing intervals (milliseconds); GPS and telemetry defaults come from
+// BLEConfigData and can be changed at runtime
 #define IMU_UPDATE_INTERVAL         100    // Update IMU every 100ms
-#define TELEMETRY_SEND_INTERVAL     10000  // Send telemetry every 10 seconds
 #define STATUS_PRINT_INTERVAL       5000   // Print status every 5 seconds
+#define STATUS_REPORT_INTERVAL      300000 // Send timing/energy status every 5 minutes
+#define BATTERY_SAMPLE_INTERVAL     10000  // Sample the battery every 10 seconds
+#define PROXIMITY_SWEEP_INTERVAL    60000  // Dongle: check herd cohesion every minute
+#define TIME_LOG_INTERVAL_MS        600000 // Pin the data log to UTC every 10 minutes
+#define TIME_TX_SLOT_MS             500    // Uplink slot: one frame on air plus clock error
+
+// Collar: track points kept between telemetry reports, each sent as its own uplink
+#define TRACK_UPLINK_POINTS         8
+
+// Dongle: a collar with no other collar this close has left the herd
+#define HERD_COHESION_DISTANCE_M    150
+#define BLE_MOTION_WAKE_HOLDOFF     300000 // Motion re-opens fast BLE advertising at most every 5 minutes
+
+// Acceleration away from 1 g (m/s²) that counts as motion
+#define IMU_MOTION_THRESHOLD        1.0
+
+// Sensor recording on flash, and records replayed between yields
+#define RECORDING_PATH              "/sensors.rec"
+#define REPLAY_YIELD_RECORDS        64
+
+// Trace budgets (microseconds); the loop budget follows the IMU sample period
+#define TRACE_BUDGET_GPS_US         2000
+#define TRACE_BUDGET_IMU_US         3000
+#define TRACE_BUDGET_TELEMETRY_US   50000
+#define TRACE_BUDGET_LORA_RX_US     20000
+#define TRACE_BUDGET_BLE_US         5000
+#define TRACE_BUDGET_FUSION_US      500
+
+// BLE wake button (BOOT button on ESP32-DevKitC)
+#define BLE_WAKE_BUTTON_PIN         0
+
+// Hardware
+Esp32Radio loraRadio(LORA_SCK, LORA_MISO, LORA_MOSI, LORA_CS, LORA_RST, LORA_DIO0);
+Esp32Uart gpsUart(Serial2, GPS_RX_PIN, GPS_TX_PIN);
+Esp32Battery batterySensor(BATTERY_ADC_CHANNEL, BATTERY_DIVIDER_RATIO);
+
+#if BRAVO_ROLE_COLLAR
+Esp32Imu imuSensor(IMU_SDA_PIN, IMU_SCL_PIN);
+
+// Sensor recording; the taps pass reads straight through when not recording
+SensorRecorder recorder;
+RecordFile recordingFile;
+SerialRecordSink serialRecordSink(Serial);
+RecordingUart gpsTap(gpsUart, recorder);
+RecordingImu imuTap(imuSensor, recorder);
+#endif
 
 // Module instances
-LoRaComm lora;
-GPS gps;
+LoRaComm lora(loraRadio);
 BLEConfig bleConfig;
-IMU imu;
-OTA ota;
 Telemetry telemetry;
+ConfigStore configStore;
+Scheduler scheduler;
+Profiler profiler;
+BatteryMonitor battery(batterySensor);
+Relay relay(DEVICE_ID, !DEVICE_TYPE_COLLAR);  // Multi-hop uplinks (see Relay.h)
+FrameCrypto crypto(DEVICE_ID, !DEVICE_TYPE_COLLAR);  // LoRa frame sealing (see FrameCrypto.h)
+TimeService timeService;           // GPS-disciplined absolute time
+#if BRAVO_OTA
+OTA ota;
+#endif
+
+#if BRAVO_ROLE_COLLAR
+GPS gps(gpsTap);
+IMU imu(imuTap);
+DataLog dataLog;
+IMUStream imuStream;
+DownlinkHandler downlinkHandler(DEVICE_ID);  // Applies received commands
+Geofence geofence;
+TrackFilter track;
+DeadReckoning deadReckoning;
+ActivitySummary activitySummary;
+#else
+GPS gps(gpsUart);                  // Absolute time for the latency stages
+DownlinkQueue downlinkQueue;       // Commands waiting for each collar
+TimeSeriesStore positionHistory;   // Positions received from each collar
+ProximityIndex proximity;          // Latest position of each collar
+LatencyTracker latencyTracker;     // Sample-to-dongle latency of each collar
+#endif
 
+// Scheduled tasks
+enum ScheduledTask {
+    TASK_GPS,
+    TASK_IMU,
+    TASK_TELEMETRY,
+    TASK_STATUS,
+    TASK_STATUS_REPORT,
+    TASK_BATTERY,
+    TASK_PROXIMITY,
+    TASK_RELAY_BEACON
+};
+
+// Time sync logging (and data log time records, see DataLogTimeRecord)
+bool timeLogged = false;
+uint32_t timeLoggedSteps = 0;
+unsigned long lastTimeLog = 0;
+
+// Status report requested over BLE
+bool statusReportRequested = false;
+
+// Plaintext frames dropped because a LoRa key is loaded
+uint32_t plaintextDropped = 0;
+
+// Uplinks dropped for not fitting a frame once sealed and relay-wrapped
+uint32_t uplinkOversize = 0;
+
+// JSON packets for BLE and serial (too big for the loop stack)
+char jsonBuffer[TELEMETRY_JSON_MAX];
+
+// Trace dump over BLE in progress
+bool traceDumpActive = false;
+uint32_t traceDumpCursor = 0;
+
+#if BRAVO_ROLE_COLLAR
 // Timing variables
-unsigned long lastGPSUpdate = 0;
-unsigned long lastIMUUpdate = 0;
-unsigned long lastTelemetrySend = 0;
-unsigned long lastStatusPrint = 0;
+unsigned long lastMotionWake = 0;
+
+// Downlink state
+BLEConfigData downlinkConfig;       // Config being built from a downlink
+bool downlinkConfigPending = false; // Apply downlinkConfig after the ack
+
+// IMU sample read this pass, not yet fused
+bool imuSampleReady = false;
+
+// Fixes kept by the track filter, not yet sent (oldest first)
+GPSData trackPoints[TRACK_UPLINK_POINTS];
+uint8_t trackPointFirst = 0;
+uint8_t trackPointCount = 0;
+uint32_t trackPointsLost = 0;       // Overwritten before they were sent
+
+// Queue and air time of the last uplink, reported in the next one
+uint32_t uplinkQueueMs = 0;
+uint32_t uplinkAirMs = 0;
+
+// Recording mode requested over BLE (-1 = none pending)
+int8_t recordModeRequested = -1;
+
+// Encoded fences on their way to or from NVS (too big for the loop stack)
+uint8_t geofenceBlob[GEOFENCE_MAX_ENCODED_SIZE];
+#else
+// Downlink state
+BLEConfigData herdConfig;           // Config the herd is moving to
+bool herdPhyChange = false;         // Follow the herd's PHY once all ack
+bool herdReportPending = false;     // Report herd latency once all ack
+
+// Position history query over BLE (dongle)
+bool historyQueryPending = false;
+char historyQueryName[32];
+uint8_t historyQueryMode = HISTORY_QUERY_LAST;
+uint32_t historyQueryCount = 0;
+uint64_t historyQueryRange[2];
+TimeSeriesPoint historyPoints[HISTORY_MAX_POINTS];
+uint8_t historyCount = 0;
+uint8_t historyCursor = 0;
+bool historyReplyActive = false;
+
+// Proximity query over BLE and the last cohesion sweep (dongle)
+bool proximityQueryPending = false;
+uint8_t proximityQuery[11];
+uint32_t proximityPairs = 0;
+uint16_t proximityIsolated = 0;
+uint32_t proximitySweepUs = 0;
+
+// Latency report over BLE (dongle): next collar, -1 for the herd row
+bool latencyQueryPending = false;
+bool latencyReplyActive = false;
+int16_t latencyCursor = 0;
+#endif
+
+/**
+ * @brief Push configuration to the scheduler, LoRa PHY and GPS
+ * @param config Configuration to apply
+ */
+void applyConfig(const BLEConfigData& config) {
+    // Power modes stretch the reporting intervals; a low battery can push
+    // the collar into a thriftier mode than configured, never the reverse
+    static const uint8_t powerModeScale[] = { 1, 3, 10 };
+    uint8_t powerMode = max(config.powerMode, (uint8_t)battery.getTier());
+    uint32_t scale = powerModeScale[powerMode];
+
+    scheduler.setInterval(TASK_GPS, config.gpsInterval * scale);
+    scheduler.setInterval(TASK_TELEMETRY, config.telemetryInterval * scale);
+
+    if (powerMode == POWER_MODE_SURVIVAL) {
+        bleConfig.stopAdvertising();
+    } else if (!bleConfig.isAdvertisingEnabled()) {
+        bleConfig.startAdvertising();
+    }
+
+    long bandwidth = config.loraBandwidth == 62 ? 62500L : config.loraBandwidth * 1000L;
+    lora.setPHY(config.loraFrequency * 1000000L, config.loraSpreadingFactor,
+                bandwidth, config.loraPower);
+
+    // The receiver only needs to produce fixes as often as we use them
+    gps.setUpdateRate(min(config.gpsInterval * scale, (uint32_t)UINT16_MAX));
+#if BRAVO_ROLE_COLLAR
+    track.setTolerance(config.trackTolerance);
+#endif
+
+    // Collars forward, the dongle beacons; relayed frames are unwrapped regardless
+    relay.setEnabled(config.relayMode);
+    relay.setPHY(config.loraSpreadingFactor, bandwidth);
+
+    LOG_INFO(LOG_CONFIG_APPLIED, config.gpsInterval, config.telemetryInterval, powerMode,
+             config.trackTolerance);
+    LOG_INFO(LOG_CONFIG_PHY, config.loraFrequency, config.loraSpreadingFactor,
+             config.loraBandwidth, config.loraPower);
+}
+
+/**
+ * @brief Apply and persist a configuration written by a BLE client
+ * @param config New configuration
+ */
+void onConfigChanged(const BLEConfigData& config) {
+    applyConfig(config);
+    if (!configStore.save(config)) {
+        LOG_ERROR(LOG_CONFIG_SAVE_FAILED);
+    }
+}
+
+/**
+ * @brief Apply one downlink command to a configuration
+ * @param config Configuration to modify
+ * @param opcode Command opcode (DL_CMD_*)
+ * @param payload Command payload
+ * @param length Payload length
+ * @return DL_STATUS_* result
+ */
+uint8_t applyDownlinkCommand(BLEConfigData& config, uint8_t opcode,
+                             const uint8_t* payload, uint8_t length) {
+    switch (opcode) {
+        case DL_CMD_CONFIG:
+            return ConfigStore::decode(payload, length, config) ?
+                   DL_STATUS_OK : DL_STATUS_REJECTED;
+
+        case DL_CMD_PHY_PROFILE: {
+            static const uint8_t profileSF[] = { 7, 9, 12 };
+            if (length != 1 || payload[0] > PHY_PROFILE_LONG_RANGE) {
+                return DL_STATUS_REJECTED;
+            }
+            config.loraSpreadingFactor = profileSF[payload[0]];
+            config.loraBandwidth = 125;
+            return DL_STATUS_OK;
+        }
+
+        case DL_CMD_POWER_MODE:
+            if (length != 1 || payload[0] > POWER_MODE_SURVIVAL) {
+                return DL_STATUS_REJECTED;
+            }
+            config.powerMode = payload[0];
+            return DL_STATUS_OK;
+
+        default:
+            // Geofence updates go to the geofence engine, not the config
+            return DL_STATUS_UNSUPPORTED;
+    }
+}
+
+#if BRAVO_ROLE_COLLAR
+/**
+ * @brief Collar: apply a geofence command, persisting the fences once final
+ * @param payload GEOFENCE_OP_* command
+ * @param length Command length
+ * @return true if applied, false otherwise
+ */
+bool applyGeofenceCommand(const uint8_t* payload, size_t length) {
+    if (!geofence.applyCommand(payload, length)) {
+        LOG_WARN(LOG_GEOFENCE_REJECTED);
+        return false;
+    }
+
+    // Fences being defined are only stored once committed
+    if (payload[0] == GEOFENCE_OP_CLEAR || payload[0] == GEOFENCE_OP_COMMIT) {
+        size_t blobLength = geofence.encode(geofenceBlob, sizeof(geofenceBlob));
+        if (!configStore.saveBlob(GEOFENCE_NVS_KEY, geofenceBlob, blobLength)) {
+            LOG_ERROR(LOG_GEOFENCE_SAVE_FAILED);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Collar: handle a command from a received downlink frame
+ * @param opcode Command opcode (DL_CMD_*)
+ * @param payload Command payload
+ * @param length Payload length
+ * @return DL_STATUS_* result
+ */
+uint8_t onDownlinkCommand(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    if (opcode == DL_CMD_GEOFENCE) {
+        uint8_t status = applyGeofenceCommand(payload, length) ?
+                         DL_STATUS_OK : DL_STATUS_REJECTED;
+        LOG_INFO(LOG_DOWNLINK_STATUS, opcode, status);
+        return status;
+    }
+
+    if (!downlinkConfigPending) {
+        downlinkConfig = bleConfig.getConfig();
+    }
 
-// Battery monitoring (placeholder - implement based on hardware)
-uint8_t batteryLevel = 100;
+    uint8_t status = applyDownlinkCommand(downlinkConfig, opcode, payload, length);
+    if (status == DL_STATUS_OK) {
+        // Applied once the ack is out, so it still goes on the old PHY
+        downlinkConfigPending = true;
+    }
 
+    LOG_INFO(LOG_DOWNLINK_STATUS, opcode, status);
+    return status;
+}
+#else
 /**
- * @brief Get battery level percentage
- * @return Battery level 0-100
+ * @brief Queue a position history query for the loop
+ * @param payload u8 name length, name, u8 mode, u32 count or u32 start, end
+ * @param length Payload length
  */
-uint8_t getBatteryLevel() {
-    // TODO: Implement actual battery monitoring via ADC
-    // This is a placeholder that simulates battery drain
-    static uint8_t battery = 100;
-    if (battery > 0 && millis() % 60000 == 0) {
-        battery--;
+void requestHistory(const uint8_t* payload, size_t length) {
+    uint8_t nameLength = payload[0];
+    if (nameLength >= sizeof(historyQueryName) || (size_t)nameLength + 6 > length) {
+        return;
+    }
+
+    const uint8_t* query = &payload[1 + nameLength];
+    uint8_t mode = query[0];
+    size_t argsLength = mode == HISTORY_QUERY_RANGE ? sizeof(historyQueryRange)
+                                                    : sizeof(historyQueryCount);
+    if ((size_t)nameLength + 2 + argsLength > length) {
+        return;
+    }
+
+    memcpy(historyQueryName, &payload[1], nameLength);
+    historyQueryName[nameLength] = '\0';
+    historyQueryMode = mode;
+    if (mode == HISTORY_QUERY_RANGE) {
+        memcpy(historyQueryRange, &query[1], argsLength);
+    } else {
+        memcpy(&historyQueryCount, &query[1], argsLength);
+    }
+    historyQueryPending = true;
+}
+#endif
+
+/**
+ * @brief Handle a command written over BLE
+ * @param data Command bytes
+ * @param length Command length
+ */
+void onBLECommand(const uint8_t* data, size_t length) {
+    if (length >= 1 && data[0] == BLE_CMD_STATUS) {
+        statusReportRequested = true;
+        return;
+    }
+
+#if BRAVO_TRACE
+    if (length >= 1 && data[0] == BLE_CMD_TRACE) {
+        traceDumpCursor = trace.startDump();
+        traceDumpActive = true;
+        return;
+    }
+#endif
+
+#if BRAVO_ROLE_COLLAR
+    if (length >= 2 && data[0] == BLE_CMD_RECORD) {
+        recordModeRequested = data[1];
+        return;
+    }
+
+    if (length >= 2 && data[0] == BLE_CMD_GEOFENCE) {
+        applyGeofenceCommand(&data[1], length - 1);
+        return;
+    }
+#else
+    if (length >= 1 + sizeof(proximityQuery) && data[0] == BLE_CMD_PROXIMITY) {
+        memcpy(proximityQuery, &data[1], sizeof(proximityQuery));
+        proximityQueryPending = true;
+        return;
     }
-    return battery;
+
+    if (length >= 1 && data[0] == BLE_CMD_LATENCY) {
+        latencyQueryPending = true;
+        return;
+    }
+
+    if (length >= 2 && data[0] == BLE_CMD_HISTORY) {
+        requestHistory(&data[1], length - 1);
+        return;
+    }
+
+    // Remaining commands queue downlinks
+    if (length < 2 || data[0] != BLE_CMD_DOWNLINK) {
+        return;
+    }
+
+    // u8 name length, name ("*" = whole herd), u8 opcode, u8 length, payload
+    uint8_t nameLength = data[1];
+    if ((size_t)nameLength + 4 > length || nameLength >= 32) {
+        return;
+    }
+
+    char name[32];
+    memcpy(name, &data[2], nameLength);
+    name[nameLength] = '\0';
+
+    const uint8_t* command = &data[2 + nameLength];
+    uint8_t opcode = command[0];
+    uint8_t payloadLength = command[1];
+    if ((size_t)nameLength + 4 + payloadLength > length) {
+        return;
+    }
+
+    if (strcmp(name, "*") == 0) {
+        // The dongle must follow a herd-wide PHY change, but only once
+        // every collar has moved
+        herdConfig = bleConfig.getConfig();
+        applyDownlinkCommand(herdConfig, opcode, &command[2], payloadLength);
+        BLEConfigData current = bleConfig.getConfig();
+        herdPhyChange = herdConfig.loraSpreadingFactor != current.loraSpreadingFactor ||
+                        herdConfig.loraBandwidth != current.loraBandwidth ||
+                        herdConfig.loraFrequency != current.loraFrequency;
+
+        uint16_t count = downlinkQueue.enqueueAll(opcode, &command[2], payloadLength);
+        herdReportPending = count > 0;
+        LOG_INFO(LOG_DOWNLINK_QUEUED_ALL, opcode, count);
+    } else if (downlinkQueue.enqueue(Downlink::hashDeviceId(name), opcode,
+                                     &command[2], payloadLength)) {
+        LOG_INFO(LOG_DOWNLINK_QUEUED, opcode, name);
+    }
+#endif
+}
+
+/**
+ * @brief Send a binary frame, sealed when a LoRa key is loaded
+ * @param data Frame bytes
+ * @param length Frame length
+ * @param collarId Dongle: target collar
+ * @return true if sent, false otherwise
+ */
+bool sendFrame(const uint8_t* data, size_t length, uint32_t collarId = 0) {
+    if (!crypto.isActive()) {
+        return lora.sendData(data, length);
+    }
+    uint8_t sealed[CRYPTO_MAX_FRAME];
+    size_t sealedLength = crypto.seal(data, length, sealed, sizeof(sealed), collarId);
+    return sealedLength > 0 && lora.sendData(sealed, sealedLength);
+}
+
+/**
+ * @brief Send an uplink, sealed when a LoRa key is loaded and wrapped for
+ * forwarding in relay mode
+ * @param payload Uplink bytes
+ * @param length Uplink length
+ * @return true if sent, false otherwise
+ */
+bool sendUplink(const uint8_t* payload, size_t length) {
+    // Sized for the worst case, so whether it fits does not depend on the
+    // key or relay mode
+    if (length > TELEMETRY_MAX_UPLINK) {
+        uplinkOversize++;
+        LOG_WARN(LOG_LORA_UPLINK_OVERSIZE, length, TELEMETRY_MAX_UPLINK);
+        return false;
+    }
+    if constexpr (!DEVICE_TYPE_COLLAR) {
+        return sendFrame(payload, length);
+    }
+    if (!relay.isEnabled()) {
+        return sendFrame(payload, length);
+    }
+
+    // Relays forward the sealed frame as it is: only the dongle opens it
+    uint8_t sealed[CRYPTO_MAX_FRAME];
+    if (crypto.isActive()) {
+        length = crypto.seal(payload, length, sealed, sizeof(sealed));
+        if (length == 0) {
+            return false;
+        }
+        payload = sealed;
+    }
+
+    uint8_t frame[RELAY_MAX_FRAME];
+    size_t frameLength = relay.wrap(payload, length, frame, sizeof(frame));
+    return frameLength > 0 && lora.sendData(frame, frameLength);
+}
+
+/**
+ * @brief Send a JSON uplink
+ * @param json Uplink text
+ * @param length Text length (0 if it did not fit its buffer)
+ * @return true if sent, false otherwise
+ */
+bool sendUplink(const char* json, size_t length) {
+    return length > 0 && sendUplink((const uint8_t*)json, length);
+}
+
+/**
+ * @brief Handle a binary downlink or ack frame
+ * @param frame Frame bytes
+ * @param length Frame length
+ */
+void handleFrame(const uint8_t* frame, size_t length) {
+#if BRAVO_ROLE_COLLAR
+    uint8_t ack[DOWNLINK_MAX_FRAME];
+    size_t ackLength = downlinkHandler.handleFrame(frame, length, ack);
+    if (ackLength == 0) {
+        return;
+    }
+
+    sendFrame(ack, ackLength);
+
+    if (downlinkConfigPending) {
+        downlinkConfigPending = false;
+        bleConfig.setConfig(downlinkConfig);
+        onConfigChanged(downlinkConfig);
+    }
+#else
+    if (!downlinkQueue.onAck(frame, length)) {
+        return;
+    }
+
+    DownlinkCampaignStats campaign = downlinkQueue.getCampaignStats();
+    if (herdReportPending && !campaign.active && campaign.acked == campaign.targets) {
+        herdReportPending = false;
+        LOG_INFO(LOG_HERD_UPDATE, campaign.acked, campaign.targets, campaign.herdLatencyMs);
+
+        char status[96];
+        snprintf(status, sizeof(status),
+                 "{\"type\":\"downlink\",\"acked\":%u,\"targets\":%u,\"herd_ms\":%u}",
+                 campaign.acked, campaign.targets, campaign.herdLatencyMs);
+        bleConfig.sendStatus(status);
+
+        if (herdPhyChange) {
+            herdPhyChange = false;
+            BLEConfigData config = bleConfig.getConfig();
+            config.loraFrequency = herdConfig.loraFrequency;
+            config.loraSpreadingFactor = herdConfig.loraSpreadingFactor;
+            config.loraBandwidth = herdConfig.loraBandwidth;
+            bleConfig.setConfig(config);
+            onConfigChanged(config);
+        }
+    }
+#endif
 }
 
 /**
@@ -85,6 +625,7 @@ void initializeModules() {
         Serial.println("✗ GPS failed");
     }
 
+#if BRAVO_ROLE_COLLAR
     // Initialize IMU
     Serial.println("\nInitializing IMU...");
     if (imu.begin()) {
@@ -92,189 +633,1437 @@ void initializeModules() {
     } else {
         Serial.println("✗ IMU failed");
     }
+#endif
+
+    // Initialize battery monitor
+    Serial.println("\nInitializing battery monitor...");
+    if (battery.begin()) {
+        Serial.println("✓ Battery monitor ready");
+    } else {
+        Serial.println("✗ Battery monitor failed");
+    }
+
+#if !BRAVO_ROLE_COLLAR
+    // Dongle: history and latest position of every collar heard
+    Serial.println("\nInitializing herd tracking...");
+    if (positionHistory.begin() && proximity.begin() && latencyTracker.begin()) {
+        Serial.println("✓ Herd tracking ready");
+    } else {
+        Serial.println("✗ Herd tracking failed");
+    }
+#endif
 
-    // Initialize BLE
+    // Initialize BLE; bulk download and live IMU streaming are collar services
     Serial.println("\nInitializing BLE...");
     if (bleConfig.begin(DEVICE_ID)) {
+#if BRAVO_ROLE_COLLAR
+        bleConfig.setBulkSource(&dataLog);
+        bleConfig.setStreamSource(&imuStream);
+#endif
         Serial.println("✓ BLE ready");
     } else {
         Serial.println("✗ BLE failed");
     }
 
-    // Initialize OTA (optional - uncomment to enable WiFi OTA)
-    // Serial.println("\nInitializing OTA...");
-    // if (ota.connectWiFi("YourSSID", "YourPassword")) {
-    //     ota.begin(DEVICE_ID);
-    //     Serial.println("✓ OTA ready");
-    // } else {
-    //     Serial.println("✗ OTA WiFi connection failed");
-    // }
+#if BRAVO_OTA
+    // Initialize OTA (build with BRAVO_OTA=1 and the OTA_WIFI_* settings)
+    Serial.println("\nInitializing OTA...");
+    if (ota.connectWiFi(OTA_WIFI_SSID, OTA_WIFI_PASSWORD)) {
+        ota.begin(DEVICE_ID);
+        Serial.println("✓ OTA ready");
+    } else {
+        Serial.println("✗ OTA WiFi connection failed");
+    }
+#endif
 
     Serial.println("\n=== Initialization Complete ===\n");
 }
 
+#if BRAVO_ROLE_COLLAR
+/**
+ * @brief Queue a fix kept by the track filter for the next telemetry report
+ *
+ * When more are kept than one report holds, the oldest is overwritten and
+ * counted, as the track sent then exceeds the tolerance there.
+ *
+ * @param kept Kept fix
+ */
+void queueTrackPoint(const GPSData& kept) {
+    if (trackPointCount == TRACK_UPLINK_POINTS) {
+        trackPointFirst = (trackPointFirst + 1) % TRACK_UPLINK_POINTS;
+        trackPointCount--;
+        trackPointsLost++;
+    }
+    trackPoints[(trackPointFirst + trackPointCount) % TRACK_UPLINK_POINTS] = kept;
+    trackPointCount++;
+}
+
+/**
+ * @brief Send one activity uplink, and its JSON form to BLE if connected
+ * @param position Track point, or nullptr for a heartbeat
+ * @param summary Activity summary (empty on all but a report's last uplink)
+ * @param estimate Dead-reckoned position, or nullptr
+ * @return true if it went out over LoRa
+ */
+bool sendActivityUplink(const GPSData* position, const ActivitySummaryData& summary,
+                        const DeadReckoningEstimate* estimate) {
+    // With a position, the fix's age is the sample stage of the latency
+    // accounting
+    uint32_t enqueueUs = micros();
+    LatencyReport latency;
+    latency.sampleMs = position ? millis() - position->timestamp : 0;
+    latency.queueMs = uplinkQueueMs;
+    latency.airMs = uplinkAirMs;
+    const LatencyReport* stages = position ? &latency : nullptr;
+
+    // Over LoRa as a binary record, which fits a frame where the JSON form
+    // would not
+    uint8_t record[TELEMETRY_MAX_UPLINK];
+    size_t recordLength = telemetry.encodeActivityUplink(
+        position, summary, DEVICE_ID, battery.getPercent(), estimate, stages,
+        record, sizeof(record)
+    );
+    bool sent = recordLength > 0 && sendUplink(record, recordLength);
+    if (sent) {
+        LOG_INFO(LOG_TELEMETRY_SENT);
+        uplinkQueueMs = (lora.getLastTxStartUs() - enqueueUs) / 1000;
+        uplinkAirMs = lora.getLastTxDurationUs() / 1000;
+    }
+
+    if (bleConfig.isConnected() &&
+        telemetry.createActivityTelemetry(position, summary, DEVICE_ID, battery.getPercent(),
+                                          estimate, stages, jsonBuffer, sizeof(jsonBuffer)) > 0) {
+        bleConfig.sendStatus(jsonBuffer);
+    }
+    return sent;
+}
+#endif
+
 /**
  * @brief Handle GPS updates
  */
 void handleGPS() {
+    ProfileScope scope(profiler, PROF_GPS);
+    MemoryScope memoryScope(memoryMonitor, MEM_GPS);
+    TRACE_SCOPE(TRACE_GPS);
     gps.update();
 
-    if (millis() - lastGPSUpdate >= GPS_UPDATE_INTERVAL) {
-        lastGPSUpdate = millis();
-        
+    // The dongle only reads GPS for time (handleTime)
+#if BRAVO_ROLE_COLLAR
+    if (scheduler.isDue(TASK_GPS)) {
         if (gps.hasFix()) {
-            double lat, lon;
-            gps.getLocation(lat, lon);
-            // GPS data is ready for telemetry
+            GPSData fix = gps.getData();
+            deadReckoning.updateFix(fix);
+
+            // Only fixes that shape the track are stored and sent
+            GPSData kept;
+            if (track.push(fix, kept)) {
+                dataLog.logGPS(kept);
+                queueTrackPoint(kept);
+            }
+
+            // Alerts only go out on confirmed crossings, not every fix
+            GeofenceEvent events[GEOFENCE_MAX_FENCES];
+            uint8_t count = geofence.update(fix, events, GEOFENCE_MAX_FENCES);
+            for (uint8_t i = 0; i < count; i++) {
+                char message[32];
+                snprintf(message, sizeof(message), "fence %u", events[i].fenceId);
+                char alertJson[TELEMETRY_MAX_UPLINK + 1];
+                size_t alertLength = telemetry.createAlertTelemetry(
+                    DEVICE_ID, events[i].entered ? "geofence_enter" : "geofence_exit", message,
+                    alertJson, sizeof(alertJson)
+                );
+
+                LOG_INFO(LOG_GEOFENCE_EVENT, events[i].fenceId,
+                         events[i].entered ? "entered" : "left");
+                if (sendUplink(alertJson, alertLength)) {
+                    lora.openReceiveWindow(DOWNLINK_RX_WINDOW_MS);
+                }
+                if (bleConfig.isConnected() && alertLength > 0) {
+                    bleConfig.sendStatus(alertJson);
+                }
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Discipline the clock with GPS time and pin the data log to UTC
+ */
+void handleTime() {
+    GPSTime gpsTime;
+    if (gps.getTime(gpsTime)) {
+        timeService.onGpsTime(gpsTime.unixSeconds, gpsTime.millisecond, gpsTime.receivedUs);
+    } else {
+        timeService.update();
+    }
+
+    if (!timeService.isSynced()) {
+        return;
+    }
+
+    // Log the mapping when it first appears, when it jumps and now and then,
+    // so every millis() stamp in the log can be converted
+    TimeStats stats = timeService.getStats();
+    bool first = !timeLogged;
+    bool stepped = stats.steps != timeLoggedSteps;
+    if (first || stepped || millis() - lastTimeLog >= TIME_LOG_INTERVAL_MS) {
+        if (first && stats.restored) {
+            LOG_INFO(LOG_TIME_RESTORED, stats.uncertaintyUs);
+        } else if (first) {
+            LOG_INFO(LOG_TIME_SYNCED, stats.pps ? "PPS" : "NMEA", stats.uncertaintyUs);
+        } else if (stepped) {
+            LOG_WARN(LOG_TIME_STEPPED, stats.lastErrorUs);
         }
+#if BRAVO_ROLE_COLLAR
+        dataLog.logTime(timeService.nowUnixMs());
+#endif
+        timeLogged = true;
+        timeLoggedSteps = stats.steps;
+        lastTimeLog = millis();
     }
 }
 
+#if BRAVO_ROLE_COLLAR
 /**
  * @brief Handle IMU updates
  */
 void handleIMU() {
-    if (millis() - lastIMUUpdate >= IMU_UPDATE_INTERVAL) {
-        lastIMUUpdate = millis();
-        
+    ProfileScope scope(profiler, PROF_IMU);
+    MemoryScope memoryScope(memoryMonitor, MEM_IMU);
+    TRACE_SCOPE(TRACE_IMU);
+
+    // Sample at the stream rate while a phone is watching live
+    bool streaming = imuStream.isActive();
+    uint32_t periodMs = streaming ? imuStream.getPeriodMs() : IMU_UPDATE_INTERVAL;
+    scheduler.setInterval(TASK_IMU, periodMs);
+    TRACE_BUDGET(TRACE_LOOP, periodMs * 1000);
+
+    if (scheduler.isDue(TASK_IMU)) {
         if (imu.readSensor()) {
+            if (streaming) {
+                imuStream.push(imu.getData());
+            }
+            imuSampleReady = true;
+
             // IMU data is ready for telemetry
             uint8_t activity = imu.getActivityLevel();
+            bool inMotion = imu.isInMotion(IMU_MOTION_THRESHOLD);
+            recorder.recordActivity(activity, inMotion, IMU_MOTION_THRESHOLD);
+            activitySummary.addSample(imu.getData(), activity);
             
             // Check for motion events
-            if (imu.isInMotion(1.0)) {
-                // Motion detected - could trigger alert
+            if (inMotion) {
+                // Motion detected - someone may be handling the collar, so
+                // make it quick to find over BLE
+                if (millis() - lastMotionWake >= BLE_MOTION_WAKE_HOLDOFF) {
+                    lastMotionWake = millis();
+                    bleConfig.wake();
+                }
             }
         }
     }
 }
 
+/**
+ * @brief Fuse the new IMU sample into the dead-reckoned position
+ *
+ * Runs at the IMU sample rate and is profiled on its own, so its CPU cost
+ * shows as "fusion" in the status report and against TRACE_BUDGET_FUSION_US.
+ */
+void handleDeadReckoning() {
+    if (!imuSampleReady) {
+        return;
+    }
+    imuSampleReady = false;
+
+    ProfileScope scope(profiler, PROF_FUSION);
+    MemoryScope memoryScope(memoryMonitor, MEM_FUSION);
+    TRACE_SCOPE(TRACE_FUSION);
+    if (deadReckoning.updateImu(imu.getData())) {
+        activitySummary.addStep();
+    }
+}
+
 /**
  * @brief Handle telemetry transmission
  */
 void handleTelemetry() {
-    if (millis() - lastTelemetrySend >= TELEMETRY_SEND_INTERVAL) {
-        lastTelemetrySend = millis();
-        
-        // Get current sensor data
-        GPSData gpsData = gps.getData();
-        IMUData imuData = imu.getData();
-        batteryLevel = getBatteryLevel();
+    ProfileScope scope(profiler, PROF_TELEMETRY);
+    MemoryScope memoryScope(memoryMonitor, MEM_TELEMETRY);
+    TRACE_SCOPE(TRACE_TELEMETRY);
 
-        // Create full telemetry packet
-        String telemetryJson = telemetry.createFullTelemetry(
-            gpsData, imuData, DEVICE_ID, batteryLevel
-        );
-
-        // Send via LoRa
-        if (lora.sendMessage(telemetryJson)) {
-            Serial.println("Telemetry sent via LoRa");
+    if (scheduler.isDue(TASK_TELEMETRY)) {
+        // With absolute time, move the next uplink into this collar's slot
+        // of the next period so collars stop colliding with each other
+        uint32_t interval = scheduler.getInterval(TASK_TELEMETRY);
+        int32_t slotDelay = timeService.msUntilSlot(interval, TIME_TX_SLOT_MS,
+                                                    Downlink::hashDeviceId(DEVICE_ID),
+                                                    interval / 2);
+        if (slotDelay >= 0) {
+            scheduler.setNextDue(TASK_TELEMETRY, slotDelay);
         }
 
-        // Also send status to BLE if connected
-        if (bleConfig.isConnected()) {
-            bleConfig.sendStatus(telemetryJson);
+        // Keep a local copy for bulk download over BLE (fixes are logged as
+        // the track filter keeps them)
+        dataLog.logIMU(imu.getData());
+
+        // A summary of all IMU samples since the last report, which starts
+        // the next interval
+        DeadReckoningEstimate estimate = deadReckoning.getEstimate();
+        ActivitySummaryData summary = activitySummary.getSummary(millis());
+        activitySummary.reset(millis());
+
+        // Every point the track filter kept since the last report goes out,
+        // oldest first, so the dongle's track stays within the tolerance;
+        // the last uplink carries the summary. Without a new point it is a
+        // heartbeat with just the summary, so the collar is still heard and
+        // still opens its window for downlinks.
+        ActivitySummaryData pointOnly;
+        memset(&pointOnly, 0, sizeof(pointOnly));
+        bool sent = false;
+        do {
+            const GPSData* position = nullptr;
+            GPSData point;
+            if (trackPointCount > 0) {
+                point = trackPoints[trackPointFirst];
+                trackPointFirst = (trackPointFirst + 1) % TRACK_UPLINK_POINTS;
+                trackPointCount--;
+                position = &point;
+            }
+            bool last = trackPointCount == 0;
+            if (sendActivityUplink(position, last ? summary : pointOnly,
+                                   last ? &estimate : nullptr)) {
+                sent = true;
+            }
+        } while (trackPointCount > 0);
+
+        // Then listen briefly for queued downlinks
+        if (sent) {
+            lora.openReceiveWindow(DOWNLINK_RX_WINDOW_MS);
         }
     }
 }
 
+#else
+/**
+ * @brief Time stamp for position history and proximity (dongle)
+ * @return Unix ms once time is synced, else millis()
+ */
+uint64_t dongleTimeMs() {
+    return timeService.isSynced() ? timeService.nowUnixMs() : millis();
+}
+
+/**
+ * @brief When the position in the last parsed uplink was taken (dongle)
+ *
+ * A track point can wait several telemetry periods on the collar, so this
+ * is the collar's own stamp when both clocks are absolute, else the receive
+ * time, less the fix's age when the uplink was built.
+ *
+ * @return Unix ms once time is synced, else millis()
+ */
+uint64_t fixTimeMs() {
+    uint64_t timeMs = dongleTimeMs();
+    uint32_t hourMs;
+    if (timeService.isSynced() && telemetry.getLastTime(hourMs)) {
+        timeMs = timeService.resolveHourMs(hourMs);
+    }
+    LatencyReport report;
+    if (telemetry.getLastLatency(report)) {
+        timeMs -= min((uint64_t)report.sampleMs, timeMs);
+    }
+    return timeMs;
+}
+
+/**
+ * @brief Account the stages of a received uplink (dongle)
+ * @param collarId Collar the uplink is from
+ * @param deviceId Collar name
+ */
+void recordLatency(uint32_t collarId, const char* deviceId) {
+    LatencyReport report;
+    if (!telemetry.getLastLatency(report)) {
+        return;
+    }
+
+    uint32_t decodeMs = (micros() - lora.getLastRxUs()) / 1000;
+    latencyTracker.record(collarId, deviceId, LATENCY_SAMPLE, report.sampleMs);
+    latencyTracker.record(collarId, deviceId, LATENCY_QUEUE, report.queueMs);
+    latencyTracker.record(collarId, deviceId, LATENCY_AIR, report.airMs);
+    latencyTracker.record(collarId, deviceId, LATENCY_DECODE, decodeMs);
+
+    // The rest needs both clocks on absolute time; clock error can put the
+    // dongle's side of the stamp slightly before the collar's
+    uint32_t hourMs;
+    if (!timeService.isSynced() || !telemetry.getLastTime(hourMs)) {
+        return;
+    }
+    int64_t sinceBuiltMs = (int64_t)(timeService.nowUnixMs() - timeService.resolveHourMs(hourMs));
+    int64_t networkMs = sinceBuiltMs - decodeMs - report.queueMs - report.airMs;
+    uint32_t totalMs = report.sampleMs + (uint32_t)max(sinceBuiltMs, (int64_t)0);
+    latencyTracker.record(collarId, deviceId, LATENCY_NETWORK,
+                          (uint32_t)max(networkMs, (int64_t)0));
+    latencyTracker.record(collarId, deviceId, LATENCY_TOTAL, totalMs);
+    LOG_DEBUG(LOG_LORA_RX_AGE, deviceId, totalMs);
+}
+#endif
+
 /**
  * @brief Handle incoming LoRa messages
  */
 void handleLoRaReceive() {
+    ProfileScope scope(profiler, PROF_LORA_RX);
+    MemoryScope memoryScope(memoryMonitor, MEM_LORA_RX);
+    TRACE_SCOPE(TRACE_LORA_RX);
+
+    // Collars only listen in the window after their own uplink, unless
+    // they relay for others
+    if constexpr (DEVICE_TYPE_COLLAR) {
+        if (!lora.isReceiveWindowOpen() && !relay.isEnabled()) {
+            return;
+        }
+    }
+
     if (lora.available()) {
-        String message = lora.receiveMessage();
+        uint8_t packet[256];
+        int length = lora.receiveData(packet, sizeof(packet) - 1);
         int rssi = lora.getRSSI();
         float snr = lora.getSNR();
 
-        Serial.println("=== LoRa Message Received ===");
-        Serial.print("Message: ");
-        Serial.println(message);
-        Serial.print("RSSI: ");
-        Serial.print(rssi);
-        Serial.println(" dBm");
-        Serial.print("SNR: ");
-        Serial.println(snr);
+        // Collars only queue relay frames for forwarding; the dongle unwraps
+        // the first copy of each and drops the rest
+        bool wrapped = Relay::isFrame(packet, length);
+        RelayHeader relayHeader;
+        if (wrapped) {
+            if (!relay.receive(packet, length, rssi, millis(), relayHeader) || DEVICE_TYPE_COLLAR) {
+                return;
+            }
+            length -= sizeof(RelayHeader);
+            memmove(packet, packet + sizeof(RelayHeader), length);
+        }
+
+        // With a key loaded, only sealed frames are trusted; the collar
+        // they are from or for must also be the one they name inside
+        bool sealed = FrameCrypto::isFrame(packet, length);
+        uint32_t sealedFor = 0;
+        if (sealed) {
+            size_t openLength = length;
+            if (!crypto.open(packet, openLength, sealedFor)) {
+                return;
+            }
+            length = openLength;
+        } else if (crypto.isActive()) {
+            plaintextDropped++;
+            return;
+        }
+
+        // Only now is a relayed uplink marked seen, and only if the collar
+        // that sealed it is the origin its relay header names
+        if (wrapped) {
+            if (sealed && relayHeader.origin != sealedFor) {
+                LOG_WARN(LOG_CRYPTO_IDENTITY, sealedFor);
+                return;
+            }
+            relay.accept(relayHeader);
+        }
+
+        if (Downlink::isFrame(packet, length)) {
+            DownlinkHeader header;
+            memcpy(&header, packet, sizeof(header));
+            if (sealed && header.deviceId != sealedFor) {
+                LOG_WARN(LOG_CRYPTO_IDENTITY, sealedFor);
+                return;
+            }
+            handleFrame(packet, length);
+            return;
+        }
+
+        LOG_INFO(LOG_LORA_RX, length, rssi, snr);
+
+        // Activity uplinks are binary records, everything else JSON
+        bool parsed;
+        if (Telemetry::isActivityUplink(packet, length)) {
+            parsed = telemetry.parseActivityUplink(packet, length);
+        } else {
+            packet[length] = '\0';
+            LOG_DEBUG(LOG_LORA_RX_TEXT, (const char*)packet);
+            parsed = telemetry.parseTelemetry((const char*)packet, length);
+        }
+
+        if (parsed) {
+            if (sealed && Downlink::hashDeviceId(telemetry.getLastDeviceId()) != sealedFor) {
+                LOG_WARN(LOG_CRYPTO_IDENTITY, sealedFor);
+                return;
+            }
+            LOG_INFO(LOG_LORA_RX_TELEMETRY, telemetry.getLastDeviceId());
+
+#if !BRAVO_ROLE_COLLAR
+            // The collar is listening right now: send anything queued for it
+            uint8_t frame[DOWNLINK_MAX_FRAME];
+            uint32_t collarId = Downlink::hashDeviceId(telemetry.getLastDeviceId());
+
+            recordLatency(collarId, telemetry.getLastDeviceId());
+
+            double latitude, longitude;
+            if (telemetry.getLastPosition(latitude, longitude)) {
+                uint64_t fixMs = fixTimeMs();
+                positionHistory.append(collarId, telemetry.getLastDeviceId(), fixMs,
+                                       latitude, longitude);
+                proximity.update(collarId, telemetry.getLastDeviceId(), fixMs,
+                                 latitude, longitude);
+            }
+
+            // A relayed collar cannot hear us: its commands wait for
+            // its next direct uplink
+            size_t frameLength = 0;
+            if (wrapped && relayHeader.hops > 0) {
+                downlinkQueue.addCollar(collarId);
+            } else {
+                frameLength = downlinkQueue.onUplink(collarId, frame);
+            }
+            if (frameLength > 0) {
+                sendFrame(frame, frameLength, collarId);
+                // Back to RX at once: the ack follows within one collar
+                // loop pass, before our next poll would re-arm the receiver
+                lora.available();
+            }
+#endif
+        }
+    }
+}
+
+/**
+ * @brief Rebroadcast relayed frames whose delay has run out (collar), or
+ * send the periodic relay beacon (dongle)
+ */
+void handleRelay() {
+    if (!relay.isEnabled()) {
+        return;
+    }
+
+    uint8_t frame[RELAY_MAX_FRAME];
+    if constexpr (!DEVICE_TYPE_COLLAR) {
+        if (scheduler.isDue(TASK_RELAY_BEACON)) {
+            lora.sendData(frame, relay.beacon(frame));
+            lora.available();
+        }
+        return;
+    }
+
+    size_t length = relay.poll(millis(), frame, sizeof(frame));
+    if (length > 0) {
+        lora.sendData(frame, length);
+    }
+}
+
+/**
+ * @brief Feed peripheral on-times into the energy model
+ */
+void updateEnergyInputs() {
+    LoRaRadioStats radio = lora.getRadioStats();
+    profiler.setOnTime(ENERGY_LORA_TX, radio.txTimeMs);
+    profiler.setOnTime(ENERGY_LORA_RX, radio.rxTimeMs);
+    profiler.setOnTime(ENERGY_GPS, gps.getOnTimeMs());
+
+    float bleRadioMs = 0;
+    for (int state = 0; state < BLE_STATE_COUNT; state++) {
+        bleRadioMs += bleConfig.getPowerStats((BLEPowerState)state).radioOnMs;
+    }
+    profiler.setOnTime(ENERGY_BLE, bleRadioMs);
+}
+
+#if !BRAVO_ROLE_COLLAR
+/**
+ * @brief Sweep the herd for collars that left or rejoined it (dongle)
+ */
+void handleProximity() {
+    if (!scheduler.isDue(TASK_PROXIMITY)) {
+        return;
+    }
+
+    uint32_t startUs = micros();
+    proximity.expire(dongleTimeMs());
+    proximityPairs = proximity.findPairs(HERD_COHESION_DISTANCE_M, nullptr, 0);
+    proximitySweepUs = micros() - startUs;
+
+    // Alert on changes only; a lone collar has no herd to leave
+    proximityIsolated = 0;
+    if (proximity.getCount() < 2) {
+        return;
+    }
+    for (uint16_t i = 0; i < proximity.getCapacity(); i++) {
+        const ProximityEntry* entry = proximity.getEntry(i);
+        if (!entry) {
+            continue;
+        }
+        if (entry->neighbours == 0) {
+            proximityIsolated++;
+        }
+
+        if (entry->neighbours == 0 && entry->previousNeighbours > 0) {
+            // The collar itself is the nearest result
+            ProximityResult nearest[2];
+            size_t found = proximity.findNearest(entry->latitude, entry->longitude, 2, nearest);
+            uint32_t distance = found == 2 ? (uint32_t)nearest[1].distanceM : 0;
+            LOG_WARN(LOG_PROXIMITY_ISOLATED, entry->deviceId, distance);
+
+            if (bleConfig.isConnected()) {
+                char message[32];
+                snprintf(message, sizeof(message), "nearest %u m", (unsigned)distance);
+                if (telemetry.createAlertTelemetry(entry->deviceId, "herd_left", message,
+                                                   jsonBuffer, sizeof(jsonBuffer)) > 0) {
+                    bleConfig.sendStatus(jsonBuffer);
+                }
+            }
+        } else if (entry->neighbours > 0 && entry->previousNeighbours == 0) {
+            LOG_INFO(LOG_PROXIMITY_REJOINED, entry->deviceId);
+        }
+    }
+}
+
+/**
+ * @brief Format one stage of a collar's (or the herd's) latency percentiles
+ * @param index Collar index, or -1 for the whole herd
+ * @param stage Stage
+ * @param line Buffer for the line
+ * @param maxLength Buffer size
+ * @return Line length
+ */
+int formatLatency(int16_t index, LatencyStage stage, char* line, size_t maxLength) {
+    uint32_t collarId;
+    const char* name = index < 0 ? "*" : latencyTracker.getCollar(index, collarId);
+    LatencyPercentiles p = index < 0 ? latencyTracker.getHerdPercentiles(stage)
+                                     : latencyTracker.getPercentiles(index, stage);
+    int length = snprintf(line, maxLength, "%s,%s,%u,%u,%u,%u\n", name,
+                          LatencyTracker::stageName(stage), (unsigned)p.count,
+                          (unsigned)p.p50Ms, (unsigned)p.p95Ms, (unsigned)p.p99Ms);
+    return min(length, (int)maxLength - 1);
+}
+
+/**
+ * @brief Print latency percentiles of the herd and every collar (dongle)
+ */
+void printLatency() {
+    Serial.printf("Latency: %u collars, %u untracked (name,stage,count,p50,p95,p99 ms)\n",
+                  latencyTracker.getCollarCount(), (unsigned)latencyTracker.getUntracked());
+    for (int16_t i = -1; i < latencyTracker.getCollarCount(); i++) {
+        for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+            char line[64];
+            formatLatency(i, (LatencyStage)stage, line, sizeof(line));
+            Serial.print(line);
+        }
+    }
+}
+
+/**
+ * @brief Answer latency queries from BLE, one collar per loop pass (dongle)
+ *
+ * Replies with "LAT <collars> <untracked>", lines of
+ * "<name>,<stage>,<count>,<p50>,<p95>,<p99>" in ms, the herd first as "*",
+ * then "LAT END".
+ */
+void handleLatencyQuery() {
+    if (latencyQueryPending) {
+        latencyQueryPending = false;
+        char header[32];
+        snprintf(header, sizeof(header), "LAT %u %u", latencyTracker.getCollarCount(),
+                 (unsigned)latencyTracker.getUntracked());
+        bleConfig.sendStatus(header);
+        latencyCursor = -1;
+        latencyReplyActive = true;
+    }
+
+    if (!latencyReplyActive) {
+        return;
+    }
+    if (!bleConfig.isConnected()) {
+        latencyReplyActive = false;
+        return;
+    }
+    if (latencyCursor >= latencyTracker.getCollarCount()) {
+        bleConfig.sendStatus("LAT END");
+        latencyReplyActive = false;
+        return;
+    }
+
+    MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+    char chunk[BLE_PREFERRED_MTU];
+    size_t maxLength = min(bleConfig.getMaxNotifySize(), sizeof(chunk) - 1);
+    size_t length = 0;
+    for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+        char line[64];
+        int lineLength = formatLatency(latencyCursor, (LatencyStage)stage, line, sizeof(line));
+        if (length + lineLength > maxLength) {
+            chunk[length] = '\0';
+            bleConfig.sendStatus(chunk);
+            length = 0;
+        }
+        memcpy(chunk + length, line, lineLength);
+        length += lineLength;
+    }
+    if (length > 0) {
+        chunk[length] = '\0';
+        bleConfig.sendStatus(chunk);
+    }
+    latencyCursor++;
+}
+
+/**
+ * @brief Answer proximity queries from BLE (dongle)
+ *
+ * Replies with "NEAR <count> <query us>", lines of "<name>,<metres>" packed
+ * into notifications, then "NEAR END".
+ */
+void handleProximityQuery() {
+    if (!proximityQueryPending) {
+        return;
+    }
+    proximityQueryPending = false;
+    MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+
+    int32_t latitude, longitude;
+    uint16_t argument;
+    memcpy(&latitude, &proximityQuery[1], 4);
+    memcpy(&longitude, &proximityQuery[5], 4);
+    memcpy(&argument, &proximityQuery[9], 2);
 
-        // Parse telemetry if it's JSON
-        if (telemetry.parseTelemetry(message)) {
-            Serial.println("Valid telemetry packet received");
+    ProximityResult results[PROXIMITY_MAX_RESULTS];
+    uint32_t startUs = micros();
+    size_t count;
+    if (proximityQuery[0] == PROXIMITY_QUERY_NEAREST) {
+        count = proximity.findNearest(latitude / 1e7, longitude / 1e7,
+                                      min((size_t)argument, (size_t)PROXIMITY_MAX_RESULTS),
+                                      results);
+    } else {
+        count = proximity.findWithin(latitude / 1e7, longitude / 1e7, argument, results,
+                                     PROXIMITY_MAX_RESULTS);
+    }
+    uint32_t queryUs = micros() - startUs;
+
+    char header[32];
+    snprintf(header, sizeof(header), "NEAR %u %u", (unsigned)count, (unsigned)queryUs);
+    bleConfig.sendStatus(header);
+
+    char chunk[BLE_PREFERRED_MTU];
+    size_t maxLength = min(bleConfig.getMaxNotifySize(), sizeof(chunk) - 1);
+    size_t length = 0;
+    for (size_t i = 0; i < count; i++) {
+        char line[32];
+        int lineLength = snprintf(line, sizeof(line), "%s,%u\n",
+                                  proximity.getEntry(results[i].index)->deviceId,
+                                  (unsigned)results[i].distanceM);
+        if (length + lineLength > maxLength) {
+            chunk[length] = '\0';
+            bleConfig.sendStatus(chunk);
+            length = 0;
         }
+        memcpy(chunk + length, line, lineLength);
+        length += lineLength;
+    }
+    if (length > 0) {
+        chunk[length] = '\0';
+        bleConfig.sendStatus(chunk);
+    }
+    bleConfig.sendStatus("NEAR END");
+}
+#endif
+
+/**
+ * @brief Sample the battery and step power modes as the charge changes
+ */
+void handleBattery() {
+    if (!scheduler.isDue(TASK_BATTERY)) {
+        return;
+    }
+
+    // LoRa TX blocks the loop, so samples never land inside a TX sag
+    if (battery.update()) {
+        applyConfig(bleConfig.getConfig());
     }
 }
 
+/**
+ * @brief Send timing and energy status telemetry
+ */
+void handleStatusReport() {
+    bool due = scheduler.isDue(TASK_STATUS_REPORT);
+    if (!due && !statusReportRequested) {
+        return;
+    }
+
+    TRACE_SCOPE(TRACE_STATUS);
+    MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+
+    updateEnergyInputs();
+    BatteryStatus batteryStatus = battery.getStatus(profiler.getEnergy().avgCurrentMa);
+    MemoryStats memoryStats = memoryMonitor.getStats();
+    const TrackStats* trackStats = nullptr;
+#if BRAVO_ROLE_COLLAR
+    TrackStats collarTrack = track.getStats();
+    collarTrack.unsent = trackPointsLost;
+    trackStats = &collarTrack;
+#endif
+    // Periodic reports go over LoRa, without the timing, energy and memory
+    // blocks, which only fit BLE and serial; a BLE request is answered locally
+    if (due) {
+        profiler.logSummary();
+        if constexpr (DEVICE_TYPE_COLLAR) {
+            char uplinkJson[TELEMETRY_MAX_UPLINK + 1];
+            size_t uplinkLength = telemetry.createStatusTelemetry(
+                DEVICE_ID, batteryStatus.percent, millis() / 1000, lora.getRSSI(), nullptr,
+                &batteryStatus, trackStats, nullptr, uplinkJson, sizeof(uplinkJson)
+            );
+            if (uplinkLength == 0) {
+                uplinkLength = telemetry.createStatusTelemetry(
+                    DEVICE_ID, batteryStatus.percent, millis() / 1000, lora.getRSSI(), nullptr,
+                    &batteryStatus, nullptr, nullptr, uplinkJson, sizeof(uplinkJson)
+                );
+            }
+            if (sendUplink(uplinkJson, uplinkLength)) {
+                lora.openReceiveWindow(DOWNLINK_RX_WINDOW_MS);
+            }
+        }
+    }
+
+    if (bleConfig.isConnected() &&
+        telemetry.createStatusTelemetry(DEVICE_ID, batteryStatus.percent, millis() / 1000,
+                                        lora.getRSSI(), &profiler, &batteryStatus, trackStats,
+                                        &memoryStats, jsonBuffer, sizeof(jsonBuffer)) > 0) {
+        bleConfig.sendStatus(jsonBuffer);
+    }
+    statusReportRequested = false;
+}
+
+#if BRAVO_ROLE_COLLAR
+/**
+ * @brief Stop the sensor recording, if one is running
+ */
+void stopRecording() {
+    if (!recorder.isRecording()) {
+        return;
+    }
+
+    recorder.end();
+    recordingFile.close();
+    RecorderStats stats = recorder.getStats();
+    Serial.printf("Recording stopped: %u records, %u bytes, %u dropped\n",
+                  stats.records, stats.bytes, stats.dropped);
+}
+
+/**
+ * @brief Start recording the GPS/IMU streams
+ * @param toFlash true to record to RECORDING_PATH, false to serial REC lines
+ */
+void startRecording(bool toFlash) {
+    stopRecording();
+
+    if (toFlash) {
+        if (!recordingFile.open(RECORDING_PATH, true) || !recorder.begin(recordingFile)) {
+            Serial.println("Recording to flash failed");
+            recordingFile.close();
+            return;
+        }
+        Serial.println("Recording to " RECORDING_PATH);
+    } else {
+        recorder.begin(serialRecordSink);
+        Serial.println("Recording to serial");
+    }
+}
+
+/**
+ * @brief Print the flash recording as REC lines (see tools/rec_extract.py)
+ */
+void dumpRecording() {
+    stopRecording();
+
+    if (!recordingFile.open(RECORDING_PATH, false)) {
+        Serial.println("No recording on flash");
+        return;
+    }
+
+    Serial.printf("Recording dump: %u bytes\n", recordingFile.size());
+    uint8_t chunk[64];
+    size_t length;
+    while ((length = recordingFile.read(chunk, sizeof(chunk))) > 0) {
+        serialRecordSink.write(chunk, length);
+    }
+    recordingFile.close();
+    Serial.println("Recording dump end");
+}
+
+/**
+ * @brief Replay the flash recording through separate GPS/IMU instances
+ * @param speed Pacing mode
+ */
+void replayRecording(ReplaySpeed speed) {
+    stopRecording();
+
+    if (!recordingFile.open(RECORDING_PATH, false)) {
+        Serial.println("No recording on flash");
+        return;
+    }
+
+    // Fresh modules so the live ones keep their state
+    ReplayUart replayUart;
+    ReplayImu replaySensor;
+    GPS replayGps(replayUart);
+    IMU replayImu(replaySensor);
+    Esp32Clock clock;
+    replayGps.begin();
+    replayImu.begin();
+
+    SensorReplay replay(recordingFile, replayUart, replaySensor, replayGps, replayImu, clock);
+    if (!replay.begin(speed)) {
+        recordingFile.close();
+        return;
+    }
+
+    Serial.printf("Replaying " RECORDING_PATH " (%s)\n",
+                  speed == REPLAY_REALTIME ? "1x" : "fast");
+    uint32_t start = micros();
+    uint32_t count = 0;
+    while (replay.step() != 0) {
+        if (++count % REPLAY_YIELD_RECORDS == 0) {
+            yield();
+        }
+    }
+    uint32_t elapsedUs = micros() - start;
+    recordingFile.close();
+
+    ReplayStats stats = replay.getStats();
+    Serial.printf("Replayed %u records (%.1f s recorded) in %u ms\n",
+                  stats.records, stats.durationUs / 1e6, elapsedUs / 1000);
+    Serial.printf("NMEA %u bytes, IMU %u samples, %u failed reads, %u skipped\n",
+                  stats.nmeaBytes, stats.imuSamples, stats.imuFailures, stats.skipped);
+    if (stats.mismatches > 0) {
+        Serial.printf("Activity decisions: %u checked, %u MISMATCHED (first at %.3f s)\n",
+                      stats.decisions, stats.mismatches, stats.firstMismatchUs / 1e6);
+    } else {
+        Serial.printf("Activity decisions: %u checked, all reproduced\n", stats.decisions);
+    }
+}
+
+#else
+/**
+ * @brief Print the position history store and each collar's newest positions
+ */
+void printHistory() {
+    TimeSeriesStats stats = positionHistory.getStats();
+    Serial.printf("History: %u collars, %u points, %u/%u blocks, %u evicted\n",
+                  stats.series, stats.points, stats.blocksUsed, stats.blockCount,
+                  stats.evictedPoints);
+    Serial.printf("Compression: %.2fx encoded, %.2fx in blocks\n",
+                  stats.compressionRatio, stats.storageRatio);
+
+    for (uint8_t i = 0; i < positionHistory.getSeriesCount(); i++) {
+        uint32_t collarId, points;
+        const char* name = positionHistory.getSeries(i, collarId, points);
+
+        TimeSeriesPoint last[5];
+        size_t count = positionHistory.queryLast(collarId, 5, last);
+        Serial.printf("%s: %u points, last %u in %u us\n", name, points, (unsigned)count,
+                      positionHistory.getStats().lastQueryUs);
+        for (size_t j = 0; j < count; j++) {
+            Serial.printf("  %llu ms %.7f %.7f\n", (unsigned long long)last[j].timeMs,
+                          last[j].latitude / 1e7,
+                          last[j].longitude / 1e7);
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Persist a LoRa frame counter
+ * @param counter Which counter
+ * @param value Value to store
+ * @return true if stored, false otherwise
+ */
+bool storeCryptoCounter(CryptoCounter counter, uint32_t value) {
+    const char* key = counter == CRYPTO_COUNTER_TX ? CRYPTO_NVS_TX_COUNTER
+                                                   : CRYPTO_NVS_RX_COUNTER;
+    return configStore.saveBlob(key, (const uint8_t*)&value, sizeof(value));
+}
+
+/**
+ * @brief Start sealing LoRa frames with a stored key, resuming its counters
+ * @param key Master key (dongle) or this collar's key
+ */
+void startCrypto(const uint8_t* key) {
+    uint32_t txCounter = 0;
+    uint32_t rxCounter = 0;
+    configStore.loadBlob(CRYPTO_NVS_TX_COUNTER, (uint8_t*)&txCounter, sizeof(txCounter));
+    configStore.loadBlob(CRYPTO_NVS_RX_COUNTER, (uint8_t*)&rxCounter, sizeof(rxCounter));
+
+    crypto.setCounterStore(storeCryptoCounter);
+    if (!crypto.begin(key, txCounter, rxCounter)) {
+        LOG_ERROR(LOG_CRYPTO_COUNTER_FAILED);
+    }
+}
+
+/**
+ * @brief Read a herd master key as 32 hex digits from serial and store the
+ * key this device keeps for it (see FrameCrypto::provisionKey)
+ */
+void provisionLoRaKey() {
+    uint8_t hex[CRYPTO_KEY_SIZE * 2];
+    uint8_t masterKey[CRYPTO_KEY_SIZE];
+    bool valid = Serial.readBytes(hex, sizeof(hex)) == sizeof(hex);
+    for (size_t i = 0; valid && i < sizeof(hex); i++) {
+        char c = tolower(hex[i]);
+        uint8_t digit = c >= 'a' ? c - 'a' + 10 : c - '0';
+        valid = isxdigit(c) != 0;
+        masterKey[i / 2] = (uint8_t)((i % 2) ? (masterKey[i / 2] << 4) | digit : digit);
+    }
+    if (!valid) {
+        LOG_WARN(LOG_CRYPTO_KEY_INVALID);
+        return;
+    }
+
+    uint8_t key[CRYPTO_KEY_SIZE];
+    crypto.provisionKey(masterKey, key);
+    memset(masterKey, 0, sizeof(masterKey));
+    if (configStore.saveBlob(CRYPTO_NVS_KEY, key, sizeof(key))) {
+        startCrypto(key);
+        LOG_INFO(LOG_CRYPTO_KEY_SET);
+    } else {
+        LOG_ERROR(LOG_CRYPTO_KEY_SAVE_FAILED);
+    }
+    memset(key, 0, sizeof(key));
+}
+
+/**
+ * @brief Handle single-key serial commands and recording requests from BLE
+ *
+ * 't' trace dump, 'l' toggle hex log output, 'k' followed by 32 hex digits
+ * provision the herd's LoRa master key. Collar: 'r'/'R' toggle recording to
+ * flash/serial, 'd' dump the flash recording, 'x'/'X' replay it fast/at 1x.
+ * Dongle: 'h' print the position history, 'L' print latency percentiles.
+ */
+void handleSerialCommand() {
+    MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+
+#if BRAVO_ROLE_COLLAR
+    if (recordModeRequested >= 0) {
+        if (recordModeRequested == 0) {
+            stopRecording();
+        } else {
+            startRecording(recordModeRequested == 1);
+        }
+        recordModeRequested = -1;
+    }
+#endif
+
+    if (!Serial.available()) {
+        return;
+    }
+
+    int key = Serial.read();
+    switch (key) {
+#if BRAVO_TRACE
+        case 't':
+            trace.dumpToSerial();
+            break;
+#endif
+        case 'l':
+            logger.setBinary(!logger.isBinary());
+            break;
+        case 'k':
+            provisionLoRaKey();
+            break;
+#if BRAVO_ROLE_COLLAR
+        case 'r':
+        case 'R': {
+            // Either key stops a running recording
+            bool toFlash = key == 'r';
+            if (recorder.isRecording()) {
+                stopRecording();
+            } else {
+                startRecording(toFlash);
+            }
+            break;
+        }
+        case 'd':
+            dumpRecording();
+            break;
+        case 'x':
+            replayRecording(REPLAY_FAST);
+            break;
+        case 'X':
+            replayRecording(REPLAY_REALTIME);
+            break;
+#else
+        case 'h':
+            printHistory();
+            break;
+        case 'L':
+            printLatency();
+            break;
+#endif
+    }
+}
+
+/**
+ * @brief Serve trace dumps requested over BLE
+ */
+void handleTraceDump() {
+#if BRAVO_TRACE
+    if (traceDumpActive) {
+        if (!bleConfig.isConnected()) {
+            // Drain without sending so recording resumes
+            char discard[256];
+            while (trace.formatDump(traceDumpCursor, discard, sizeof(discard)) > 0) {
+            }
+            traceDumpActive = false;
+            return;
+        }
+
+        // A couple of notifications per pass keeps the loop responsive
+        char chunk[BLE_PREFERRED_MTU];
+        size_t maxLength = min(bleConfig.getMaxNotifySize(), sizeof(chunk) - 1);
+        for (int i = 0; i < 2 && traceDumpActive; i++) {
+            size_t length = trace.formatDump(traceDumpCursor, chunk, maxLength);
+            if (length == 0) {
+                bleConfig.sendStatus("TRACE END");
+                traceDumpActive = false;
+            } else {
+                chunk[length] = '\0';
+                bleConfig.sendStatus(chunk);
+            }
+        }
+    }
+#endif
+}
+
+#if !BRAVO_ROLE_COLLAR
+/**
+ * @brief Answer position history queries from BLE
+ *
+ * Replies with "HIST <name> <count> <query us>", lines of
+ * "<ms>,<lat e7>,<lon e7>" packed into notifications, then "HIST END".
+ */
+void handleHistoryQuery() {
+    if (historyQueryPending) {
+        MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+        uint32_t collarId = Downlink::hashDeviceId(historyQueryName);
+        if (historyQueryMode == HISTORY_QUERY_RANGE) {
+            historyCount = positionHistory.queryRange(collarId, historyQueryRange[0],
+                                                      historyQueryRange[1], historyPoints,
+                                                      HISTORY_MAX_POINTS);
+        } else {
+            historyCount = positionHistory.queryLast(
+                collarId, min(historyQueryCount, (uint32_t)HISTORY_MAX_POINTS), historyPoints);
+        }
+        historyQueryPending = false;
+
+        char header[64];
+        snprintf(header, sizeof(header), "HIST %s %u %u", historyQueryName, historyCount,
+                 (unsigned)positionHistory.getStats().lastQueryUs);
+        bleConfig.sendStatus(header);
+        historyCursor = 0;
+        historyReplyActive = true;
+    }
+
+    if (!historyReplyActive) {
+        return;
+    }
+    if (!bleConfig.isConnected()) {
+        historyReplyActive = false;
+        return;
+    }
+
+    // A couple of notifications per pass keeps the loop responsive
+    MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+    char chunk[BLE_PREFERRED_MTU];
+    size_t maxLength = min(bleConfig.getMaxNotifySize(), sizeof(chunk) - 1);
+    for (int i = 0; i < 2 && historyReplyActive; i++) {
+        if (historyCursor >= historyCount) {
+            bleConfig.sendStatus("HIST END");
+            historyReplyActive = false;
+            break;
+        }
+
+        size_t length = 0;
+        while (historyCursor < historyCount) {
+            const TimeSeriesPoint& point = historyPoints[historyCursor];
+            char line[40];
+            int lineLength = snprintf(line, sizeof(line), "%llu,%d,%d\n",
+                                      (unsigned long long)point.timeMs,
+                                      (int)point.latitude, (int)point.longitude);
+            if (length + lineLength > maxLength) {
+                break;
+            }
+            memcpy(chunk + length, line, lineLength);
+            length += lineLength;
+            historyCursor++;
+        }
+        chunk[length] = '\0';
+        bleConfig.sendStatus(chunk);
+    }
+}
+#endif
+
 /**
  * @brief Print status information
  */
 void printStatus() {
-    if (millis() - lastStatusPrint >= STATUS_PRINT_INTERVAL) {
-        lastStatusPrint = millis();
-        
-        Serial.println("\n=== Status Update ===");
-        Serial.print("Uptime: ");
-        Serial.print(millis() / 1000);
-        Serial.println(" seconds");
-        
-        Serial.print("Battery: ");
-        Serial.print(batteryLevel);
-        Serial.println("%");
+    if (scheduler.isDue(TASK_STATUS)) {
+        TRACE_SCOPE(TRACE_STATUS);
+        MemoryScope memoryScope(memoryMonitor, MEM_STATUS);
+        LOG_INFO(LOG_STATUS_HEADER);
+        LOG_INFO(LOG_STATUS_UPTIME, millis() / 1000);
         
-        Serial.print("GPS Fix: ");
-        Serial.println(gps.hasFix() ? "Yes" : "No");
-        
-        if (gps.hasFix()) {
-            Serial.print("Satellites: ");
-            Serial.println(gps.getSatellites());
+        if (battery.isPresent()) {
+            LOG_INFO(LOG_STATUS_BATTERY, battery.getPercent(), battery.getMillivolts(),
+                     BatteryMonitor::tierName(battery.getTier()));
+        } else {
+            LOG_INFO(LOG_STATUS_NO_BATTERY);
         }
         
-        Serial.print("BLE Connected: ");
-        Serial.println(bleConfig.isConnected() ? "Yes" : "No");
-        
-        Serial.print("Activity Level: ");
-        Serial.println(imu.getActivityLevel());
-        
-        Serial.println("====================\n");
+        LOG_INFO(LOG_STATUS_GPS, gps.hasFix() ? "Yes" : "No", gps.getSatellites());
+
+#if BRAVO_ROLE_COLLAR
+        TrackStats trackStats = track.getStats();
+        LOG_INFO(LOG_STATUS_TRACK, trackStats.kept, trackStats.received, trackStats.maxErrorM);
+        if (trackPointsLost > 0) {
+            LOG_WARN(LOG_STATUS_TRACK_LOST, trackPointsLost);
+        }
+
+        DeadReckoningEstimate estimate = deadReckoning.getEstimate();
+        DeadReckoningStats drStats = deadReckoning.getStats();
+        if (estimate.valid) {
+            LOG_INFO(LOG_STATUS_DR, estimate.steps, estimate.uncertaintyM, drStats.strideM,
+                     drStats.calibrations);
+        }
+#endif
+
+        static const char* bleStateNames[] = { "adv-fast", "adv-slow", "idle", "bulk" };
+        BLEPowerState bleState = bleConfig.getPowerState();
+        BLEStateStats bleStats = bleConfig.getPowerStats(bleState);
+        LOG_INFO(LOG_STATUS_BLE, bleConfig.isConnected() ? "Yes" : "No",
+                 bleStateNames[bleState], bleStats.radioOnMs, bleStats.avgCurrentMa);
+
+#if BRAVO_ROLE_COLLAR
+        static const char* activityClassNames[] = { "rest", "walk", "run" };
+        ActivitySummaryData activity = activitySummary.getSummary(millis());
+        LOG_INFO(LOG_STATUS_ACTIVITY, imu.getActivityLevel(),
+                 activityClassNames[activitySummary.getCurrentClass()],
+                 activity.motionEvents, activity.steps, activity.durationMs / 1000);
+
+        if (geofence.isActive()) {
+            GeofenceStats fenceStats = geofence.getStats();
+            LOG_INFO(LOG_STATUS_GEOFENCE, geofence.getFenceCount(), geofence.getVertexCount(),
+                     fenceStats.evaluations ?
+                     (float)fenceStats.edgesTested / fenceStats.evaluations : 0.0f);
+        }
+#else
+        DownlinkCampaignStats campaign = downlinkQueue.getCampaignStats();
+        LOG_INFO(LOG_STATUS_DOWNLINK, downlinkQueue.getPendingCount(), campaign.acked,
+                 campaign.targets);
+
+        TimeSeriesStats history = positionHistory.getStats();
+        LOG_INFO(LOG_STATUS_HISTORY, history.series, history.points, history.blocksUsed,
+                 history.compressionRatio, history.lastQueryUs);
+        LOG_INFO(LOG_STATUS_PROXIMITY, proximity.getCount(), proximityPairs,
+                 HERD_COHESION_DISTANCE_M, proximityIsolated, proximitySweepUs);
+
+        LatencyPercentiles latency = latencyTracker.getHerdPercentiles(LATENCY_TOTAL);
+        if (latency.count > 0) {
+            LOG_INFO(LOG_STATUS_LATENCY, latencyTracker.getCollarCount(), latency.p50Ms,
+                     latency.p95Ms, latency.p99Ms);
+        }
+#endif
+
+#if BRAVO_TRACE
+        if (trace.getOverrunCount() > 0) {
+            TraceOverrun overrun = trace.getLastOverrun();
+            LOG_INFO(LOG_STATUS_OVERRUN, trace.getOverrunCount(), Trace::pointName(overrun.point),
+                     overrun.durationUs, overrun.timestampMs);
+        }
+#endif
+
+#if BRAVO_ROLE_COLLAR
+        if (recorder.isRecording()) {
+            RecorderStats recording = recorder.getStats();
+            LOG_INFO(LOG_STATUS_RECORDING, recording.records, recording.bytes, recording.dropped);
+        }
+
+        if (imuStream.isActive()) {
+            IMUStreamStats stream = imuStream.getStats();
+            LOG_INFO(LOG_STATUS_STREAM, stream.rateHz, stream.sentBatches, stream.droppedBatches);
+        }
+#endif
+
+        RelayStats relayStats = relay.getStats();
+        if (relay.isEnabled() || relayStats.received > 0) {
+            LOG_INFO(LOG_STATUS_RELAY, relay.getLevel(), relayStats.firstDirect,
+                     relayStats.firstRelayed, relayStats.duplicates, relayStats.forwarded);
+        }
+
+        TimeStats timeStats = timeService.getStats();
+        if (timeStats.synced) {
+            LOG_INFO(LOG_STATUS_TIME, timeStats.pps ? "PPS" : "NMEA", timeStats.driftPpm,
+                     timeStats.uncertaintyUs, timeStats.samples, timeStats.steps);
+        } else {
+            LOG_INFO(LOG_STATUS_NO_TIME);
+        }
+
+        if (crypto.isActive()) {
+            CryptoStats cryptoStats = crypto.getStats();
+            LOG_INFO(LOG_STATUS_CRYPTO, cryptoStats.sealed, cryptoStats.lastSealUs,
+                     cryptoStats.opened, cryptoStats.lastOpenUs,
+                     cryptoStats.badMic + cryptoStats.replayed + plaintextDropped);
+        }
+        if (uplinkOversize > 0) {
+            LOG_INFO(LOG_STATUS_UPLINK, uplinkOversize);
+        }
+
+        MemoryStats memoryStats = memoryMonitor.getStats();
+        LOG_INFO(LOG_STATUS_MEMORY, memoryStats.freeHeap, memoryStats.largestFreeBlock,
+                 memoryStats.minFreeHeap, memoryStats.allocations, memoryStats.failures);
+
+        LogStats logStats = logger.getStats();
+        LOG_INFO(LOG_STATUS_LOG, logStats.written, logStats.dropped);
+        LOG_INFO(LOG_STATUS_FOOTER);
     }
 }
 
-/**
- * @brief Arduino setup function
- */
 void setup() {
+    // Count allocations from here on; everything until lockHeap() is setup
+    memoryMonitor.begin();
+
     // Initialize serial communication
     Serial.begin(115200);
     delay(1000);
     Serial.println("\n\n");
+    logger.begin();
+
+    pinMode(BLE_WAKE_BUTTON_PIN, INPUT_PULLUP);
+
+    scheduler.setInterval(TASK_IMU, IMU_UPDATE_INTERVAL);
+    scheduler.setInterval(TASK_STATUS, STATUS_PRINT_INTERVAL);
+    scheduler.setInterval(TASK_STATUS_REPORT, STATUS_REPORT_INTERVAL);
+    scheduler.setInterval(TASK_BATTERY, BATTERY_SAMPLE_INTERVAL);
+    scheduler.setInterval(TASK_PROXIMITY, PROXIMITY_SWEEP_INTERVAL);
+    scheduler.setInterval(TASK_RELAY_BEACON, RELAY_BEACON_INTERVAL_MS);
+
+    TRACE_BUDGET(TRACE_GPS, TRACE_BUDGET_GPS_US);
+    TRACE_BUDGET(TRACE_IMU, TRACE_BUDGET_IMU_US);
+    TRACE_BUDGET(TRACE_TELEMETRY, TRACE_BUDGET_TELEMETRY_US);
+    TRACE_BUDGET(TRACE_LORA_RX, TRACE_BUDGET_LORA_RX_US);
+    TRACE_BUDGET(TRACE_BLE_UPDATE, TRACE_BUDGET_BLE_US);
+    TRACE_BUDGET(TRACE_FUSION, TRACE_BUDGET_FUSION_US);
+
+    // Load persisted configuration before the radios start
+    BLEConfigData config = bleConfig.getConfig();
+    if (configStore.load(config)) {
+        Serial.println("Loaded stored configuration");
+        bleConfig.setConfig(config);
+    }
+
+#if BRAVO_ROLE_COLLAR
+    size_t fenceLength = configStore.loadBlob(GEOFENCE_NVS_KEY, geofenceBlob,
+                                              sizeof(geofenceBlob));
+    if (fenceLength > 0 && geofence.decode(geofenceBlob, fenceLength)) {
+        Serial.println("Loaded stored geofences");
+    }
+#endif
+
+    uint8_t loraKey[CRYPTO_KEY_SIZE];
+    if (configStore.loadBlob(CRYPTO_NVS_KEY, loraKey, sizeof(loraKey)) == sizeof(loraKey)) {
+        startCrypto(loraKey);
+        memset(loraKey, 0, sizeof(loraKey));
+    } else {
+        LOG_WARN(LOG_CRYPTO_NO_KEY);
+    }
+
+    // Absolute time carried through deep sleep, if any
+    timeService.begin(GPS_PPS_PIN);
+    telemetry.setTimeService(&timeService);
 
     // Initialize all modules
     initializeModules();
+    profiler.begin();
+
+    applyConfig(bleConfig.getConfig());
+    bleConfig.setConfigCallback(onConfigChanged);
+    bleConfig.setCommandCallback(onBLECommand);
+#if BRAVO_ROLE_COLLAR
+    downlinkHandler.setCommandHandler(onDownlinkCommand);
+#endif
+
+    // The loop should run from buffers allocated above
+    memoryMonitor.lockHeap();
+
+    // Per-role footprint: image size, heap left after setup, and time from
+    // application start to the first loop pass (including the serial delay)
+    LOG_INFO(LOG_BOOT_DONE, DEVICE_TYPE_COLLAR ? "collar" : "dongle", ESP.getSketchSize(),
+             memoryMonitor.getStats().freeHeap, millis());
 }
 
 /**
  * @brief Arduino main loop function
  */
 void loop() {
+    TRACE_BEGIN(TRACE_LOOP);
+
     // Update GPS continuously
     handleGPS();
+    handleTime();
 
+#if BRAVO_ROLE_COLLAR
     // Update IMU periodically
     handleIMU();
+    handleDeadReckoning();
+#endif
 
     // Handle BLE updates
+    if (digitalRead(BLE_WAKE_BUTTON_PIN) == LOW) {
+        bleConfig.wake();
+    }
+    TRACE_BEGIN(TRACE_BLE_UPDATE);
+    memoryMonitor.enter(MEM_BLE);
     bleConfig.update();
+    memoryMonitor.enter(MEM_LOOP);
+    TRACE_END(TRACE_BLE_UPDATE);
 
-    // Handle OTA updates (if enabled)
-    // ota.handle();
+#if BRAVO_OTA
+    ota.handle();
+#endif
 
+#if BRAVO_ROLE_COLLAR
     // Send telemetry periodically
     handleTelemetry();
+#endif
 
-    // Check for incoming LoRa messages
+    // Check for incoming LoRa messages and forward relayed ones
     handleLoRaReceive();
+    handleRelay();
+
+    // Track the battery and adjust power modes
+    handleBattery();
 
     // Print status periodically
     printStatus();
+    handleStatusReport();
+    handleSerialCommand();
+    handleTraceDump();
+
+#if BRAVO_ROLE_COLLAR
+    // Small delay to prevent watchdog issues (shorter while streaming
+    // so the IMU can be sampled at up to 200 Hz)
+    delay(imuStream.isActive() ? 1 : 10);
+#else
+    // Herd cohesion and the herd queries from BLE
+    handleProximity();
+    handleHistoryQuery();
+    handleProximityQuery();
+    handleLatencyQuery();
 
     // Small delay to prevent watchdog issues
     delay(10);
+#endif
+
+    TRACE_END(TRACE_LOOP);
 }
@@ -0,0 +1,318 @@
+/**
+ * @file LoRaChannel.cpp
+ * @brief Simulated LoRa channel and radio implementation
+ */
+
+#ifdef BRAVO_NATIVE
+
+#include "netsim/LoRaChannel.h"
+#include <math.h>
+#include <algorithm>
+
+// ---------------------------------------------------------------------------
+// Channel
+// ---------------------------------------------------------------------------
+
+LoRaChannel::LoRaChannel(uint32_t seed)
+    : model(defaultModel()), random(seed), fading(0.0f, 1.0f), airtimeUs(0) {
+}
+
+ChannelModel LoRaChannel::defaultModel() {
+    ChannelModel defaults;
+    defaults.captureDb = NETSIM_CAPTURE_DB;
+    defaults.noiseFigureDb = NETSIM_NOISE_FIGURE_DB;
+    defaults.pathLoss1mDb = NETSIM_PATH_LOSS_1M_DB;
+    defaults.pathLossExponent = NETSIM_PATH_LOSS_EXPONENT;
+    defaults.shadowingDb = NETSIM_SHADOWING_DB;
+    return defaults;
+}
+
+void LoRaChannel::setModel(const ChannelModel& newModel) {
+    model = newModel;
+}
+
+uint32_t LoRaChannel::timeOnAirUs(uint8_t sf, long bw, size_t length) {
+    // Semtech SX1276 datasheet, section 4.1.1.7
+    double symbolUs = (double)(1UL << sf) * 1000000.0 / bw;
+    int lowDataRate = symbolUs > 16000.0 ? 1 : 0;
+    int crc = 1;
+    int implicitHeader = 0;
+
+    double preambleUs = (NETSIM_PREAMBLE_SYMBOLS + 4.25) * symbolUs;
+    double numerator = 8.0 * length - 4.0 * sf + 28 + 16 * crc - 20 * implicitHeader;
+    double denominator = 4.0 * (sf - 2 * lowDataRate);
+    double payloadSymbols = 8 + std::max(ceil(numerator / denominator) *
+                                         (NETSIM_CODING_RATE + 4), 0.0);
+
+    return (uint32_t)(preambleUs + payloadSymbols * symbolUs);
+}
+
+float LoRaChannel::demodFloorDb(uint8_t sf) {
+    // SX1276 datasheet table 13: -7.5 dB at SF7, 2.5 dB lower per step
+    return -7.5f - 2.5f * (sf - 7);
+}
+
+float LoRaChannel::noiseFloorDbm(long bw) {
+    return -174.0f + 10.0f * log10f((float)bw) + model.noiseFigureDb;
+}
+
+float LoRaChannel::meanRssi(int txPower, float distanceM) {
+    float distance = std::max(distanceM, 1.0f);
+    return txPower - model.pathLoss1mDb - 10.0f * model.pathLossExponent * log10f(distance);
+}
+
+void LoRaChannel::attach(ChannelRadio* radio) {
+    radios.push_back(radio);
+}
+
+void LoRaChannel::detach(ChannelRadio* radio) {
+    radios.erase(std::remove(radios.begin(), radios.end(), radio), radios.end());
+}
+
+uint32_t LoRaChannel::transmit(ChannelRadio* sender, const std::vector<uint8_t>& data) {
+    Packet packet;
+    packet.sender = sender;
+    packet.frequency = sender->getFrequency();
+    packet.spreadingFactor = sender->getSpreadingFactor();
+    packet.bandwidth = sender->getBandwidth();
+    packet.txPower = sender->getTxPower();
+    packet.fadingDb = model.shadowingDb > 0 ? fading(random) * model.shadowingDb : 0.0f;
+    packet.resolved = false;
+    packet.data = data;
+
+    uint32_t airtime = timeOnAirUs(packet.spreadingFactor, packet.bandwidth, data.size());
+    packet.startUs = sender->getTimeUs();
+    packet.endUs = packet.startUs + airtime;
+    airtimeUs += airtime;
+
+    packets.push_back(packet);
+    return airtime;
+}
+
+float LoRaChannel::rssiAt(const Packet& packet, const ChannelRadio& receiver) {
+    return meanRssi(packet.txPower, packet.sender->distanceTo(receiver)) + packet.fadingDb;
+}
+
+void LoRaChannel::resolveAt(const Packet& packet, ChannelRadio& receiver) {
+    ChannelRadioStats& stats = receiver.getStats();
+
+    if (!receiver.listenedThrough(packet.startUs, packet.endUs)) {
+        stats.missed++;
+        return;
+    }
+
+    float rssi = rssiAt(packet, receiver);
+    float snr = rssi - noiseFloorDbm(packet.bandwidth);
+    if (snr < demodFloorDb(packet.spreadingFactor)) {
+        stats.weak++;
+        return;
+    }
+
+    // Any same-PHY overlap within the capture margin destroys the packet
+    bool interfered = false;
+    for (size_t i = 0; i < packets.size(); i++) {
+        const Packet& other = packets[i];
+        if (&other == &packet || other.sender == &receiver ||
+            other.startUs >= packet.endUs || other.endUs <= packet.startUs ||
+            other.frequency != packet.frequency ||
+            other.spreadingFactor != packet.spreadingFactor ||
+            other.bandwidth != packet.bandwidth) {
+            continue;
+        }
+
+        if (rssiAt(other, receiver) > rssi - model.captureDb) {
+            stats.collided++;
+            return;
+        }
+        interfered = true;
+    }
+
+    if (interfered) {
+        stats.captured++;
+    }
+    receiver.deliver(packet.data, rssi, snr);
+}
+
+void LoRaChannel::resolve(uint64_t nowUs) {
+    for (size_t i = 0; i < packets.size(); i++) {
+        Packet& packet = packets[i];
+        if (packet.resolved || packet.endUs > nowUs) {
+            continue;
+        }
+
+        for (size_t r = 0; r < radios.size(); r++) {
+            if (radios[r] != packet.sender &&
+                radios[r]->tunedTo(packet.frequency, packet.spreadingFactor, packet.bandwidth)) {
+                resolveAt(packet, *radios[r]);
+            }
+        }
+        packet.resolved = true;
+    }
+
+    // Keep packets only while they can still overlap an unresolved one
+    size_t kept = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        if (!packets[i].resolved || packets[i].endUs + NETSIM_MAX_AIRTIME_US > nowUs) {
+            if (kept != i) {
+                packets[kept] = packets[i];
+            }
+            kept++;
+        }
+    }
+    packets.resize(kept);
+}
+
+uint64_t LoRaChannel::getAirtimeUs() {
+    return airtimeUs;
+}
+
+// ---------------------------------------------------------------------------
+// Radio
+// ---------------------------------------------------------------------------
+
+ChannelRadio::ChannelRadio(LoRaChannel& channel, SimClock& clock)
+    : channel(channel), clock(clock), frequency(0), spreadingFactor(7), bandwidth(125000),
+      txPower(17), x(0), y(0), receiving(false), rxStartUs(0), rxStopUs(0),
+      fifoFull(false), rxPosition(0), fifoRssi(0), fifoSnr(0), rssi(0), snr(0) {
+    memset(&stats, 0, sizeof(stats));
+    channel.attach(this);
+}
+
+ChannelRadio::~ChannelRadio() {
+    channel.detach(this);
+}
+
+bool ChannelRadio::begin(long freq) {
+    frequency = freq;
+    return true;
+}
+
+void ChannelRadio::setFrequency(long freq) {
+    frequency = freq;
+}
+
+void ChannelRadio::setSpreadingFactor(int sf) {
+    spreadingFactor = sf;
+}
+
+void ChannelRadio::setSignalBandwidth(long bw) {
+    bandwidth = bw;
+}
+
+void ChannelRadio::setTxPower(int power) {
+    txPower = power;
+}
+
+void ChannelRadio::enableCrc() {
+}
+
+void ChannelRadio::stopReceiving() {
+    if (receiving) {
+        receiving = false;
+        rxStopUs = clock.getTimeUs();
+    }
+}
+
+bool ChannelRadio::beginPacket() {
+    stopReceiving();
+    txPacket.clear();
+    return true;
+}
+
+size_t ChannelRadio::write(const uint8_t* data, size_t length) {
+    size_t room = SIM_RADIO_MAX_PACKET - txPacket.size();
+    length = std::min(length, room);
+    txPacket.insert(txPacket.end(), data, data + length);
+    return length;
+}
+
+bool ChannelRadio::endPacket() {
+    // Blocks until TX done, as LoRa.endPacket() does
+    uint32_t airtime = channel.transmit(this, txPacket);
+    txPacket.clear();
+    clock.advance(airtime);
+    return true;
+}
+
+int ChannelRadio::parsePacket() {
+    if (!receiving) {
+        receiving = true;
+        rxStartUs = clock.getTimeUs();
+    }
+
+    if (!fifoFull) {
+        return 0;
+    }
+
+    rxPacket.swap(fifo);
+    fifoFull = false;
+    rxPosition = 0;
+    rssi = fifoRssi;
+    snr = fifoSnr;
+    return rxPacket.size();
+}
+
+int ChannelRadio::available() {
+    return rxPacket.size() - rxPosition;
+}
+
+int ChannelRadio::read() {
+    if (rxPosition >= rxPacket.size()) {
+        return -1;
+    }
+    return rxPacket[rxPosition++];
+}
+
+int ChannelRadio::packetRssi() {
+    return (int)lroundf(rssi);
+}
+
+float ChannelRadio::packetSnr() {
+    return snr;
+}
+
+void ChannelRadio::sleep() {
+    stopReceiving();
+}
+
+void ChannelRadio::setPosition(float east, float north) {
+    x = east;
+    y = north;
+}
+
+float ChannelRadio::distanceTo(const ChannelRadio& other) const {
+    return hypotf(x - other.x, y - other.y);
+}
+
+bool ChannelRadio::tunedTo(long freq, uint8_t sf, long bw) const {
+    return frequency == freq && spreadingFactor == sf && bandwidth == bw;
+}
+
+bool ChannelRadio::listenedThrough(uint64_t startUs, uint64_t endUs) const {
+    if (rxStartUs > startUs) {
+        return false;
+    }
+    return receiving || rxStopUs >= endUs;
+}
+
+void ChannelRadio::deliver(const std::vector<uint8_t>& data, float packetRssi, float packetSnr) {
+    if (fifoFull) {
+        stats.overwritten++;
+    }
+
+    fifo = data;
+    fifoFull = true;
+    fifoRssi = packetRssi;
+    fifoSnr = packetSnr;
+    stats.delivered++;
+}
+
+ChannelRadioStats& ChannelRadio::getStats() {
+    return stats;
+}
+
+uint64_t ChannelRadio::getTimeUs() {
+    return clock.getTimeUs();
+}
+
+#endif // BRAVO_NATIVE
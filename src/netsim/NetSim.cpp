@@ -0,0 +1,520 @@
+/**
+ * @file NetSim.cpp
+ * @brief Discrete-event network simulator implementation
+ */
+
+#ifdef BRAVO_NATIVE
+
+#include "netsim/NetSim.h"
+#include <math.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+
+// Scheduled collar tasks (the subset of main.cpp's that touch the radio)
+enum SimCollarTask {
+    SIM_TASK_TELEMETRY
+};
+
+// Herd master key of the simulated herd
+static const uint8_t NETSIM_HERD_KEY[CRYPTO_KEY_SIZE] = {
+    0x42, 0x52, 0x41, 0x56, 0x4F, 0x2D, 0x4E, 0x45,
+    0x54, 0x53, 0x49, 0x4D, 0x2D, 0x4B, 0x45, 0x59
+};
+
+static const char* formatDeviceId(char* buffer, uint16_t index) {
+    snprintf(buffer, 16, NETSIM_ID_PREFIX "%04u", index);
+    return buffer;
+}
+
+static uint8_t acceptDownlink(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    // Collars acknowledge but keep their configuration, so the herd's
+    // traffic pattern stays what the sweep asked for
+    return DL_STATUS_OK;
+}
+
+static float percentileMs(const std::vector<uint32_t>& sortedUs, uint8_t percentile) {
+    if (sortedUs.empty()) {
+        return 0;
+    }
+    return sortedUs[(sortedUs.size() - 1) * percentile / 100] / 1000.0f;
+}
+
+// ---------------------------------------------------------------------------
+// GPS source
+// ---------------------------------------------------------------------------
+
+NmeaUart::NmeaUart(SimClock& clock)
+    : clock(clock), latitude(NETSIM_BASE_LATITUDE), longitude(NETSIM_BASE_LONGITUDE),
+      lastSecond(UINT64_MAX), length(0), position(0) {
+}
+
+bool NmeaUart::begin(uint32_t baud) {
+    return true;
+}
+
+void NmeaUart::setPosition(double lat, double lon) {
+    latitude = lat;
+    longitude = lon;
+}
+
+void NmeaUart::appendSentence(const char* body) {
+    uint8_t checksum = 0;
+    for (const char* c = body; *c; c++) {
+        checksum ^= *c;
+    }
+    length += snprintf(buffer + length, sizeof(buffer) - length, "$%s*%02X\r\n", body, checksum);
+}
+
+int NmeaUart::available() {
+    // A new fix arrives at the top of every second
+    uint64_t second = clock.getTimeUs() / NETSIM_GPS_PERIOD_US;
+    if (second != lastSecond && position >= length) {
+        lastSecond = second;
+
+        uint32_t timeOfDay = second % 86400;
+        char utc[16];
+        snprintf(utc, sizeof(utc), "%02u%02u%02u.00",
+                 timeOfDay / 3600, timeOfDay / 60 % 60, timeOfDay % 60);
+
+        // ddmm.mmmmm / dddmm.mmmmm, northern and eastern hemispheres
+        char lat[16];
+        char lon[16];
+        int latDeg = (int)latitude;
+        int lonDeg = (int)longitude;
+        snprintf(lat, sizeof(lat), "%02d%08.5f", latDeg, (latitude - latDeg) * 60.0);
+        snprintf(lon, sizeof(lon), "%03d%08.5f", lonDeg, (longitude - lonDeg) * 60.0);
+
+        char body[96];
+        length = 0;
+        position = 0;
+        snprintf(body, sizeof(body), "GPGGA,%s,%s,N,%s,E,1,08,0.9,545.4,M,46.9,M,,", utc, lat, lon);
+        appendSentence(body);
+        snprintf(body, sizeof(body), "GPRMC,%s,A,%s,N,%s,E,0.0,0.0,181026,,,A", utc, lat, lon);
+        appendSentence(body);
+    }
+
+    return length - position;
+}
+
+int NmeaUart::read() {
+    if (available() == 0) {
+        return -1;
+    }
+    return (uint8_t)buffer[position++];
+}
+
+size_t NmeaUart::write(const uint8_t* data, size_t count) {
+    // UBX configuration from the GPS module is accepted and ignored
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Collar
+// ---------------------------------------------------------------------------
+
+SimCollar::SimCollar(LoRaChannel& channel, uint16_t index, const NetSimConfig& config)
+    : radio(channel, clock), gpsUart(clock), lora(radio), gps(gpsUart), imu(imuSensor),
+      downlinkHandler(formatDeviceId(deviceId, index)), relay(deviceId, false),
+      crypto(deviceId, false), config(config),
+      booted(false), lastSendUs(0), sent(0), relayAirtimeUs(0) {
+}
+
+void SimCollar::setPosition(float x, float y) {
+    radio.setPosition(x, y);
+    gpsUart.setPosition(NETSIM_BASE_LATITUDE + y / NETSIM_METERS_PER_DEG,
+                        NETSIM_BASE_LONGITUDE + x / (NETSIM_METERS_PER_DEG *
+                                                     cos(NETSIM_BASE_LATITUDE * PI / 180.0)));
+}
+
+void SimCollar::boot() {
+    booted = true;
+    lora.begin();
+    lora.setPHY(LORA_BAND, config.spreadingFactor, config.bandwidth, config.txPower);
+    gps.begin();
+    imu.begin();
+    imu.readSensor();
+    profiler.begin();
+    downlinkHandler.setCommandHandler(acceptDownlink);
+    relay.setEnabled(config.relay);
+    relay.setPHY(config.spreadingFactor, config.bandwidth);
+    activitySummary.reset(millis());
+
+    uint8_t collarKey[CRYPTO_KEY_SIZE];
+    crypto.provisionKey(NETSIM_HERD_KEY, collarKey);
+    crypto.begin(collarKey, 0, 0);
+
+    // First report right after boot; boot times are spread by the simulator
+    scheduler.setInterval(SIM_TASK_TELEMETRY, config.telemetryIntervalMs);
+    scheduler.trigger(SIM_TASK_TELEMETRY);
+}
+
+uint64_t SimCollar::step() {
+    if (!booted) {
+        boot();
+    }
+
+    gps.update();
+
+    if (scheduler.isDue(SIM_TASK_TELEMETRY)) {
+        // The firmware's activity uplink; the IMU does not affect the radio,
+        // so the summary is empty but the record is full size
+        GPSData gpsData = gps.getData();
+        ActivitySummaryData summary = activitySummary.getSummary(millis());
+        activitySummary.reset(millis());
+        uint8_t record[TELEMETRY_MAX_UPLINK];
+        size_t recordLength = telemetry.encodeActivityUplink(&gpsData, summary, deviceId, 100,
+                                                             nullptr, nullptr,
+                                                             record, sizeof(record));
+
+        lastSendUs = clock.getTimeUs();
+        if (recordLength > 0 && sendUplink(record, recordLength)) {
+            sent++;
+            lora.openReceiveWindow(DOWNLINK_RX_WINDOW_MS);
+        }
+    }
+
+    if (lora.isReceiveWindowOpen() || relay.isEnabled()) {
+        if (lora.available()) {
+            uint8_t packet[256];
+            size_t length = lora.receiveData(packet, sizeof(packet));
+            uint32_t collarId;
+            if (Relay::isFrame(packet, length)) {
+                RelayHeader header;
+                relay.receive(packet, length, lora.getRSSI(), millis(), header);
+            } else if (crypto.open(packet, length, collarId) && Downlink::isFrame(packet, length)) {
+                uint8_t ack[DOWNLINK_MAX_FRAME];
+                size_t ackLength = downlinkHandler.handleFrame(packet, length, ack);
+                uint8_t sealed[CRYPTO_MAX_FRAME];
+                ackLength = ackLength > 0 ?
+                    crypto.seal(ack, ackLength, sealed, sizeof(sealed)) : 0;
+                if (ackLength > 0) {
+                    lora.sendData(sealed, ackLength);
+                }
+            }
+        }
+
+        uint8_t forward[RELAY_MAX_FRAME];
+        size_t forwardLength = relay.poll(millis(), forward, sizeof(forward));
+        if (forwardLength > 0) {
+            relayAirtimeUs += LoRaChannel::timeOnAirUs(config.spreadingFactor, config.bandwidth,
+                                                       forwardLength);
+            lora.sendData(forward, forwardLength);
+        }
+        return clock.getTimeUs() + NETSIM_LOOP_US;
+    }
+
+    // Idle until the next fix or report; the random offset is where in its
+    // loop period the firmware would notice the task is due
+    uint64_t now = clock.getTimeUs();
+    uint64_t untilFix = NETSIM_GPS_PERIOD_US - now % NETSIM_GPS_PERIOD_US;
+    uint64_t untilReport = scheduler.getTimeUntilDue(SIM_TASK_TELEMETRY) * 1000ULL +
+                           random(NETSIM_LOOP_US);
+    return now + std::min(untilFix, untilReport);
+}
+
+bool SimCollar::sendUplink(const uint8_t* payload, size_t length) {
+    // Same sealing and wrapping as the firmware's sendUplink()
+    uint8_t sealed[CRYPTO_MAX_FRAME];
+    size_t sealedLength = crypto.seal(payload, length, sealed, sizeof(sealed));
+    if (sealedLength == 0) {
+        return false;
+    }
+    if (!relay.isEnabled()) {
+        return lora.sendData(sealed, sealedLength);
+    }
+    uint8_t frame[RELAY_MAX_FRAME];
+    size_t frameLength = relay.wrap(sealed, sealedLength, frame, sizeof(frame));
+    return frameLength > 0 && lora.sendData(frame, frameLength);
+}
+
+CollarResult SimCollar::getResult() {
+    LoRaRadioStats stats = lora.getRadioStats();
+    profiler.setOnTime(ENERGY_LORA_TX, stats.txTimeMs);
+    profiler.setOnTime(ENERGY_LORA_RX, stats.rxTimeMs);
+    profiler.setOnTime(ENERGY_GPS, gps.getOnTimeMs());
+    EnergySummary energy = profiler.getEnergy();
+
+    float dayScale = energy.elapsedMs > 0 ? 86400000.0f / energy.elapsedMs : 0;
+
+    CollarResult result;
+    result.distanceM = 0;
+    result.sent = sent;
+    result.delivered = 0;
+    result.txTimeMs = stats.txTimeMs;
+    result.rxTimeMs = stats.rxTimeMs;
+    result.forwarded = relay.getStats().forwarded;
+    result.radioMAhPerDay = (energy.mAh[ENERGY_LORA_TX] + energy.mAh[ENERGY_LORA_RX]) * dayScale;
+    result.totalMAhPerDay = energy.totalMAh * dayScale;
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Dongle
+// ---------------------------------------------------------------------------
+
+SimDongle::SimDongle(LoRaChannel& channel, const NetSimConfig& config)
+    : radio(channel, clock), lora(radio), relay("SIM_DONGLE", true),
+      crypto("SIM_DONGLE", true), config(config),
+      delivered(-1), deliveredRelayed(false), deliveredBytes(0), nextBeaconUs(0) {
+}
+
+bool SimDongle::begin() {
+    if (!lora.begin()) {
+        return false;
+    }
+    relay.setEnabled(config.relay);
+    relay.setPHY(config.spreadingFactor, config.bandwidth);
+    crypto.begin(NETSIM_HERD_KEY, 0, 0);
+    return lora.setPHY(LORA_BAND, config.spreadingFactor, config.bandwidth, config.txPower);
+}
+
+uint64_t SimDongle::step() {
+    delivered = -1;
+
+    if (relay.isEnabled() && clock.getTimeUs() >= nextBeaconUs) {
+        nextBeaconUs = clock.getTimeUs() + RELAY_BEACON_INTERVAL_MS * 1000ULL;
+        uint8_t beacon[sizeof(RelayHeader)];
+        lora.sendData(beacon, relay.beacon(beacon));
+        lora.available();
+    }
+
+    if (lora.available()) {
+        uint8_t packet[256];
+        int length = lora.receiveData(packet, sizeof(packet) - 1);
+
+        // Unwrap the first copy of a relay frame; later copies are dropped
+        bool relayed = false;
+        bool wrapped = Relay::isFrame(packet, length);
+        RelayHeader header;
+        if (wrapped) {
+            if (!relay.receive(packet, length, lora.getRSSI(), millis(), header)) {
+                return clock.getTimeUs() + NETSIM_LOOP_US;
+            }
+            relayed = header.hops > 0;
+            length -= sizeof(RelayHeader);
+            memmove(packet, packet + sizeof(RelayHeader), length);
+        }
+
+        // Only sealed frames are trusted, as on a provisioned dongle
+        size_t openLength = length;
+        uint32_t sealedFor;
+        if (!crypto.open(packet, openLength, sealedFor)) {
+            return clock.getTimeUs() + NETSIM_LOOP_US;
+        }
+        length = openLength;
+
+        // Relayed uplinks count as seen once they authenticate, as in the firmware
+        if (wrapped) {
+            if (header.origin != sealedFor) {
+                return clock.getTimeUs() + NETSIM_LOOP_US;
+            }
+            relay.accept(header);
+        }
+
+        if (Downlink::isFrame(packet, length)) {
+            downlinkQueue.onAck(packet, length);
+        } else if (telemetry.parseActivityUplink(packet, length)) {
+            const char* sender = telemetry.getLastDeviceId();
+            if (strncmp(sender, NETSIM_ID_PREFIX, strlen(NETSIM_ID_PREFIX)) == 0) {
+                delivered = atoi(sender + strlen(NETSIM_ID_PREFIX));
+                deliveredRelayed = relayed;
+                deliveredBytes += length;
+            }
+
+            // The collar is listening right now: send anything queued for
+            // it, unless it was relayed and cannot hear us
+            uint8_t frame[DOWNLINK_MAX_FRAME];
+            size_t frameLength = 0;
+            if (relayed) {
+                downlinkQueue.addCollar(sealedFor);
+            } else {
+                frameLength = downlinkQueue.onUplink(sealedFor, frame);
+            }
+            uint8_t sealed[CRYPTO_MAX_FRAME];
+            frameLength = frameLength > 0 ?
+                crypto.seal(frame, frameLength, sealed, sizeof(sealed), sealedFor) : 0;
+            if (frameLength > 0) {
+                lora.sendData(sealed, frameLength);
+                lora.available();
+            }
+        }
+    }
+
+    return clock.getTimeUs() + NETSIM_LOOP_US;
+}
+
+int SimDongle::takeDelivered(bool& relayed) {
+    int index = delivered;
+    relayed = deliveredRelayed;
+    delivered = -1;
+    return index;
+}
+
+uint16_t SimDongle::queueHerdCommand(uint8_t opcode, const uint8_t* payload, uint8_t length) {
+    return downlinkQueue.enqueueAll(opcode, payload, length);
+}
+
+uint64_t SimDongle::getDeliveredBytes() {
+    return deliveredBytes;
+}
+
+DownlinkCampaignStats SimDongle::getCampaignStats() {
+    return downlinkQueue.getCampaignStats();
+}
+
+// ---------------------------------------------------------------------------
+// Simulation
+// ---------------------------------------------------------------------------
+
+NetSim::NetSim(const NetSimConfig& config) : config(config) {
+}
+
+NetSimConfig NetSim::defaultConfig() {
+    NetSimConfig defaults;
+    defaults.collars = 100;
+    defaults.spreadingFactor = LORA_SPREAD;
+    defaults.bandwidth = LORA_BANDWIDTH;
+    defaults.txPower = 17;
+    defaults.telemetryIntervalMs = 30000;
+    defaults.durationS = 3600;
+    defaults.radiusM = 2000;
+    defaults.downlinkAtS = 0;
+    defaults.seed = 1;
+    defaults.relay = false;
+    defaults.channel = LoRaChannel::defaultModel();
+    return defaults;
+}
+
+NetSimResult NetSim::run() {
+    typedef std::pair<uint64_t, uint16_t> Event;   // Wake-up time, node (0 = dongle)
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    randomSeed(config.seed);
+
+    LoRaChannel channel(config.seed);
+    channel.setModel(config.channel);
+
+    SimDongle dongle(channel, config);
+    setNativeClock(dongle.getClock());
+    dongle.begin();
+    events.push(Event(0, 0));
+
+    // Nodes hold references to their own clocks, so they never move
+    std::vector<std::unique_ptr<SimCollar> > collars;
+    for (uint16_t i = 0; i < config.collars; i++) {
+        collars.emplace_back(new SimCollar(channel, i, config));
+
+        float distance = config.radiusM * sqrtf(unit(rng));
+        float angle = 2.0f * PI * unit(rng);
+        collars[i]->setPosition(distance * cosf(angle), distance * sinf(angle));
+
+        // Collars power up at random points in the first reporting interval
+        uint64_t bootUs = (uint64_t)(unit(rng) * config.telemetryIntervalMs * 1000.0f);
+        collars[i]->getClock().advance(bootUs);
+        events.push(Event(bootUs, i + 1));
+    }
+
+    std::vector<uint32_t> delivered(config.collars, 0);
+    std::vector<uint32_t> latenciesUs;
+    uint32_t deliveredRelayed = 0;
+    uint64_t endUs = (uint64_t)config.durationS * 1000000ULL;
+    uint64_t downlinkUs = (uint64_t)config.downlinkAtS * 1000000ULL;
+    bool downlinkQueued = config.downlinkAtS == 0;
+
+    while (!events.empty() && events.top().first < endUs) {
+        Event event = events.top();
+        events.pop();
+
+        // Everything that ended on air before now has reached its receivers
+        channel.resolve(event.first);
+
+        SimClock& clock = event.second == 0 ? dongle.getClock() :
+                          collars[event.second - 1]->getClock();
+        if (clock.getTimeUs() < event.first) {
+            clock.advance(event.first - clock.getTimeUs());
+        }
+        setNativeClock(clock);
+
+        if (event.second != 0) {
+            events.push(Event(collars[event.second - 1]->step(), event.second));
+            continue;
+        }
+
+        if (!downlinkQueued && event.first >= downlinkUs) {
+            uint8_t powerMode = 0;      // POWER_MODE_NORMAL
+            dongle.queueHerdCommand(DL_CMD_POWER_MODE, &powerMode, 1);
+            downlinkQueued = true;
+        }
+
+        events.push(Event(dongle.step(), 0));
+
+        // Parsed at the start of the pass, before any downlink went out
+        bool relayed;
+        int index = dongle.takeDelivered(relayed);
+        if (index >= 0 && index < config.collars) {
+            delivered[index]++;
+            deliveredRelayed += relayed;
+            latenciesUs.push_back(event.first - collars[index]->getLastSendUs());
+        }
+    }
+    channel.resolve(endUs);
+
+    NetSimResult result;
+    result.offered = 0;
+    result.delivered = latenciesUs.size();
+    result.deliveredRelayed = deliveredRelayed;
+    result.duplicates = dongle.getRelayStats().duplicates;
+    result.forwarded = 0;
+    result.dongleRadio = dongle.getRadio().getStats();
+    result.channelLoad = (float)channel.getAirtimeUs() / endUs;
+
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    result.latencyP50Ms = percentileMs(latenciesUs, 50);
+    result.latencyP95Ms = percentileMs(latenciesUs, 95);
+    result.latencyP99Ms = percentileMs(latenciesUs, 99);
+    result.latencyMaxMs = percentileMs(latenciesUs, 100);
+
+    setNativeClock(dongle.getClock());
+    result.herd = dongle.getCampaignStats();
+
+    float radioTotal = 0;
+    float energyTotal = 0;
+    uint64_t relayAirtimeUs = 0;
+    result.radioMAhPerDayMax = 0;
+    for (uint16_t i = 0; i < config.collars; i++) {
+        // Bring every collar to the end time so energy covers the same span
+        SimClock& clock = collars[i]->getClock();
+        if (clock.getTimeUs() < endUs) {
+            clock.advance(endUs - clock.getTimeUs());
+        }
+        setNativeClock(clock);
+
+        CollarResult collar = collars[i]->getResult();
+        collar.distanceM = collars[i]->getRadio().distanceTo(dongle.getRadio());
+        collar.delivered = delivered[i];
+        result.offered += collar.sent;
+        result.forwarded += collar.forwarded;
+        relayAirtimeUs += collars[i]->getRelayAirtimeUs();
+        radioTotal += collar.radioMAhPerDay;
+        energyTotal += collar.totalMAhPerDay;
+        result.radioMAhPerDayMax = std::max(result.radioMAhPerDayMax, collar.radioMAhPerDay);
+        result.collars.push_back(collar);
+    }
+
+    result.deliveryRatio = result.offered ? (float)result.delivered / result.offered : 0;
+    result.relayAirtimeShare = channel.getAirtimeUs() ?
+                               (float)relayAirtimeUs / channel.getAirtimeUs() : 0;
+    result.radioMAhPerDayAvg = config.collars ? radioTotal / config.collars : 0;
+    result.totalMAhPerDayAvg = config.collars ? energyTotal / config.collars : 0;
+
+    result.goodputBps = dongle.getDeliveredBytes() * 8.0f / config.durationS;
+
+    setNativeClock(dongle.getClock());
+    return result;
+}
+
+#endif // BRAVO_NATIVE
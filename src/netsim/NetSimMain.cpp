@@ -0,0 +1,190 @@
+/**
+ * @file NetSimMain.cpp
+ * @brief Command line driver for the network simulator
+ *
+ * Runs every combination of the listed parameters and prints one CSV row
+ * per run to stdout. Module log output goes to stderr with --verbose.
+ *
+ * Usage: bravo_netsim [options]
+ *   --collars N[,N...]     Herd sizes (default 100)
+ *   --sf SF[,SF...]        Spreading factors (default 7)
+ *   --bw KHZ[,KHZ...]      Bandwidths in kHz (default 125)
+ *   --interval S[,S...]    Telemetry intervals in seconds (default 30)
+ *   --duration S           Simulated time per run (default 3600)
+ *   --radius M             Herd radius around the dongle (default 2000)
+ *   --power DBM            TX power (default 17)
+ *   --downlink-at S        Queue a herd-wide downlink at this time
+ *   --capture DB           Capture threshold (default 6)
+ *   --exponent N           Path loss exponent (default 2.7)
+ *   --shadowing DB         Fading standard deviation (default 4)
+ *   --seed N               Random seed (default 1)
+ *   --relay 0|1[,0|1]      Collar relay mode off/on (default 0)
+ *   --per-collar FILE      Also write one CSV row per collar and run
+ *   --verbose              Show module log output on stderr
+ */
+
+#ifdef BRAVO_NATIVE
+
+#include <Arduino.h>
+#include <vector>
+#include "netsim/NetSim.h"
+
+/**
+ * @brief Parse a comma-separated list of numbers
+ * @param text List text
+ * @param values Parsed values (appended)
+ * @return true if every entry is a number, false otherwise
+ */
+static bool parseList(const char* text, std::vector<double>& values) {
+    values.clear();
+    while (*text) {
+        char* end;
+        double value = strtod(text, &end);
+        if (end == text) {
+            return false;
+        }
+        values.push_back(value);
+        text = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+static void printUsage() {
+    fprintf(stderr,
+            "usage: bravo_netsim [--collars N,..] [--sf SF,..] [--bw KHZ,..] [--interval S,..]\n"
+            "                    [--duration S] [--radius M] [--power DBM] [--downlink-at S]\n"
+            "                    [--capture DB] [--exponent N] [--shadowing DB] [--seed N]\n"
+            "                    [--relay 0|1,..] [--per-collar FILE] [--verbose]\n");
+}
+
+int main(int argc, char** argv) {
+    NetSimConfig base = NetSim::defaultConfig();
+    std::vector<double> collarCounts(1, base.collars);
+    std::vector<double> spreadingFactors(1, base.spreadingFactor);
+    std::vector<double> bandwidthsKHz(1, base.bandwidth / 1000.0);
+    std::vector<double> intervalsS(1, base.telemetryIntervalMs / 1000.0);
+    std::vector<double> relayModes(1, base.relay);
+    const char* perCollarPath = nullptr;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (strcmp(option, "--verbose") == 0) {
+            verbose = true;
+            continue;
+        }
+
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        bool ok = true;
+        if (strcmp(option, "--collars") == 0) {
+            ok = parseList(value, collarCounts);
+        } else if (strcmp(option, "--sf") == 0) {
+            ok = parseList(value, spreadingFactors);
+        } else if (strcmp(option, "--bw") == 0) {
+            ok = parseList(value, bandwidthsKHz);
+        } else if (strcmp(option, "--interval") == 0) {
+            ok = parseList(value, intervalsS);
+        } else if (strcmp(option, "--duration") == 0) {
+            base.durationS = atoi(value);
+        } else if (strcmp(option, "--radius") == 0) {
+            base.radiusM = atof(value);
+        } else if (strcmp(option, "--power") == 0) {
+            base.txPower = atoi(value);
+        } else if (strcmp(option, "--downlink-at") == 0) {
+            base.downlinkAtS = atoi(value);
+        } else if (strcmp(option, "--capture") == 0) {
+            base.channel.captureDb = atof(value);
+        } else if (strcmp(option, "--exponent") == 0) {
+            base.channel.pathLossExponent = atof(value);
+        } else if (strcmp(option, "--shadowing") == 0) {
+            base.channel.shadowingDb = atof(value);
+        } else if (strcmp(option, "--seed") == 0) {
+            base.seed = atoi(value);
+        } else if (strcmp(option, "--relay") == 0) {
+            ok = parseList(value, relayModes);
+        } else if (strcmp(option, "--per-collar") == 0) {
+            perCollarPath = value;
+        } else {
+            ok = false;
+        }
+
+        if (!ok || base.durationS == 0) {
+            printUsage();
+            return 2;
+        }
+        i++;
+    }
+
+    Serial.setOutput(verbose ? stderr : nullptr);
+
+    FILE* perCollar = nullptr;
+    if (perCollarPath) {
+        perCollar = fopen(perCollarPath, "w");
+        if (!perCollar) {
+            fprintf(stderr, "cannot write %s\n", perCollarPath);
+            return 1;
+        }
+        fprintf(perCollar, "collars,sf,bw_khz,interval_s,relay,collar,distance_m,sent,delivered,"
+                           "forwarded,tx_ms,rx_ms,radio_mah_day,total_mah_day\n");
+    }
+
+    printf("collars,sf,bw_khz,interval_s,relay,offered,delivered,pdr,collided,captured,weak,"
+           "missed,overwritten,load,goodput_bps,lat_p50_ms,lat_p95_ms,lat_p99_ms,lat_max_ms,"
+           "radio_mah_day_avg,radio_mah_day_max,total_mah_day_avg,herd_acked,herd_targets,herd_ms,"
+           "relayed,forwarded,duplicates,relay_airtime\n");
+
+    for (size_t c = 0; c < collarCounts.size(); c++) {
+        for (size_t s = 0; s < spreadingFactors.size(); s++) {
+            for (size_t b = 0; b < bandwidthsKHz.size(); b++) {
+                for (size_t t = 0; t < intervalsS.size(); t++) {
+                    for (size_t r = 0; r < relayModes.size(); r++) {
+                        NetSimConfig config = base;
+                        config.collars = (uint16_t)collarCounts[c];
+                        config.spreadingFactor = (uint8_t)spreadingFactors[s];
+                        config.bandwidth = (long)(bandwidthsKHz[b] * 1000);
+                        config.telemetryIntervalMs = (uint32_t)(intervalsS[t] * 1000);
+                        config.relay = relayModes[r] != 0;
+
+                        NetSim sim(config);
+                        NetSimResult result = sim.run();
+
+                        printf("%u,%u,%g,%g,%u,%u,%u,%.4f,%u,%u,%u,%u,%u,%.4f,%.1f,%.1f,%.1f,%.1f,"
+                               "%.1f,%.3f,%.3f,%.1f,%u,%u,%u,%u,%u,%u,%.4f\n",
+                               config.collars, config.spreadingFactor, bandwidthsKHz[b],
+                               intervalsS[t], config.relay, result.offered, result.delivered,
+                               result.deliveryRatio, result.dongleRadio.collided,
+                               result.dongleRadio.captured, result.dongleRadio.weak,
+                               result.dongleRadio.missed, result.dongleRadio.overwritten,
+                               result.channelLoad, result.goodputBps, result.latencyP50Ms,
+                               result.latencyP95Ms, result.latencyP99Ms, result.latencyMaxMs,
+                               result.radioMAhPerDayAvg, result.radioMAhPerDayMax,
+                               result.totalMAhPerDayAvg, result.herd.acked, result.herd.targets,
+                               result.herd.herdLatencyMs, result.deliveredRelayed,
+                               result.forwarded, result.duplicates, result.relayAirtimeShare);
+                        fflush(stdout);
+
+                        for (size_t i = 0; perCollar && i < result.collars.size(); i++) {
+                            const CollarResult& collar = result.collars[i];
+                            fprintf(perCollar, "%u,%u,%g,%g,%u,%u,%.0f,%u,%u,%u,%u,%u,%.3f,%.1f\n",
+                                    config.collars, config.spreadingFactor, bandwidthsKHz[b],
+                                    intervalsS[t], config.relay, (unsigned)i, collar.distanceM,
+                                    collar.sent, collar.delivered, collar.forwarded,
+                                    collar.txTimeMs, collar.rxTimeMs, collar.radioMAhPerDay,
+                                    collar.totalMAhPerDay);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (perCollar) {
+        fclose(perCollar);
+    }
+    return 0;
+}
+
+#endif // BRAVO_NATIVE
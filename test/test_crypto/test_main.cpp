@@ -0,0 +1,194 @@
+/**
+ * @file test_main.cpp
+ * @brief FrameCrypto tests: AES-CMAC and AES-CTR known answers, and the
+ * bounded counter search after a dongle reboot
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "FrameCrypto.h"
+#include "hal/LinuxHAL.h"
+
+static SimClock simClock;
+
+// RFC 4493 and NIST SP 800-38A share the key and the message blocks
+static const uint8_t KEY[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+};
+
+static const uint8_t MESSAGE[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+};
+
+static const uint8_t HERD_KEY[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+};
+
+static void checkCmac(size_t length, const uint8_t* expected) {
+    FrameCrypto crypto("BRAVO_DONGLE", true);
+    uint8_t tag[16];
+    TEST_ASSERT_TRUE(crypto.cmac(KEY, MESSAGE, length, tag));
+    TEST_ASSERT_EQUAL(0, memcmp(tag, expected, sizeof(tag)));
+}
+
+void test_cmac_rfc4493_empty() {
+    static const uint8_t tag[16] = {
+        0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28,
+        0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46,
+    };
+    checkCmac(0, tag);
+}
+
+void test_cmac_rfc4493_one_block() {
+    static const uint8_t tag[16] = {
+        0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44,
+        0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c,
+    };
+    checkCmac(16, tag);
+}
+
+void test_cmac_rfc4493_partial_block() {
+    static const uint8_t tag[16] = {
+        0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30,
+        0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27,
+    };
+    checkCmac(40, tag);
+}
+
+void test_cmac_rfc4493_four_blocks() {
+    static const uint8_t tag[16] = {
+        0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92,
+        0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe,
+    };
+    checkCmac(64, tag);
+}
+
+void test_cmac_too_long() {
+    FrameCrypto crypto("BRAVO_DONGLE", true);
+    uint8_t message[CRYPTO_MAX_FRAME + 1];
+    uint8_t tag[16];
+    memset(message, 0, sizeof(message));
+    TEST_ASSERT_FALSE(crypto.cmac(KEY, message, sizeof(message), tag));
+}
+
+// NIST SP 800-38A F.5.1, CTR-AES128.Encrypt
+void test_ctr_sp800_38a() {
+    static const uint8_t ciphertext[64] = {
+        0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26, 0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+        0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff, 0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+        0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e, 0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+        0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1, 0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee,
+    };
+    static const uint8_t initialCounter[16] = {
+        0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+        0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+    };
+    FrameCrypto crypto("BRAVO_DONGLE", true);
+
+    uint8_t data[64];
+    uint8_t counter[16];
+    memcpy(data, MESSAGE, sizeof(data));
+    memcpy(counter, initialCounter, sizeof(counter));
+    crypto.ctr(KEY, counter, data, sizeof(data));
+    TEST_ASSERT_EQUAL(0, memcmp(data, ciphertext, sizeof(data)));
+
+    // A partial last block uses the start of its key stream, and the same
+    // counter decrypts
+    memcpy(data, ciphertext, sizeof(data));
+    memcpy(counter, initialCounter, sizeof(counter));
+    crypto.ctr(KEY, counter, data, 60);
+    TEST_ASSERT_EQUAL(0, memcmp(data, MESSAGE, 60));
+    TEST_ASSERT_EQUAL(0, memcmp(data + 60, ciphertext + 60, 4));
+}
+
+/**
+ * @brief Seal an uplink from a collar whose counter starts at txCounter
+ */
+static size_t sealFrom(const char* collarId, uint32_t txCounter, uint8_t* frame) {
+    FrameCrypto collar(collarId, false);
+    uint8_t key[CRYPTO_KEY_SIZE];
+    collar.provisionKey(HERD_KEY, key);
+    collar.begin(key, txCounter, 0);
+    static const uint8_t payload[] = "uplink";
+    return collar.seal(payload, sizeof(payload), frame, CRYPTO_MAX_FRAME);
+}
+
+void test_round_trip_and_replay() {
+    FrameCrypto dongle("BRAVO_DONGLE", true);
+    uint8_t key[CRYPTO_KEY_SIZE];
+    dongle.provisionKey(HERD_KEY, key);
+    TEST_ASSERT_TRUE(dongle.begin(key, 0, 0));
+
+    uint8_t frame[CRYPTO_MAX_FRAME];
+    uint8_t copy[CRYPTO_MAX_FRAME];
+    size_t length = sealFrom("BRAVO_001", 0, frame);
+    TEST_ASSERT_EQUAL(sizeof("uplink") + CRYPTO_OVERHEAD, length);
+    memcpy(copy, frame, length);
+
+    size_t opened = length;
+    uint32_t collarId;
+    TEST_ASSERT_TRUE(dongle.open(frame, opened, collarId));
+    TEST_ASSERT_EQUAL(sizeof("uplink"), opened);
+    TEST_ASSERT_EQUAL_STRING("uplink", (const char*)frame);
+
+    opened = length;
+    TEST_ASSERT_FALSE(dongle.open(copy, opened, collarId));
+    TEST_ASSERT_EQUAL_UINT32(1, dongle.getStats().replayed);
+}
+
+void test_resync_window_is_bounded() {
+    setNativeClock(simClock);
+    FrameCrypto dongle("BRAVO_DONGLE", true);
+    uint8_t key[CRYPTO_KEY_SIZE];
+    dongle.provisionKey(HERD_KEY, key);
+    TEST_ASSERT_TRUE(dongle.begin(key, 0, 0));
+
+    uint8_t frame[CRYPTO_MAX_FRAME];
+    size_t length;
+    uint32_t collarId;
+
+    // Within the first epochs: found without the deep search
+    length = sealFrom("BRAVO_001", (CRYPTO_RESYNC_EPOCHS - 1) * 0x10000UL, frame);
+    TEST_ASSERT_TRUE(dongle.open(frame, length, collarId));
+    TEST_ASSERT_EQUAL_UINT32(0, dongle.getStats().deepResyncs);
+
+    // Further on: the deep search finds it once
+    uint32_t farCounter = (CRYPTO_RESYNC_EPOCHS + 10) * 0x10000UL;
+    length = sealFrom("BRAVO_002", farCounter, frame);
+    TEST_ASSERT_TRUE(dongle.open(frame, length, collarId));
+    TEST_ASSERT_EQUAL_UINT32(1, dongle.getStats().deepResyncs);
+
+    // Another such collar waits until the next deep search is due
+    length = sealFrom("BRAVO_003", farCounter, frame);
+    TEST_ASSERT_FALSE(dongle.open(frame, length, collarId));
+    TEST_ASSERT_EQUAL_UINT32(1, dongle.getStats().deepResyncs);
+    TEST_ASSERT_EQUAL_UINT32(1, dongle.getStats().badMic);
+
+    simClock.advance((uint64_t)CRYPTO_DEEP_RESYNC_MS * 1000);
+    length = sealFrom("BRAVO_003", farCounter + 1, frame);
+    TEST_ASSERT_TRUE(dongle.open(frame, length, collarId));
+    TEST_ASSERT_EQUAL_UINT32(2, dongle.getStats().deepResyncs);
+
+    // Once synced, a collar is tracked without searching
+    length = sealFrom("BRAVO_003", farCounter + 2, frame);
+    TEST_ASSERT_TRUE(dongle.open(frame, length, collarId));
+    TEST_ASSERT_EQUAL_UINT32(2, dongle.getStats().deepResyncs);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cmac_rfc4493_empty);
+    RUN_TEST(test_cmac_rfc4493_one_block);
+    RUN_TEST(test_cmac_rfc4493_partial_block);
+    RUN_TEST(test_cmac_rfc4493_four_blocks);
+    RUN_TEST(test_cmac_too_long);
+    RUN_TEST(test_ctr_sp800_38a);
+    RUN_TEST(test_round_trip_and_replay);
+    RUN_TEST(test_resync_window_is_bounded);
+    return UNITY_END();
+}
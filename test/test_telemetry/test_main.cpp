@@ -0,0 +1,178 @@
+/**
+ * @file test_main.cpp
+ * @brief Telemetry tests: the LoRa activity record fits one sealed,
+ * relay-wrapped frame and decodes to what was sent
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "Telemetry.h"
+
+static Telemetry telemetry;
+
+// A 31-character ID, the longest a record carries
+static const char* LONGEST_ID = "BRAVO_COLLAR_WITH_A_LONG_NAME_1";
+
+static GPSData worstFix() {
+    GPSData fix;
+    fix.latitude = -89.9999999;
+    fix.longitude = -179.9999999;
+    fix.altitude = 8848.9;
+    fix.speed = 6553.5;
+    fix.course = 359.99;
+    fix.satellites = 255;
+    fix.hdop = UINT32_MAX;
+    fix.valid = true;
+    fix.timestamp = 0;
+    return fix;
+}
+
+static ActivitySummaryData worstSummary() {
+    ActivitySummaryData summary;
+    summary.startMs = 0;
+    summary.durationMs = UINT32_MAX;
+    summary.samples = UINT32_MAX;
+    for (uint8_t i = 0; i < ACTIVITY_HISTOGRAM_BINS; i++) {
+        summary.histogram[i] = UINT32_MAX / ACTIVITY_HISTOGRAM_BINS;
+    }
+    for (uint8_t i = 0; i < ACTIVITY_CLASS_COUNT; i++) {
+        summary.classMs[i] = UINT32_MAX;
+    }
+    summary.peakAccel = 156.9f;
+    summary.motionEvents = UINT16_MAX;
+    summary.steps = UINT16_MAX;
+    summary.meanActivity = 100;
+    return summary;
+}
+
+static DeadReckoningEstimate worstEstimate() {
+    DeadReckoningEstimate estimate;
+    estimate.valid = true;
+    estimate.latitude = 89.9999999;
+    estimate.longitude = 179.9999999;
+    estimate.uncertaintyM = 6553.5f;
+    estimate.steps = UINT16_MAX;
+    estimate.ageMs = UINT32_MAX;
+    return estimate;
+}
+
+void test_worst_case_activity_record_fits_uplink() {
+    GPSData fix = worstFix();
+    ActivitySummaryData summary = worstSummary();
+    DeadReckoningEstimate estimate = worstEstimate();
+    LatencyReport latency = { UINT32_MAX, UINT32_MAX, UINT32_MAX };
+
+    uint8_t record[RELAY_MAX_FRAME];
+    size_t length = telemetry.encodeActivityUplink(&fix, summary, LONGEST_ID, 100,
+                                                   &estimate, &latency,
+                                                   record, sizeof(record));
+    TEST_ASSERT_GREATER_THAN(0, length);
+    TEST_ASSERT_LESS_OR_EQUAL(TELEMETRY_MAX_UPLINK, length);
+
+    // Longer IDs are truncated, not allowed to grow the record
+    length = telemetry.encodeActivityUplink(&fix, summary,
+                                            "BRAVO_COLLAR_WITH_A_MUCH_LONGER_NAME_THAN_FITS",
+                                            100, &estimate, &latency,
+                                            record, sizeof(record));
+    TEST_ASSERT_LESS_OR_EQUAL(TELEMETRY_MAX_UPLINK, length);
+}
+
+void test_activity_uplink_too_small_buffer() {
+    GPSData fix = worstFix();
+    uint8_t record[sizeof(ActivityUplink)];
+    TEST_ASSERT_EQUAL(0, telemetry.encodeActivityUplink(&fix, worstSummary(), LONGEST_ID, 100,
+                                                        nullptr, nullptr,
+                                                        record, sizeof(record)));
+}
+
+void test_activity_uplink_round_trip() {
+    GPSData fix = worstFix();
+    fix.latitude = 40.7128;
+    fix.longitude = -74.0060;
+    ActivitySummaryData summary = worstSummary();
+    DeadReckoningEstimate estimate = worstEstimate();
+    LatencyReport latency = { 2140, 4, 62 };
+
+    uint8_t record[TELEMETRY_MAX_UPLINK];
+    size_t length = telemetry.encodeActivityUplink(&fix, summary, LONGEST_ID, 85,
+                                                   &estimate, &latency,
+                                                   record, sizeof(record));
+    TEST_ASSERT_TRUE(Telemetry::isActivityUplink(record, length));
+
+    ActivityUplink r;
+    memcpy(&r, record, sizeof(r));
+    TEST_ASSERT_EQUAL(ACTIVITY_UPLINK_FIX | ACTIVITY_UPLINK_DR | ACTIVITY_UPLINK_LATENCY, r.flags);
+    TEST_ASSERT_EQUAL(407128000, r.latitude);
+    TEST_ASSERT_EQUAL(-740060000, r.longitude);
+    TEST_ASSERT_EQUAL(2140, r.sampleMs);
+    TEST_ASSERT_EQUAL(4, r.queueMs);
+    TEST_ASSERT_EQUAL(62, r.airMs);
+    TEST_ASSERT_EQUAL(85, r.battery);
+    TEST_ASSERT_EQUAL(UINT16_MAX, r.steps);
+
+    // UINT32_MAX ms rounds to 0.1 s without wrapping
+    TEST_ASSERT_EQUAL_UINT32(42949673, r.periodDs);
+    for (uint8_t i = 0; i < ACTIVITY_CLASS_COUNT; i++) {
+        TEST_ASSERT_EQUAL_UINT32(42949673, r.classDs[i]);
+    }
+
+    Telemetry dongle;
+    TEST_ASSERT_TRUE(dongle.parseActivityUplink(record, length));
+    TEST_ASSERT_EQUAL(TELEMETRY_ACTIVITY, dongle.getLastType());
+    TEST_ASSERT_EQUAL_STRING(LONGEST_ID, dongle.getLastDeviceId());
+
+    double latitude, longitude;
+    TEST_ASSERT_TRUE(dongle.getLastPosition(latitude, longitude));
+    TEST_ASSERT_DOUBLE_WITHIN(1e-7, 40.7128, latitude);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-7, -74.0060, longitude);
+
+    LatencyReport stages;
+    TEST_ASSERT_TRUE(dongle.getLastLatency(stages));
+    TEST_ASSERT_EQUAL_UINT32(2140, stages.sampleMs);
+    TEST_ASSERT_EQUAL_UINT32(4, stages.queueMs);
+    TEST_ASSERT_EQUAL_UINT32(62, stages.airMs);
+
+    // Without absolute time the stamp is the collar's millis()
+    uint32_t hourMs;
+    TEST_ASSERT_FALSE(dongle.getLastTime(hourMs));
+
+    // With it, ms into the UTC hour
+    ActivityUplink synced = r;
+    synced.flags |= ACTIVITY_UPLINK_ABS_TIME;
+    synced.time = 1234567;
+    memcpy(record, &synced, sizeof(synced));
+    TEST_ASSERT_TRUE(dongle.parseActivityUplink(record, length));
+    TEST_ASSERT_TRUE(dongle.getLastTime(hourMs));
+    TEST_ASSERT_EQUAL_UINT32(1234567, hourMs);
+
+    // A truncated record is rejected
+    TEST_ASSERT_FALSE(dongle.parseActivityUplink(record, length - 1));
+}
+
+void test_activity_uplink_without_position() {
+    uint8_t record[TELEMETRY_MAX_UPLINK];
+    size_t length = telemetry.encodeActivityUplink(nullptr, worstSummary(), "BRAVO_001", 85,
+                                                   nullptr, nullptr,
+                                                   record, sizeof(record));
+    ActivityUplink r;
+    memcpy(&r, record, sizeof(r));
+    TEST_ASSERT_EQUAL(0, r.flags);
+    TEST_ASSERT_EQUAL(0, r.latitude);
+    TEST_ASSERT_EQUAL(sizeof(ActivityUplink) + 9, length);
+
+    Telemetry dongle;
+    TEST_ASSERT_TRUE(dongle.parseActivityUplink(record, length));
+    double latitude, longitude;
+    TEST_ASSERT_FALSE(dongle.getLastPosition(latitude, longitude));
+    LatencyReport stages;
+    TEST_ASSERT_FALSE(dongle.getLastLatency(stages));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_worst_case_activity_record_fits_uplink);
+    RUN_TEST(test_activity_uplink_too_small_buffer);
+    RUN_TEST(test_activity_uplink_round_trip);
+    RUN_TEST(test_activity_uplink_without_position);
+    return UNITY_END();
+}
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Compare two B.R.A.V.O. benchmark runs.
+
+Reads the "BENCH {json}" lines printed by the bench_native / bench_esp32
+builds (other log lines are ignored) and prints per-benchmark changes in
+time, cycles and allocations. Exits with status 1 if any benchmark got
+slower, or allocates more, than the threshold allows.
+
+Usage:
+    tools/bench_compare.py base.txt new.txt [--threshold 5] [--json]
+"""
+
+import argparse
+import json
+import sys
+
+PREFIX = "BENCH "
+
+
+def load(path):
+    header = {}
+    results = {}
+    with open(path) as f:
+        for line in f:
+            start = line.find(PREFIX)
+            if start < 0:
+                continue
+            try:
+                record = json.loads(line[start + len(PREFIX):])
+            except ValueError:
+                continue
+            if "bench" in record:
+                results[record["bench"]] = record
+            elif "suite" in record:
+                header = record
+    return header, results
+
+
+def change(base, new):
+    if base == 0:
+        return 0.0 if new == 0 else float("inf")
+    return (new - base) * 100.0 / base
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="allowed slowdown in percent (default 5)")
+    parser.add_argument("--json", action="store_true",
+                        help="print the comparison as JSON")
+    args = parser.parse_args()
+
+    base_header, base = load(args.base)
+    new_header, new = load(args.new)
+
+    if base_header.get("target") != new_header.get("target"):
+        print("warning: comparing %s against %s" % (base_header.get("target"),
+                                                    new_header.get("target")), file=sys.stderr)
+
+    # Cycles are the stable metric on the device; wall time elsewhere
+    metric = "cycles_per_op" if base_header.get("cycle_source") == "ccount" else "ns_per_op"
+
+    rows = []
+    regressions = 0
+    for name in sorted(set(base) | set(new)):
+        if name not in base or name not in new:
+            rows.append({"bench": name, "status": "added" if name in new else "removed"})
+            continue
+
+        b, n = base[name], new[name]
+        time_change = change(b[metric], n[metric])
+        alloc_change = n["alloc_bytes_per_op"] - b["alloc_bytes_per_op"]
+        regressed = time_change > args.threshold or alloc_change > 0
+        regressions += regressed
+        rows.append({
+            "bench": name,
+            "metric": metric,
+            "base": b[metric],
+            "new": n[metric],
+            "change_pct": round(time_change, 2),
+            "alloc_bytes_base": b["alloc_bytes_per_op"],
+            "alloc_bytes_new": n["alloc_bytes_per_op"],
+            "status": "regressed" if regressed else "ok",
+        })
+
+    code_base = base_header.get("code_bytes", 0)
+    code_new = new_header.get("code_bytes", 0)
+
+    if args.json:
+        json.dump({"metric": metric, "code_bytes_base": code_base, "code_bytes_new": code_new,
+                   "regressions": regressions, "results": rows}, sys.stdout, indent=2)
+        print()
+    else:
+        print("%-26s %12s %12s %8s %10s %10s  %s" % ("benchmark", "base", "new", "change",
+                                                   "alloc B", "alloc B'", "status"))
+        for row in rows:
+            if "metric" not in row:
+                print("%-26s %s" % (row["bench"], row["status"]))
+                continue
+            print("%-26s %12.1f %12.1f %7.1f%% %10.1f %10.1f  %s" % (
+                row["bench"], row["base"], row["new"], row["change_pct"],
+                row["alloc_bytes_base"], row["alloc_bytes_new"], row["status"]))
+        print("metric: %s, code size: %d -> %d bytes (%+d)" % (metric, code_base, code_new,
+                                                              code_new - code_base))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
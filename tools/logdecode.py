@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""Decode B.R.A.V.O. binary log records from a serial log.
+
+Reads a serial log captured with hex log output enabled (serial key 'l'),
+which holds lines of the form
+
+    LOG <hex record>
+
+and prints each record as the text the device would have formatted:
+
+    I [12.345] Telemetry sent via LoRa
+
+Format strings are read from include/LogFormats.h, so decode with the
+LogFormats.h of the firmware that produced the log. Other lines are passed
+through unchanged (use --only to drop them), so a raw `pio device monitor`
+capture can be used directly.
+
+Usage:
+    tools/logdecode.py serial.log
+    tools/logdecode.py serial.log --formats include/LogFormats.h --only
+"""
+
+import argparse
+import binascii
+import os
+import re
+import struct
+import sys
+
+DEFAULT_FORMATS = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               "..", "include", "LogFormats.h")
+
+LEVEL_CHARS = "-EWID"
+
+ENTRY = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)[hlzjt]*([diuxXcfeEgGs%])")
+
+
+def load_formats(path):
+    formats = []
+    with open(path) as f:
+        for match in ENTRY.finditer(f.read()):
+            text = match.group(2).encode().decode("unicode_escape")
+            formats.append((match.group(1), text))
+    return formats
+
+
+def parse_args(data):
+    args = []
+    pos = 0
+    while pos < len(data):
+        tag = chr(data[pos])
+        if tag == "s":
+            length = data[pos + 1]
+            args.append(data[pos + 2:pos + 2 + length].decode("utf-8", "replace"))
+            pos += 2 + length
+        elif tag in "iuf":
+            code = {"i": "<i", "u": "<I", "f": "<f"}[tag]
+            args.append(struct.unpack_from(code, data, pos + 1)[0])
+            pos += 5
+        else:
+            break
+    return args
+
+
+def format_message(fmt, args):
+    # Same rules as Logger::formatRecord: a missing or mismatched argument
+    # prints as "?"
+    values = iter(args)
+
+    def convert(match):
+        flags, conversion = match.group(1), match.group(2)
+        if conversion == "%":
+            return "%"
+        value = next(values, None)
+        if value is None or isinstance(value, str) != (conversion == "s"):
+            return "?"
+        if conversion == "s":
+            return value
+        if conversion in "feEgG":
+            return ("%" + flags + conversion) % float(value)
+        if conversion == "c":
+            return chr(int(value) & 0xFF)
+        if conversion == "u":
+            value = int(value) & 0xFFFFFFFF
+            conversion = "d"
+        return ("%" + flags + conversion) % int(value)
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode_record(data, formats):
+    timestamp, format_id, level, length = struct.unpack_from("<IHBB", data)
+    args = parse_args(data[8:8 + length])
+    if format_id < len(formats):
+        message = format_message(formats[format_id][1], args)
+    else:
+        message = "unknown format %u %r" % (format_id, args)
+    level_char = LEVEL_CHARS[level] if level < len(LEVEL_CHARS) else "-"
+    return "%s [%u.%03u] %s" % (level_char, timestamp // 1000, timestamp % 1000, message)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("--formats", default=DEFAULT_FORMATS,
+                        help="LogFormats.h of the firmware (default: %(default)s)")
+    parser.add_argument("--only", action="store_true",
+                        help="print decoded records only")
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+    if not formats:
+        sys.exit("no formats found in %s" % args.formats)
+
+    source = open(args.log, errors="replace") if args.log else sys.stdin
+    bad = 0
+    for line in source:
+        # Other output can end up on the same line as a record
+        start = line.find("LOG ")
+        if start < 0:
+            if not args.only:
+                sys.stdout.write(line)
+            continue
+
+        if start > 0 and not args.only:
+            print(line[:start])
+        try:
+            print(decode_record(binascii.unhexlify(line[start + 4:].strip()), formats))
+        except (binascii.Error, ValueError, struct.error):
+            bad += 1
+
+    if bad:
+        print("%d undecodable LOG lines" % bad, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
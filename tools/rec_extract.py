@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Extract a B.R.A.V.O. sensor recording from a serial log.
+
+Reads a serial log containing the lines written while recording to serial
+('R') or dumping the flash recording ('d'):
+
+    REC <hex bytes>
+
+and writes the bytes to a .rec file for the replay tool. Other lines in the
+log are ignored, so a raw `pio device monitor` capture can be used directly.
+If the log holds several recordings, only the last one is written.
+
+Usage:
+    tools/rec_extract.py serial.log -o sensors.rec
+"""
+
+import argparse
+import binascii
+import struct
+import sys
+
+RECORDING_MAGIC = struct.pack("<I", 0x56525242)
+
+
+def extract(lines):
+    data = bytearray()
+    bad = 0
+
+    for line in lines:
+        # Log output can end up on the same line as a record
+        start = line.find("REC ")
+        if start < 0:
+            continue
+
+        text = line[start + 4:].strip()
+        try:
+            chunk = binascii.unhexlify(text)
+        except (binascii.Error, ValueError):
+            bad += 1
+            continue
+
+        # Each recording starts with its header in a line of its own
+        if chunk.startswith(RECORDING_MAGIC) and len(chunk) == 8:
+            data = bytearray()
+        data += chunk
+
+    return bytes(data), bad
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("-o", "--output", required=True, help="recording to write")
+    args = parser.parse_args()
+
+    source = open(args.input, errors="replace") if args.input else sys.stdin
+    with source:
+        data, bad = extract(source)
+
+    if not data.startswith(RECORDING_MAGIC):
+        sys.exit("no sensor recording found in log")
+
+    with open(args.output, "wb") as f:
+        f.write(data)
+
+    print("%d bytes written to %s" % (len(data), args.output), file=sys.stderr)
+    if bad:
+        print("warning: %d corrupt REC lines skipped" % bad, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
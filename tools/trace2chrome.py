@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Convert a B.R.A.V.O. trace dump to Chrome trace JSON.
+
+Reads a serial log (or BLE status notifications saved to a file) containing
+lines of the form
+
+    T <timestamp_us> <core> <B|E|I> <name> <arg>
+
+and writes a JSON file that can be opened in chrome://tracing or Perfetto.
+Other lines in the log are ignored, so a raw `pio device monitor` capture
+can be used directly.
+
+Usage:
+    tools/trace2chrome.py serial.log -o trace.json
+"""
+
+import argparse
+import json
+import sys
+
+WRAP_US = 1 << 32
+
+
+def parse_events(lines):
+    events = []
+    offset = 0
+    last = None
+
+    for line in lines:
+        parts = line.split()
+        if len(parts) != 6 or parts[0] != "T":
+            continue
+
+        try:
+            ts = int(parts[1])
+            core = int(parts[2])
+            arg = int(parts[5])
+        except ValueError:
+            continue
+
+        phase, name = parts[3], parts[4]
+
+        # The device clock is 32-bit microseconds and wraps every ~71 min
+        if last is not None and ts + offset < last - WRAP_US // 2:
+            offset += WRAP_US
+        ts += offset
+        last = ts
+
+        event = {"name": name, "ph": phase, "ts": ts, "pid": 1, "tid": core}
+        if phase == "I":
+            event["s"] = "t"
+            event["args"] = {"arg": arg}
+        events.append(event)
+
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", nargs="?", help="trace dump (default: stdin)")
+    parser.add_argument("-o", "--output", help="output JSON (default: stdout)")
+    args = parser.parse_args()
+
+    source = open(args.input) if args.input else sys.stdin
+    with source:
+        events = parse_events(source)
+
+    trace = {
+        "traceEvents": events,
+        "displayTimeUnit": "ms",
+        "metadata": {"source": "bravo-firmware"},
+    }
+    # Name the per-core tracks
+    for core in sorted({e["tid"] for e in events}):
+        events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": core,
+                       "args": {"name": "core %d" % core}})
+
+    output = open(args.output, "w") if args.output else sys.stdout
+    with output:
+        json.dump(trace, output)
+
+    print("%d events" % len(events), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()